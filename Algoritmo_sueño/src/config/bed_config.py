@@ -121,6 +121,13 @@ VALVE_SAFETY_PIN = 20       # Pin GPIO para relé de seguridad (corte general)
 # MQTT_TOPIC_STATE = "bed/sleep_state"
 # MQTT_TOPIC_HEALTH = "bed/health_alerts"
 
+# PULSERA VÍA GATEWAY (oib_ingest --shm)
+# --------------------------------------
+PULSERA_SHM_ENABLED = True            # Leer la pulsera de la memoria compartida del ingest
+PULSERA_SHM_NAME = "/oib_pulseras"    # Segmento POSIX que crea el ingest
+PULSERA_ID = None                     # Id de la pulsera (None = la primera que aparezca)
+PULSERA_MAX_AGE_S = 10                # Datos más viejos se consideran sin lectura
+
 # CONFIGURACIÓN DE LOGGING (Solo para debug, no persistencia)
 # ----------------------------------------------------------
 LOG_TO_CONSOLE = True
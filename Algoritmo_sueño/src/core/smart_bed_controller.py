@@ -15,6 +15,7 @@ from . import presence_detector
 from ..sensors.drivers import MMA
 from ..sensors.drivers import MAX30102
 from ..sensors.drivers import HTU21D
+from ..sensors.drivers import Pulsera
 
 # Importar driver AHT10 para temperatura ambiente
 try:
@@ -51,36 +52,54 @@ class SmartBedController:
         Controlador inteligente para cama ortopédica con válvulas de agua
         Usa MAX30102 para monitoreo de HR y SpO2
         """
-        # Sensor MAX30102 para HR y SpO2
-        try:
-            self.max30102 = MAX30102.MAX30102(bed_config.I2C_MAX30102_ADDR)
+        # Pulsera vía el ingest del gateway (oib_ingest --shm): sus sensores
+        # reemplazan a los locales y se leen de memoria compartida, sin broker
+        self.pulsera = None
+        if bed_config.PULSERA_SHM_ENABLED:
+            try:
+                self.pulsera = Pulsera.PulseraShm(bed_config.PULSERA_SHM_NAME)
+                print(f"✅ Pulsera en memoria compartida: {self.pulsera.dispositivos() or 'esperando datos'}")
+            except Exception as e:
+                print(f"⚠️ Pulsera en memoria compartida no disponible: {e}")
+
+        if self.pulsera:
+            self.max30102 = Pulsera.MAX30102Pulsera(self.pulsera)
             self.max30102_available = True
-            print("✅ MAX30102 inicializado correctamente")
-        except Exception as e:
-            print(f"⚠️ MAX30102 no disponible: {e}")
-            self.max30102_available = False
-        
-        # Acelerómetro para detección de movimiento
-        try:
-            self.mma8452q = MMA.MMA8452Q()
+            self.mma8452q = Pulsera.MMA8452QPulsera(self.pulsera)
             self.activity_threshold = bed_config.ACCELEROMETER_ACTIVITY_THRESHOLD
-            print("✅ Acelerómetro MMA8452Q inicializado")
-        except Exception as e:
-            print(f"⚠️ Acelerómetro no disponible: {e}")
-            self.mma8452q = None
+            self.aht10 = Pulsera.AHT10Pulsera(self.pulsera)
+            self.aht10_available = True
+        else:
+            # Sensor MAX30102 para HR y SpO2
+            try:
+                self.max30102 = MAX30102.MAX30102(bed_config.I2C_MAX30102_ADDR)
+                self.max30102_available = True
+                print("✅ MAX30102 inicializado correctamente")
+            except Exception as e:
+                print(f"⚠️ MAX30102 no disponible: {e}")
+                self.max30102_available = False
         
-        # Sensor AHT10 para temperatura corporal (pulsera)
-        try:
-            if AHT10_AVAILABLE:
-                i2c = busio.I2C(board.SCL, board.SDA)
-                self.aht10 = adafruit_ahtx0.AHTx0(i2c)
-                self.aht10_available = True
-                print("✅ Sensor AHT10 (pulsera) inicializado correctamente")
-            else:
+            # Acelerómetro para detección de movimiento
+            try:
+                self.mma8452q = MMA.MMA8452Q()
+                self.activity_threshold = bed_config.ACCELEROMETER_ACTIVITY_THRESHOLD
+                print("✅ Acelerómetro MMA8452Q inicializado")
+            except Exception as e:
+                print(f"⚠️ Acelerómetro no disponible: {e}")
+                self.mma8452q = None
+        
+            # Sensor AHT10 para temperatura corporal (pulsera)
+            try:
+                if AHT10_AVAILABLE:
+                    i2c = busio.I2C(board.SCL, board.SDA)
+                    self.aht10 = adafruit_ahtx0.AHTx0(i2c)
+                    self.aht10_available = True
+                    print("✅ Sensor AHT10 (pulsera) inicializado correctamente")
+                else:
+                    self.aht10_available = False
+            except Exception as e:
+                print(f"⚠️ AHT10 (pulsera) no disponible: {e}")
                 self.aht10_available = False
-        except Exception as e:
-            print(f"⚠️ AHT10 (pulsera) no disponible: {e}")
-            self.aht10_available = False
         
         # Sensor HTU21D para temperatura de la cama
         try:
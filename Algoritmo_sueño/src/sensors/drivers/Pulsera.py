@@ -0,0 +1,278 @@
+#!/usr/bin/env python3
+"""
+Driver para la pulsera a través del ingest del gateway
+Lee lo que oib_ingest --shm deja en memoria compartida (/dev/shm/oib_pulseras,
+ver pulsera/gateway/shm_bridge.h): el último valor de cada tabla y un anillo
+con las últimas muestras de cada pulsera, sin pasar por el broker MQTT
+
+Cada pulsera se protege con un seqlock: se lee seq, los campos pedidos
+directo del mmap, seq_end y otra vez seq; si seq era impar o los tres no
+coinciden, el ingest estaba escribiendo y se vuelve a leer, cediendo el
+procesador mientras seq es impar. Tras REINTENTOS sin una lectura limpia (un
+ingest que murió a mitad de una escritura deja seq impar hasta que otro
+reinicia el segmento) la lectura da "sin datos", como una pulsera que no
+publicó. El lector nunca escribe en el segmento.
+
+Los adaptadores imitan la interfaz de los drivers locales (MAX30102, MMA8452Q
+y AHT10) para que SmartBedController los use sin cambios.
+"""
+
+import mmap
+import os
+import struct
+import time
+
+from ...config import bed_config
+
+# Tipos de registro (pulsera/gateway/record.h)
+VITALS = 1        # hr, spo2, dedo, etapa
+ENVIRONMENT = 2   # temperatura °C, humedad %RH
+PRESENCE = 3      # ocupada, confianza %, indicadores
+EPOCH = 4         # índice, etapa, etapa de reglas, hr, rmssd ms, actividad
+HEART = 16        # ir, bpm, bpm_avg, dedo
+ACCEL = 17        # x, y, z, magnitud (g)
+ALERT = 18        # tipo, activa, valor, umbral, seq
+PPG = 19          # ir, rojo (100 Hz)
+ACCEL_RAW = 20    # x, y, z (cuentas, 1 g = 1024)
+
+# Orden de ShmDevice::latest (SHM_KINDS)
+TIPOS = (VITALS, ENVIRONMENT, PRESENCE, EPOCH, HEART, ACCEL, ALERT, PPG, ACCEL_RAW)
+
+MAGIC = 0x5342494F  # "OIBS"
+VERSION = 1
+CABECERA = struct.Struct('<IHHIIIIQ32x')    # ShmHeader, 64 B
+ULTIMO = struct.Struct('<QQ6f')             # ShmLatest, 40 B
+MUESTRA = struct.Struct('<QIB3x4f')         # ShmSample, 32 B
+
+# Desplazamientos dentro de ShmDevice
+OFF_SEQ = 0
+OFF_ID = 8
+OFF_UPDATED = 32
+OFF_LATEST = 48
+OFF_RING_COUNT = OFF_LATEST + len(TIPOS) * ULTIMO.size
+OFF_RING = OFF_RING_COUNT + 8
+
+REINTENTOS = 1000
+CUENTAS_POR_G = 1024  # MMA8452Q a ±2 g, como read_accl()
+
+
+class PulseraShm:
+    """
+    Lector del segmento compartido del ingest
+    """
+
+    def __init__(self, nombre=None):
+        nombre = nombre or bed_config.PULSERA_SHM_NAME
+        fd = os.open('/dev/shm/' + nombre.lstrip('/'), os.O_RDONLY)
+        try:
+            self.m = mmap.mmap(fd, 0, mmap.MAP_SHARED, mmap.PROT_READ)
+        finally:
+            os.close(fd)
+        self.lugares = {}
+        self.creado = None
+        self.leer_cabecera()
+
+    def leer_cabecera(self):
+        """
+        Validar la cabecera; si el ingest se reinició, olvidar los lugares
+        """
+        (magic, version, header_size, max_devices, device_size, ring_size,
+         devices, created_ns) = CABECERA.unpack_from(self.m, 0)
+        if magic != MAGIC or version != VERSION:
+            raise RuntimeError("Memoria compartida de la pulsera no inicializada")
+        if created_ns != self.creado:
+            self.lugares = {}
+            self.creado = created_ns
+        self.header_size = header_size
+        self.max_devices = max_devices
+        self.device_size = device_size
+        self.ring_size = ring_size
+        return min(devices, max_devices)
+
+    def leer_consistente(self, lugar, leer):
+        """
+        Ejecutar leer(base) dentro del seqlock de la pulsera; None si no se
+        consiguió una lectura limpia
+        """
+        base = self.header_size + lugar * self.device_size
+        fin = base + self.device_size - 8  # seq_end
+        for _ in range(REINTENTOS):
+            s1 = struct.unpack_from('<I', self.m, base + OFF_SEQ)[0]
+            if s1 & 1:
+                time.sleep(0)
+                continue
+            valor = leer(base)
+            s2 = struct.unpack_from('<I', self.m, fin)[0]
+            s3 = struct.unpack_from('<I', self.m, base + OFF_SEQ)[0]
+            if s1 == s2 == s3:
+                return valor
+        return None
+
+    def dispositivos(self):
+        """
+        Ids de las pulseras que publicó el ingest, en orden de aparición
+        """
+        ids = []
+        for lugar in range(self.leer_cabecera()):
+            def leer_id(base):
+                crudo = self.m[base + OFF_ID:base + OFF_ID + 24]
+                return crudo.split(b'\0', 1)[0].decode()
+            pulsera = self.leer_consistente(lugar, leer_id)
+            if pulsera:
+                self.lugares[pulsera] = lugar
+                ids.append(pulsera)
+        return ids
+
+    def lugar(self, pulsera):
+        self.leer_cabecera()
+        if pulsera not in self.lugares:
+            self.dispositivos()
+        return self.lugares.get(pulsera)
+
+    def ultimo(self, pulsera, tipo):
+        """
+        Último registro de una tabla: (sample_ms, recv_ms, valores) o None
+        """
+        lugar = self.lugar(pulsera)
+        if lugar is None:
+            return None
+        k = TIPOS.index(tipo)
+
+        def leer(base):
+            return ULTIMO.unpack_from(self.m, base + OFF_LATEST + k * ULTIMO.size)
+
+        d = self.leer_consistente(lugar, leer)
+        if d is None or d[0] == 0:
+            return None
+        return d[0], d[1], d[2:]
+
+    def muestras(self, pulsera, tipo=None, desde_ms=0):
+        """
+        Muestras del anillo (las últimas ring_size), de la más vieja a la más
+        nueva: lista de (sample_ms, seq, tipo, valores)
+        """
+        lugar = self.lugar(pulsera)
+        if lugar is None:
+            return []
+
+        def leer(base):
+            total = struct.unpack_from('<Q', self.m, base + OFF_RING_COUNT)[0]
+            n = min(total, self.ring_size)
+            primera = (total - n) % self.ring_size
+            filas = []
+            for i in range(n):
+                j = (primera + i) % self.ring_size
+                filas.append(MUESTRA.unpack_from(self.m, base + OFF_RING + j * MUESTRA.size))
+            return filas
+
+        filas = self.leer_consistente(lugar, leer) or []
+        return [(f[0], f[1], f[2], f[3:]) for f in filas
+                if (tipo is None or f[2] == tipo) and f[0] >= desde_ms]
+
+    def cerrar(self):
+        self.m.close()
+
+
+class AdaptadorPulsera:
+    """
+    Base de los adaptadores: una pulsera y una edad máxima de los datos
+    """
+
+    def __init__(self, shm, pulsera=None, max_edad_s=None):
+        self.shm = shm
+        self.pulsera = pulsera or bed_config.PULSERA_ID
+        self.max_edad_s = max_edad_s if max_edad_s is not None else bed_config.PULSERA_MAX_AGE_S
+
+    def reciente(self, tipo):
+        """
+        Último registro del tipo (sample_ms, recv_ms, valores), o None si no
+        hay o es viejo
+        """
+        if self.pulsera is None:
+            ids = self.shm.dispositivos()
+            if not ids:
+                return None
+            self.pulsera = ids[0]
+        d = self.shm.ultimo(self.pulsera, tipo)
+        if d is None:
+            return None
+        if self.max_edad_s and time.time() * 1000 - d[1] > self.max_edad_s * 1000:
+            return None
+        return d
+
+    def fresco(self, tipo):
+        d = self.reciente(tipo)
+        return d[2] if d else None
+
+    def cleanup(self):
+        pass
+
+
+class MAX30102Pulsera(AdaptadorPulsera):
+    """
+    HR y SpO2 calculados en la pulsera, con la interfaz de MAX30102
+    """
+
+    def update(self):
+        vitales = self.fresco(VITALS)
+        if vitales is None:
+            raise RuntimeError("Sin vitales recientes de la pulsera")
+        ambiente = self.fresco(ENVIRONMENT)
+        hr, spo2, dedo = vitales[0], vitales[1], vitales[2]
+        return {
+            'heart_rate': int(round(hr)),
+            'spo2': int(round(spo2)),
+            'valid_hr': dedo > 0 and hr > 0,
+            'valid_spo2': dedo > 0 and spo2 > 0,
+            'temperature': ambiente[0] if ambiente else 22.0
+        }
+
+    def get_heart_rate(self):
+        data = self.update()
+        return data['heart_rate'] if data['valid_hr'] else 60  # Valor por defecto
+
+    def get_spo2(self):
+        data = self.update()
+        return data['spo2'] if data['valid_spo2'] else 98  # Valor por defecto
+
+    def is_finger_present(self):
+        vitales = self.fresco(VITALS)
+        return bool(vitales and vitales[2] > 0)
+
+
+class MMA8452QPulsera(AdaptadorPulsera):
+    """
+    Acelerómetro de la pulsera, en cuentas como MMA8452Q.read_accl()
+    """
+
+    def read_accl(self):
+        # Lo más nuevo entre la lectura periódica (g) y las capturas (cuentas)
+        g = self.reciente(ACCEL)
+        crudo = self.reciente(ACCEL_RAW)
+        if crudo and (g is None or crudo[0] > g[0]):
+            x, y, z = crudo[2][:3]
+            return {'x': x, 'y': y, 'z': z}
+        if g is None:
+            raise RuntimeError("Sin acelerómetro reciente de la pulsera")
+        x, y, z = g[2][:3]
+        return {'x': x * CUENTAS_POR_G, 'y': y * CUENTAS_POR_G, 'z': z * CUENTAS_POR_G}
+
+
+class AHT10Pulsera(AdaptadorPulsera):
+    """
+    Temperatura de la pulsera (HTU21D), con la interfaz de adafruit_ahtx0
+    """
+
+    @property
+    def temperature(self):
+        ambiente = self.fresco(ENVIRONMENT)
+        if ambiente is None:
+            raise RuntimeError("Sin temperatura reciente de la pulsera")
+        return ambiente[0]
+
+    @property
+    def relative_humidity(self):
+        ambiente = self.fresco(ENVIRONMENT)
+        if ambiente is None:
+            raise RuntimeError("Sin humedad reciente de la pulsera")
+        return ambiente[1]
@@ -0,0 +1,460 @@
+/*
+ * oib_ingest: ingesta de la telemetría de las pulseras en la Raspberry
+ *
+ * Reemplaza la lectura en el lazo de 2 s del controlador en Python: se
+ * suscribe a oib/+/sensores/#, decodifica las tramas binarias y los JSON
+ * heredados, valida la secuencia de cada pulsera y guarda los registros en
+ * un archivo por pulsera y noche (night_file.h), con sus resúmenes a 1 s,
+ * 30 s y 5 min al lado (rollup.h). La fuente reparte las pulseras entre
+ * trabajadores fijos, cada uno con su cola sin locks (ingest_pool.h):
+ *
+ *   fuente (broker o registro de la simulación)
+ *     -> cola del trabajador de la pulsera -> trabajador
+ *        (decodificar, secuencia, archivo de noche)
+ *
+ * Cada trabajador arma los bloques del archivo de noche en memoria: una
+ * caída pierde lo que esperaba en ellos, a lo sumo NIGHT_CHUNK_MAX_MS de
+ * llegadas.
+ *
+ * Con --log lee un registro de la simulación (sim --mqtt-log) y --copias N
+ * lo reparte entre N pulseras (oib/<id>-k/...): a máxima velocidad mide el
+ * techo sin broker; con --velocidad X lo reproduce X veces más rápido que
+ * en la simulación y mide la latencia de cada trabajador. --lenta ID demora
+ * cada mensaje de esa pulsera --lenta-us µs para ver a quién afecta.
+ *
+ * Con --shm publica además el último estado de cada pulsera en memoria
+ * compartida (shm_bridge.h) para el controlador de la cama en Python.
+ *
+ * Con --metricas PUERTO (o una ruta de socket Unix) expone los contadores e
+ * histogramas en formato Prometheus (metrics_server.h): por trabajador y
+ * por pulsera, mensajes, errores de decodificación, huecos de secuencia,
+ * cola, y la latencia en partes (de la pulsera a la llegada, en la cola,
+ * decodificando y guardando) para ver si el atraso es del broker o nuestro.
+ *
+ *   pio run -e gateway_ingest
+ *   .pio/build/gateway_ingest/program --broker localhost --dir /var/lib/oib --shm \
+ *       --metricas 9101
+ *   curl -s localhost:9101/metrics
+ *   .pio/build/gateway_ingest/program --log noche.jsonl --copias 64 --trabajadores 4
+ */
+
+#include <signal.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ingest_pool.h"
+#include "log_source.h"
+#include "metrics_server.h"
+#include "mqtt_socket.h"
+
+struct Opciones {
+  std::string broker;
+  uint16_t puerto = 1883;
+  std::string usuario;
+  std::string password;
+  std::string topico = "oib/+/sensores/#";
+  std::string log;
+  uint32_t copias = 1;
+  double velocidad = 0;  // 0 = máxima
+  std::string dir;
+  uint32_t trabajadores = 4;
+  size_t cola = 4096;
+  std::string lenta;
+  uint32_t lenta_us = 20000;
+  std::string shm;  // vacío = sin puente
+  std::string metricas;  // vacío = sin servidor de métricas
+  double informe_s = 10;
+};
+
+struct Contadores {
+  std::atomic<uint64_t> mensajes{0};
+  std::atomic<uint64_t> bytes{0};
+};
+
+struct Publicacion {
+  double t_ms;
+  Message m;
+};
+
+static std::atomic<bool> terminar{false};
+
+static void al_terminar(int) { terminar = true; }
+
+static uint64_t hora_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+static void informe(FILE* out, const IngestPool& pool, const Contadores& c, double s,
+                    bool final) {
+  uint64_t decodificados = 0, ignorados = pool.ignored(), errores = 0, registros = 0;
+  uint64_t huecos = 0, duplicados = 0, reordenados = 0, reinicios = 0;
+  uint64_t bytes = 0, guardados = 0, resumenes = 0;
+  uint32_t pulseras = 0, noches = 0;
+  for (size_t i = 0; i < pool.workers(); i++) {
+    const WorkerStats& w = pool.stats(i);
+    decodificados += w.decodificados;
+    ignorados += w.ignorados;
+    errores += w.errores;
+    registros += w.registros;
+    huecos += w.huecos;
+    duplicados += w.duplicados;
+    reordenados += w.reordenados;
+    reinicios += w.reinicios;
+    bytes += w.bytes_disco;
+    guardados += w.registros_disco;
+    resumenes += w.bytes_resumen;
+    pulseras += w.pulseras;
+    noches += w.noches;
+  }
+  uint64_t mensajes = c.mensajes;
+  fprintf(out,
+          "%s%llu mensajes (%.0f msg/s, %.2f MB/s) | decodificados %llu | ignorados %llu | "
+          "errores %llu\n",
+          final ? "\nIngesta: " : "", (unsigned long long)mensajes, mensajes / s,
+          c.bytes / s / 1e6, (unsigned long long)decodificados, (unsigned long long)ignorados,
+          (unsigned long long)errores);
+  fprintf(out,
+          "  %u pulseras | %llu registros | secuencia: huecos %llu, duplicados %llu, "
+          "reordenados %llu, reinicios %llu\n",
+          pulseras, (unsigned long long)registros, (unsigned long long)huecos,
+          (unsigned long long)duplicados, (unsigned long long)reordenados,
+          (unsigned long long)reinicios);
+  if (guardados) {
+    fprintf(out, "  disco: %.2f MB en %u noches (%.1f B/registro), resúmenes %.2f MB\n",
+            bytes / 1e6, noches, (double)bytes / guardados, resumenes / 1e6);
+  }
+  for (size_t i = 0; i < pool.workers(); i++) {
+    const WorkerStats& w = pool.stats(i);
+    fprintf(out,
+            "  t%zu: %u pulseras, %llu msg | cola %zu (máx %llu/%zu, llena %llu) | "
+            "latencia p50 %.2f ms, p99 %.2f ms, máx %.2f ms\n",
+            i, w.pulseras.load(), (unsigned long long)w.mensajes.load(), pool.queueSize(i),
+            (unsigned long long)w.cola_max.load(), pool.queueCapacity(i),
+            (unsigned long long)w.llena.load(), w.latencia.percentile(0.50) / 1000.0,
+            w.latencia.percentile(0.99) / 1000.0, w.latencia.max() / 1000.0);
+  }
+  fflush(out);
+}
+
+// Mensajes por segundo de una pulsera entre dos lecturas de las métricas
+// separadas por al menos 1 s; lo usa sólo el hilo del servidor
+struct Ritmo {
+  uint64_t mensajes = 0;
+  double t = 0;
+  double por_segundo = 0;
+};
+
+static void metricas(const IngestPool& pool, const Contadores& c, double s,
+                     std::unordered_map<std::string, Ritmo>& ritmos, MetricsText& out) {
+  out.family("oib_ingest_segundos", "gauge", "Segundos desde que arrancó la ingesta");
+  out.sample("oib_ingest_segundos", "", s);
+  out.family("oib_ingest_fuente_mensajes_total", "counter",
+             "Mensajes recibidos del broker o del registro");
+  out.sample("oib_ingest_fuente_mensajes_total", "", c.mensajes);
+  out.family("oib_ingest_fuente_bytes_total", "counter", "Bytes de tópico y payload recibidos");
+  out.sample("oib_ingest_fuente_bytes_total", "", c.bytes);
+  out.family("oib_ingest_fuera_de_pulsera_total", "counter",
+             "Mensajes con un tópico que no es de una pulsera");
+  out.sample("oib_ingest_fuera_de_pulsera_total", "", pool.ignored());
+
+  // Por trabajador
+  std::vector<std::string> trabajador;
+  for (size_t i = 0; i < pool.workers(); i++) {
+    trabajador.push_back(MetricsText::label("trabajador", std::to_string(i)));
+  }
+  auto contador = [&](const char* nombre, const char* tipo, const char* ayuda,
+                      double (*valor)(const IngestPool&, size_t)) {
+    out.family(nombre, tipo, ayuda);
+    for (size_t i = 0; i < pool.workers(); i++) out.sample(nombre, trabajador[i], valor(pool, i));
+  };
+  contador("oib_ingest_mensajes_total", "counter", "Mensajes procesados",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).mensajes; });
+  contador("oib_ingest_decodificados_total", "counter", "Mensajes decodificados",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).decodificados; });
+  contador("oib_ingest_ignorados_total", "counter", "Mensajes de tópicos que no se guardan",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).ignorados; });
+  contador("oib_ingest_errores_decodificacion_total", "counter",
+           "Mensajes que no se pudieron decodificar",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).errores; });
+  contador("oib_ingest_registros_total", "counter", "Registros guardados",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).registros; });
+  contador("oib_ingest_huecos_total", "counter", "Números de secuencia que faltaron",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).huecos; });
+  contador("oib_ingest_duplicados_total", "counter", "Mensajes con secuencia repetida",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).duplicados; });
+  contador("oib_ingest_reordenados_total", "counter", "Mensajes llegados fuera de orden",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).reordenados; });
+  contador("oib_ingest_reinicios_total", "counter", "Reinicios de la secuencia de una pulsera",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).reinicios; });
+  contador("oib_ingest_cola_mensajes", "gauge", "Mensajes esperando en la cola del trabajador",
+           [](const IngestPool& p, size_t i) { return (double)p.queueSize(i); });
+  contador("oib_ingest_cola_maxima", "gauge", "Mayor largo visto de la cola",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).cola_max; });
+  contador("oib_ingest_cola_capacidad", "gauge", "Capacidad de la cola",
+           [](const IngestPool& p, size_t i) { return (double)p.queueCapacity(i); });
+  contador("oib_ingest_cola_llena_total", "counter",
+           "Veces que la fuente esperó con la cola llena",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).llena; });
+  contador("oib_ingest_pulseras", "gauge", "Pulseras del trabajador",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).pulseras; });
+  contador("oib_ingest_disco_bytes", "gauge", "Bytes de los archivos de noche",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).bytes_disco; });
+  contador("oib_ingest_resumen_bytes", "gauge", "Bytes de los archivos de resúmenes",
+           [](const IngestPool& p, size_t i) { return (double)p.stats(i).bytes_resumen; });
+
+  struct Histograma {
+    const char* nombre;
+    const char* ayuda;
+    const LatencyHistogram WorkerStats::*h;
+  };
+  static const Histograma HISTOGRAMAS[] = {
+      {"oib_ingest_latencia_segundos", "De encolado a guardado",
+       &WorkerStats::latencia},
+      {"oib_ingest_espera_segundos", "En la cola del trabajador", &WorkerStats::espera},
+      {"oib_ingest_proceso_segundos", "Decodificando y guardando un mensaje",
+       &WorkerStats::proceso},
+      {"oib_ingest_llegada_segundos", "De la muestra en la pulsera a la llegada al gateway",
+       &WorkerStats::llegada},
+  };
+  for (const Histograma& h : HISTOGRAMAS) {
+    out.family(h.nombre, "histogram", h.ayuda);
+    for (size_t i = 0; i < pool.workers(); i++) {
+      out.histogram(h.nombre, trabajador[i], pool.stats(i).*h.h);
+    }
+  }
+
+  // Por pulsera
+  std::vector<std::pair<std::string, const DeviceStats*>> pulseras;
+  for (size_t i = 0; i < pool.workers(); i++) {
+    for (size_t k = 0; k < pool.listedDevices(i); k++) {
+      const DeviceStats& d = pool.stats(i).por_pulsera[k];
+      pulseras.push_back({MetricsText::label("pulsera", d.id) + "," + trabajador[i], &d});
+    }
+  }
+  auto por_pulsera = [&](const char* nombre, const char* tipo, const char* ayuda,
+                         double (*valor)(const DeviceStats&)) {
+    out.family(nombre, tipo, ayuda);
+    for (const auto& p : pulseras) out.sample(nombre, p.first, valor(*p.second));
+  };
+  por_pulsera("oib_ingest_pulsera_mensajes_total", "counter", "Mensajes de la pulsera",
+              [](const DeviceStats& d) { return (double)d.mensajes; });
+  out.family("oib_ingest_pulsera_mensajes_por_segundo", "gauge",
+             "Mensajes por segundo desde la lectura anterior de las métricas");
+  for (const auto& p : pulseras) {
+    Ritmo& r = ritmos[p.second->id];
+    uint64_t n = p.second->mensajes;
+    if (s - r.t >= 1) {
+      r.por_segundo = (n - r.mensajes) / (s - r.t);
+      r.mensajes = n;
+      r.t = s;
+    }
+    out.sample("oib_ingest_pulsera_mensajes_por_segundo", p.first, r.por_segundo);
+  }
+  por_pulsera("oib_ingest_pulsera_registros_total", "counter", "Registros guardados",
+              [](const DeviceStats& d) { return (double)d.registros; });
+  por_pulsera("oib_ingest_pulsera_errores_decodificacion_total", "counter",
+              "Mensajes que no se pudieron decodificar",
+              [](const DeviceStats& d) { return (double)d.errores; });
+  por_pulsera("oib_ingest_pulsera_huecos_total", "counter", "Números de secuencia que faltaron",
+              [](const DeviceStats& d) { return (double)d.huecos; });
+  por_pulsera("oib_ingest_pulsera_duplicados_total", "counter", "Mensajes con secuencia repetida",
+              [](const DeviceStats& d) { return (double)d.duplicados; });
+  por_pulsera("oib_ingest_pulsera_ultimo_mensaje_segundos", "gauge",
+              "Hora de llegada del último mensaje (epoch)",
+              [](const DeviceStats& d) { return d.ultimo_ms / 1000.0; });
+}
+
+static void encolar(IngestPool& pool, Contadores& c, Message&& m) {
+  c.mensajes++;
+  c.bytes += m.topic.size() + m.payload.size();
+  pool.submit(std::move(m));
+}
+
+// El registro entero en memoria: la lectura del archivo no entra en la medición
+static bool cargar_log(const std::string& ruta, std::vector<Publicacion>& publicaciones) {
+  LogSource log;
+  if (!log.open(ruta)) return false;
+  Publicacion p;
+  bool retenido;
+  while (log.next(p.m, p.t_ms, retenido)) publicaciones.push_back(p);
+  if (log.badLines()) {
+    fprintf(stderr, "%llu líneas descartadas\n", (unsigned long long)log.badLines());
+  }
+  return true;
+}
+
+// Cada mensaje de una pulsera sale para N pulseras, a máxima velocidad o
+// al ritmo de la simulación multiplicado por velocidad
+static void desde_log(const Opciones& o, const std::vector<Publicacion>& publicaciones,
+                      IngestPool& pool, Contadores& c) {
+  auto inicio = std::chrono::steady_clock::now();
+  double t0 = publicaciones.empty() ? 0 : publicaciones.front().t_ms;
+  for (const Publicacion& p : publicaciones) {
+    if (o.velocidad > 0) {
+      std::this_thread::sleep_until(
+          inicio + std::chrono::microseconds((int64_t)((p.t_ms - t0) * 1000 / o.velocidad)));
+    }
+    std::string dispositivo;
+    const char* sufijo;
+    bool propio = splitTopic(p.m.topic, dispositivo, sufijo);
+    for (uint32_t k = 0; k < (propio ? o.copias : 1); k++) {
+      Message copia = p.m;
+      if (k > 0) copia.topic = "oib/" + dispositivo + "-" + std::to_string(k) + "/" + sufijo;
+      encolar(pool, c, std::move(copia));
+    }
+    if (terminar) return;
+  }
+}
+
+static void desde_broker(const Opciones& o, IngestPool& pool, Contadores& c) {
+  MqttSocket mqtt;
+  auto al_recibir = [&](std::string&& topico, std::string&& payload) {
+    Message m;
+    m.topic = std::move(topico);
+    m.payload = std::move(payload);
+    m.recv_ms = hora_ms();
+    encolar(pool, c, std::move(m));
+  };
+  while (!terminar) {
+    if (!mqtt.connected()) {
+      if (!mqtt.connect(o.broker, o.puerto, "oib-ingest", o.usuario, o.password) ||
+          !mqtt.subscribe(o.topico, 0)) {
+        fprintf(stderr, "Sin conexión con %s:%u, reintento en 2 s\n", o.broker.c_str(), o.puerto);
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        continue;
+      }
+      printf("Suscripto a %s en %s:%u\n", o.topico.c_str(), o.broker.c_str(), o.puerto);
+    }
+    mqtt.poll(200, al_recibir);
+  }
+}
+
+int main(int argc, char** argv) {
+  Opciones o;
+  for (int i = 1; i < argc; i++) {
+    bool hay = i + 1 < argc;
+    if (!strcmp(argv[i], "--broker") && hay) {
+      o.broker = argv[++i];
+    } else if (!strcmp(argv[i], "--puerto") && hay) {
+      o.puerto = (uint16_t)atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--usuario") && hay) {
+      o.usuario = argv[++i];
+    } else if (!strcmp(argv[i], "--password") && hay) {
+      o.password = argv[++i];
+    } else if (!strcmp(argv[i], "--topico") && hay) {
+      o.topico = argv[++i];
+    } else if (!strcmp(argv[i], "--log") && hay) {
+      o.log = argv[++i];
+    } else if (!strcmp(argv[i], "--copias") && hay) {
+      o.copias = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--velocidad") && hay) {
+      o.velocidad = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--dir") && hay) {
+      o.dir = argv[++i];
+    } else if (!strcmp(argv[i], "--trabajadores") && hay) {
+      o.trabajadores = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--cola") && hay) {
+      o.cola = std::max(2, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--lenta") && hay) {
+      o.lenta = argv[++i];
+    } else if (!strcmp(argv[i], "--lenta-us") && hay) {
+      o.lenta_us = std::max(0, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--shm")) {
+      o.shm = OIB_SHM_NAME;
+    } else if (!strcmp(argv[i], "--shm-nombre") && hay) {
+      o.shm = argv[++i];
+    } else if (!strcmp(argv[i], "--metricas") && hay) {
+      o.metricas = argv[++i];
+    } else if (!strcmp(argv[i], "--informe") && hay) {
+      o.informe_s = atof(argv[++i]);
+    } else {
+      o.broker.clear();
+      o.log.clear();
+      break;
+    }
+  }
+  if (o.broker.empty() == o.log.empty()) {
+    fprintf(stderr,
+            "uso: %s (--broker HOST | --log ARCHIVO) [--puerto N] [--usuario U] [--password P]\n"
+            "          [--topico FILTRO] [--dir DIR] [--trabajadores N] [--cola N]\n"
+            "          [--copias N] [--velocidad X] [--lenta ID] [--lenta-us N] [--informe S]\n"
+            "          [--shm] [--shm-nombre /NOMBRE] [--metricas [HOST:]PUERTO|RUTA]\n",
+            argv[0]);
+    return 1;
+  }
+
+  std::vector<Publicacion> registro;
+  if (!o.log.empty() && !cargar_log(o.log, registro)) {
+    fprintf(stderr, "No se pudo abrir %s\n", o.log.c_str());
+    return 1;
+  }
+
+  signal(SIGINT, al_terminar);
+  signal(SIGTERM, al_terminar);
+
+  IngestPool pool(o.trabajadores, o.cola, o.dir);
+  if (!o.lenta.empty()) pool.setSlowDevice(o.lenta, o.lenta_us);
+  ShmBridge puente;
+  if (!o.shm.empty()) {
+    if (!puente.open(o.shm.c_str())) {
+      fprintf(stderr, "No se pudo abrir la memoria compartida %s: %s\n", o.shm.c_str(),
+              errno == EWOULDBLOCK ? "la está usando otro oib_ingest" : strerror(errno));
+      return 1;
+    }
+    printf("Memoria compartida %s (%.1f MB)\n", o.shm.c_str(), puente.segmentSize() / 1e6);
+    pool.setShmBridge(&puente);
+  }
+  Contadores contadores;
+  pool.start();
+  auto inicio = std::chrono::steady_clock::now();
+  auto segundos = [&] {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+  };
+
+  MetricsServer servidor;
+  std::unordered_map<std::string, Ritmo> ritmos;
+  if (!o.metricas.empty()) {
+    if (!servidor.listen(o.metricas)) {
+      fprintf(stderr, "No se pudo escuchar en %s para las métricas\n", o.metricas.c_str());
+      return 1;
+    }
+    servidor.start([&](MetricsText& out) { metricas(pool, contadores, segundos(), ritmos, out); });
+    printf("Métricas en %s\n", o.metricas.c_str());
+  }
+
+  // El informe periódico corre aparte: lee métricas atómicas, no frena a nadie
+  std::atomic<bool> listo{false};
+  std::thread informes([&] {
+    auto periodo = std::chrono::milliseconds((int64_t)(o.informe_s * 1000));
+    auto siguiente = inicio + periodo;
+    while (!listo && o.informe_s > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      if (std::chrono::steady_clock::now() < siguiente) continue;
+      informe(stdout, pool, contadores, segundos(), false);
+      siguiente += periodo;
+    }
+  });
+
+  if (!o.log.empty()) desde_log(o, registro, pool, contadores);
+  else desde_broker(o, pool, contadores);
+
+  pool.stop();
+  servidor.stop();
+  double s = segundos();
+  listo = true;
+  informes.join();
+  informe(stdout, pool, contadores, s, true);
+  return 0;
+}
@@ -0,0 +1,229 @@
+#include "ingest_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "payload_decoder.h"
+
+// Espera de un trabajador sin mensajes: unas vueltas cediendo el CPU y
+// después de a ESPERA_US, para no quemar un núcleo de la Raspberry
+static const uint32_t VUELTAS_ANTES_DE_DORMIR = 16;
+static const uint32_t ESPERA_US = 100;
+static const uint32_t MENSAJES_ENTRE_RELOJ = 256;
+
+static uint64_t reloj_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static void guardar_maximo(std::atomic<uint64_t>& maximo, uint64_t v) {
+  if (v > maximo.load(std::memory_order_relaxed)) maximo.store(v, std::memory_order_relaxed);
+}
+
+IngestPool::IngestPool(uint32_t workers, size_t queue_capacity, const std::string& d) : dir(d) {
+  for (uint32_t i = 0; i < (workers ? workers : 1); i++) {
+    trabajadores.emplace_back(new Trabajador(queue_capacity));
+  }
+}
+
+void IngestPool::setSlowDevice(const std::string& device, uint32_t us) {
+  lenta = device;
+  lenta_us = us;
+}
+
+uint32_t IngestPool::workerFor(const std::string& device, uint32_t workers) {
+  uint32_t h = 2166136261u;  // FNV-1a
+  for (char c : device) {
+    h ^= (uint8_t)c;
+    h *= 16777619u;
+  }
+  return h % workers;
+}
+
+void IngestPool::start() {
+  if (corriendo) return;
+  cerrando = false;
+  corriendo = true;
+  for (auto& t : trabajadores) t->hilo = std::thread(&IngestPool::run, this, std::ref(*t));
+}
+
+bool IngestPool::submit(Message&& m) {
+  std::string dispositivo;
+  const char* sufijo;
+  if (!splitTopic(m.topic, dispositivo, sufijo)) {
+    ignorados.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  Trabajador& t = *trabajadores[workerFor(dispositivo, trabajadores.size())];
+  Entrada e;
+  e.m = std::move(m);
+  e.encolado_ns = reloj_ns();
+  if (!t.cola.tryPush(e)) {
+    t.stats.llena.fetch_add(1, std::memory_order_relaxed);
+    do {
+      std::this_thread::sleep_for(std::chrono::microseconds(ESPERA_US));
+    } while (!t.cola.tryPush(e));
+  }
+  guardar_maximo(t.stats.cola_max, t.cola.size());
+  return true;
+}
+
+void IngestPool::stop() {
+  if (!corriendo) return;
+  cerrando = true;
+  for (auto& t : trabajadores) t->hilo.join();
+  corriendo = false;
+}
+
+void IngestPool::run(Trabajador& t) {
+  auto siguiente_sync = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  uint32_t vueltas = 0, desde_reloj = 0;
+  Entrada e;
+  for (;;) {
+    bool hay = t.cola.tryPop(e);
+    if (hay) {
+      procesar(t, e);
+      vueltas = 0;
+    } else if (cerrando.load(std::memory_order_acquire)) {
+      // La fuente ya no agrega: lo que quede en la cola es lo último
+      if (!t.cola.tryPop(e)) break;
+      procesar(t, e);
+      continue;
+    }
+
+    if (!hay || ++desde_reloj >= MENSAJES_ENTRE_RELOJ) {
+      desde_reloj = 0;
+      auto ahora = std::chrono::steady_clock::now();
+      if (ahora >= siguiente_sync) {
+        sincronizar(t);
+        siguiente_sync = ahora + std::chrono::seconds(1);
+      }
+    }
+    if (!hay) {
+      if (++vueltas < VUELTAS_ANTES_DE_DORMIR) std::this_thread::yield();
+      else std::this_thread::sleep_for(std::chrono::microseconds(ESPERA_US));
+    }
+  }
+  cerrar(t);
+}
+
+void IngestPool::procesar(Trabajador& t, Entrada& e) {
+  WorkerStats& s = t.stats;
+  uint64_t inicio_ns = reloj_ns();
+  s.espera.add((inicio_ns - e.encolado_ns) / 1000);
+  s.mensajes.fetch_add(1, std::memory_order_relaxed);
+  std::string id;
+  const char* sufijo;
+  splitTopic(e.m.topic, id, sufijo);
+
+  std::unique_ptr<Dispositivo>& d = t.dispositivos[id];
+  if (!d) {
+    d.reset(new Dispositivo());
+    uint32_t n = s.listadas.load(std::memory_order_relaxed);
+    if (n < INGEST_DEVICE_STATS) {
+      d->stats = &s.por_pulsera[n];
+      memset(d->stats->id, 0, sizeof(d->stats->id));
+      memcpy(d->stats->id, id.data(), std::min(id.size(), sizeof(d->stats->id) - 1));
+      s.listadas.store(n + 1, std::memory_order_release);
+    }
+    s.pulseras.store(t.dispositivos.size(), std::memory_order_relaxed);
+  }
+  DeviceStats* ds = d->stats;
+  if (ds) {
+    ds->mensajes.fetch_add(1, std::memory_order_relaxed);
+    ds->ultimo_ms.store(e.m.recv_ms, std::memory_order_relaxed);
+  }
+
+  t.registros.clear();
+  DecodeResult r = decodeMessage(sufijo, e.m, t.registros);
+  if (r == DECODE_IGNORED) s.ignorados.fetch_add(1, std::memory_order_relaxed);
+  if (r == DECODE_ERROR) {
+    s.errores.fetch_add(1, std::memory_order_relaxed);
+    if (ds) ds->errores.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (r != DECODE_OK) return;
+  s.decodificados.fetch_add(1, std::memory_order_relaxed);
+
+  if (!d->abierto) {
+    d->abierto = true;
+    if (!dir.empty() && !d->archivo.open(dir, id)) {
+      fprintf(stderr, "No se pudo abrir el archivo de %s en %s\n", id.c_str(), dir.c_str());
+    }
+    if (puente) d->lugar_shm = puente->claim(id);
+  }
+  if (lenta_us && id == lenta) std::this_thread::sleep_for(std::chrono::microseconds(lenta_us));
+
+  // Los que pasan quedan al principio de t.registros, para el puente
+  size_t guardados = 0;
+  for (const Record& rec : t.registros) {
+    if (rec.seq_space < SEQ_SPACES) {
+      SeqTracker::Result r = d->secuencia[rec.seq_space].observe(rec.seq);
+      if (r == SeqTracker::SEQ_DUPLICATE) continue;
+      if (r == SeqTracker::SEQ_RESET) d->alertas.forget();
+    }
+    if (rec.kind == RECORD_TRACE_ONLY) continue;
+    if (rec.kind == RECORD_ALERT &&
+        !d->alertas.first((uint32_t)rec.v[4], (uint8_t)rec.v[0], rec.v[1] != 0, rec.sample_ms)) {
+      continue;
+    }
+    if (rec.recv_ms > t.llegada_ms) t.llegada_ms = rec.recv_ms;
+    if (!dir.empty()) d->archivo.append(rec);
+    t.registros[guardados++] = rec;
+  }
+  if (puente) puente->publish(d->lugar_shm, t.registros.data(), guardados);
+  s.registros.fetch_add(guardados, std::memory_order_relaxed);
+  if (ds) ds->registros.fetch_add(guardados, std::memory_order_relaxed);
+  // Una por mensaje: los registros de un mensaje salen de la misma muestra
+  if (guardados && t.registros[0].sample_ms) {
+    uint64_t muestra = t.registros[0].sample_ms;
+    s.llegada.add(e.m.recv_ms > muestra ? (e.m.recv_ms - muestra) * 1000 : 0);
+  }
+  uint64_t fin_ns = reloj_ns();
+  s.proceso.add((fin_ns - inicio_ns) / 1000);
+  s.latencia.add((fin_ns - e.encolado_ns) / 1000);
+}
+
+void IngestPool::sincronizar(Trabajador& t) {
+  uint64_t huecos = 0, duplicados = 0, reordenados = 0, reinicios = 0;
+  uint64_t bytes = 0, registros = 0, bytes_resumen = 0;
+  uint32_t noches = 0;
+  for (auto& par : t.dispositivos) {
+    Dispositivo& d = *par.second;
+    uint64_t huecos_d = 0, duplicados_d = 0;
+    for (const SeqTracker& sec : d.secuencia) {
+      huecos_d += sec.gaps();
+      duplicados_d += sec.duplicates();
+      reordenados += sec.reordered();
+      reinicios += sec.resets();
+    }
+    duplicados_d += d.alertas.duplicates();
+    huecos += huecos_d;
+    duplicados += duplicados_d;
+    if (d.stats) {
+      d.stats->huecos.store(huecos_d, std::memory_order_relaxed);
+      d.stats->duplicados.store(duplicados_d, std::memory_order_relaxed);
+    }
+    if (!dir.empty()) d.archivo.sync(t.llegada_ms);
+    bytes += d.archivo.bytes();
+    registros += d.archivo.records();
+    bytes_resumen += d.archivo.rollupBytes();
+    noches += d.archivo.nights();
+  }
+  WorkerStats& s = t.stats;
+  s.huecos.store(huecos, std::memory_order_relaxed);
+  s.duplicados.store(duplicados, std::memory_order_relaxed);
+  s.reordenados.store(reordenados, std::memory_order_relaxed);
+  s.reinicios.store(reinicios, std::memory_order_relaxed);
+  s.bytes_disco.store(bytes, std::memory_order_relaxed);
+  s.registros_disco.store(registros, std::memory_order_relaxed);
+  s.bytes_resumen.store(bytes_resumen, std::memory_order_relaxed);
+  s.noches.store(noches, std::memory_order_relaxed);
+}
+
+void IngestPool::cerrar(Trabajador& t) {
+  for (auto& par : t.dispositivos) par.second->archivo.close();
+  sincronizar(t);
+}
@@ -0,0 +1,155 @@
+/*
+ * Trabajadores del ingest, con las pulseras repartidas por hash
+ *
+ * Cada pulsera va siempre al mismo trabajador (FNV-1a del id) y cada
+ * trabajador tiene su propia SpscQueue desde el hilo de la fuente: los
+ * mensajes de una pulsera se procesan en orden y sin locks, y una pulsera
+ * lenta sólo demora a las que comparten su trabajador. El trabajador hace
+ * todo lo de sus pulseras: decodificar, validar la secuencia y guardar en
+ * el archivo de noche (night_file.h) y, si hay, en el puente de memoria
+ * compartida (shm_bridge.h), donde es el único escritor de sus pulseras.
+ *
+ * Con la cola de un trabajador llena, submit() espera: la presión vuelve
+ * hasta el socket del broker en vez de crecer sin techo en la Raspberry.
+ * Las métricas de cada trabajador (WorkerStats) y de cada una de sus
+ * pulseras (DeviceStats) son atómicas y las leen el informe y el servidor
+ * de métricas (metrics_server.h) desde otro hilo sin detenerlo.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "latency_histogram.h"
+#include "night_file.h"
+#include "record.h"
+#include "seq_tracker.h"
+#include "shm_bridge.h"
+#include "spsc_queue.h"
+
+// Pulseras con métricas propias por trabajador; las que pasen cuentan sólo
+// en el total del trabajador
+#ifndef INGEST_DEVICE_STATS
+#define INGEST_DEVICE_STATS 256
+#endif
+
+// Las escribe sólo el trabajador de la pulsera
+struct DeviceStats {
+  char id[24];
+  std::atomic<uint64_t> mensajes{0};
+  std::atomic<uint64_t> registros{0};
+  std::atomic<uint64_t> errores{0};
+  std::atomic<uint64_t> ultimo_ms{0};  // llegada del último mensaje
+  // Al día cada segundo
+  std::atomic<uint64_t> huecos{0};
+  std::atomic<uint64_t> duplicados{0};
+};
+
+struct WorkerStats {
+  std::atomic<uint64_t> mensajes{0};
+  std::atomic<uint64_t> decodificados{0};
+  std::atomic<uint64_t> ignorados{0};
+  std::atomic<uint64_t> errores{0};
+  std::atomic<uint64_t> registros{0};
+  std::atomic<uint32_t> pulseras{0};
+  // Al día cada segundo (los mantiene el trabajador por pulsera)
+  std::atomic<uint64_t> huecos{0};
+  std::atomic<uint64_t> duplicados{0};
+  std::atomic<uint64_t> reordenados{0};
+  std::atomic<uint64_t> reinicios{0};
+  std::atomic<uint64_t> bytes_disco{0};
+  std::atomic<uint64_t> registros_disco{0};
+  std::atomic<uint64_t> bytes_resumen{0};
+  std::atomic<uint32_t> noches{0};
+  // Los escribe el hilo de la fuente
+  std::atomic<uint64_t> llena{0};  // veces que encontró la cola llena
+  std::atomic<uint64_t> cola_max{0};
+  // Desde que la fuente encola hasta que el registro queda guardado, y sus
+  // dos partes: en la cola y decodificando y guardando
+  LatencyHistogram latencia;
+  LatencyHistogram espera;
+  LatencyHistogram proceso;
+  // De la muestra en la pulsera a la llegada al gateway (relojes de los dos
+  // lados, sincronizados por NTP; 0 si la pulsera va adelantada)
+  LatencyHistogram llegada;
+  // Las primeras listadas de por_pulsera tienen id (publicado con release)
+  std::atomic<uint32_t> listadas{0};
+  DeviceStats por_pulsera[INGEST_DEVICE_STATS];
+};
+
+class IngestPool {
+ public:
+  IngestPool(uint32_t workers, size_t queue_capacity, const std::string& dir);
+  IngestPool(const IngestPool&) = delete;
+  IngestPool& operator=(const IngestPool&) = delete;
+  ~IngestPool() { stop(); }
+
+  // Para medir el aislamiento: cada mensaje de esa pulsera demora us más en
+  // su trabajador (una espera, como un análisis que bloquea)
+  void setSlowDevice(const std::string& device, uint32_t us);
+  // Además del archivo, cada trabajador publica lo de sus pulseras en el
+  // puente de memoria compartida (antes de start)
+  void setShmBridge(ShmBridge* bridge) { puente = bridge; }
+
+  void start();
+  // Sólo desde el hilo de la fuente; false si no es un tópico de pulsera
+  bool submit(Message&& m);
+  // Vacía las colas, cierra los archivos y espera a los trabajadores
+  void stop();
+
+  static uint32_t workerFor(const std::string& device, uint32_t workers);
+
+  size_t workers() const { return trabajadores.size(); }
+  const WorkerStats& stats(size_t i) const { return trabajadores[i]->stats; }
+  size_t queueSize(size_t i) const { return trabajadores[i]->cola.size(); }
+  size_t queueCapacity(size_t i) const { return trabajadores[i]->cola.capacity(); }
+  uint64_t ignored() const { return ignorados.load(std::memory_order_relaxed); }
+  // Pulseras de stats(i).por_pulsera que se pueden leer
+  size_t listedDevices(size_t i) const {
+    return trabajadores[i]->stats.listadas.load(std::memory_order_acquire);
+  }
+
+ private:
+  struct Entrada {
+    Message m;
+    uint64_t encolado_ns = 0;
+  };
+
+  struct Dispositivo {
+    SeqTracker secuencia[SEQ_SPACES];
+    AlertDedup alertas;
+    NightStore archivo;
+    bool abierto = false;  // archivo y puente, con el primer mensaje decodificado
+    int lugar_shm = -1;
+    DeviceStats* stats = nullptr;  // nullptr sin lugar en por_pulsera
+  };
+
+  struct Trabajador {
+    explicit Trabajador(size_t capacidad) : cola(capacidad) {}
+    SpscQueue<Entrada> cola;
+    std::thread hilo;
+    WorkerStats stats;
+    std::unordered_map<std::string, std::unique_ptr<Dispositivo>> dispositivos;
+    std::vector<Record> registros;  // los del mensaje que se está procesando
+    uint64_t llegada_ms = 0;        // reloj de los bloques: la última llegada vista
+  };
+
+  void run(Trabajador& t);
+  void procesar(Trabajador& t, Entrada& e);
+  void sincronizar(Trabajador& t);
+  void cerrar(Trabajador& t);
+
+  std::vector<std::unique_ptr<Trabajador>> trabajadores;
+  std::string dir;
+  std::string lenta;
+  uint32_t lenta_us = 0;
+  ShmBridge* puente = nullptr;
+  std::atomic<bool> cerrando{false};
+  bool corriendo = false;
+  std::atomic<uint64_t> ignorados{0};  // tópicos que no son de una pulsera
+};
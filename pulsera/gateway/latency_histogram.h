@@ -0,0 +1,71 @@
+/*
+ * Histograma de latencias en µs para leer desde otro hilo
+ *
+ * Cuatro cubetas por potencia de 2 (error relativo < 25 %): un solo hilo
+ * escribe y cualquiera lee percentiles sin detenerlo. Los contadores son
+ * atómicos relajados; una lectura puede mezclar muestras de dos instantes
+ * cercanos, lo que no cambia un percentil.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+class LatencyHistogram {
+ public:
+  static const uint8_t CUBETAS = 4 * 40;
+
+  // Sólo el hilo dueño
+  void add(uint64_t us) {
+    uint8_t i = cubeta(us);
+    cuentas[i].store(cuentas[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    suma.store(suma.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+    if (us > maximo.load(std::memory_order_relaxed)) maximo.store(us, std::memory_order_relaxed);
+  }
+
+  uint64_t count() const { return total.load(std::memory_order_relaxed); }
+  uint64_t max() const { return maximo.load(std::memory_order_relaxed); }
+  uint64_t sum() const { return suma.load(std::memory_order_relaxed); }
+
+  // Muestras en cubetas cuyo borde superior no pasa de us (las de la cubeta
+  // que contiene a us cuentan en el borde siguiente)
+  uint64_t countAtMost(uint64_t us) const {
+    uint64_t n = 0;
+    for (uint8_t i = 0; i < CUBETAS && borde(i) <= us; i++) {
+      n += cuentas[i].load(std::memory_order_relaxed);
+    }
+    return n;
+  }
+
+  // Borde superior de la cubeta donde cae el percentil p (0..1)
+  uint64_t percentile(double p) const {
+    uint64_t n = count();
+    if (!n) return 0;
+    uint64_t objetivo = (uint64_t)(p * n), acumulado = 0;
+    for (uint8_t i = 0; i < CUBETAS; i++) {
+      acumulado += cuentas[i].load(std::memory_order_relaxed);
+      if (acumulado > objetivo) return borde(i);
+    }
+    return max();
+  }
+
+ private:
+  static uint8_t cubeta(uint64_t us) {
+    if (us < 4) return (uint8_t)us;
+    uint8_t e = 63 - __builtin_clzll(us);
+    uint8_t i = 4 * (e - 1) + ((us >> (e - 2)) & 3);
+    return i < CUBETAS ? i : CUBETAS - 1;
+  }
+  static uint64_t borde(uint8_t i) {
+    if (i < 4) return i;
+    uint8_t e = i / 4 + 1;
+    return ((uint64_t)(4 + i % 4 + 1) << (e - 2)) - 1;
+  }
+
+  std::atomic<uint64_t> cuentas[CUBETAS] = {};
+  std::atomic<uint64_t> total{0};
+  std::atomic<uint64_t> maximo{0};
+  std::atomic<uint64_t> suma{0};
+};
@@ -0,0 +1,78 @@
+#include "log_source.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// Valor de texto de "clave":"..."; deshace los escapes de la simulación
+static bool texto(const std::string& linea, const char* clave, std::string& out) {
+  size_t p = linea.find(clave);
+  if (p == std::string::npos) return false;
+  out.clear();
+  for (size_t i = p + strlen(clave); i < linea.size(); i++) {
+    char c = linea[i];
+    if (c == '"') return true;
+    if (c == '\\' && i + 1 < linea.size()) c = linea[++i];
+    out.push_back(c);
+  }
+  return false;
+}
+
+static int nibble(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool parseLogLine(const std::string& linea, Message& m, double& t_ms, bool& retained) {
+  size_t p = linea.find("\"t_ms\":");
+  size_t q = linea.find("\"recv_epoch_ms\":");
+  if (p == std::string::npos || q == std::string::npos) return false;
+  t_ms = strtod(linea.c_str() + p + 7, nullptr);
+  m.recv_ms = strtoull(linea.c_str() + q + 16, nullptr, 10);
+  retained = linea.find("\"retained\":1") != std::string::npos;
+  if (!texto(linea, "\"topic\":\"", m.topic)) return false;
+
+  std::string hex;
+  if (texto(linea, "\"payload_hex\":\"", hex)) {
+    if (hex.size() % 2) return false;
+    m.payload.resize(hex.size() / 2);
+    for (size_t i = 0; i < m.payload.size(); i++) {
+      int alto = nibble(hex[2 * i]), bajo = nibble(hex[2 * i + 1]);
+      if (alto < 0 || bajo < 0) return false;
+      m.payload[i] = (char)(alto << 4 | bajo);
+    }
+    return true;
+  }
+  return texto(linea, "\"payload\":\"", m.payload);
+}
+
+bool LogSource::open(const std::string& ruta) {
+  close();
+  archivo = fopen(ruta.c_str(), "r");
+  return archivo != nullptr;
+}
+
+bool LogSource::next(Message& m, double& t_ms, bool& retained) {
+  if (!archivo) return false;
+  char bloque[4096];
+  for (;;) {
+    linea.clear();
+    while (fgets(bloque, sizeof(bloque), archivo)) {
+      linea += bloque;
+      if (!linea.empty() && linea.back() == '\n') break;
+    }
+    if (linea.empty()) return false;
+    if (parseLogLine(linea, m, t_ms, retained)) return true;
+    malas++;
+  }
+}
+
+void LogSource::rewind() {
+  if (archivo) ::rewind(archivo);
+}
+
+void LogSource::close() {
+  if (archivo) fclose(archivo);
+  archivo = nullptr;
+}
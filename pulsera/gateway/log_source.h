@@ -0,0 +1,38 @@
+/*
+ * Lectura de los registros de la simulación (sim --mqtt-log) en el gateway
+ *
+ * Una línea JSON por publicación: t_ms, recv_epoch_ms, topic, retained y
+ * payload (texto, con '"' y '\' escapados) o payload_hex (binario). El
+ * ingest los usa como fuente sin broker y el replay para republicarlos.
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+#include "record.h"
+
+class LogSource {
+ public:
+  LogSource() = default;
+  LogSource(const LogSource&) = delete;
+  LogSource& operator=(const LogSource&) = delete;
+  ~LogSource() { close(); }
+
+  bool open(const std::string& ruta);
+  // Siguiente publicación; false al final. t_ms: instante en la simulación.
+  bool next(Message& m, double& t_ms, bool& retained);
+  void rewind();
+  void close();
+
+  uint64_t badLines() const { return malas; }
+
+ private:
+  FILE* archivo = nullptr;
+  std::string linea;
+  uint64_t malas = 0;
+};
+
+// Una línea del registro -> mensaje; false si no es una publicación válida
+bool parseLogLine(const std::string& linea, Message& m, double& t_ms, bool& retained);
@@ -0,0 +1,200 @@
+#include "metrics_server.h"
+
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+static const int ESPERA_CLIENTE_MS = 1000;
+static const int VUELTA_MS = 200;  // cada cuánto mira si tiene que cerrar
+static const size_t PEDIDO_MAX = 8192;
+
+// Bordes de las cubetas de los histogramas, en segundos
+static const double BORDES_S[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005,
+                                  0.01,   0.025,   0.05,   0.1,   0.25,   0.5,
+                                  1,      2.5,     5,      10};
+
+static std::string numero(double v) {
+  if (std::isinf(v)) return v > 0 ? "+Inf" : "-Inf";
+  char buf[32];
+  if (v == std::floor(v) && std::fabs(v) < 1e15) snprintf(buf, sizeof(buf), "%.0f", v);
+  else snprintf(buf, sizeof(buf), "%.6g", v);
+  return buf;
+}
+
+void MetricsText::family(const char* name, const char* type, const char* help) {
+  texto += "# HELP ";
+  texto += name;
+  texto += ' ';
+  texto += help;
+  texto += "\n# TYPE ";
+  texto += name;
+  texto += ' ';
+  texto += type;
+  texto += '\n';
+}
+
+void MetricsText::sample(const char* name, const std::string& labels, double value) {
+  texto += name;
+  if (!labels.empty()) {
+    texto += '{';
+    texto += labels;
+    texto += '}';
+  }
+  texto += ' ';
+  texto += numero(value);
+  texto += '\n';
+}
+
+void MetricsText::histogram(const char* name, const std::string& labels,
+                            const LatencyHistogram& h) {
+  std::string cubeta = std::string(name) + "_bucket";
+  std::string coma = labels.empty() ? "" : labels + ",";
+  for (double borde : BORDES_S) {
+    sample(cubeta.c_str(), coma + label("le", numero(borde)),
+           h.countAtMost((uint64_t)llround(borde * 1e6)));
+  }
+  uint64_t n = h.count();
+  sample(cubeta.c_str(), coma + label("le", "+Inf"), n);
+  sample((std::string(name) + "_sum").c_str(), labels, h.sum() / 1e6);
+  sample((std::string(name) + "_count").c_str(), labels, n);
+}
+
+std::string MetricsText::label(const char* name, const std::string& value) {
+  std::string s = name;
+  s += "=\"";
+  for (char c : value) {
+    if (c == '\\' || c == '"') s += '\\';
+    if (c == '\n') {
+      s += "\\n";
+      continue;
+    }
+    s += c;
+  }
+  s += '"';
+  return s;
+}
+
+bool MetricsServer::listen(const std::string& address) {
+  stop();
+  if (address.find('/') != std::string::npos) {
+    sockaddr_un a = {};
+    a.sun_family = AF_UNIX;
+    if (address.size() >= sizeof(a.sun_path)) return false;
+    memcpy(a.sun_path, address.c_str(), address.size());
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    unlink(address.c_str());
+    if (bind(fd, (sockaddr*)&a, sizeof(a)) != 0 || ::listen(fd, 4) != 0) {
+      close(fd);
+      fd = -1;
+      return false;
+    }
+    ruta_unix = address;
+    return true;
+  }
+
+  size_t dos_puntos = address.rfind(':');
+  std::string host = dos_puntos == std::string::npos ? "127.0.0.1" : address.substr(0, dos_puntos);
+  std::string puerto = dos_puntos == std::string::npos ? address : address.substr(dos_puntos + 1);
+  addrinfo pista = {};
+  pista.ai_family = AF_UNSPEC;
+  pista.ai_socktype = SOCK_STREAM;
+  pista.ai_flags = AI_PASSIVE;
+  addrinfo* direcciones = nullptr;
+  if (getaddrinfo(host.c_str(), puerto.c_str(), &pista, &direcciones) != 0) return false;
+  for (addrinfo* a = direcciones; a && fd < 0; a = a->ai_next) {
+    fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0) continue;
+    int uno = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &uno, sizeof(uno));
+    if (bind(fd, a->ai_addr, a->ai_addrlen) != 0 || ::listen(fd, 4) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(direcciones);
+  return fd >= 0;
+}
+
+void MetricsServer::start(Writer writer) {
+  if (fd < 0 || hilo.joinable()) return;
+  escribir = writer;
+  cerrando = false;
+  hilo = std::thread(&MetricsServer::run, this);
+}
+
+void MetricsServer::stop() {
+  cerrando = true;
+  if (hilo.joinable()) hilo.join();
+  if (fd >= 0) close(fd);
+  fd = -1;
+  if (!ruta_unix.empty()) unlink(ruta_unix.c_str());
+  ruta_unix.clear();
+}
+
+void MetricsServer::run() {
+  while (!cerrando.load(std::memory_order_relaxed)) {
+    pollfd p = {fd, POLLIN, 0};
+    if (::poll(&p, 1, VUELTA_MS) <= 0) continue;
+    int cliente = accept(fd, nullptr, nullptr);
+    if (cliente < 0) continue;
+    timeval plazo = {ESPERA_CLIENTE_MS / 1000, (ESPERA_CLIENTE_MS % 1000) * 1000};
+    setsockopt(cliente, SOL_SOCKET, SO_RCVTIMEO, &plazo, sizeof(plazo));
+    setsockopt(cliente, SOL_SOCKET, SO_SNDTIMEO, &plazo, sizeof(plazo));
+    atender(cliente);
+    close(cliente);
+  }
+}
+
+static void enviar(int cliente, const char* datos, size_t largo) {
+  while (largo) {
+    ssize_t n = send(cliente, datos, largo, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return;
+    datos += n;
+    largo -= n;
+  }
+}
+
+void MetricsServer::atender(int cliente) {
+  std::string pedido;
+  char buf[1024];
+  while (pedido.find("\r\n\r\n") == std::string::npos && pedido.size() < PEDIDO_MAX) {
+    ssize_t n = recv(cliente, buf, sizeof(buf), 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return;
+    pedido.append(buf, n);
+  }
+
+  // "GET /metrics HTTP/1.1"; también "/" para probar con el navegador
+  const char* estado = "200 OK";
+  size_t fin = pedido.find(' ', 4);
+  std::string ruta = pedido.compare(0, 4, "GET ") == 0 && fin != std::string::npos
+                         ? pedido.substr(4, fin - 4)
+                         : "";
+  size_t pregunta = ruta.find('?');
+  if (pregunta != std::string::npos) ruta.resize(pregunta);
+  texto.clear();
+  if (ruta == "/metrics" || ruta == "/") {
+    escribir(texto);
+    pedidos.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    estado = ruta.empty() ? "405 Method Not Allowed" : "404 Not Found";
+  }
+
+  char cabecera[160];
+  int n = snprintf(cabecera, sizeof(cabecera),
+                   "HTTP/1.1 %s\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                   "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                   estado, texto.text().size());
+  enviar(cliente, cabecera, n);
+  enviar(cliente, texto.text().data(), texto.text().size());
+}
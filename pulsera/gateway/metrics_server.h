@@ -0,0 +1,70 @@
+/*
+ * Métricas del gateway en el formato de texto de Prometheus
+ *
+ * Un hilo propio atiende GET /metrics por HTTP en la Raspberry: en TCP
+ * (127.0.0.1:<puerto> salvo que se pida otra dirección) o en un socket Unix
+ * (curl --unix-socket RUTA http://oib/metrics). El texto lo arma la función
+ * que se le da en start(), en ese hilo, leyendo sólo métricas atómicas
+ * (WorkerStats, DeviceStats, LatencyHistogram): una lectura nunca frena a la
+ * ingesta. Atiende de a un cliente y le da ESPERA_CLIENTE_MS para mandar el
+ * pedido y leer la respuesta: es local y lo consulta un solo recolector.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "latency_histogram.h"
+
+class MetricsText {
+ public:
+  // HELP y TYPE ("counter", "gauge", "histogram") antes de las muestras
+  void family(const char* name, const char* type, const char* help);
+  // labels sin llaves, de label(): pulsera="x",trabajador="0"; vacío = sin
+  void sample(const char* name, const std::string& labels, double value);
+  // Un LatencyHistogram (µs) en segundos: cubetas acumuladas, _sum y _count,
+  // a la resolución del histograma
+  void histogram(const char* name, const std::string& labels, const LatencyHistogram& h);
+
+  static std::string label(const char* name, const std::string& value);
+
+  const std::string& text() const { return texto; }
+  void clear() { texto.clear(); }
+
+ private:
+  std::string texto;
+};
+
+class MetricsServer {
+ public:
+  typedef std::function<void(MetricsText& out)> Writer;
+
+  MetricsServer() = default;
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+  ~MetricsServer() { stop(); }
+
+  // "9100" o "0.0.0.0:9100" (TCP), o una ruta con '/' (socket Unix, se
+  // reemplaza si quedó de antes)
+  bool listen(const std::string& address);
+  void start(Writer writer);
+  void stop();
+
+  uint64_t requests() const { return pedidos.load(std::memory_order_relaxed); }
+
+ private:
+  void run();
+  void atender(int cliente);
+
+  int fd = -1;
+  std::string ruta_unix;
+  Writer escribir;
+  MetricsText texto;
+  std::thread hilo;
+  std::atomic<bool> cerrando{false};
+  std::atomic<uint64_t> pedidos{0};
+};
@@ -0,0 +1,250 @@
+#include "mqtt_socket.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+static const uint8_t MQTT_CONNECT = 0x10;
+static const uint8_t MQTT_CONNACK = 0x20;
+static const uint8_t MQTT_PUBLISH = 0x30;
+static const uint8_t MQTT_PUBACK = 0x40;
+static const uint8_t MQTT_SUBSCRIBE = 0x82;
+static const uint8_t MQTT_SUBACK = 0x90;
+static const uint8_t MQTT_PINGREQ = 0xC0;
+static const uint8_t MQTT_DISCONNECT = 0xE0;
+
+static const size_t SALIDA_FLUSH = 16384;
+
+static uint64_t ahora_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static void agregar_texto(std::vector<uint8_t>& v, const std::string& s) {
+  v.push_back(s.size() >> 8);
+  v.push_back(s.size() & 0xFF);
+  v.insert(v.end(), s.begin(), s.end());
+}
+
+bool MqttSocket::connect(const std::string& host, uint16_t port, const std::string& client_id,
+                         const std::string& user, const std::string& password,
+                         uint16_t keepalive_s, bool clean_session) {
+  disconnect();
+  addrinfo pista = {};
+  pista.ai_family = AF_UNSPEC;
+  pista.ai_socktype = SOCK_STREAM;
+  addrinfo* direcciones = nullptr;
+  if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &pista, &direcciones) != 0) {
+    return false;
+  }
+  for (addrinfo* a = direcciones; a && fd < 0; a = a->ai_next) {
+    fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0) continue;
+    if (::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(direcciones);
+  if (fd < 0) return false;
+  int uno = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno));
+
+  entrada.clear();
+  entrada_pos = 0;
+  salida.clear();
+  keepalive_ms = keepalive_s * 1000;
+
+  std::vector<uint8_t> cuerpo;
+  agregar_texto(cuerpo, "MQTT");
+  cuerpo.push_back(4);  // 3.1.1
+  uint8_t flags = clean_session ? 0x02 : 0;
+  if (!user.empty()) flags |= 0x80;
+  if (!password.empty()) flags |= 0x40;
+  cuerpo.push_back(flags);
+  cuerpo.push_back(keepalive_s >> 8);
+  cuerpo.push_back(keepalive_s & 0xFF);
+  agregar_texto(cuerpo, client_id);
+  if (!user.empty()) agregar_texto(cuerpo, user);
+  if (!password.empty()) agregar_texto(cuerpo, password);
+  encolar(MQTT_CONNECT, cuerpo);
+  if (!flush() || !esperar(MQTT_CONNACK, 5000)) {
+    disconnect();
+    return false;
+  }
+  return true;
+}
+
+bool MqttSocket::subscribe(const std::string& filter, uint8_t qos) {
+  std::vector<uint8_t> cuerpo;
+  uint16_t id = siguiente_id++;
+  if (!siguiente_id) siguiente_id = 1;
+  cuerpo.push_back(id >> 8);
+  cuerpo.push_back(id & 0xFF);
+  agregar_texto(cuerpo, filter);
+  cuerpo.push_back(qos);
+  encolar(MQTT_SUBSCRIBE, cuerpo);
+  return flush() && esperar(MQTT_SUBACK, 5000);
+}
+
+bool MqttSocket::publish(const std::string& topic, const void* payload, size_t len, bool retain) {
+  if (fd < 0) return false;
+  size_t resto = 2 + topic.size() + len;
+  salida.push_back(MQTT_PUBLISH | (retain ? 1 : 0));
+  do {
+    uint8_t b = resto & 0x7F;
+    resto >>= 7;
+    salida.push_back(resto ? b | 0x80 : b);
+  } while (resto);
+  agregar_texto(salida, topic);
+  const uint8_t* p = (const uint8_t*)payload;
+  salida.insert(salida.end(), p, p + len);
+  return salida.size() < SALIDA_FLUSH || flush();
+}
+
+void MqttSocket::encolar(uint8_t tipo, const std::vector<uint8_t>& cuerpo) {
+  salida.push_back(tipo);
+  size_t resto = cuerpo.size();
+  do {
+    uint8_t b = resto & 0x7F;
+    resto >>= 7;
+    salida.push_back(resto ? b | 0x80 : b);
+  } while (resto);
+  salida.insert(salida.end(), cuerpo.begin(), cuerpo.end());
+}
+
+bool MqttSocket::flush() {
+  if (salida.empty()) return fd >= 0;
+  bool ok = escribir(salida.data(), salida.size());
+  salida.clear();
+  return ok;
+}
+
+bool MqttSocket::escribir(const uint8_t* data, size_t len) {
+  while (len && fd >= 0) {
+    ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      disconnect();
+      return false;
+    }
+    data += n;
+    len -= n;
+    bytes_out += n;
+  }
+  ultimo_envio_ms = ahora_ms();
+  return fd >= 0;
+}
+
+bool MqttSocket::leer(int timeout_ms) {
+  pollfd p = {fd, POLLIN, 0};
+  int r = ::poll(&p, 1, timeout_ms);
+  if (r < 0) return errno == EINTR;
+  if (r == 0) return true;
+  if (entrada_pos > 0 && (entrada_pos == entrada.size() || entrada_pos > 65536)) {
+    entrada.erase(entrada.begin(), entrada.begin() + entrada_pos);
+    entrada_pos = 0;
+  }
+  size_t antes = entrada.size();
+  entrada.resize(antes + 65536);
+  ssize_t n = recv(fd, entrada.data() + antes, 65536, 0);
+  if (n <= 0) {
+    entrada.resize(antes);
+    if (n < 0 && errno == EINTR) return true;
+    disconnect();
+    return false;
+  }
+  entrada.resize(antes + n);
+  bytes_in += n;
+  return true;
+}
+
+bool MqttSocket::siguiente(uint8_t& tipo, size_t& inicio, size_t& largo) {
+  size_t i = entrada_pos;
+  if (i + 2 > entrada.size()) return false;
+  tipo = entrada[i++];
+  size_t resto = 0;
+  for (int desplazamiento = 0;; desplazamiento += 7) {
+    if (i >= entrada.size() || desplazamiento > 21) return false;
+    uint8_t b = entrada[i++];
+    resto |= (size_t)(b & 0x7F) << desplazamiento;
+    if (!(b & 0x80)) break;
+  }
+  if (i + resto > entrada.size()) return false;
+  inicio = i;
+  largo = resto;
+  return true;
+}
+
+// Para CONNACK y SUBACK: los PUBLISH que lleguen antes (retenidos) quedan
+// en el buffer para el próximo poll()
+bool MqttSocket::esperar(uint8_t tipo_esperado, int timeout_ms) {
+  uint64_t limite = ahora_ms() + timeout_ms;
+  while (fd >= 0) {
+    size_t guardado = entrada_pos;
+    uint8_t tipo;
+    size_t inicio, largo;
+    while (siguiente(tipo, inicio, largo)) {
+      if ((tipo & 0xF0) == (tipo_esperado & 0xF0)) {
+        bool ok = tipo != MQTT_CONNACK || (largo >= 2 && entrada[inicio + 1] == 0);
+        entrada.erase(entrada.begin() + entrada_pos, entrada.begin() + inicio + largo);
+        entrada_pos = guardado;
+        return ok;
+      }
+      entrada_pos = inicio + largo;
+    }
+    entrada_pos = guardado;
+    uint64_t t = ahora_ms();
+    if (t >= limite || !leer((int)(limite - t))) return false;
+  }
+  return false;
+}
+
+void MqttSocket::keepalive() {
+  if (keepalive_ms && ahora_ms() - ultimo_envio_ms >= keepalive_ms / 2) {
+    std::vector<uint8_t> vacio;
+    encolar(MQTT_PINGREQ, vacio);
+  }
+}
+
+bool MqttSocket::poll(int timeout_ms, const Handler& fn) {
+  if (fd < 0) return false;
+  keepalive();
+  if (!flush()) return false;
+  if (!leer(timeout_ms)) return false;
+
+  uint8_t tipo;
+  size_t inicio, largo;
+  while (siguiente(tipo, inicio, largo)) {
+    entrada_pos = inicio + largo;
+    if ((tipo & 0xF0) != MQTT_PUBLISH || largo < 2) continue;
+    uint8_t qos = (tipo >> 1) & 0x03;
+    const uint8_t* p = entrada.data() + inicio;
+    size_t largo_topico = (size_t)p[0] << 8 | p[1];
+    size_t datos = 2 + largo_topico + (qos ? 2 : 0);
+    if (datos > largo) continue;
+    if (qos == 1) {
+      std::vector<uint8_t> id(p + 2 + largo_topico, p + 4 + largo_topico);
+      encolar(MQTT_PUBACK, id);
+    }
+    fn(std::string((const char*)p + 2, largo_topico),
+       std::string((const char*)p + datos, largo - datos));
+  }
+  return flush();
+}
+
+void MqttSocket::disconnect() {
+  if (fd < 0) return;
+  uint8_t paquete[2] = {MQTT_DISCONNECT, 0};
+  send(fd, paquete, sizeof(paquete), MSG_NOSIGNAL);
+  close(fd);
+  fd = -1;
+}
@@ -0,0 +1,60 @@
+/*
+ * Cliente MQTT 3.1.1 mínimo sobre un socket TCP, para el gateway
+ *
+ * Lo justo para ingerir y reproducir telemetría sin depender de libmosquitto
+ * en la imagen de la Raspberry: CONNECT, SUBSCRIBE, PUBLISH QoS 0 de salida
+ * y QoS 0/1 de entrada (con PUBACK), PINGREQ. Como PubSubClient en la
+ * pulsera, no reintenta ni guarda estado: si poll() devuelve false el que
+ * lo usa vuelve a conectar.
+ *
+ * No es thread-safe: un único hilo lee (ingest) o escribe (replay).
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class MqttSocket {
+ public:
+  typedef std::function<void(std::string&& topic, std::string&& payload)> Handler;
+
+  ~MqttSocket() { disconnect(); }
+
+  bool connect(const std::string& host, uint16_t port, const std::string& client_id,
+               const std::string& user = "", const std::string& password = "",
+               uint16_t keepalive_s = 30, bool clean_session = true);
+  bool subscribe(const std::string& filter, uint8_t qos);
+  // QoS 0; queda en el buffer de salida hasta flush() o poll()
+  bool publish(const std::string& topic, const void* payload, size_t len, bool retain = false);
+  bool flush();
+  // Lee lo que llegue en hasta timeout_ms y llama a fn por cada PUBLISH
+  bool poll(int timeout_ms, const Handler& fn);
+  void disconnect();
+  bool connected() const { return fd >= 0; }
+
+  uint64_t bytesIn() const { return bytes_in; }
+  uint64_t bytesOut() const { return bytes_out; }
+
+ private:
+  bool escribir(const uint8_t* data, size_t len);
+  void encolar(uint8_t tipo, const std::vector<uint8_t>& cuerpo);
+  // Un paquete completo del buffer de entrada: tipo y cuerpo; false si falta
+  bool siguiente(uint8_t& tipo, size_t& inicio, size_t& largo);
+  bool esperar(uint8_t tipo_esperado, int timeout_ms);
+  bool leer(int timeout_ms);
+  void keepalive();
+
+  int fd = -1;
+  uint16_t keepalive_ms = 30000;
+  uint64_t ultimo_envio_ms = 0;
+  uint16_t siguiente_id = 1;
+  std::vector<uint8_t> entrada;
+  size_t entrada_pos = 0;
+  std::vector<uint8_t> salida;
+  uint64_t bytes_in = 0;
+  uint64_t bytes_out = 0;
+};
@@ -0,0 +1,586 @@
+#include "night_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "rollup.h"
+
+static const uint32_t MAGIC_BLOQUE = 0x4342494F;  // "OIBC"
+static const uint32_t MAGIC_INDICE = 0x5842494F;  // "OIBX"
+static const size_t BUFFER = 65536;
+
+// Columnas fijas de todas las tablas: t y seq avanzan a paso casi constante
+static const NightColumn FIJAS[NIGHT_FIXED_COLUMNS] = {
+    {"t", 1, 2},
+    {"llegada", 1, 1},
+    {"seq", 1, 2},
+};
+
+// Escalas: la resolución con que publica la pulsera (tramas en décimas o
+// centésimas, accel_datos con 3 decimales, alertas con 1)
+static std::vector<NightTable> con_resumenes(std::vector<NightTable> tablas) {
+  for (const NightTable& t : rollupTables()) tablas.push_back(t);
+  return tablas;
+}
+
+static const std::vector<NightTable> TABLAS = con_resumenes({
+    {RECORD_VITALS, "vitales", 4,
+     {{"hr", 10, 1}, {"spo2", 10, 1}, {"dedo", 1, 1}, {"etapa", 1, 1}}},
+    {RECORD_ENVIRONMENT, "ambiente", 2, {{"temperatura", 100, 1}, {"humedad", 100, 1}}},
+    {RECORD_PRESENCE, "presencia", 3,
+     {{"ocupada", 1, 1}, {"confianza", 1, 1}, {"indicadores", 1, 1}}},
+    {RECORD_EPOCH, "epocas", 6,
+     {{"indice", 1, 2}, {"etapa", 1, 1}, {"etapa_reglas", 1, 1}, {"hr", 10, 1},
+      {"rmssd", 10, 1}, {"actividad", 1000, 1}}},
+    {RECORD_HEART, "corazon", 4,
+     {{"ir", 1, 1}, {"bpm", 1, 1}, {"bpm_avg", 1, 1}, {"dedo", 1, 1}}},
+    {RECORD_ACCEL, "accel", 4,
+     {{"x", 1000, 1}, {"y", 1000, 1}, {"z", 1000, 1}, {"mag", 1000, 1}}},
+    {RECORD_ALERT, "alertas", 5,
+     {{"tipo", 1, 1}, {"activa", 1, 1}, {"valor", 10, 1}, {"umbral", 10, 1}, {"seq", 1, 1}}},
+    {RECORD_PPG, "ppg", 2, {{"ir", 1, 2}, {"rojo", 1, 2}}},
+    {RECORD_ACCEL_RAW, "accel_crudo", 3, {{"x", 1, 2}, {"y", 1, 2}, {"z", 1, 2}}},
+});
+
+static int posicion_tabla(uint8_t kind) {
+  for (size_t i = 0; i < TABLAS.size(); i++) {
+    if (TABLAS[i].kind == kind) return (int)i;
+  }
+  return -1;
+}
+
+const NightTable* nightTable(uint8_t kind) {
+  int i = posicion_tabla(kind);
+  return i < 0 ? nullptr : &TABLAS[i];
+}
+
+const NightTable* nightTableByName(const std::string& name) {
+  for (const NightTable& t : TABLAS) {
+    if (name == t.name) return &t;
+  }
+  return nullptr;
+}
+
+const std::vector<NightTable>& nightTables() { return TABLAS; }
+
+static const NightColumn& columna(const NightTable& t, uint8_t c) {
+  return c < NIGHT_FIXED_COLUMNS ? FIJAS[c] : t.column[c - NIGHT_FIXED_COLUMNS];
+}
+
+static uint64_t tiempo(const Record& r) { return r.sample_ms ? r.sample_ms : r.recv_ms; }
+
+uint64_t nightStartMs(uint64_t t_ms) {
+  time_t s = (time_t)(t_ms / 1000) - 12 * 3600;
+  struct tm dia;
+  localtime_r(&s, &dia);
+  dia.tm_hour = 12;
+  dia.tm_min = 0;
+  dia.tm_sec = 0;
+  dia.tm_isdst = -1;
+  return (uint64_t)mktime(&dia) * 1000;
+}
+
+std::string nightName(uint64_t night_start_ms) {
+  time_t s = (time_t)(night_start_ms / 1000);
+  struct tm dia;
+  localtime_r(&s, &dia);
+  char nombre[16];
+  strftime(nombre, sizeof(nombre), "%Y-%m-%d", &dia);
+  return nombre;
+}
+
+// ---- Codificación de columnas ----
+
+static void escribir_uvarint(std::vector<uint8_t>& out, uint64_t z) {
+  while (z >= 0x80) {
+    out.push_back((uint8_t)(z | 0x80));
+    z >>= 7;
+  }
+  out.push_back((uint8_t)z);
+}
+
+static void escribir_varint(std::vector<uint8_t>& out, int64_t v) {
+  escribir_uvarint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));  // zigzag
+}
+
+static bool leer_uvarint(const uint8_t*& p, const uint8_t* fin, uint64_t& z) {
+  z = 0;
+  for (uint8_t corrimiento = 0; corrimiento < 70; corrimiento += 7) {
+    if (p == fin) return false;
+    uint8_t b = *p++;
+    z |= (uint64_t)(b & 0x7F) << corrimiento;
+    if (b < 0x80) return true;
+  }
+  return false;
+}
+
+static bool leer_varint(const uint8_t*& p, const uint8_t* fin, int64_t& v) {
+  uint64_t z;
+  if (!leer_uvarint(p, fin, z)) return false;
+  v = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+  return true;
+}
+
+static int64_t prediccion(const int64_t* v, size_t k, uint8_t orden) {
+  if (orden == 1 || k == 1) return v[k - 1];
+  return 2 * v[k - 1] - v[k - 2];
+}
+
+// Agrega la columna a datos y completa su entrada del directorio
+static void codificar(const std::vector<int64_t>& v, uint8_t orden, NightColumnEntry& e,
+                      std::vector<uint8_t>& datos) {
+  memset(&e, 0, sizeof(e));
+  e.first = v[0];
+  bool constante = std::all_of(v.begin(), v.end(), [&](int64_t x) { return x == v[0]; });
+  if (constante) {
+    e.codec = NIGHT_CONSTANT;
+    return;
+  }
+  e.codec = orden == 1 ? NIGHT_DELTA1 : NIGHT_DELTA2;
+  size_t antes = datos.size();
+  for (size_t k = 1; k < v.size(); k++) {
+    escribir_varint(datos, v[k] - prediccion(v.data(), k, orden));
+  }
+  e.bytes = (uint32_t)(datos.size() - antes);
+
+  // La misma columna con las rachas de ceros contadas; queda la más chica
+  size_t con_rachas = datos.size();
+  for (size_t k = 1; k < v.size(); k++) {
+    int64_t residuo = v[k] - prediccion(v.data(), k, orden);
+    escribir_varint(datos, residuo);
+    if (residuo) continue;
+    size_t racha = 0;
+    while (k + 1 < v.size() && v[k + 1] == prediccion(v.data(), k + 1, orden)) {
+      k++;
+      racha++;
+    }
+    escribir_uvarint(datos, racha);
+  }
+  size_t largo = datos.size() - con_rachas;
+  if (largo < e.bytes) {
+    memmove(datos.data() + antes, datos.data() + con_rachas, largo);
+    e.codec |= NIGHT_ZERO_RUNS;
+    e.bytes = (uint32_t)largo;
+  }
+  datos.resize(antes + e.bytes);
+}
+
+// ---- Recorrido de un archivo (mapeado o recién leído) ----
+
+static bool cabecera_valida(const uint8_t* base, size_t largo) {
+  if (largo < sizeof(NightFileHeader)) return false;
+  const NightFileHeader* c = (const NightFileHeader*)base;
+  return c->magic == NightWriter::MAGIC && c->version == NightWriter::VERSION &&
+         c->header_size == sizeof(NightFileHeader);
+}
+
+static bool bloque_valido(const uint8_t* base, size_t largo, uint64_t pos) {
+  if (pos + sizeof(NightChunkHeader) > largo) return false;
+  const NightChunkHeader* b = (const NightChunkHeader*)(base + pos);
+  if (b->magic != MAGIC_BLOQUE || !b->rows) return false;
+  const NightTable* t = nightTable(b->kind);
+  if (!t || b->columns != NIGHT_FIXED_COLUMNS + t->values) return false;
+  return pos + sizeof(NightChunkHeader) + b->bytes <= largo &&
+         b->bytes >= b->columns * sizeof(NightColumnEntry);
+}
+
+// Índice desde la cola; si no está (el archivo no se cerró) recorre los
+// bloques. fin: donde termina el último bloque válido.
+static bool escanear(const uint8_t* base, size_t largo, std::vector<NightIndexEntry>& indice,
+                     uint64_t& fin) {
+  indice.clear();
+  if (largo >= sizeof(NightFileHeader) + sizeof(NightTrailer)) {
+    NightTrailer cola;
+    memcpy(&cola, base + largo - sizeof(cola), sizeof(cola));
+    uint64_t tam = (uint64_t)cola.entries * sizeof(NightIndexEntry);
+    if (cola.magic == MAGIC_INDICE && cola.index_offset >= sizeof(NightFileHeader) &&
+        cola.index_offset + tam + sizeof(cola) == largo) {
+      indice.resize(cola.entries);
+      memcpy(indice.data(), base + cola.index_offset, tam);
+      bool ok = std::all_of(indice.begin(), indice.end(), [&](const NightIndexEntry& e) {
+        return bloque_valido(base, cola.index_offset, e.offset);
+      });
+      if (ok) {
+        fin = cola.index_offset;
+        return true;
+      }
+      indice.clear();
+    }
+  }
+  uint64_t pos = sizeof(NightFileHeader);
+  while (bloque_valido(base, largo, pos)) {
+    const NightChunkHeader* b = (const NightChunkHeader*)(base + pos);
+    NightIndexEntry e;
+    memset(&e, 0, sizeof(e));
+    e.kind = b->kind;
+    e.rows = b->rows;
+    e.t_first = b->t_first;
+    e.t_last = b->t_last;
+    e.offset = pos;
+    indice.push_back(e);
+    pos += sizeof(NightChunkHeader) + b->bytes;
+  }
+  fin = pos;
+  return false;
+}
+
+static bool por_tabla_y_tiempo(const NightIndexEntry& a, const NightIndexEntry& b) {
+  return a.kind != b.kind ? a.kind < b.kind : a.t_first < b.t_first;
+}
+
+// ---- NightWriter ----
+
+bool NightWriter::open(const std::string& ruta, const std::string& device,
+                       uint64_t night_start_ms) {
+  close();
+  pendientes.assign(TABLAS.size(), Pendiente());
+  indice.clear();
+  registros = 0;
+  posicion = 0;
+  inicio_noche = night_start_ms;
+
+  // Archivo de una corrida anterior: se recupera el índice y se trunca lo
+  // que quedó después del último bloque completo
+  int fd = ::open(ruta.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    struct stat st;
+    bool ok = false;
+    if (fstat(fd, &st) != 0) st.st_size = 0;
+    if (st.st_size > 0) {
+      void* m = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (m != MAP_FAILED) {
+        const uint8_t* base = (const uint8_t*)m;
+        const NightFileHeader* c = (const NightFileHeader*)base;
+        if (cabecera_valida(base, st.st_size) && c->night_start_ms == night_start_ms &&
+            !strncmp(c->device, device.c_str(), sizeof(c->device))) {
+          escanear(base, st.st_size, indice, posicion);
+          for (const NightIndexEntry& e : indice) registros += e.rows;
+          ok = true;
+        }
+        munmap(m, st.st_size);
+      }
+    }
+    ::close(fd);
+    if (!ok && st.st_size > 0) return false;  // no es de esta pulsera y noche: no se pisa
+    if (ok && truncate(ruta.c_str(), posicion) != 0) return false;
+  }
+
+  archivo = fopen(ruta.c_str(), "ab");
+  if (!archivo) return false;
+  buffer = (char*)malloc(BUFFER);
+  setvbuf(archivo, buffer, _IOFBF, BUFFER);
+  if (posicion == 0) {
+    NightFileHeader c;
+    memset(&c, 0, sizeof(c));
+    c.magic = MAGIC;
+    c.version = VERSION;
+    c.header_size = sizeof(c);
+    memcpy(c.device, device.data(), std::min(device.size(), sizeof(c.device)));
+    c.night_start_ms = night_start_ms;
+    c.created_ms = (uint64_t)time(nullptr) * 1000;
+    fwrite(&c, sizeof(c), 1, archivo);
+    posicion = sizeof(c);
+  }
+  return true;
+}
+
+bool NightWriter::append(const Record& r) {
+  int i = posicion_tabla(r.kind);
+  if (!archivo || i < 0) return false;
+  Pendiente& p = pendientes[i];
+  if (p.filas.empty()) p.primera_llegada = r.recv_ms;
+  p.filas.push_back(r);
+  registros++;
+  if (p.filas.size() >= NIGHT_CHUNK_ROWS) escribir_bloque(r.kind, p.filas);
+  return true;
+}
+
+void NightWriter::sync(uint64_t now_ms) {
+  if (!archivo) return;
+  for (size_t i = 0; i < pendientes.size(); i++) {
+    Pendiente& p = pendientes[i];
+    if (!p.filas.empty() && now_ms - p.primera_llegada >= NIGHT_CHUNK_MAX_MS) {
+      escribir_bloque(TABLAS[i].kind, p.filas);
+    }
+  }
+  fflush(archivo);
+}
+
+void NightWriter::escribir_bloque(uint8_t kind, std::vector<Record>& filas) {
+  const NightTable& t = TABLAS[posicion_tabla(kind)];
+  std::stable_sort(filas.begin(), filas.end(),
+                   [](const Record& a, const Record& b) { return tiempo(a) < tiempo(b); });
+
+  uint8_t columnas = NIGHT_FIXED_COLUMNS + t.values;
+  size_t directorio = sizeof(NightChunkHeader);
+  datos.assign(directorio + columnas * sizeof(NightColumnEntry), 0);
+  NightColumnEntry entradas[NIGHT_FIXED_COLUMNS + NIGHT_MAX_VALUES];
+  valores.resize(filas.size());
+  for (uint8_t c = 0; c < columnas; c++) {
+    for (size_t k = 0; k < filas.size(); k++) {
+      const Record& r = filas[k];
+      if (c == 0) valores[k] = (int64_t)tiempo(r);
+      else if (c == 1) valores[k] = (int64_t)r.recv_ms - (int64_t)tiempo(r);
+      else if (c == 2) valores[k] = r.seq;
+      else valores[k] = llround((double)r.v[c - NIGHT_FIXED_COLUMNS] * columna(t, c).scale);
+    }
+    codificar(valores, columna(t, c).order, entradas[c], datos);
+  }
+  memcpy(datos.data() + directorio, entradas, columnas * sizeof(NightColumnEntry));
+
+  NightChunkHeader cab;
+  memset(&cab, 0, sizeof(cab));
+  cab.magic = MAGIC_BLOQUE;
+  cab.kind = kind;
+  cab.columns = columnas;
+  cab.rows = (uint32_t)filas.size();
+  cab.bytes = (uint32_t)(datos.size() - sizeof(cab));
+  cab.t_first = tiempo(filas.front());
+  cab.t_last = tiempo(filas.back());
+  memcpy(datos.data(), &cab, sizeof(cab));
+
+  NightIndexEntry e;
+  memset(&e, 0, sizeof(e));
+  e.kind = kind;
+  e.rows = cab.rows;
+  e.t_first = cab.t_first;
+  e.t_last = cab.t_last;
+  e.offset = posicion;
+  indice.push_back(e);
+
+  fwrite(datos.data(), datos.size(), 1, archivo);
+  posicion += datos.size();
+  filas.clear();
+}
+
+void NightWriter::close() {
+  if (archivo) {
+    for (size_t i = 0; i < pendientes.size(); i++) {
+      if (!pendientes[i].filas.empty()) escribir_bloque(TABLAS[i].kind, pendientes[i].filas);
+    }
+    std::sort(indice.begin(), indice.end(), por_tabla_y_tiempo);
+    NightTrailer cola = {posicion, (uint32_t)indice.size(), MAGIC_INDICE};
+    fwrite(indice.data(), sizeof(NightIndexEntry), indice.size(), archivo);
+    fwrite(&cola, sizeof(cola), 1, archivo);
+    posicion += indice.size() * sizeof(NightIndexEntry) + sizeof(cola);
+    fclose(archivo);
+  }
+  archivo = nullptr;
+  free(buffer);
+  buffer = nullptr;
+}
+
+// ---- NightReader ----
+
+bool NightReader::open(const std::string& ruta) {
+  close();
+  int fd = ::open(ruta.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(NightFileHeader)) {
+    ::close(fd);
+    return false;
+  }
+  void* m = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (m == MAP_FAILED) return false;
+  mapa = (const uint8_t*)m;
+  largo = st.st_size;
+  if (!cabecera_valida(mapa, largo)) {
+    close();
+    return false;
+  }
+  cabecera = (const NightFileHeader*)mapa;
+
+  uint64_t fin;
+  rearmado = !escanear(mapa, largo, indice, fin);
+  std::sort(indice.begin(), indice.end(), por_tabla_y_tiempo);
+  t_maximo.resize(indice.size());
+  for (size_t i = 0; i < indice.size(); i++) {
+    bool misma = i > 0 && indice[i - 1].kind == indice[i].kind;
+    t_maximo[i] = misma ? std::max(t_maximo[i - 1], indice[i].t_last) : indice[i].t_last;
+  }
+  return true;
+}
+
+void NightReader::close() {
+  if (mapa) munmap((void*)mapa, largo);
+  mapa = nullptr;
+  largo = 0;
+  cabecera = nullptr;
+  indice.clear();
+  t_maximo.clear();
+  rearmado = false;
+}
+
+std::pair<size_t, size_t> NightReader::seek(uint8_t kind, uint64_t desde_ms,
+                                            uint64_t hasta_ms) const {
+  auto tabla = std::equal_range(indice.begin(), indice.end(), NightIndexEntry{kind, {}, 0, 0, 0, 0},
+                                [](const NightIndexEntry& a, const NightIndexEntry& b) {
+                                  return a.kind < b.kind;
+                                });
+  size_t a = tabla.first - indice.begin();
+  size_t b = tabla.second - indice.begin();
+  // Los bloques de una tabla pueden solaparse (llegadas tardías): el primero
+  // es el que lleva el máximo acumulado de t_last hasta desde_ms
+  size_t primero = std::lower_bound(t_maximo.begin() + a, t_maximo.begin() + b, desde_ms) -
+                   t_maximo.begin();
+  size_t ultimo = std::upper_bound(indice.begin() + a, indice.begin() + b, hasta_ms,
+                                   [](uint64_t t, const NightIndexEntry& e) {
+                                     return t < e.t_first;
+                                   }) -
+                  indice.begin();
+  return {primero, std::max(primero, ultimo)};
+}
+
+const NightChunkHeader& NightReader::chunk(size_t i) const {
+  return *(const NightChunkHeader*)(mapa + indice[i].offset);
+}
+
+const NightColumnEntry* NightReader::columns(size_t i) const {
+  return (const NightColumnEntry*)(mapa + indice[i].offset + sizeof(NightChunkHeader));
+}
+
+const uint8_t* NightReader::columnData(size_t i, uint8_t column) const {
+  const NightColumnEntry* e = columns(i);
+  const uint8_t* p = (const uint8_t*)(e + chunk(i).columns);
+  for (uint8_t c = 0; c < column; c++) p += e[c].bytes;
+  return p;
+}
+
+bool NightReader::readColumn(size_t i, uint8_t column, std::vector<int64_t>& out) const {
+  const NightChunkHeader& b = chunk(i);
+  if (column >= b.columns) return false;
+  const NightColumnEntry& e = columns(i)[column];
+  out.resize(b.rows);
+  if (e.codec == NIGHT_CONSTANT) {
+    std::fill(out.begin(), out.end(), e.first);
+    return true;
+  }
+  const uint8_t* p = columnData(i, column);
+  const uint8_t* fin = p + e.bytes;
+  if (fin > mapa + largo) return false;
+  uint8_t orden = (e.codec & ~NIGHT_ZERO_RUNS) == NIGHT_DELTA1 ? 1 : 2;
+  bool rachas = e.codec & NIGHT_ZERO_RUNS;
+  int64_t* v = out.data();
+  v[0] = e.first;
+  for (size_t k = 1; k < b.rows; k++) {
+    int64_t residuo;
+    if (!leer_varint(p, fin, residuo)) return false;
+    v[k] = prediccion(v, k, orden) + residuo;
+    uint64_t racha;
+    if (!rachas || residuo) continue;
+    if (!leer_uvarint(p, fin, racha) || racha >= b.rows - k) return false;
+    for (; racha; racha--) {
+      k++;
+      v[k] = prediccion(v, k, orden);
+    }
+  }
+  return true;
+}
+
+bool NightReader::readChunk(size_t i, std::vector<Record>& out) const {
+  const NightChunkHeader& b = chunk(i);
+  const NightTable* t = nightTable(b.kind);
+  size_t antes = out.size();
+  out.resize(antes + b.rows);
+  Record* filas = out.data() + antes;
+  memset(filas, 0, b.rows * sizeof(Record));
+  std::vector<int64_t> v;
+  for (uint8_t c = 0; c < b.columns; c++) {
+    if (!readColumn(i, c, v)) {
+      out.resize(antes);
+      return false;
+    }
+    float escala = c < NIGHT_FIXED_COLUMNS ? 1 : t->column[c - NIGHT_FIXED_COLUMNS].scale;
+    for (uint32_t k = 0; k < b.rows; k++) {
+      Record& r = filas[k];
+      if (c == 0) r.sample_ms = v[k];
+      else if (c == 1) r.recv_ms = r.sample_ms + v[k];
+      else if (c == 2) r.seq = (uint32_t)v[k];
+      else r.v[c - NIGHT_FIXED_COLUMNS] = v[k] / escala;
+    }
+  }
+  uint8_t espacio = SEQ_TRACE;
+  if (b.kind < RECORD_HEART) espacio = SEQ_FRAME;
+  if (b.kind == RECORD_PPG || b.kind == RECORD_ACCEL_RAW || b.kind >= RECORD_ROLLUP) {
+    espacio = SEQ_NONE;
+  }
+  for (uint32_t k = 0; k < b.rows; k++) {
+    filas[k].kind = b.kind;
+    filas[k].seq_space = espacio;
+  }
+  return true;
+}
+
+// ---- NightStore ----
+
+bool NightStore::open(const std::string& d, const std::string& id) {
+  dir = d;
+  device = id;
+  mkdir(dir.c_str(), 0755);
+  return mkdir((dir + "/" + device).c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+bool NightStore::abrir(NightWriter& w, uint64_t& fin, uint64_t t, const char* extension) {
+  uint64_t inicio = nightStartMs(t);
+  fin = nightStartMs(inicio + 30 * 3600 * 1000ULL);  // mediodía siguiente, con DST
+  return w.open(dir + "/" + device + "/" + nightName(inicio) + extension, device, inicio);
+}
+
+bool NightStore::append(const Record& r) {
+  uint64_t t = tiempo(r);
+  bool otra_noche = !noche.isOpen() || t < noche.nightStart() || t >= fin_noche;
+  // Lo abierto es de la noche que termina: se cierra antes de empezar la
+  // otra, así el archivo de resúmenes no va y vuelve entre las dos
+  if (otra_noche) resumenes.flush(UINT64_MAX, filas_resumen);
+  resumenes.add(r, filas_resumen);
+  guardar_resumenes();
+
+  if (otra_noche) {
+    noche.close();
+    registros_cerrados += noche.records();
+    bytes_cerrados += noche.bytes();
+    if (!abrir(noche, fin_noche, t, ".oibn")) return false;
+    noches++;
+  }
+  return noche.append(r);
+}
+
+// Cada resumen va al archivo de su noche: uno que llega tarde puede
+// reabrir el de la noche anterior
+void NightStore::guardar_resumenes() {
+  for (const Record& r : filas_resumen) {
+    uint64_t t = r.sample_ms;
+    if (!resumen.isOpen() || t < resumen.nightStart() || t >= fin_resumen) {
+      resumen.close();
+      bytes_resumen_cerrados += resumen.bytes();
+      if (!abrir(resumen, fin_resumen, t, ".oibr")) continue;
+    }
+    resumen.append(r);
+  }
+  filas_resumen.clear();
+}
+
+void NightStore::sync(uint64_t now_ms) {
+  resumenes.flush(now_ms, filas_resumen);
+  guardar_resumenes();
+  noche.sync(now_ms);
+  resumen.sync(now_ms);
+}
+
+void NightStore::close() {
+  resumenes.flush(UINT64_MAX, filas_resumen);
+  guardar_resumenes();
+  noche.close();
+  resumen.close();
+}
@@ -0,0 +1,245 @@
+/*
+ * Archivo de noche: la telemetría de una pulsera en una noche, por columnas
+ *
+ * <dir>/<id>/<AAAA-MM-DD>.oibn, con la fecha de la tarde en que empieza la
+ * noche (de mediodía a mediodía, hora local del gateway). Sólo se agrega al
+ * final:
+ *
+ *   cabecera (64 B) | bloque | bloque | ... | índice | cola (16 B)
+ *
+ * Un bloque guarda hasta NIGHT_CHUNK_ROWS registros de una tabla (un
+ * RecordKind, ver nightTable()) ordenados por tiempo, columna por columna:
+ * t (hora de la muestra, o de llegada si la pulsera no tenía hora),
+ * llegada − t, seq y los valores de la tabla como enteros a la resolución
+ * con que los manda la pulsera. Cada columna se codifica aparte: constante
+ * si no cambia en el bloque y si no residuos zigzag en varint de un
+ * predictor de primer o segundo orden, como las capturas de la pulsera
+ * (include/raw_capture.h), con las rachas de ceros contadas cuando rinde
+ * (señales que casi no cambian entre muestras).
+ *
+ * El índice (tabla, t primero, t último, posición) se escribe al cerrar. Si
+ * el proceso se cae antes, NightReader lo rearma recorriendo las cabeceras
+ * de los bloques y NightWriter, al reabrir, trunca lo que quedó a medias y
+ * sigue agregando. La lectura mapea el archivo: las columnas se decodifican
+ * directo desde el mapa, sin read() intermedios.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "record.h"
+#include "rollup.h"
+
+#ifndef NIGHT_CHUNK_ROWS
+#define NIGHT_CHUNK_ROWS 4096
+#endif
+#ifndef NIGHT_CHUNK_MAX_MS
+#define NIGHT_CHUNK_MAX_MS 300000  // un bloque no espera más de 5 min de llegadas
+#endif
+
+static const uint8_t NIGHT_MAX_VALUES = 6;
+static const uint8_t NIGHT_FIXED_COLUMNS = 3;  // t, llegada, seq
+
+struct NightColumn {
+  const char* name;
+  float scale;    // valor guardado = round(v × scale)
+  uint8_t order;  // predictor: 1 = anterior, 2 = extrapolación lineal
+};
+
+struct NightTable {
+  uint8_t kind;  // RecordKind
+  const char* name;
+  uint8_t values;
+  NightColumn column[NIGHT_MAX_VALUES];
+};
+
+// Tabla de un tipo de registro; nullptr si no se guarda
+const NightTable* nightTable(uint8_t kind);
+const NightTable* nightTableByName(const std::string& name);
+const std::vector<NightTable>& nightTables();
+
+struct NightFileHeader {
+  uint32_t magic;  // "OIBN"
+  uint16_t version;
+  uint16_t header_size;
+  char device[24];
+  uint64_t night_start_ms;  // mediodía local en que empieza la noche
+  uint64_t created_ms;
+  uint8_t reserved[16];
+};
+static_assert(sizeof(NightFileHeader) == 64, "cabecera fija en disco");
+
+struct NightChunkHeader {
+  uint32_t magic;  // "OIBC"
+  uint8_t kind;
+  uint8_t columns;
+  uint16_t reserved;
+  uint32_t rows;
+  uint32_t bytes;  // directorio de columnas + datos, después de esta cabecera
+  uint64_t t_first;
+  uint64_t t_last;
+};
+static_assert(sizeof(NightChunkHeader) == 32, "cabecera fija en disco");
+
+enum NightCodec : uint8_t {
+  NIGHT_CONSTANT = 0,  // todas las filas valen first; sin datos
+  NIGHT_DELTA1 = 1,
+  NIGHT_DELTA2 = 2,
+  // Con DELTA1/DELTA2: cada residuo 0 va seguido de cuántos ceros más lo
+  // siguen. Se usa sólo si la columna queda más chica así.
+  NIGHT_ZERO_RUNS = 0x10,
+};
+
+struct NightColumnEntry {
+  uint8_t codec;  // NightCodec
+  uint8_t reserved[3];
+  uint32_t bytes;
+  int64_t first;
+};
+static_assert(sizeof(NightColumnEntry) == 16, "entrada fija en disco");
+
+struct NightIndexEntry {
+  uint8_t kind;
+  uint8_t reserved[3];
+  uint32_t rows;
+  uint64_t t_first;
+  uint64_t t_last;
+  uint64_t offset;  // de la cabecera del bloque
+};
+static_assert(sizeof(NightIndexEntry) == 32, "entrada fija en disco");
+
+struct NightTrailer {
+  uint64_t index_offset;
+  uint32_t entries;
+  uint32_t magic;  // "OIBX"
+};
+
+// Mediodía local en que empieza la noche de t_ms
+uint64_t nightStartMs(uint64_t t_ms);
+// "AAAA-MM-DD" de la tarde en que empieza esa noche
+std::string nightName(uint64_t night_start_ms);
+
+class NightWriter {
+ public:
+  static const uint32_t MAGIC = 0x4E42494F;  // "OIBN"
+  static const uint16_t VERSION = 1;
+
+  NightWriter() = default;
+  NightWriter(const NightWriter&) = delete;
+  NightWriter& operator=(const NightWriter&) = delete;
+  ~NightWriter() { close(); }
+
+  // Crea el archivo o reabre uno existente para seguir agregando
+  bool open(const std::string& ruta, const std::string& device, uint64_t night_start_ms);
+  // Registros de tablas sin nightTable() se descartan; false si no se guardó
+  bool append(const Record& r);
+  // Escribe los bloques que esperan desde hace NIGHT_CHUNK_MAX_MS (en hora
+  // de llegada) y vacía el buffer del archivo
+  void sync(uint64_t now_ms);
+  // Escribe lo pendiente, el índice y la cola
+  void close();
+
+  bool isOpen() const { return archivo != nullptr; }
+  uint64_t nightStart() const { return inicio_noche; }
+  uint64_t records() const { return registros; }
+  uint64_t bytes() const { return posicion; }
+  uint64_t chunks() const { return indice.size(); }
+
+ private:
+  struct Pendiente {
+    std::vector<Record> filas;
+    uint64_t primera_llegada = 0;
+  };
+
+  void escribir_bloque(uint8_t kind, std::vector<Record>& filas);
+
+  FILE* archivo = nullptr;
+  char* buffer = nullptr;
+  std::vector<Pendiente> pendientes;  // uno por tabla, en el orden de nightTables()
+  std::vector<NightIndexEntry> indice;
+  std::vector<int64_t> valores;       // columna que se está codificando
+  std::vector<uint8_t> datos;         // bloque armado
+  uint64_t inicio_noche = 0;
+  uint64_t registros = 0;
+  uint64_t posicion = 0;
+};
+
+class NightReader {
+ public:
+  NightReader() = default;
+  NightReader(const NightReader&) = delete;
+  NightReader& operator=(const NightReader&) = delete;
+  ~NightReader() { close(); }
+
+  bool open(const std::string& ruta);
+  void close();
+
+  const NightFileHeader& header() const { return *cabecera; }
+  // Ordenado por (tabla, t primero)
+  const std::vector<NightIndexEntry>& index() const { return indice; }
+  // El índice se rearmó recorriendo los bloques (el archivo no se cerró)
+  bool recovered() const { return rearmado; }
+  size_t fileSize() const { return largo; }
+
+  // Rango [primero, último) del índice con los bloques de la tabla que
+  // pueden tener filas en [desde_ms, hasta_ms]; búsqueda binaria
+  std::pair<size_t, size_t> seek(uint8_t kind, uint64_t desde_ms, uint64_t hasta_ms) const;
+
+  const NightChunkHeader& chunk(size_t i) const;
+  const NightColumnEntry* columns(size_t i) const;
+  // Datos codificados de una columna, dentro del mapa
+  const uint8_t* columnData(size_t i, uint8_t column) const;
+
+  // Columna 0 = t, 1 = llegada − t, 2 = seq, 3.. = valores (enteros escalados)
+  bool readColumn(size_t i, uint8_t column, std::vector<int64_t>& out) const;
+  // El bloque entero como registros, agregados al final de out
+  bool readChunk(size_t i, std::vector<Record>& out) const;
+
+ private:
+  const uint8_t* mapa = nullptr;
+  size_t largo = 0;
+  const NightFileHeader* cabecera = nullptr;
+  std::vector<NightIndexEntry> indice;
+  std::vector<uint64_t> t_maximo;  // máximo de t_last hasta cada entrada, por tabla
+  bool rearmado = false;
+};
+
+// Un archivo abierto por pulsera; cambia de archivo cuando cambia la noche.
+// Al lado de cada <noche>.oibn escribe <noche>.oibr con los resúmenes por
+// intervalo (rollup.h).
+class NightStore {
+ public:
+  bool open(const std::string& dir, const std::string& device);
+  bool append(const Record& r);
+  // Además cierra los resúmenes de intervalos ya terminados
+  void sync(uint64_t now_ms);
+  void close();
+
+  // En los archivos tocados, contando lo que ya tenían de corridas anteriores
+  uint64_t records() const { return registros_cerrados + noche.records(); }
+  uint64_t bytes() const { return bytes_cerrados + noche.bytes(); }
+  uint32_t nights() const { return noches; }
+  uint64_t rollupBytes() const { return bytes_resumen_cerrados + resumen.bytes(); }
+
+ private:
+  bool abrir(NightWriter& w, uint64_t& fin, uint64_t t, const char* extension);
+  void guardar_resumenes();
+
+  std::string dir;
+  std::string device;
+  NightWriter noche;
+  uint64_t fin_noche = 0;
+  uint64_t registros_cerrados = 0;
+  uint64_t bytes_cerrados = 0;
+  uint32_t noches = 0;
+  RollupBuilder resumenes;
+  std::vector<Record> filas_resumen;  // los que cerró el último registro
+  NightWriter resumen;
+  uint64_t fin_resumen = 0;
+  uint64_t bytes_resumen_cerrados = 0;
+};
@@ -0,0 +1,417 @@
+/*
+ * oib_night: inspección y medición de los archivos de noche (night_file.h)
+ *
+ *   --info ARCHIVO   tablas, bloques, filas y bytes por columna
+ *   --bench --log noche.jsonl [--dir DIR] [--copias N] [--busquedas N]
+ *       decodifica un registro de la simulación (sim --mqtt-log), escribe
+ *       N archivos con sus registros y los vuelve a leer: velocidad de
+ *       escritura, de lectura completa y de búsqueda por tiempo, tamaño por
+ *       noche y verificación contra los registros originales
+ *   --bench --log noche.jsonl --noches N [--dir DIR]
+ *       guarda el registro como N noches seguidas de una pulsera (NightStore,
+ *       con sus resúmenes .oibr) y arma el informe de cada noche desde los
+ *       resúmenes de 5 min y recorriendo los registros: tiempo y diferencias
+ *
+ *   pio run -e gateway_night
+ *   .pio/build/gateway_night/program --bench --log noche.jsonl --copias 16
+ */
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "log_source.h"
+#include "night_file.h"
+#include "payload_decoder.h"
+#include "rollup.h"
+
+static double segundos_desde(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+static int info(const std::string& ruta) {
+  NightReader r;
+  if (!r.open(ruta)) {
+    fprintf(stderr, "No se pudo abrir %s como archivo de noche\n", ruta.c_str());
+    return 1;
+  }
+  const NightFileHeader& c = r.header();
+  printf("%s: pulsera %.24s, noche %s, %zu B, %zu bloques%s\n", ruta.c_str(), c.device,
+         nightName(c.night_start_ms).c_str(), r.fileSize(), r.index().size(),
+         r.recovered() ? " (índice rearmado: el archivo no se cerró)" : "");
+
+  const std::vector<NightIndexEntry>& indice = r.index();
+  uint64_t filas_total = 0;
+  for (size_t i = 0; i < indice.size();) {
+    const NightTable* t = nightTable(indice[i].kind);
+    uint8_t columnas = NIGHT_FIXED_COLUMNS + t->values;
+    std::vector<uint64_t> bytes(columnas, 0);
+    uint64_t filas = 0, bloques = 0, total = 0;
+    uint64_t desde = indice[i].t_first, hasta = indice[i].t_last;
+    for (; i < indice.size() && indice[i].kind == t->kind; i++) {
+      const NightChunkHeader& b = r.chunk(i);
+      const NightColumnEntry* e = r.columns(i);
+      for (uint8_t k = 0; k < columnas; k++) bytes[k] += e[k].bytes;
+      filas += b.rows;
+      bloques++;
+      total += sizeof(b) + b.bytes;
+      hasta = std::max(hasta, (uint64_t)indice[i].t_last);
+    }
+    filas_total += filas;
+    printf("  %-12s %7llu filas en %4llu bloques, %8llu B (%.2f B/fila), %.1f h\n", t->name,
+           (unsigned long long)filas, (unsigned long long)bloques, (unsigned long long)total,
+           (double)total / filas, (hasta - desde) / 3.6e6);
+    printf("    ");
+    for (uint8_t k = 0; k < columnas; k++) {
+      const char* nombre = k == 0 ? "t" : k == 1 ? "llegada" : k == 2 ? "seq"
+                                                                        : t->column[k - 3].name;
+      printf(" %s %.2f", nombre, (double)bytes[k] / filas);
+    }
+    printf(" B/fila\n");
+  }
+  printf("  %llu filas, %.2f B/fila (Record: %zu B)\n", (unsigned long long)filas_total,
+         filas_total ? (double)r.fileSize() / filas_total : 0.0, sizeof(Record));
+  return 0;
+}
+
+static bool decodificar_log(const std::string& ruta, std::vector<Record>& registros,
+                            uint64_t& bytes_log) {
+  LogSource log;
+  if (!log.open(ruta)) return false;
+  struct stat st;
+  bytes_log = stat(ruta.c_str(), &st) == 0 ? st.st_size : 0;
+  Message m;
+  double t_ms;
+  bool retenido;
+  std::string dispositivo;
+  const char* sufijo;
+  while (log.next(m, t_ms, retenido)) {
+    if (!splitTopic(m.topic, dispositivo, sufijo)) continue;
+    decodeMessage(sufijo, m, registros);
+  }
+  registros.erase(std::remove_if(registros.begin(), registros.end(),
+                                 [](const Record& r) { return !nightTable(r.kind); }),
+                  registros.end());
+  return true;
+}
+
+// Registros releídos contra los originales, a la resolución de cada columna
+static uint64_t diferencias(std::vector<Record> originales, std::vector<Record> leidos) {
+  auto orden = [](const Record& a, const Record& b) {
+    uint64_t ta = a.sample_ms ? a.sample_ms : a.recv_ms;
+    uint64_t tb = b.sample_ms ? b.sample_ms : b.recv_ms;
+    if (a.kind != b.kind) return a.kind < b.kind;
+    return ta != tb ? ta < tb : a.seq < b.seq;
+  };
+  std::stable_sort(originales.begin(), originales.end(), orden);
+  std::stable_sort(leidos.begin(), leidos.end(), orden);
+  if (originales.size() != leidos.size()) return std::max(originales.size(), leidos.size());
+  uint64_t malas = 0;
+  for (size_t i = 0; i < originales.size(); i++) {
+    const Record& a = originales[i];
+    const Record& b = leidos[i];
+    bool ok = a.kind == b.kind && a.seq == b.seq && a.recv_ms == b.recv_ms &&
+              (a.sample_ms ? a.sample_ms : a.recv_ms) == b.sample_ms;
+    const NightTable* t = nightTable(a.kind);
+    for (uint8_t k = 0; ok && k < t->values; k++) {
+      ok = fabs(a.v[k] - b.v[k]) <= 0.5f / t->column[k].scale + 1e-3f * fabs(a.v[k]);
+    }
+    if (!ok) malas++;
+  }
+  return malas;
+}
+
+static int bench(const std::string& log, const std::string& dir, uint32_t copias,
+                 uint32_t busquedas) {
+  std::vector<Record> registros;
+  uint64_t bytes_log;
+  if (!decodificar_log(log, registros, bytes_log) || registros.empty()) {
+    fprintf(stderr, "Sin registros en %s\n", log.c_str());
+    return 1;
+  }
+  uint64_t desde = UINT64_MAX, hasta = 0;
+  for (const Record& r : registros) {
+    uint64_t t = r.sample_ms ? r.sample_ms : r.recv_ms;
+    desde = std::min(desde, t);
+    hasta = std::max(hasta, t);
+  }
+  double horas = (hasta - desde) / 3.6e6;
+  printf("%s: %zu registros en %.2f h de datos, %.2f MB de registro JSON\n", log.c_str(),
+         registros.size(), horas, bytes_log / 1e6);
+
+  mkdir(dir.c_str(), 0755);
+  std::vector<std::string> rutas;
+  uint64_t bytes = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t k = 0; k < copias; k++) {
+    rutas.push_back(dir + "/bench-" + std::to_string(k) + ".oibn");
+    remove(rutas.back().c_str());
+    NightWriter w;
+    if (!w.open(rutas.back(), "bench-" + std::to_string(k), nightStartMs(desde))) {
+      fprintf(stderr, "No se pudo crear %s\n", rutas.back().c_str());
+      return 1;
+    }
+    for (const Record& r : registros) w.append(r);
+    w.close();
+    bytes += w.bytes();
+  }
+  double s = segundos_desde(t0);
+  uint64_t total = (uint64_t)registros.size() * copias;
+  printf("Escritura: %llu registros en %.3f s: %.2f M registros/s (%.0f MB/s de Record)\n",
+         (unsigned long long)total, s, total / s / 1e6, total * sizeof(Record) / s / 1e6);
+
+  double por_noche = (double)bytes / copias;
+  printf("Tamaño: %.1f KB por archivo, %.2f B/registro | Record %.1f KB (%.1fx), "
+         "JSON %.1f KB (%.1fx)\n",
+         por_noche / 1e3, por_noche / registros.size(),
+         registros.size() * sizeof(Record) / 1e3, registros.size() * sizeof(Record) / por_noche,
+         bytes_log / 1e3, bytes_log / por_noche);
+  if (horas > 0) printf("        %.2f MB por noche de 8 h\n", por_noche / horas * 8 / 1e6);
+
+  std::vector<Record> leidos;
+  t0 = std::chrono::steady_clock::now();
+  uint64_t filas = 0;
+  for (const std::string& ruta : rutas) {
+    NightReader r;
+    if (!r.open(ruta)) return 1;
+    leidos.clear();
+    for (size_t i = 0; i < r.index().size(); i++) r.readChunk(i, leidos);
+    filas += leidos.size();
+  }
+  s = segundos_desde(t0);
+  printf("Lectura completa (mmap): %llu registros en %.3f s: %.2f M registros/s\n",
+         (unsigned long long)filas, s, filas / s / 1e6);
+  uint64_t malas = diferencias(registros, leidos);
+  printf("Verificación: %llu de %zu registros distintos del original\n",
+         (unsigned long long)malas, registros.size());
+
+  // Ventanas de 60 s al azar: ubicar los bloques y decodificar sólo la
+  // columna t de cada uno para contar las filas de la ventana
+  NightReader r;
+  r.open(rutas[0]);
+  std::vector<uint8_t> tablas;
+  for (const NightIndexEntry& e : r.index()) {
+    if (tablas.empty() || tablas.back() != e.kind) tablas.push_back(e.kind);
+  }
+  std::mt19937_64 azar(1);
+  std::vector<int64_t> t;
+  uint64_t encontradas = 0, bloques = 0;
+  t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < busquedas; i++) {
+    uint8_t kind = tablas[azar() % tablas.size()];
+    uint64_t inicio = desde + azar() % (hasta - desde + 1);
+    std::pair<size_t, size_t> rango = r.seek(kind, inicio, inicio + 60000);
+    for (size_t b = rango.first; b < rango.second; b++) {
+      r.readColumn(b, 0, t);
+      auto a = std::lower_bound(t.begin(), t.end(), (int64_t)inicio);
+      auto z = std::upper_bound(a, t.end(), (int64_t)inicio + 60000);
+      encontradas += z - a;
+      bloques++;
+    }
+  }
+  s = segundos_desde(t0);
+  if (busquedas) {
+    printf("Búsqueda: %u ventanas de 60 s en %.3f s: %.1f us/ventana, %.2f bloques y "
+           "%.1f filas por ventana\n",
+           busquedas, s, s * 1e6 / busquedas, (double)bloques / busquedas,
+           (double)encontradas / busquedas);
+  }
+  printf("\n");
+  return info(rutas[0]);
+}
+
+// Lo que pide un informe de noche: media, mínimo y máximo de cada señal y
+// muestras por etapa
+struct InformeNoche {
+  double suma[ROLLUP_SIGNALS] = {};
+  uint64_t n[ROLLUP_SIGNALS] = {};
+  float min[ROLLUP_SIGNALS] = {};
+  float max[ROLLUP_SIGNALS] = {};
+  uint64_t etapas[ROLLUP_STAGE_BINS] = {};
+
+  void sumar(uint8_t s, float minimo, float maximo, double suma_s, uint64_t n_s) {
+    min[s] = n[s] ? std::min(min[s], minimo) : minimo;
+    max[s] = n[s] ? std::max(max[s], maximo) : maximo;
+    suma[s] += suma_s;
+    n[s] += n_s;
+  }
+};
+
+static bool informe_de_resumenes(const std::string& ruta, InformeNoche& inf) {
+  NightReader r;
+  if (!r.open(ruta)) return false;
+  std::vector<RollupBucket> intervalos;
+  for (uint8_t s = 0; s < ROLLUP_SIGNALS; s++) {
+    intervalos.clear();
+    readRollups(r, s, ROLLUP_5MIN, 0, UINT64_MAX, intervalos);
+    for (const RollupBucket& b : intervalos) inf.sumar(s, b.min, b.max, (double)b.mean * b.n, b.n);
+  }
+  std::vector<StageBucket> etapas;
+  readStages(r, ROLLUP_5MIN, 0, UINT64_MAX, etapas);
+  for (const StageBucket& b : etapas) {
+    for (uint8_t k = 0; k < ROLLUP_STAGE_BINS; k++) inf.etapas[k] += b.n[k];
+  }
+  return true;
+}
+
+static bool informe_de_registros(const std::string& ruta, InformeNoche& inf) {
+  NightReader r;
+  if (!r.open(ruta)) return false;
+  std::vector<Record> filas;
+  for (uint8_t kind : {RECORD_VITALS, RECORD_ENVIRONMENT, RECORD_ACCEL, RECORD_EPOCH}) {
+    std::pair<size_t, size_t> rango = r.seek(kind, 0, UINT64_MAX);
+    filas.clear();
+    for (size_t i = rango.first; i < rango.second; i++) r.readChunk(i, filas);
+    for (const Record& f : filas) {
+      for (uint8_t s = 0; s < ROLLUP_SIGNALS; s++) {
+        const RollupSignalDef& d = rollupSignal(s);
+        float v = f.v[d.value];
+        if (d.kind != kind || (d.positive && !(v > 0))) continue;
+        inf.sumar(s, v, v, v, 1);
+      }
+      if (kind == RECORD_VITALS) {
+        float e = f.v[rollupSignal(ROLLUP_STAGES).value];
+        inf.etapas[e >= 0 && e < ROLLUP_STAGE_BINS - 1 ? (int)e : ROLLUP_STAGE_BINS - 1]++;
+      }
+    }
+  }
+  return true;
+}
+
+static int bench_noches(const std::string& log, const std::string& dir, uint32_t noches) {
+  std::vector<Record> registros;
+  uint64_t bytes_log;
+  if (!decodificar_log(log, registros, bytes_log) || registros.empty()) {
+    fprintf(stderr, "Sin registros en %s\n", log.c_str());
+    return 1;
+  }
+  const std::string pulsera = "semana";
+  mkdir(dir.c_str(), 0755);
+  std::string carpeta = dir + "/" + pulsera;
+  uint64_t desde = UINT64_MAX;
+  for (const Record& r : registros) desde = std::min(desde, r.sample_ms ? r.sample_ms : r.recv_ms);
+  std::vector<uint64_t> inicios;
+  for (uint32_t k = 0; k < noches; k++) {
+    uint64_t inicio = nightStartMs(desde + k * 86400000ULL);
+    inicios.push_back(inicio);
+    remove((carpeta + "/" + nightName(inicio) + ".oibn").c_str());
+    remove((carpeta + "/" + nightName(inicio) + ".oibr").c_str());
+  }
+
+  NightStore store;
+  if (!store.open(dir, pulsera)) return 1;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t k = 0; k < noches; k++) {
+    uint64_t corrimiento = k * 86400000ULL;
+    for (Record r : registros) {
+      if (r.sample_ms) r.sample_ms += corrimiento;
+      r.recv_ms += corrimiento;
+      store.append(r);
+    }
+  }
+  store.close();
+  double s = segundos_desde(t0);
+  uint64_t total = (uint64_t)registros.size() * noches;
+  printf("%u noches de %s: %llu registros en %.3f s (%.2f M registros/s con resúmenes)\n", noches,
+         log.c_str(), (unsigned long long)total, s, total / s / 1e6);
+  printf("Disco: registros %.1f KB/noche, resúmenes %.1f KB/noche\n",
+         store.bytes() / 1e3 / noches, store.rollupBytes() / 1e3 / noches);
+
+  std::vector<InformeNoche> de_resumenes(noches), de_registros(noches);
+  t0 = std::chrono::steady_clock::now();
+  for (uint32_t k = 0; k < noches; k++) {
+    if (!informe_de_resumenes(carpeta + "/" + nightName(inicios[k]) + ".oibr", de_resumenes[k])) {
+      return 1;
+    }
+  }
+  double s_resumenes = segundos_desde(t0);
+  t0 = std::chrono::steady_clock::now();
+  for (uint32_t k = 0; k < noches; k++) {
+    if (!informe_de_registros(carpeta + "/" + nightName(inicios[k]) + ".oibn", de_registros[k])) {
+      return 1;
+    }
+  }
+  double s_registros = segundos_desde(t0);
+  printf("Informe de %u noches: resúmenes de 5 min %.2f ms, recorriendo los registros %.2f ms "
+         "(%.0fx)\n\n",
+         noches, s_resumenes * 1e3, s_registros * 1e3, s_registros / s_resumenes);
+
+  static const char* ETAPAS[ROLLUP_STAGE_BINS] = {"despierto", "ligero", "rem", "profundo",
+                                                  "sin etapa"};
+  uint64_t diferentes = 0;
+  for (uint32_t k = 0; k < noches; k++) {
+    const InformeNoche& a = de_resumenes[k];
+    const InformeNoche& b = de_registros[k];
+    printf("  %s:", nightName(inicios[k]).c_str());
+    for (uint8_t s = 0; s < ROLLUP_SIGNALS; s++) {
+      if (!a.n[s]) continue;
+      double media = a.suma[s] / a.n[s];
+      printf(" %s %.2f (%.2f-%.2f)", rollupSignal(s).name, media, a.min[s], a.max[s]);
+      // Los resúmenes guardan milésimas de la unidad de la señal
+      double otra = b.n[s] ? b.suma[s] / b.n[s] : 0;
+      auto cerca = [](double x, double y) { return fabs(x - y) <= 1e-3 * (1 + fabs(y)); };
+      if (a.n[s] != b.n[s] || !cerca(a.min[s], b.min[s]) || !cerca(a.max[s], b.max[s]) ||
+          !cerca(media, otra)) {
+        diferentes++;
+      }
+    }
+    uint64_t muestras = 0;
+    for (uint8_t e = 0; e < ROLLUP_STAGE_BINS; e++) {
+      muestras += a.etapas[e];
+      if (a.etapas[e] != b.etapas[e]) diferentes++;
+    }
+    printf("\n   ");
+    for (uint8_t e = 0; e < ROLLUP_STAGE_BINS; e++) {
+      printf(" %s %.0f%%", ETAPAS[e], muestras ? 100.0 * a.etapas[e] / muestras : 0.0);
+    }
+    printf("\n");
+  }
+  printf("Verificación: %llu valores distintos entre resúmenes y registros\n\n",
+         (unsigned long long)diferentes);
+  return info(carpeta + "/" + nightName(inicios[0]) + ".oibr");
+}
+
+int main(int argc, char** argv) {
+  std::string archivo, log, dir = "bench_noches";
+  bool medir = false;
+  uint32_t copias = 1, busquedas = 10000, noches = 0;
+  for (int i = 1; i < argc; i++) {
+    bool hay = i + 1 < argc;
+    if (!strcmp(argv[i], "--info") && hay) {
+      archivo = argv[++i];
+    } else if (!strcmp(argv[i], "--bench")) {
+      medir = true;
+    } else if (!strcmp(argv[i], "--log") && hay) {
+      log = argv[++i];
+    } else if (!strcmp(argv[i], "--dir") && hay) {
+      dir = argv[++i];
+    } else if (!strcmp(argv[i], "--copias") && hay) {
+      copias = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--busquedas") && hay) {
+      busquedas = std::max(0, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--noches") && hay) {
+      noches = std::max(1, atoi(argv[++i]));
+    } else {
+      archivo.clear();
+      medir = false;
+      break;
+    }
+  }
+  if (!archivo.empty()) return info(archivo);
+  if (medir && !log.empty() && noches) return bench_noches(log, dir, noches);
+  if (medir && !log.empty()) return bench(log, dir, copias, busquedas);
+  fprintf(stderr,
+          "uso: %s --info ARCHIVO.oibn\n"
+          "     %s --bench --log ARCHIVO [--dir DIR] [--copias N] [--busquedas N]\n"
+          "     %s --bench --log ARCHIVO --noches N [--dir DIR]\n",
+          argv[0], argv[0], argv[0]);
+  return 1;
+}
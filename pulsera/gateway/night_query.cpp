@@ -0,0 +1,382 @@
+#include "night_query.h"
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+#include "night_file.h"
+
+static const uint8_t NIVEL = ROLLUP_30S;  // resúmenes que usa la consulta
+static const uint8_t COLUMNA_ETAPA = NIGHT_FIXED_COLUMNS + 3;  // vitales.etapa
+static const uint8_t SIN_ETAPA = ROLLUP_STAGE_BINS - 1;
+
+static const char* ETAPAS[ROLLUP_STAGE_BINS] = {"despierto", "ligero", "rem", "profundo",
+                                                "sin_etapa"};
+
+typedef std::vector<std::pair<uint64_t, uint64_t>> Intervalos;  // [desde, hasta), ordenados
+
+struct Noche {
+  std::string device;
+  uint64_t inicio;
+  uint64_t fin;
+  std::string base;  // <dir>/<id>/<AAAA-MM-DD>, sin extensión
+};
+
+// Etapa de cada vitales de la noche, para ubicar la de otros registros
+struct Linea {
+  std::vector<std::pair<int64_t, uint8_t>> puntos;
+
+  void armar(const NightReader& r) {
+    std::pair<size_t, size_t> rango = r.seek(RECORD_VITALS, 0, UINT64_MAX);
+    std::vector<int64_t> t, e;
+    for (size_t i = rango.first; i < rango.second; i++) {
+      if (!r.readColumn(i, 0, t) || !r.readColumn(i, COLUMNA_ETAPA, e)) continue;
+      for (size_t k = 0; k < t.size(); k++) puntos.push_back({t[k], (uint8_t)e[k]});
+    }
+    std::stable_sort(puntos.begin(), puntos.end(),
+                     [](const std::pair<int64_t, uint8_t>& a,
+                        const std::pair<int64_t, uint8_t>& b) { return a.first < b.first; });
+  }
+  // Primer punto posterior a t
+  size_t despues(int64_t t) const {
+    return std::upper_bound(puntos.begin(), puntos.end(), std::make_pair(t, (uint8_t)0xFF)) -
+           puntos.begin();
+  }
+  uint8_t bin(size_t siguiente) const {
+    if (!siguiente) return SIN_ETAPA;
+    uint8_t e = puntos[siguiente - 1].second;
+    return e < SIN_ETAPA ? e : SIN_ETAPA;
+  }
+  // ¿Alguna etapa aceptada entre desde y hasta?
+  bool coincide(int64_t desde, int64_t hasta, uint8_t etapas) const {
+    size_t k = despues(desde);
+    if (etapas >> bin(k) & 1) return true;
+    for (; k < puntos.size() && puntos[k].first <= hasta; k++) {
+      if (etapas >> bin(k + 1) & 1) return true;
+    }
+    return false;
+  }
+};
+
+void QueryResult::add(float v) {
+  min = count ? std::min(min, v) : v;
+  max = count ? std::max(max, v) : v;
+  sum += v;
+  count++;
+}
+
+void QueryResult::merge(const QueryResult& o) {
+  if (!o.count) return;
+  min = count ? std::min(min, o.min) : o.min;
+  max = count ? std::max(max, o.max) : o.max;
+  sum += o.sum;
+  count += o.count;
+}
+
+bool parseQueryColumn(const std::string& s, uint8_t& kind, uint8_t& column) {
+  size_t punto = s.find('.');
+  if (punto == std::string::npos) return false;
+  const NightTable* t = nightTableByName(s.substr(0, punto));
+  if (!t) return false;
+  std::string nombre = s.substr(punto + 1);
+  for (uint8_t c = 0; c < t->values; c++) {
+    if (nombre == t->column[c].name) {
+      kind = t->kind;
+      column = c;
+      return true;
+    }
+  }
+  return false;
+}
+
+int parseQueryStage(const std::string& s) {
+  for (int b = 0; b < ROLLUP_STAGE_BINS; b++) {
+    if (s == ETAPAS[b]) return b;
+  }
+  return -1;
+}
+
+static bool inicio_de_nombre(const std::string& nombre, uint64_t& inicio) {
+  int a, m, d;
+  if (nombre.size() != 15 || nombre.compare(10, 5, ".oibn") != 0 ||
+      sscanf(nombre.c_str(), "%4d-%2d-%2d", &a, &m, &d) != 3) {
+    return false;
+  }
+  struct tm dia = {};
+  dia.tm_year = a - 1900;
+  dia.tm_mon = m - 1;
+  dia.tm_mday = d;
+  dia.tm_hour = 12;
+  dia.tm_isdst = -1;
+  inicio = (uint64_t)mktime(&dia) * 1000;
+  return true;
+}
+
+static bool listar(const std::string& ruta, std::vector<std::string>& nombres, bool carpetas) {
+  DIR* d = opendir(ruta.c_str());
+  if (!d) return false;
+  while (struct dirent* e = readdir(d)) {
+    if (e->d_name[0] == '.') continue;
+    if (carpetas && e->d_type != DT_DIR && e->d_type != DT_UNKNOWN) continue;
+    nombres.push_back(e->d_name);
+  }
+  closedir(d);
+  std::sort(nombres.begin(), nombres.end());
+  return true;
+}
+
+// Pulsera y tiempo: sólo las noches que tocan el rango, por el nombre
+static bool planificar(const NightQuery& q, std::vector<Noche>& noches) {
+  std::vector<std::string> ids = q.devices;
+  if (ids.empty() && !listar(q.dir, ids, true)) return false;
+  for (const std::string& id : ids) {
+    std::vector<std::string> nombres;
+    listar(q.dir + "/" + id, nombres, false);
+    size_t primera = noches.size();
+    for (const std::string& nombre : nombres) {
+      uint64_t inicio;
+      if (!inicio_de_nombre(nombre, inicio)) continue;
+      uint64_t fin = nightStartMs(inicio + 30 * 3600 * 1000ULL);
+      if (fin <= q.desde_ms || inicio >= q.hasta_ms) continue;
+      noches.push_back({id, inicio, fin, q.dir + "/" + id + "/" + nombre.substr(0, 10)});
+    }
+    if (q.last_nights && noches.size() - primera > q.last_nights) {
+      noches.erase(noches.begin() + primera, noches.end() - q.last_nights);
+    }
+  }
+  return true;
+}
+
+static void agregar_intervalo(Intervalos& v, uint64_t desde, uint64_t hasta) {
+  if (desde >= hasta) return;
+  if (!v.empty() && v.back().second >= desde) v.back().second = std::max(v.back().second, hasta);
+  else v.push_back({desde, hasta});
+}
+
+// ¿El bloque tiene filas en alguno de los intervalos?
+static bool toca(const NightIndexEntry& c, const Intervalos& intervalos) {
+  auto k = std::upper_bound(intervalos.begin(), intervalos.end(), (uint64_t)c.t_first,
+                            [](uint64_t x, const std::pair<uint64_t, uint64_t>& iv) {
+                              return x < iv.second;
+                            });
+  return k != intervalos.end() && k->first <= c.t_last;
+}
+
+// Intervalos de 30 s dentro del rango: con una sola etapa (o sin filtro) se
+// toman del resumen; los de los bordes y los de etapas mezcladas quedan en
+// residuo para recorrer los registros. Si el residuo igual toca todos los
+// bloques de la tabla, el resumen no ahorra lectura: false y se recorre todo.
+static bool desde_resumenes(const NightReader& rr, const NightReader& r, const NightQuery& q,
+                            uint8_t senal, uint64_t desde, uint64_t hasta, QueryResult& res,
+                            QueryStats& st, Intervalos& residuo) {
+  uint64_t paso = ROLLUP_TIER_MS[NIVEL];
+  uint64_t primero = (desde + paso - 1) / paso * paso;
+  uint64_t ultimo = hasta - hasta % paso;  // excluido
+  if (primero >= ultimo) {
+    agregar_intervalo(residuo, desde, hasta);
+    return true;
+  }
+  agregar_intervalo(residuo, desde, primero);
+
+  // Con etapa: de los intervalos completos, los que salen del resumen
+  std::vector<uint64_t> puros;
+  if (q.stages) {
+    std::vector<StageBucket> etapas;
+    readStages(rr, NIVEL, primero >= paso ? primero - paso : 0, ultimo, etapas);
+    bool vitales = q.kind == RECORD_VITALS;
+    uint8_t anterior = 0;  // bins del intervalo anterior (0 = sin vitales)
+    size_t e = 0;
+    for (uint64_t t = primero; t < ultimo; t += paso) {
+      uint8_t bins = 0;
+      while (e < etapas.size() && etapas[e].t < t) e++;
+      if (e < etapas.size() && etapas[e].t == t) {
+        for (uint8_t b = 0; b < ROLLUP_STAGE_BINS; b++) {
+          if (etapas[e].n[b]) bins |= 1 << b;
+        }
+      }
+      if (t == primero && e > 0 && etapas[e - 1].t + paso == t) {
+        for (uint8_t b = 0; b < ROLLUP_STAGE_BINS; b++) {
+          if (etapas[e - 1].n[b]) anterior |= 1 << b;
+        }
+      }
+      // Fuera de los vitales, el principio del intervalo tiene la etapa del
+      // anterior, o de antes si no hubo vitales
+      uint8_t posibles = vitales ? bins : bins | anterior;
+      bool una = posibles && !(posibles & (posibles - 1));
+      if (vitales ? !(bins & q.stages) : posibles && anterior && !(posibles & q.stages)) {
+        // ninguna fila con una etapa aceptada
+      } else if (una && (vitales || anterior == bins)) {
+        puros.push_back(t);
+      } else {
+        agregar_intervalo(residuo, t, t + paso);
+      }
+      anterior = bins;
+    }
+    agregar_intervalo(residuo, ultimo, hasta);
+
+    std::pair<size_t, size_t> rango = r.seek(q.kind, desde, hasta - 1);
+    size_t tocados = 0, bloques = 0;
+    for (size_t i = rango.first; i < rango.second; i++) {
+      const NightIndexEntry& c = r.index()[i];
+      if (c.t_last < desde || c.t_first >= hasta) continue;
+      bloques++;
+      if (toca(c, residuo)) tocados++;
+    }
+    if (bloques && tocados == bloques) return false;
+  } else {
+    agregar_intervalo(residuo, ultimo, hasta);
+  }
+
+  std::vector<RollupBucket> intervalos;
+  readRollups(rr, senal, NIVEL, primero, ultimo, intervalos);
+  size_t k = 0;
+  for (const RollupBucket& b : intervalos) {
+    if (q.stages) {
+      while (k < puros.size() && puros[k] < b.t) k++;
+      if (k == puros.size() || puros[k] != b.t) continue;
+    }
+    QueryResult parcial;
+    parcial.count = b.n;
+    parcial.sum = (double)b.mean * b.n;
+    parcial.min = b.min;
+    parcial.max = b.max;
+    res.merge(parcial);
+    st.rollup_buckets++;
+  }
+  return true;
+}
+
+static void recorrer(const NightReader& r, const NightQuery& q, const Intervalos& intervalos,
+                     bool positivo, QueryResult& res, QueryStats& st) {
+  if (intervalos.empty()) return;
+  const NightTable* tabla = nightTable(q.kind);
+  float escala = tabla->column[q.column].scale;
+  bool vitales = q.kind == RECORD_VITALS;
+  // Fuera de los vitales, la etapa sale de la línea de los vitales
+  Linea linea;
+  if (q.stages && !vitales) linea.armar(r);
+
+  std::pair<size_t, size_t> rango =
+      r.seek(q.kind, intervalos.front().first, intervalos.back().second - 1);
+  std::vector<int64_t> t, v, e;
+  for (size_t i = rango.first; i < rango.second; i++) {
+    const NightIndexEntry& c = r.index()[i];
+    if (!toca(c, intervalos)) continue;
+    if (q.stages && !vitales && !linea.coincide(c.t_first, c.t_last, q.stages)) {
+      st.chunks_skipped++;
+      continue;
+    }
+    if (!r.readColumn(i, 0, t) || !r.readColumn(i, NIGHT_FIXED_COLUMNS + q.column, v)) continue;
+    if (q.stages && vitales && !r.readColumn(i, COLUMNA_ETAPA, e)) continue;
+    st.chunks++;
+    auto k = intervalos.begin();
+    size_t siguiente = q.stages && !vitales && !t.empty() ? linea.despues(t[0]) : 0;
+    for (size_t f = 0; f < t.size(); f++) {
+      uint64_t tf = t[f];
+      while (k != intervalos.end() && k->second <= tf) k++;
+      if (k == intervalos.end()) break;
+      if (tf < k->first) continue;
+      st.rows++;
+      if (q.stages) {
+        uint8_t bin;
+        if (vitales) {
+          bin = e[f] < SIN_ETAPA ? (uint8_t)e[f] : SIN_ETAPA;
+        } else {
+          while (siguiente < linea.puntos.size() && linea.puntos[siguiente].first <= t[f]) {
+            siguiente++;
+          }
+          bin = linea.bin(siguiente);
+        }
+        if (!(q.stages >> bin & 1)) continue;
+      }
+      float x = v[f] / escala;
+      if (positivo && !(x > 0)) continue;
+      res.add(x);
+    }
+  }
+}
+
+// Lo que recuerda cada hilo entre noches
+struct Hilo {
+  QueryStats stats;
+  // Pulsera cuya última noche no aprovechó los resúmenes: las noches de una
+  // misma persona se parecen, y con etapas la prueba cuesta leer los de etapa
+  std::string sin_resumenes;
+};
+
+static void consultar_noche(const NightQuery& q, const Noche& n, int senal, QueryResult& res,
+                            Hilo& h) {
+  uint64_t desde = std::max(q.desde_ms, n.inicio);
+  uint64_t hasta = std::min(q.hasta_ms, n.fin);
+  NightReader r;
+  if (!r.open(n.base + ".oibn")) return;
+  Intervalos residuo;
+  NightReader rr;
+  bool resumenes = senal >= 0 && q.use_rollups && h.sin_resumenes != n.device;
+  if (!resumenes || !rr.open(n.base + ".oibr") ||
+      !desde_resumenes(rr, r, q, senal, desde, hasta, res, h.stats, residuo)) {
+    if (resumenes) h.sin_resumenes = n.device;
+    residuo.assign(1, {desde, hasta});
+  }
+  recorrer(r, q, residuo, senal >= 0 && rollupSignal(senal).positive, res, h.stats);
+}
+
+bool runQuery(const NightQuery& q, std::vector<QueryResult>& out, QueryStats* stats) {
+  auto t0 = std::chrono::steady_clock::now();
+  const NightTable* tabla = nightTable(q.kind);
+  if (!tabla || q.column >= tabla->values) return false;
+  std::vector<Noche> noches;
+  if (!planificar(q, noches)) return false;
+
+  int senal = -1;
+  for (uint8_t s = 0; s < ROLLUP_SIGNALS; s++) {
+    if (rollupSignal(s).kind == q.kind && rollupSignal(s).value == q.column) senal = s;
+  }
+
+  // Una noche por vez en cada hilo, cada una con su resultado
+  std::vector<QueryResult> parciales(noches.size());
+  uint32_t hilos = std::max<uint32_t>(1, std::min<uint32_t>(q.threads, noches.size()));
+  std::vector<Hilo> por_hilo(hilos);
+  std::atomic<size_t> siguiente{0};
+  auto trabajar = [&](uint32_t h) {
+    for (size_t i; (i = siguiente.fetch_add(1)) < noches.size();) {
+      consultar_noche(q, noches[i], senal, parciales[i], por_hilo[h]);
+    }
+  };
+  std::vector<std::thread> extra;
+  for (uint32_t h = 1; h < hilos; h++) extra.emplace_back(trabajar, h);
+  trabajar(0);
+  for (std::thread& h : extra) h.join();
+
+  for (size_t i = 0; i < noches.size(); i++) {
+    bool nuevo = out.empty() || q.group == QUERY_BY_NIGHT ||
+                 (q.group == QUERY_BY_DEVICE && out.back().device != noches[i].device);
+    if (nuevo) {
+      out.push_back(QueryResult());
+      if (q.group != QUERY_TOTAL) out.back().device = noches[i].device;
+      if (q.group == QUERY_BY_NIGHT) out.back().night_start_ms = noches[i].inicio;
+    }
+    out.back().merge(parciales[i]);
+  }
+  if (out.empty() && q.group == QUERY_TOTAL) out.push_back(QueryResult());
+
+  if (stats) {
+    *stats = QueryStats();
+    stats->nights = noches.size();
+    for (const Hilo& h : por_hilo) {
+      const QueryStats& s = h.stats;
+      stats->rollup_buckets += s.rollup_buckets;
+      stats->chunks += s.chunks;
+      stats->chunks_skipped += s.chunks_skipped;
+      stats->rows += s.rows;
+    }
+    stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  }
+  return true;
+}
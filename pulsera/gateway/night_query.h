@@ -0,0 +1,85 @@
+/*
+ * Consultas sobre las noches guardadas: una señal agregada en un rango
+ *
+ *   "hr medio en REM en las últimas 30 noches de la pulsera X"
+ *   NightQuery q;
+ *   q.dir = "/var/lib/oib"; q.devices = {"X"}; q.last_nights = 30;
+ *   parseQueryColumn("vitales.hr", q.kind, q.column); q.stages = 1 << 2;
+ *
+ * Los filtros se aplican lo antes posible:
+ *  - pulsera: sólo se listan sus carpetas (<dir>/<id>/);
+ *  - tiempo: sólo las noches que lo tocan (por el nombre del archivo) y, en
+ *    cada una, sólo los bloques del índice que lo tocan (NightReader::seek);
+ *  - etapa: con la señal en los resúmenes (rollup.h), cada intervalo de
+ *    30 s dentro del rango cuya etapa es una sola se toma del resumen sin
+ *    leer registros; sólo los intervalos de los bordes y los de etapas
+ *    mezcladas se recorren en el archivo de noche. Si esos igual tocan
+ *    todos los bloques, el resumen no ahorra nada y se recorre la noche
+ *    entera (y las siguientes de la pulsera, en ese hilo). Fuera de los
+ *    vitales se saltean los bloques en que la etapa nunca coincide.
+ *
+ * La etapa de un registro es la de los últimos vitales en o antes de él (en
+ * los vitales, la propia). Como en los resúmenes, los valores sin lectura
+ * (RollupSignalDef::positive) no cuentan.
+ *
+ * Cada noche se recorre en un hilo, decodificando sólo las columnas t, la
+ * del valor y la de la etapa, y se agrega al vuelo sin armar registros.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rollup.h"
+
+enum QueryGroup : uint8_t {
+  QUERY_TOTAL = 0,
+  QUERY_BY_DEVICE,
+  QUERY_BY_NIGHT,
+};
+
+struct NightQuery {
+  std::string dir;
+  std::vector<std::string> devices;  // vacío = todas las de dir
+  uint64_t desde_ms = 0;
+  uint64_t hasta_ms = UINT64_MAX;    // excluido
+  uint32_t last_nights = 0;          // por pulsera; 0 = todas
+  uint8_t kind = RECORD_VITALS;
+  uint8_t column = 0;                // valor de la tabla (NightTable::column)
+  uint8_t stages = 0;                // bit k = bin k de los resúmenes; 0 = sin filtro
+  QueryGroup group = QUERY_TOTAL;
+  bool use_rollups = true;
+  uint32_t threads = 1;
+};
+
+struct QueryResult {
+  std::string device;         // vacío con QUERY_TOTAL
+  uint64_t night_start_ms = 0;  // sólo con QUERY_BY_NIGHT
+  uint64_t count = 0;
+  double sum = 0;
+  float min = 0;
+  float max = 0;
+
+  double mean() const { return count ? sum / count : 0; }
+  void add(float v);
+  void merge(const QueryResult& o);
+};
+
+struct QueryStats {
+  uint32_t nights = 0;            // archivos de noche en el rango
+  uint64_t rollup_buckets = 0;    // intervalos de 30 s tomados del resumen
+  uint64_t chunks = 0;            // bloques decodificados
+  uint64_t chunks_skipped = 0;    // bloques en el rango salteados por la etapa
+  uint64_t rows = 0;              // filas recorridas
+  double seconds = 0;
+};
+
+// "tabla.columna", por ejemplo "vitales.hr" o "accel.mag"
+bool parseQueryColumn(const std::string& s, uint8_t& kind, uint8_t& column);
+// Bin de etapa por nombre: despierto, ligero, rem, profundo, sin_etapa; -1 si no
+int parseQueryStage(const std::string& s);
+
+// false si dir no se puede leer o la columna no existe
+bool runQuery(const NightQuery& q, std::vector<QueryResult>& out, QueryStats* stats = nullptr);
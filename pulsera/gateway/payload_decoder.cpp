@@ -0,0 +1,266 @@
+#include "payload_decoder.h"
+
+#include <cstdlib>
+#include <cstring>
+
+bool splitTopic(const std::string& topic, std::string& device, const char*& suffix) {
+  static const char RAIZ[] = "oib/";
+  if (topic.compare(0, sizeof(RAIZ) - 1, RAIZ) != 0) return false;
+  size_t barra = topic.find('/', sizeof(RAIZ) - 1);
+  if (barra == std::string::npos || barra == sizeof(RAIZ) - 1) return false;
+  device.assign(topic, sizeof(RAIZ) - 1, barra - (sizeof(RAIZ) - 1));
+  suffix = topic.c_str() + barra + 1;
+  return true;
+}
+
+static Record nuevo(uint8_t kind, uint8_t espacio, uint32_t seq, uint64_t sample_ms,
+                    uint64_t recv_ms) {
+  Record r;
+  memset(&r, 0, sizeof(r));
+  r.kind = kind;
+  r.seq_space = espacio;
+  r.seq = seq;
+  r.sample_ms = sample_ms;
+  r.recv_ms = recv_ms;
+  return r;
+}
+
+DecodeResult decodeFrames(const uint8_t* data, size_t len, uint64_t recv_ms,
+                          std::vector<Record>& out) {
+  size_t i = 0;
+  while (i < len) {
+    if (len - i < sizeof(FrameHeader) + 2) return DECODE_ERROR;
+    FrameHeader cab;
+    memcpy(&cab, data + i, sizeof(cab));
+    if (cab.magic != OIB_FRAME_MAGIC || cab.version != OIB_FRAME_VERSION) return DECODE_ERROR;
+    size_t largo = sizeof(cab) + cab.length;
+    if (len - i < largo + 2) return DECODE_ERROR;
+    uint16_t crc = data[i + largo] | (uint16_t)data[i + largo + 1] << 8;
+    if (FrameEncoder::crc16(data + i, largo) != crc) return DECODE_ERROR;
+
+    const uint8_t* datos = data + i + sizeof(cab);
+    Record r = nuevo(cab.type, SEQ_FRAME, cab.seq, cab.sample_epoch_ms, recv_ms);
+    switch (cab.type) {
+      case FRAME_VITALS: {
+        if (cab.length < sizeof(FrameVitals)) return DECODE_ERROR;
+        FrameVitals f;
+        memcpy(&f, datos, sizeof(f));
+        r.v[0] = f.hr_x10 / 10.0f;
+        r.v[1] = f.spo2_x10 / 10.0f;
+        r.v[2] = f.finger;
+        r.v[3] = f.stage;
+        break;
+      }
+      case FRAME_ENVIRONMENT: {
+        if (cab.length < sizeof(FrameEnvironment)) return DECODE_ERROR;
+        FrameEnvironment f;
+        memcpy(&f, datos, sizeof(f));
+        r.v[0] = f.temp_x100 / 100.0f;
+        r.v[1] = f.humidity_x100 / 100.0f;
+        break;
+      }
+      case FRAME_PRESENCE: {
+        if (cab.length < sizeof(FramePresence)) return DECODE_ERROR;
+        FramePresence f;
+        memcpy(&f, datos, sizeof(f));
+        r.v[0] = f.occupied;
+        r.v[1] = f.confidence;
+        r.v[2] = f.indicators;
+        break;
+      }
+      case FRAME_EPOCH: {
+        if (cab.length < sizeof(FrameEpoch)) return DECODE_ERROR;
+        FrameEpoch f;
+        memcpy(&f, datos, sizeof(f));
+        r.v[0] = f.index;
+        r.v[1] = f.stage;
+        r.v[2] = f.rules_stage;
+        r.v[3] = f.hr_x10 / 10.0f;
+        r.v[4] = f.rmssd_x10 / 10.0f;
+        r.v[5] = f.activity_x1000 / 1000.0f;
+        break;
+      }
+      default:
+        // Tipo nuevo de una versión de firmware posterior: la trama es
+        // válida, sólo no se guarda
+        i += largo + 2;
+        continue;
+    }
+    out.push_back(r);
+    i += largo + 2;
+  }
+  return DECODE_OK;
+}
+
+// La cabecera de include/raw_capture.h (ese archivo necesita Arduino)
+struct __attribute__((packed)) CabeceraCaptura {
+  uint8_t magic[2];
+  uint8_t version;
+  uint8_t triggers;
+  uint16_t seq;
+  uint16_t chunk;
+  uint8_t stream;
+  uint8_t flags;
+  uint16_t first;
+  uint16_t samples;
+  uint16_t total;
+  uint16_t trigger_index;
+  uint32_t period_us;
+  uint64_t trigger_epoch_ms;
+};
+static const uint8_t CAPTURA_VERSION = 1;
+
+static bool leer_varint(const uint8_t*& p, const uint8_t* fin, int32_t& v) {
+  uint32_t z = 0;
+  for (uint8_t corrimiento = 0; corrimiento < 35; corrimiento += 7) {
+    if (p == fin) return false;
+    uint8_t b = *p++;
+    z |= (uint32_t)(b & 0x7F) << corrimiento;
+    if (b < 0x80) {
+      v = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+DecodeResult decodeCaptureChunk(const uint8_t* data, size_t len, uint64_t recv_ms,
+                                std::vector<Record>& out) {
+  CabeceraCaptura cab;
+  if (len < sizeof(cab)) return DECODE_ERROR;
+  memcpy(&cab, data, sizeof(cab));
+  if (cab.magic[0] != 'R' || cab.magic[1] != 'C' || cab.version != CAPTURA_VERSION) {
+    return DECODE_ERROR;
+  }
+  uint8_t canales = cab.stream == 0 ? 2 : cab.stream == 1 ? 3 : 0;
+  if (!canales) return DECODE_ERROR;
+
+  // Sin reloj sincronizado la hora es la de llegada: aproximada, pero las
+  // muestras quedan en orden y a su período
+  uint64_t base_ms = cab.trigger_epoch_ms ? cab.trigger_epoch_ms : recv_ms;
+  const uint8_t* p = data + sizeof(cab);
+  const uint8_t* fin = data + len;
+  int32_t p1[3] = {0, 0, 0}, p2[3] = {0, 0, 0};
+  size_t antes = out.size();
+  for (uint16_t k = 0; k < cab.samples; k++) {
+    uint16_t indice = cab.first + k;
+    int64_t desde_disparo_us = ((int64_t)indice - cab.trigger_index) * cab.period_us;
+    Record r = nuevo(cab.stream == 0 ? RECORD_PPG : RECORD_ACCEL_RAW, SEQ_NONE,
+                     (uint32_t)cab.seq << 16 | indice,
+                     (uint64_t)((int64_t)base_ms + desde_disparo_us / 1000), recv_ms);
+    for (uint8_t c = 0; c < canales; c++) {
+      int32_t residuo;
+      if (!leer_varint(p, fin, residuo)) {
+        out.resize(antes);
+        return DECODE_ERROR;
+      }
+      int32_t v = k == 0 ? residuo : k == 1 ? residuo + p1[c] : residuo + 2 * p1[c] - p2[c];
+      p2[c] = p1[c];
+      p1[c] = v;
+      r.v[c] = v;
+    }
+    out.push_back(r);
+  }
+  return DECODE_OK;
+}
+
+// Valor numérico de "clave": en un JSON plano; false si no está
+static bool campo(const std::string& json, const char* clave, double& valor) {
+  size_t p = json.find(clave);
+  if (p == std::string::npos) return false;
+  const char* inicio = json.c_str() + p + strlen(clave);
+  char* fin;
+  valor = strtod(inicio, &fin);
+  return fin != inicio;
+}
+
+static bool campo_entero(const std::string& json, const char* clave, uint64_t& valor) {
+  size_t p = json.find(clave);
+  if (p == std::string::npos) return false;
+  const char* inicio = json.c_str() + p + strlen(clave);
+  char* fin;
+  valor = strtoull(inicio, &fin, 10);
+  return fin != inicio;
+}
+
+// Traza de latencia: "traza":{"id":N,"adq":EPOCH_MS,...}
+static bool traza(const std::string& json, uint64_t& id, uint64_t& adq) {
+  return campo_entero(json, "\"id\":", id) && campo_entero(json, "\"adq\":", adq);
+}
+
+DecodeResult decodeMessage(const char* suffix, const Message& m, std::vector<Record>& out) {
+  if (!strcmp(suffix, "sensores/trama")) {
+    return decodeFrames((const uint8_t*)m.payload.data(), m.payload.size(), m.recv_ms, out);
+  }
+
+  if (!strcmp(suffix, "sensores/captura")) {
+    return decodeCaptureChunk((const uint8_t*)m.payload.data(), m.payload.size(), m.recv_ms,
+                              out);
+  }
+
+  if (!strcmp(suffix, "sensores/heart_data")) {
+    uint64_t id, adq;
+    double ir, bpm, promedio;
+    if (!traza(m.payload, id, adq) || !campo(m.payload, "\"ir\":", ir) ||
+        !campo(m.payload, "\"bpm\":", bpm) || !campo(m.payload, "\"bpm_avg\":", promedio)) {
+      return DECODE_ERROR;
+    }
+    Record r = nuevo(RECORD_HEART, SEQ_TRACE, (uint32_t)id, adq, m.recv_ms);
+    r.v[0] = ir;
+    r.v[1] = bpm;
+    r.v[2] = promedio;
+    r.v[3] = m.payload.find("\"finger\":\"detectado\"") != std::string::npos ? 1 : 0;
+    out.push_back(r);
+    return DECODE_OK;
+  }
+
+  if (!strcmp(suffix, "sensores/accel_datos")) {
+    uint64_t id, adq;
+    double x, y, z, mag;
+    if (!traza(m.payload, id, adq) || !campo(m.payload, "\"x\":", x) ||
+        !campo(m.payload, "\"y\":", y) || !campo(m.payload, "\"z\":", z) ||
+        !campo(m.payload, "\"mag\":", mag)) {
+      return DECODE_ERROR;
+    }
+    Record r = nuevo(RECORD_ACCEL, SEQ_TRACE, (uint32_t)id, adq, m.recv_ms);
+    r.v[0] = x;
+    r.v[1] = y;
+    r.v[2] = z;
+    r.v[3] = mag;
+    out.push_back(r);
+    return DECODE_OK;
+  }
+
+  if (!strcmp(suffix, "sensores/alerta")) {
+    static const char* const TIPOS[] = {"hr_alta", "hr_baja", "spo2_baja", "temp_cama_alta",
+                                        "temp_cama_baja"};
+    uint64_t id, adq, seq;
+    double activa, valor, umbral;
+    if (!traza(m.payload, id, adq) || !campo_entero(m.payload, "\"seq\":", seq) ||
+        !campo(m.payload, "\"activa\":", activa) || !campo(m.payload, "\"valor\":", valor) ||
+        !campo(m.payload, "\"umbral\":", umbral)) {
+      return DECODE_ERROR;
+    }
+    Record r = nuevo(RECORD_ALERT, SEQ_TRACE, (uint32_t)id, adq, m.recv_ms);
+    r.v[0] = -1;
+    for (size_t t = 0; t < sizeof(TIPOS) / sizeof(TIPOS[0]); t++) {
+      std::string clave = std::string("\"tipo\":\"") + TIPOS[t] + "\"";
+      if (m.payload.find(clave) != std::string::npos) r.v[0] = t;
+    }
+    r.v[1] = activa;
+    r.v[2] = valor;
+    r.v[3] = umbral;
+    r.v[4] = seq;
+    out.push_back(r);
+    return DECODE_OK;
+  }
+
+  if (!strcmp(suffix, "sensores/sueno/epoca")) {
+    uint64_t id, adq;
+    if (!traza(m.payload, id, adq)) return DECODE_ERROR;
+    out.push_back(nuevo(RECORD_TRACE_ONLY, SEQ_TRACE, (uint32_t)id, adq, m.recv_ms));
+    return DECODE_OK;
+  }
+
+  return DECODE_IGNORED;
+}
@@ -0,0 +1,32 @@
+/*
+ * Decodificación de los payloads de las pulseras en el gateway
+ *
+ * Binario: una o más tramas seguidas (la pulsera publica una por mensaje,
+ * BLE junta varias); se verifica magic, versión, largo y CRC de cada una.
+ * JSON heredado: se leen los campos por nombre sin armar un árbol, igual que
+ * la pulsera lee el seq del eco de las alertas. Capturas: cada trozo se
+ * decodifica solo (predictor de segundo orden, como tools/raw_capture.py) y
+ * da una muestra por registro.
+ *
+ * No guarda estado: cada reintento de una alerta da su registro y los
+ * descarta quien sigue a cada pulsera (AlertDedup en seq_tracker.h).
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "record.h"
+
+enum DecodeResult : uint8_t {
+  DECODE_OK,
+  DECODE_IGNORED,  // tópico que el gateway no guarda
+  DECODE_ERROR,    // payload mal formado o CRC inválido
+};
+
+// Los registros se agregan al final de out
+DecodeResult decodeMessage(const char* suffix, const Message& m, std::vector<Record>& out);
+DecodeResult decodeFrames(const uint8_t* data, size_t len, uint64_t recv_ms,
+                          std::vector<Record>& out);
+DecodeResult decodeCaptureChunk(const uint8_t* data, size_t len, uint64_t recv_ms,
+                                std::vector<Record>& out);
@@ -0,0 +1,137 @@
+#include "payload_encoder.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// Los de AlertMonitor::typeName() (src/alert_monitor.cpp)
+static const char* const TIPOS_ALERTA[] = {"hr_alta", "hr_baja", "spo2_baja", "temp_cama_alta",
+                                           "temp_cama_baja"};
+static const int N_TIPOS_ALERTA = sizeof(TIPOS_ALERTA) / sizeof(TIPOS_ALERTA[0]);
+
+static void agregar(std::vector<Message>& out, const std::string& device, const char* sufijo,
+                    std::string payload, uint64_t recv_ms) {
+  Message m;
+  m.topic = "oib/" + device + "/" + sufijo;
+  m.payload = std::move(payload);
+  m.recv_ms = recv_ms;
+  out.push_back(std::move(m));
+}
+
+static std::string texto(const char* formato, double v) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), formato, v);
+  return buf;
+}
+
+// Como FrameEncoder::encode, pero con la seq y la hora del registro
+static std::string trama(const Record& r, const void* datos, uint8_t largo) {
+  uint8_t buf[OIB_FRAME_MAX];
+  FrameHeader cab;
+  cab.magic = OIB_FRAME_MAGIC;
+  cab.version = OIB_FRAME_VERSION;
+  cab.type = r.kind;
+  cab.length = largo;
+  cab.seq = r.seq;
+  cab.sample_epoch_ms = r.sample_ms;
+  memcpy(buf, &cab, sizeof(cab));
+  memcpy(buf + sizeof(cab), datos, largo);
+  uint16_t crc = FrameEncoder::crc16(buf, sizeof(cab) + largo);
+  buf[sizeof(cab) + largo] = crc & 0xFF;
+  buf[sizeof(cab) + largo + 1] = crc >> 8;
+  return std::string((const char*)buf, sizeof(cab) + largo + 2);
+}
+
+// La de traza_json() (src/latency_trace.cpp), sin las etapas
+static std::string traza(const Record& r) {
+  char buf[96];
+  snprintf(buf, sizeof(buf), "\"traza\":{\"id\":%lu,\"adq\":%llu,\"enc\":0,\"cod\":0,\"pub\":0}",
+           (unsigned long)r.seq, (unsigned long long)r.sample_ms);
+  return buf;
+}
+
+bool encodeRecord(const Record& r, const std::string& device, std::vector<Message>& out) {
+  switch (r.kind) {
+    case RECORD_VITALS: {
+      FrameVitals f;
+      f.hr_x10 = (uint16_t)lroundf(r.v[0] * 10);
+      f.spo2_x10 = (uint16_t)lroundf(r.v[1] * 10);
+      f.finger = (uint8_t)r.v[2];
+      f.stage = (uint8_t)r.v[3];
+      agregar(out, device, "sensores/trama", trama(r, &f, sizeof(f)), r.recv_ms);
+      return true;
+    }
+    case RECORD_ENVIRONMENT: {
+      FrameEnvironment f;
+      f.temp_x100 = (int16_t)lroundf(r.v[0] * 100);
+      f.humidity_x100 = (uint16_t)lroundf(r.v[1] * 100);
+      agregar(out, device, "sensores/trama", trama(r, &f, sizeof(f)), r.recv_ms);
+      agregar(out, device, "sensores/temperatura", texto("%.2f", r.v[0]), r.recv_ms);
+      agregar(out, device, "sensores/humedad", texto("%.2f", r.v[1]), r.recv_ms);
+      return true;
+    }
+    case RECORD_PRESENCE: {
+      FramePresence f;
+      f.occupied = (uint8_t)r.v[0];
+      f.confidence = (uint8_t)r.v[1];
+      f.indicators = (uint8_t)r.v[2];
+      f.reserved = 0;
+      agregar(out, device, "sensores/trama", trama(r, &f, sizeof(f)), r.recv_ms);
+      return true;
+    }
+    case RECORD_EPOCH: {
+      FrameEpoch f;
+      f.index = (uint32_t)r.v[0];
+      f.stage = (uint8_t)r.v[1];
+      f.rules_stage = (uint8_t)r.v[2];
+      f.hr_x10 = (uint16_t)lroundf(r.v[3] * 10);
+      f.rmssd_x10 = (uint16_t)lroundf(r.v[4] * 10);
+      f.activity_x1000 = (uint16_t)lroundf(r.v[5] * 1000);
+      agregar(out, device, "sensores/trama", trama(r, &f, sizeof(f)), r.recv_ms);
+      return true;
+    }
+    case RECORD_HEART: {
+      const char* dedo = r.v[3] ? "detectado" : "no_detectado";
+      agregar(out, device, "sensores/ir_value", texto("%.0f", r.v[0]), r.recv_ms);
+      agregar(out, device, "sensores/bpm", texto("%.0f", r.v[1]), r.recv_ms);
+      agregar(out, device, "sensores/bpm_avg", texto("%.0f", r.v[2]), r.recv_ms);
+      agregar(out, device, "sensores/finger_status", dedo, r.recv_ms);
+      char buf[96];
+      snprintf(buf, sizeof(buf), "{\"ir\":%.0f,\"bpm\":%.0f,\"bpm_avg\":%.0f,\"finger\":\"%s\",",
+               r.v[0], r.v[1], r.v[2], dedo);
+      agregar(out, device, "sensores/heart_data", buf + traza(r) + "}", r.recv_ms);
+      return true;
+    }
+    case RECORD_ACCEL: {
+      float x = r.v[0], y = r.v[1], z = r.v[2], mag = r.v[3];
+      if (x >= -4 && x <= 4) agregar(out, device, "sensores/accel_x", texto("%.3f", x), r.recv_ms);
+      if (y >= -4 && y <= 4) agregar(out, device, "sensores/accel_y", texto("%.3f", y), r.recv_ms);
+      if (z >= -4 && z <= 4) agregar(out, device, "sensores/accel_z", texto("%.3f", z), r.recv_ms);
+      agregar(out, device, "sensores/accel_mag", texto("%.3f", mag), r.recv_ms);
+      const char* orientacion = "indefinida";
+      if (fabsf(z) > fabsf(x) && fabsf(z) > fabsf(y)) {
+        if (z > 0.5f) orientacion = "boca_arriba";
+        else if (z < -0.5f) orientacion = "boca_abajo";
+      }
+      agregar(out, device, "sensores/orientacion", orientacion, r.recv_ms);
+      agregar(out, device, "sensores/movimiento", mag > 1.5f ? "SI" : "NO", r.recv_ms);
+      char buf[96];
+      snprintf(buf, sizeof(buf), "{\"x\":%.3f,\"y\":%.3f,\"z\":%.3f,\"mag\":%.3f,", x, y, z, mag);
+      agregar(out, device, "sensores/accel_datos", buf + traza(r) + "}", r.recv_ms);
+      return true;
+    }
+    case RECORD_ALERT: {
+      int tipo = (int)r.v[0];
+      char buf[160];
+      snprintf(buf, sizeof(buf),
+               "{\"seq\":%lu,\"tipo\":\"%s\",\"activa\":%u,\"valor\":%.1f,\"umbral\":%.1f,"
+               "\"intento\":1,\"espera_us\":0,",
+               (unsigned long)r.v[4], tipo >= 0 && tipo < N_TIPOS_ALERTA ? TIPOS_ALERTA[tipo] : "?",
+               r.v[1] ? 1u : 0u, r.v[2], r.v[3]);
+      agregar(out, device, "sensores/alerta", buf + traza(r) + "}", r.recv_ms);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
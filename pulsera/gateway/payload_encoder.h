@@ -0,0 +1,27 @@
+/*
+ * Registros -> mensajes como los publica la pulsera (src/main.cpp)
+ *
+ * Lo inverso de payload_decoder.h, para reproducir las noches guardadas
+ * como si la pulsera estuviera conectada. Las tramas binarias
+ * (sensores/trama) salen idénticas: misma seq, misma hora y los valores a la
+ * escala de la trama, que es la del archivo de noche. Los JSON heredados
+ * (heart_data, accel_datos, alerta) salen con los campos que se guardan y
+ * la traza con id y adq; enc, cod, pub, intento y espera_us no se guardan y
+ * van en 0 (o 1 el intento). Con cada uno van los tópicos sueltos del mismo
+ * ciclo de main.cpp (sensores/bpm, sensores/accel_x, ..., y con la trama de
+ * ambiente sensores/temperatura y sensores/humedad), en el mismo orden.
+ *
+ * Las capturas (PPG y ACCEL_RAW) no se rearman: salen de la pulsera en
+ * trozos comprimidos (include/raw_capture.h) que la noche no guarda.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "record.h"
+
+// Agrega a out los mensajes del registro, con recv_ms = r.recv_ms; false si
+// ese tipo no se reproduce
+bool encodeRecord(const Record& r, const std::string& device, std::vector<Message>& out);
@@ -0,0 +1,285 @@
+/*
+ * oib_query: consultas sobre las noches guardadas por el ingest (night_query.h)
+ *
+ *   --dir DIR --senal TABLA.COLUMNA [--pulsera ID]... [--desde FECHA]
+ *   [--hasta FECHA] [--ultimas N] [--etapa ETAPA]... [--por total|pulsera|noche]
+ *   [--hilos N] [--sin-resumenes]
+ *       n, media, mínimo y máximo de la señal. FECHA: AAAA-MM-DD (el
+ *       mediodía en que empieza esa noche) o AAAA-MM-DDTHH:MM, hora local;
+ *       --hasta excluida. ETAPA: despierto, ligero, rem, profundo, sin_etapa
+ *   --generar --log noche.jsonl --dir DIR [--noches N] [--pulseras N]
+ *       guarda el registro de la simulación (sim --mqtt-log) como N noches
+ *       seguidas de cada pulsera (NightStore, con sus resúmenes)
+ *   --bench --dir DIR [--hilos N]
+ *       consultas típicas sobre lo generado: tiempo con resúmenes y
+ *       recorriendo los registros, con uno y N hilos, y que den lo mismo
+ *
+ *   pio run -e gateway_query
+ *   .pio/build/gateway_query/program --dir /var/lib/oib --senal vitales.hr \
+ *       --pulsera cama-01 --etapa rem --ultimas 30 --por noche
+ */
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "log_source.h"
+#include "night_file.h"
+#include "night_query.h"
+#include "payload_decoder.h"
+
+static bool leer_fecha(const char* s, uint64_t& ms) {
+  int a, m, d, h = 12, min = 0;
+  int campos = sscanf(s, "%4d-%2d-%2dT%2d:%2d", &a, &m, &d, &h, &min);
+  if (campos != 3 && campos != 5) return false;
+  struct tm t = {};
+  t.tm_year = a - 1900;
+  t.tm_mon = m - 1;
+  t.tm_mday = d;
+  t.tm_hour = h;
+  t.tm_min = min;
+  t.tm_isdst = -1;
+  time_t segundos = mktime(&t);
+  if (segundos < 0) return false;
+  ms = (uint64_t)segundos * 1000;
+  return true;
+}
+
+static void imprimir(const NightQuery& q, const std::vector<QueryResult>& res,
+                     const QueryStats& st) {
+  for (const QueryResult& r : res) {
+    std::string grupo = q.group == QUERY_TOTAL ? "total" : r.device;
+    if (q.group == QUERY_BY_NIGHT) grupo += " " + nightName(r.night_start_ms);
+    printf("%-24s n %9llu  media %8.3f  min %8.3f  max %8.3f\n", grupo.c_str(),
+           (unsigned long long)r.count, r.mean(), r.count ? r.min : 0.0f,
+           r.count ? r.max : 0.0f);
+  }
+  printf("%u noches, %llu intervalos de resumen, %llu bloques leídos (%llu salteados por la "
+         "etapa), %llu filas, %.2f ms\n",
+         st.nights, (unsigned long long)st.rollup_buckets, (unsigned long long)st.chunks,
+         (unsigned long long)st.chunks_skipped, (unsigned long long)st.rows, st.seconds * 1e3);
+}
+
+static int generar(const std::string& log, const std::string& dir, uint32_t noches,
+                   uint32_t pulseras) {
+  LogSource fuente;
+  if (!fuente.open(log)) {
+    fprintf(stderr, "No se pudo abrir %s\n", log.c_str());
+    return 1;
+  }
+  std::vector<Record> registros;
+  Message m;
+  double t_ms;
+  bool retenido;
+  std::string dispositivo;
+  const char* sufijo;
+  while (fuente.next(m, t_ms, retenido)) {
+    if (splitTopic(m.topic, dispositivo, sufijo)) decodeMessage(sufijo, m, registros);
+  }
+  registros.erase(std::remove_if(registros.begin(), registros.end(),
+                                 [](const Record& r) { return !nightTable(r.kind); }),
+                  registros.end());
+  if (registros.empty()) {
+    fprintf(stderr, "Sin registros en %s\n", log.c_str());
+    return 1;
+  }
+
+  mkdir(dir.c_str(), 0755);
+  auto t0 = std::chrono::steady_clock::now();
+  uint64_t bytes = 0, bytes_resumen = 0;
+  for (uint32_t p = 0; p < pulseras; p++) {
+    char id[16];
+    snprintf(id, sizeof(id), "cama-%02u", p + 1);
+    NightStore store;
+    if (!store.open(dir, id)) return 1;
+    for (uint32_t k = 0; k < noches; k++) {
+      uint64_t corrimiento = k * 86400000ULL;
+      for (Record r : registros) {
+        if (r.sample_ms) r.sample_ms += corrimiento;
+        r.recv_ms += corrimiento;
+        store.append(r);
+      }
+    }
+    store.close();
+    bytes += store.bytes();
+    bytes_resumen += store.rollupBytes();
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  uint64_t total = (uint64_t)registros.size() * noches * pulseras;
+  printf("%u pulseras × %u noches: %llu registros en %.1f s; registros %.1f MB, resúmenes "
+         "%.1f MB\n",
+         pulseras, noches, (unsigned long long)total, s, bytes / 1e6, bytes_resumen / 1e6);
+  return 0;
+}
+
+struct Caso {
+  const char* nombre;
+  const char* senal;
+  int etapa;             // -1 = sin filtro
+  uint32_t ultimas;
+  bool una_pulsera;
+  QueryGroup grupo;
+};
+
+static double mediana_ms(NightQuery q, uint32_t veces, std::vector<QueryResult>& res,
+                         QueryStats& st) {
+  std::vector<double> ms;
+  for (uint32_t i = 0; i < veces; i++) {
+    res.clear();
+    runQuery(q, res, &st);
+    ms.push_back(st.seconds * 1e3);
+  }
+  std::sort(ms.begin(), ms.end());
+  return ms[ms.size() / 2];
+}
+
+// Misma cantidad; media, mínimo y máximo a la resolución de los resúmenes
+static bool iguales(const std::vector<QueryResult>& a, const std::vector<QueryResult>& b,
+                    double& peor) {
+  if (a.size() != b.size()) return false;
+  auto diferencia = [](double x, double y) { return std::fabs(x - y) / (1 + std::fabs(y)); };
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].count != b[i].count || a[i].device != b[i].device) return false;
+    peor = std::max({peor, diferencia(a[i].mean(), b[i].mean()), diferencia(a[i].min, b[i].min),
+                     diferencia(a[i].max, b[i].max)});
+  }
+  return true;
+}
+
+static int bench(const std::string& dir, uint32_t hilos) {
+  static const Caso CASOS[] = {
+      {"hr en REM, últimas 30 noches", "vitales.hr", 2, 30, true, QUERY_TOTAL},
+      {"hr en REM, todo el año", "vitales.hr", 2, 0, true, QUERY_TOTAL},
+      {"hr por noche, últimas 7", "vitales.hr", -1, 7, true, QUERY_BY_NIGHT},
+      {"temperatura por pulsera, todo", "ambiente.temperatura", -1, 0, false, QUERY_BY_DEVICE},
+      {"movimiento en profundo, todo el año", "accel.mag", 3, 0, true, QUERY_TOTAL},
+      {"rmssd en ligero, todo el año", "epocas.rmssd", 1, 0, true, QUERY_TOTAL},
+      {"bpm en REM, todo el año (sin resumen)", "corazon.bpm", 2, 0, true, QUERY_TOTAL},
+  };
+  NightQuery todas;
+  todas.dir = dir;
+  todas.kind = RECORD_VITALS;
+  std::vector<QueryResult> por_pulsera;
+  todas.group = QUERY_BY_DEVICE;
+  todas.last_nights = 1;
+  if (!runQuery(todas, por_pulsera) || por_pulsera.empty()) {
+    fprintf(stderr, "Sin noches en %s (generarlas con --generar)\n", dir.c_str());
+    return 1;
+  }
+
+  printf("%-40s %10s %10s %10s %8s  %s\n", "consulta", "resúmenes", "registros",
+         "reg. hilos", "bloques", "verificación");
+  bool bien = true;
+  for (const Caso& c : CASOS) {
+    NightQuery q;
+    q.dir = dir;
+    if (c.una_pulsera) q.devices.push_back(por_pulsera[0].device);
+    q.last_nights = c.ultimas;
+    parseQueryColumn(c.senal, q.kind, q.column);
+    if (c.etapa >= 0) q.stages = 1 << c.etapa;
+    q.group = c.grupo;
+
+    std::vector<QueryResult> con, sin, sin_hilos;
+    QueryStats st_con, st_sin, st_hilos;
+    double ms_con = mediana_ms(q, 5, con, st_con);
+    q.use_rollups = false;
+    double ms_sin = mediana_ms(q, 3, sin, st_sin);
+    q.threads = hilos;
+    double ms_hilos = mediana_ms(q, 3, sin_hilos, st_hilos);
+
+    double peor = 0;
+    bool ok = iguales(con, sin, peor) && iguales(sin_hilos, sin, peor);
+    bien = bien && ok && peor < 1e-3;
+    char verificacion[64];
+    snprintf(verificacion, sizeof(verificacion), "%s (media %.1e)",
+             ok ? "igual" : "DISTINTO", peor);
+    printf("%-40s %8.2f ms %7.1f ms %7.1f ms %4llu/%-4llu %s\n", c.nombre, ms_con, ms_sin,
+           ms_hilos, (unsigned long long)st_con.chunks, (unsigned long long)st_sin.chunks,
+           verificacion);
+    printf("%-40s %u noches, %llu intervalos de 30 s, %llu bloques salteados por la etapa, "
+           "media %.3f\n",
+           "", st_con.nights, (unsigned long long)st_con.rollup_buckets,
+           (unsigned long long)st_sin.chunks_skipped, con.empty() ? 0.0 : con[0].mean());
+  }
+  printf("Con %u hilos; bloques: leídos con resúmenes / recorriendo\n", hilos);
+  return bien ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  NightQuery q;
+  std::string log, dir = "noches", senal;
+  bool generar_ = false, medir = false, mal = false;
+  uint32_t noches = 365, pulseras = 4;
+  for (int i = 1; i < argc && !mal; i++) {
+    bool hay = i + 1 < argc;
+    if (!strcmp(argv[i], "--dir") && hay) {
+      dir = argv[++i];
+    } else if (!strcmp(argv[i], "--senal") && hay) {
+      senal = argv[++i];
+      mal = !parseQueryColumn(senal, q.kind, q.column);
+    } else if (!strcmp(argv[i], "--pulsera") && hay) {
+      q.devices.push_back(argv[++i]);
+    } else if (!strcmp(argv[i], "--desde") && hay) {
+      mal = !leer_fecha(argv[++i], q.desde_ms);
+    } else if (!strcmp(argv[i], "--hasta") && hay) {
+      mal = !leer_fecha(argv[++i], q.hasta_ms);
+    } else if (!strcmp(argv[i], "--ultimas") && hay) {
+      q.last_nights = std::max(0, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--etapa") && hay) {
+      int etapa = parseQueryStage(argv[++i]);
+      if (etapa < 0) mal = true;
+      else q.stages |= 1 << etapa;
+    } else if (!strcmp(argv[i], "--por") && hay) {
+      std::string por = argv[++i];
+      if (por == "total") q.group = QUERY_TOTAL;
+      else if (por == "pulsera") q.group = QUERY_BY_DEVICE;
+      else if (por == "noche") q.group = QUERY_BY_NIGHT;
+      else mal = true;
+    } else if (!strcmp(argv[i], "--hilos") && hay) {
+      q.threads = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--sin-resumenes")) {
+      q.use_rollups = false;
+    } else if (!strcmp(argv[i], "--generar")) {
+      generar_ = true;
+    } else if (!strcmp(argv[i], "--log") && hay) {
+      log = argv[++i];
+    } else if (!strcmp(argv[i], "--noches") && hay) {
+      noches = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--pulseras") && hay) {
+      pulseras = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--bench")) {
+      medir = true;
+    } else {
+      mal = true;
+    }
+  }
+  if (!mal && generar_ && !log.empty()) return generar(log, dir, noches, pulseras);
+  if (!mal && medir) return bench(dir, q.threads > 1 ? q.threads : 4);
+  if (!mal && !senal.empty()) {
+    q.dir = dir;
+    std::vector<QueryResult> res;
+    QueryStats st;
+    if (!runQuery(q, res, &st)) {
+      fprintf(stderr, "No se pudo leer %s\n", dir.c_str());
+      return 1;
+    }
+    imprimir(q, res, st);
+    return 0;
+  }
+  fprintf(stderr,
+          "uso: %s --dir DIR --senal TABLA.COLUMNA [--pulsera ID]... [--desde FECHA]\n"
+          "        [--hasta FECHA] [--ultimas N] [--etapa ETAPA]... [--por total|pulsera|noche]\n"
+          "        [--hilos N] [--sin-resumenes]\n"
+          "     %s --generar --log ARCHIVO --dir DIR [--noches N] [--pulseras N]\n"
+          "     %s --bench --dir DIR [--hilos N]\n",
+          argv[0], argv[0], argv[0]);
+  return 1;
+}
@@ -0,0 +1,79 @@
+/*
+ * Mensajes de las pulseras y registros decodificados en el gateway
+ *
+ * Cada mensaje MQTT (oib/<id>/<sufijo>, ver include/device_identity.h) se
+ * decodifica a uno o más Record de tamaño fijo. Las tramas binarias
+ * (sensores/trama, include/telemetry_frame.h) traen su seq; los JSON
+ * heredados (sensores/heart_data y sensores/accel_datos) traen el id de la
+ * traza de latencia, un contador aparte que comparten con las alertas.
+ *
+ * Valores por tipo (v[]):
+ *   VITALS       hr, spo2, dedo, etapa (0xFF = ninguna)
+ *   ENVIRONMENT  temperatura °C, humedad %RH
+ *   PRESENCE     ocupada, confianza %, indicadores
+ *   EPOCH        índice, etapa, etapa de reglas, hr, rmssd ms, actividad
+ *   HEART        ir, bpm, bpm_avg, dedo
+ *   ACCEL        x, y, z, magnitud (g)
+ *   ALERT        AlertType, activa, valor, umbral, seq de la alerta
+ *   PPG          ir, rojo (cuentas del MAX30105, 100 Hz)
+ *   ACCEL_RAW    x, y, z (cuentas del MMA8452Q, 1 g = 1024)
+ *
+ * PPG y ACCEL_RAW salen de las capturas (sensores/captura,
+ * include/raw_capture.h): seq = número de captura << 16 | índice de la
+ * muestra, sin espacio de secuencia propio (SEQ_NONE).
+ *
+ * Desde RECORD_ROLLUP están los resúmenes por intervalo que arma el
+ * gateway (rollup.h): no llegan de la pulsera.
+ *
+ * sensores/sueno/epoca también lleva traza: da un TRACE_ONLY, que sólo
+ * cuenta para la secuencia (la época se guarda desde la trama binaria).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "telemetry_frame.h"
+
+enum RecordKind : uint8_t {
+  RECORD_VITALS = FRAME_VITALS,
+  RECORD_ENVIRONMENT = FRAME_ENVIRONMENT,
+  RECORD_PRESENCE = FRAME_PRESENCE,
+  RECORD_EPOCH = FRAME_EPOCH,
+  RECORD_HEART = 16,
+  RECORD_ACCEL = 17,
+  RECORD_ALERT = 18,
+  RECORD_PPG = 19,
+  RECORD_ACCEL_RAW = 20,
+  RECORD_ROLLUP = 32,  // rollupKind(): una tabla por señal y nivel
+  RECORD_TRACE_ONLY = 0xFF,
+};
+
+// Espacios de numeración independientes: cada uno se valida por separado
+enum SeqSpace : uint8_t {
+  SEQ_FRAME = 0,
+  SEQ_TRACE = 1,
+  SEQ_SPACES = 2,
+  SEQ_NONE = 0xFF,  // no se valida
+};
+
+struct Record {
+  uint64_t sample_ms;  // hora de la muestra en la pulsera (0 = sin sincronizar)
+  uint64_t recv_ms;    // llegada al gateway (hora de pared)
+  uint32_t seq;
+  uint8_t kind;        // RecordKind
+  uint8_t seq_space;   // SeqSpace
+  uint8_t reserved[2];
+  float v[6];
+};
+static_assert(sizeof(Record) == 48, "Record se guarda tal cual en disco");
+
+struct Message {
+  std::string topic;
+  std::string payload;
+  uint64_t recv_ms = 0;
+};
+
+// "oib/<id>/<sufijo>" -> id y puntero al sufijo; false si no es de una pulsera
+bool splitTopic(const std::string& topic, std::string& device, const char*& suffix);
@@ -0,0 +1,288 @@
+/*
+ * oib_replay: reproduce noches grabadas en un broker, como pulseras en vivo
+ *
+ * Para cargar el gateway y el controlador de la cama con noches reales a
+ * 1×, 10× o 100×:
+ *
+ *   --log noche.jsonl    el registro de la simulación (sim --mqtt-log): cada
+ *                        publicación sale tal cual (tópico, payload, retenido)
+ *   --noche A.oibn ...   archivos de noche del ingest (night_file.h): los
+ *                        mensajes se rearman desde los registros
+ *                        (payload_encoder.h) y se verifica que decodifiquen
+ *                        a los mismos; varios archivos salen mezclados por
+ *                        hora de llegada
+ *
+ * Los tiempos entre mensajes son los grabados divididos por --velocidad
+ * (1 = tiempo real, 0 = lo más rápido posible). Con --copias N cada mensaje
+ * de una pulsera sale también para <id>-1 ... <id>-(N-1), como en
+ * oib_ingest --copias. Mientras espera, el socket atiende el keepalive.
+ *
+ * El informe compara el ritmo pedido con el logrado y mide el atraso de
+ * cada mensaje respecto de su horario: si crece, el broker o la red no dan
+ * abasto a esa velocidad.
+ *
+ *   pio run -e gateway_replay
+ *   .pio/build/gateway_replay/program --broker localhost --log noche.jsonl --velocidad 10
+ *   .pio/build/gateway_replay/program --broker localhost --noche /var/lib/oib/X/2026-01-01.oibn \
+ *       --velocidad 100 --copias 12
+ */
+
+#include <signal.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "latency_histogram.h"
+#include "log_source.h"
+#include "mqtt_socket.h"
+#include "night_file.h"
+#include "payload_decoder.h"
+#include "payload_encoder.h"
+
+struct Opciones {
+  std::string broker;
+  uint16_t puerto = 1883;
+  std::string usuario;
+  std::string password;
+  std::string log;
+  std::vector<std::string> noches;
+  std::string pulsera;  // en vez del id guardado en la noche
+  double velocidad = 1;
+  uint32_t copias = 1;
+  double informe_s = 10;
+};
+
+struct Publicacion {
+  double t_ms;  // desde el principio de la grabación
+  Message m;
+  bool retenido;
+};
+
+struct Contadores {
+  uint64_t mensajes = 0;
+  uint64_t bytes = 0;
+  uint64_t perdidos = 0;  // sin conexión con el broker
+  LatencyHistogram atraso;  // µs después de su horario
+};
+
+static std::atomic<bool> terminar{false};
+
+static void al_terminar(int) { terminar = true; }
+
+static bool cargar_log(const std::string& ruta, std::vector<Publicacion>& publicaciones) {
+  LogSource log;
+  if (!log.open(ruta)) return false;
+  Publicacion p;
+  while (log.next(p.m, p.t_ms, p.retenido)) publicaciones.push_back(p);
+  if (log.badLines()) {
+    fprintf(stderr, "%llu líneas descartadas\n", (unsigned long long)log.badLines());
+  }
+  return true;
+}
+
+static bool mismo_registro(const Record& a, const Record& b) {
+  if (a.kind != b.kind || a.seq != b.seq || a.sample_ms != b.sample_ms) return false;
+  const NightTable* t = nightTable(a.kind);
+  for (uint8_t c = 0; t && c < t->values; c++) {
+    if (a.v[c] != b.v[c]) return false;
+  }
+  return true;
+}
+
+// Los registros de la noche, rearmados como los publicó la pulsera; t_ms es
+// la hora de llegada, hasta ordenar todo
+static bool cargar_noche(const std::string& ruta, const std::string& pulsera,
+                         std::vector<Publicacion>& publicaciones) {
+  NightReader r;
+  if (!r.open(ruta)) return false;
+  const NightFileHeader& c = r.header();
+  std::string id = !pulsera.empty() ? pulsera
+                                    : std::string(c.device, strnlen(c.device, sizeof(c.device)));
+  std::vector<Record> registros;
+  for (size_t i = 0; i < r.index().size(); i++) {
+    if (r.index()[i].kind < RECORD_ROLLUP) r.readChunk(i, registros);
+  }
+  std::stable_sort(registros.begin(), registros.end(),
+                   [](const Record& a, const Record& b) { return a.recv_ms < b.recv_ms; });
+
+  uint64_t rearmados = 0, sin_rearmar = 0, distintos = 0;
+  std::vector<Message> mensajes;
+  std::vector<Record> vuelta;
+  for (const Record& rec : registros) {
+    mensajes.clear();
+    if (!encodeRecord(rec, id, mensajes)) {
+      sin_rearmar++;
+      continue;
+    }
+    rearmados++;
+    vuelta.clear();
+    for (Message& m : mensajes) {
+      std::string dispositivo;
+      const char* sufijo;
+      if (splitTopic(m.topic, dispositivo, sufijo)) decodeMessage(sufijo, m, vuelta);
+      publicaciones.push_back({(double)rec.recv_ms, std::move(m), false});
+    }
+    if (vuelta.size() != 1 || !mismo_registro(vuelta[0], rec)) distintos++;
+  }
+  printf("%s: pulsera %s, %llu registros rearmados (%llu distintos al decodificarlos), "
+         "%llu de capturas sin rearmar\n",
+         ruta.c_str(), id.c_str(), (unsigned long long)rearmados, (unsigned long long)distintos,
+         (unsigned long long)sin_rearmar);
+  return true;
+}
+
+static void informe(const Contadores& c, double s, double pedido, bool final) {
+  fprintf(stdout,
+          "%s%llu mensajes en %.1f s: %.0f msg/s (pedido %.0f msg/s), %.2f MB/s | atraso p50 "
+          "%.2f ms, p99 %.2f ms, máx %.2f ms | perdidos %llu\n",
+          final ? "\nReproducción: " : "", (unsigned long long)c.mensajes, s, c.mensajes / s,
+          pedido, c.bytes / s / 1e6, c.atraso.percentile(0.50) / 1000.0,
+          c.atraso.percentile(0.99) / 1000.0, c.atraso.max() / 1000.0,
+          (unsigned long long)c.perdidos);
+  fflush(stdout);
+}
+
+static bool conectar(const Opciones& o, MqttSocket& mqtt) {
+  if (mqtt.connect(o.broker, o.puerto, "oib-replay", o.usuario, o.password)) return true;
+  fprintf(stderr, "Sin conexión con %s:%u\n", o.broker.c_str(), o.puerto);
+  return false;
+}
+
+int main(int argc, char** argv) {
+  Opciones o;
+  bool mal = false;
+  for (int i = 1; i < argc && !mal; i++) {
+    bool hay = i + 1 < argc;
+    if (!strcmp(argv[i], "--broker") && hay) {
+      o.broker = argv[++i];
+    } else if (!strcmp(argv[i], "--puerto") && hay) {
+      o.puerto = (uint16_t)atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--usuario") && hay) {
+      o.usuario = argv[++i];
+    } else if (!strcmp(argv[i], "--password") && hay) {
+      o.password = argv[++i];
+    } else if (!strcmp(argv[i], "--log") && hay) {
+      o.log = argv[++i];
+    } else if (!strcmp(argv[i], "--noche") && hay) {
+      o.noches.push_back(argv[++i]);
+    } else if (!strcmp(argv[i], "--pulsera") && hay) {
+      o.pulsera = argv[++i];
+    } else if (!strcmp(argv[i], "--velocidad") && hay) {
+      o.velocidad = std::max(0.0, atof(argv[++i]));
+    } else if (!strcmp(argv[i], "--copias") && hay) {
+      o.copias = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--informe") && hay) {
+      o.informe_s = atof(argv[++i]);
+    } else {
+      mal = true;
+    }
+  }
+  if (mal || o.broker.empty() || o.log.empty() == o.noches.empty()) {
+    fprintf(stderr,
+            "uso: %s --broker HOST (--log ARCHIVO | --noche ARCHIVO.oibn ...) [--puerto N]\n"
+            "          [--usuario U] [--password P] [--velocidad X] [--copias N] [--pulsera ID]\n"
+            "          [--informe S]\n",
+            argv[0]);
+    return 1;
+  }
+
+  std::vector<Publicacion> grabacion;
+  if (!o.log.empty() && !cargar_log(o.log, grabacion)) {
+    fprintf(stderr, "No se pudo abrir %s\n", o.log.c_str());
+    return 1;
+  }
+  for (const std::string& ruta : o.noches) {
+    if (!cargar_noche(ruta, o.pulsera, grabacion)) {
+      fprintf(stderr, "No se pudo abrir %s como archivo de noche\n", ruta.c_str());
+      return 1;
+    }
+  }
+  if (grabacion.empty()) {
+    fprintf(stderr, "Nada que reproducir\n");
+    return 1;
+  }
+  std::stable_sort(grabacion.begin(), grabacion.end(),
+                   [](const Publicacion& a, const Publicacion& b) { return a.t_ms < b.t_ms; });
+  double t0 = grabacion.front().t_ms;
+  double duracion_s = (grabacion.back().t_ms - t0) / 1000;
+  uint64_t total = (uint64_t)grabacion.size() * o.copias;
+  // Ritmo pedido: el de la grabación por la velocidad (0 = sin techo)
+  double pedido = o.velocidad > 0 && duracion_s > 0 ? total / duracion_s * o.velocidad : 0;
+  printf("%llu mensajes en %.1f min grabados, a %gx: %.1f min, %.0f msg/s\n",
+         (unsigned long long)total, duracion_s / 60, o.velocidad,
+         o.velocidad > 0 ? duracion_s / 60 / o.velocidad : 0.0, pedido);
+
+  MqttSocket mqtt;
+  if (!conectar(o, mqtt)) return 1;
+  signal(SIGINT, al_terminar);
+  signal(SIGTERM, al_terminar);
+
+  auto nada = [](std::string&&, std::string&&) {};
+  Contadores c;
+  auto inicio = std::chrono::steady_clock::now();
+  auto segundos = [&] {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+  };
+  auto periodo = std::chrono::milliseconds((int64_t)(o.informe_s * 1000));
+  auto siguiente_informe = inicio + periodo;
+  auto siguiente_conexion = inicio;
+  std::string dispositivo;
+  const char* sufijo;
+
+  for (size_t i = 0; i < grabacion.size() && !terminar; i++) {
+    const Publicacion& p = grabacion[i];
+    auto ahora = std::chrono::steady_clock::now();
+    if (o.velocidad > 0) {
+      auto horario = inicio + std::chrono::microseconds(
+                                  (int64_t)((p.t_ms - t0) * 1000 / o.velocidad));
+      if (horario > ahora) {
+        // Lo anterior sale antes de esperar; la espera atiende el keepalive
+        mqtt.flush();
+        int64_t falta_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(horario - ahora).count();
+        if (falta_ms > 2 && mqtt.connected()) mqtt.poll(falta_ms - 1, nada);
+        std::this_thread::sleep_until(horario);
+        ahora = std::chrono::steady_clock::now();
+      }
+      c.atraso.add(std::chrono::duration_cast<std::chrono::microseconds>(ahora - horario).count());
+    } else if (i % 1024 == 0 && mqtt.connected()) {
+      mqtt.poll(0, nada);
+    }
+
+    if (!mqtt.connected() && ahora >= siguiente_conexion) {
+      if (!conectar(o, mqtt)) siguiente_conexion = ahora + std::chrono::seconds(1);
+    }
+    bool propio = splitTopic(p.m.topic, dispositivo, sufijo);
+    for (uint32_t k = 0; k < (propio ? o.copias : 1); k++) {
+      const std::string topico =
+          k == 0 ? p.m.topic : "oib/" + dispositivo + "-" + std::to_string(k) + "/" + sufijo;
+      if (mqtt.publish(topico, p.m.payload.data(), p.m.payload.size(), p.retenido)) {
+        c.mensajes++;
+        c.bytes += topico.size() + p.m.payload.size();
+      } else {
+        c.perdidos++;
+      }
+    }
+
+    if (o.informe_s > 0 && ahora >= siguiente_informe) {
+      informe(c, segundos(), pedido, false);
+      siguiente_informe += periodo;
+    }
+  }
+  mqtt.flush();
+  double s = segundos();
+  mqtt.disconnect();
+  informe(c, s, pedido, true);
+  if (pedido > 0) {
+    printf("Logrado %.1f %% del ritmo pedido; %.1f s contra %.1f s ideales\n",
+           100.0 * (c.mensajes / s) / pedido, s, duracion_s / o.velocidad);
+  }
+  return 0;
+}
@@ -0,0 +1,181 @@
+#include "rollup.h"
+
+#include <algorithm>
+
+#include "night_file.h"
+
+static const RollupSignalDef SENALES[ROLLUP_SIGNALS + 1] = {
+    {"hr", RECORD_VITALS, 0, true},
+    {"spo2", RECORD_VITALS, 1, true},
+    {"temperatura", RECORD_ENVIRONMENT, 0, false},
+    {"humedad", RECORD_ENVIRONMENT, 1, false},
+    {"movimiento", RECORD_ACCEL, 3, false},
+    {"rmssd", RECORD_EPOCH, 4, true},
+    {"actividad", RECORD_EPOCH, 5, false},
+    {"etapas", RECORD_VITALS, 3, false},
+};
+
+static const char* NIVELES[ROLLUP_TIERS] = {"1s", "30s", "5min"};
+
+// Nombres de las tablas, "<señal>_<nivel>"
+static const char* TABLAS[ROLLUP_SIGNALS + 1][ROLLUP_TIERS] = {
+    {"hr_1s", "hr_30s", "hr_5min"},
+    {"spo2_1s", "spo2_30s", "spo2_5min"},
+    {"temperatura_1s", "temperatura_30s", "temperatura_5min"},
+    {"humedad_1s", "humedad_30s", "humedad_5min"},
+    {"movimiento_1s", "movimiento_30s", "movimiento_5min"},
+    {"rmssd_1s", "rmssd_30s", "rmssd_5min"},
+    {"actividad_1s", "actividad_30s", "actividad_5min"},
+    {"etapas_1s", "etapas_30s", "etapas_5min"},
+};
+
+const RollupSignalDef& rollupSignal(uint8_t signal) { return SENALES[signal]; }
+
+const char* rollupTierName(uint8_t tier) { return NIVELES[tier]; }
+
+std::vector<NightTable> rollupTables() {
+  std::vector<NightTable> tablas;
+  for (uint8_t s = 0; s <= ROLLUP_SIGNALS; s++) {
+    for (uint8_t n = 0; n < ROLLUP_TIERS; n++) {
+      // En las unidades de la señal, a milésimas (alcanza para todas). El
+      // máximo y la media van como diferencia con el mínimo: en el nivel de
+      // 1 s casi siempre hay una sola muestra y quedan en rachas de ceros.
+      if (s == ROLLUP_STAGES) {
+        tablas.push_back({rollupKind(s, n), TABLAS[s][n], ROLLUP_STAGE_BINS,
+                          {{"despierto", 1, 1},
+                           {"ligero", 1, 1},
+                           {"rem", 1, 1},
+                           {"profundo", 1, 1},
+                           {"sin_etapa", 1, 1}}});
+      } else {
+        tablas.push_back({rollupKind(s, n), TABLAS[s][n], 4,
+                          {{"min", 1000, 1}, {"rango", 1000, 1}, {"sobre_min", 1000, 1}, {"n", 1, 1}}});
+      }
+    }
+  }
+  return tablas;
+}
+
+void RollupBuilder::agregar(Acumulador& a, uint8_t senal, float v) {
+  if (senal == ROLLUP_STAGES) {
+    a.etapas[v >= 0 && v < ROLLUP_STAGE_BINS - 1 ? (int)v : ROLLUP_STAGE_BINS - 1]++;
+  } else {
+    a.min = a.n ? std::min(a.min, v) : v;
+    a.max = a.n ? std::max(a.max, v) : v;
+    a.suma += v;
+  }
+  a.n++;
+}
+
+void RollupBuilder::emitir(const Acumulador& a, uint8_t senal, uint8_t nivel,
+                           std::vector<Record>& out) {
+  Record r = {};
+  r.sample_ms = a.inicio;
+  r.recv_ms = a.inicio;
+  r.kind = rollupKind(senal, nivel);
+  r.seq_space = SEQ_NONE;
+  if (senal == ROLLUP_STAGES) {
+    for (uint8_t b = 0; b < ROLLUP_STAGE_BINS; b++) r.v[b] = a.etapas[b];
+  } else {
+    r.v[0] = a.min;
+    r.v[1] = a.max - a.min;
+    r.v[2] = (float)(a.suma / a.n - a.min);
+    r.v[3] = a.n;
+  }
+  out.push_back(r);
+}
+
+void RollupBuilder::add(const Record& r, std::vector<Record>& out) {
+  uint64_t t = r.sample_ms ? r.sample_ms : r.recv_ms;
+  for (uint8_t s = 0; s <= ROLLUP_SIGNALS; s++) {
+    const RollupSignalDef& d = SENALES[s];
+    if (d.kind != r.kind) continue;
+    float v = r.v[d.value];
+    if (d.positive && !(v > 0)) continue;
+    for (uint8_t n = 0; n < ROLLUP_TIERS; n++) sumar(s, n, t, v, out);
+  }
+}
+
+void RollupBuilder::sumar(uint8_t senal, uint8_t nivel, uint64_t t, float v,
+                          std::vector<Record>& out) {
+  Acumulador& a = acumuladores[senal][nivel];
+  uint64_t inicio = t - t % ROLLUP_TIER_MS[nivel];
+  if (a.n && inicio != a.inicio) {
+    if (inicio < a.inicio) {
+      // Llegó tarde: fila aparte para su intervalo, se combina al leer. Lo
+      // que se guardó sin conexión llega en orden, así que se junta hasta
+      // que cambia el intervalo en vez de una fila por muestra
+      Acumulador& tarde = tardios[senal][nivel];
+      if (tarde.n && tarde.inicio != inicio) {
+        emitir(tarde, senal, nivel, out);
+        tarde = Acumulador();
+      }
+      if (!tarde.n) tarde.inicio = inicio;
+      agregar(tarde, senal, v);
+      return;
+    }
+    emitir(a, senal, nivel, out);
+    a = Acumulador();
+  }
+  if (!a.n) a.inicio = inicio;
+  agregar(a, senal, v);
+}
+
+void RollupBuilder::flush(uint64_t t_ms, std::vector<Record>& out) {
+  uint64_t hasta = t_ms == UINT64_MAX ? UINT64_MAX : t_ms - std::min<uint64_t>(t_ms, ROLLUP_WAIT_MS);
+  for (uint8_t s = 0; s <= ROLLUP_SIGNALS; s++) {
+    for (uint8_t n = 0; n < ROLLUP_TIERS; n++) {
+      for (Acumulador* a : {&tardios[s][n], &acumuladores[s][n]}) {
+        if (!a->n || a->inicio + ROLLUP_TIER_MS[n] > hasta) continue;
+        emitir(*a, s, n, out);
+        *a = Acumulador();
+      }
+    }
+  }
+}
+
+// Filas de la tabla en el rango, ordenadas por intervalo
+static void filas_en_rango(const NightReader& r, uint8_t kind, uint64_t desde_ms, uint64_t hasta_ms,
+                           std::vector<Record>& filas) {
+  filas.clear();
+  if (hasta_ms <= desde_ms) return;
+  std::pair<size_t, size_t> rango = r.seek(kind, desde_ms, hasta_ms - 1);
+  for (size_t i = rango.first; i < rango.second; i++) r.readChunk(i, filas);
+  filas.erase(std::remove_if(filas.begin(), filas.end(),
+                             [&](const Record& f) {
+                               return f.sample_ms < desde_ms || f.sample_ms >= hasta_ms;
+                             }),
+              filas.end());
+  std::stable_sort(filas.begin(), filas.end(),
+                   [](const Record& a, const Record& b) { return a.sample_ms < b.sample_ms; });
+}
+
+void readRollups(const NightReader& r, uint8_t signal, uint8_t tier, uint64_t desde_ms,
+                 uint64_t hasta_ms, std::vector<RollupBucket>& out) {
+  std::vector<Record> filas;
+  filas_en_rango(r, rollupKind(signal, tier), desde_ms, hasta_ms, filas);
+  size_t primero = out.size();
+  for (const Record& f : filas) {
+    RollupBucket fila = {f.sample_ms, (uint32_t)f.v[3], f.v[0], f.v[0] + f.v[1], f.v[0] + f.v[2]};
+    if (out.size() > primero && out.back().t == fila.t) {
+      RollupBucket& b = out.back();
+      b.mean = (b.mean * b.n + fila.mean * fila.n) / (b.n + fila.n);
+      b.min = std::min(b.min, fila.min);
+      b.max = std::max(b.max, fila.max);
+      b.n += fila.n;
+    } else {
+      out.push_back(fila);
+    }
+  }
+}
+
+void readStages(const NightReader& r, uint8_t tier, uint64_t desde_ms, uint64_t hasta_ms,
+                std::vector<StageBucket>& out) {
+  std::vector<Record> filas;
+  filas_en_rango(r, rollupKind(ROLLUP_STAGES, tier), desde_ms, hasta_ms, filas);
+  size_t primero = out.size();
+  for (const Record& f : filas) {
+    if (out.size() == primero || out.back().t != f.sample_ms) out.push_back({f.sample_ms, {}});
+    for (uint8_t b = 0; b < ROLLUP_STAGE_BINS; b++) out.back().n[b] += (uint32_t)f.v[b];
+  }
+}
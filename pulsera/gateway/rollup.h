@@ -0,0 +1,120 @@
+/*
+ * Resúmenes de la noche a 1 s, 30 s (una época) y 5 min
+ *
+ * Mientras guarda los registros, NightStore (night_file.h) va armando por
+ * pulsera el mínimo, máximo, media y cantidad de cada señal de ROLLUP_SIGNALS
+ * y el histograma de etapas de los vitales en cada intervalo, y los escribe
+ * al lado del archivo de noche, en <AAAA-MM-DD>.oibr con el mismo formato:
+ * una tabla por señal y nivel (rollupKind()), con t = inicio del intervalo.
+ * Cada registro suma a un acumulador por señal y nivel: O(1), sin buscar.
+ *
+ * Un intervalo se cierra cuando llega una muestra de uno posterior, cuando
+ * pasaron ROLLUP_WAIT_MS desde su fin (sync) o al cambiar de noche. Una muestra de un intervalo
+ * ya cerrado (la pulsera mandando lo que guardó sin conexión, un reinicio
+ * del ingest) va a un segundo acumulador por señal y nivel, que sale como
+ * fila aparte cuando llega una tarde de otro intervalo o en flush(): puede
+ * haber varias filas por intervalo y readRollups() las combina.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "record.h"
+
+struct NightTable;
+class NightReader;
+
+#ifndef ROLLUP_WAIT_MS
+#define ROLLUP_WAIT_MS 60000
+#endif
+
+enum RollupTier : uint8_t {
+  ROLLUP_1S = 0,
+  ROLLUP_30S = 1,
+  ROLLUP_5MIN = 2,
+  ROLLUP_TIERS = 3,
+};
+
+static const uint32_t ROLLUP_TIER_MS[ROLLUP_TIERS] = {1000, 30000, 300000};
+
+enum RollupSignal : uint8_t {
+  ROLLUP_HR = 0,
+  ROLLUP_SPO2,
+  ROLLUP_TEMPERATURE,
+  ROLLUP_HUMIDITY,
+  ROLLUP_MOVEMENT,
+  ROLLUP_RMSSD,
+  ROLLUP_ACTIVITY,
+  ROLLUP_SIGNALS,
+  // Histograma de etapas de los vitales: despierto, ligero, REM, profundo y
+  // sin etapa, en muestras
+  ROLLUP_STAGES = ROLLUP_SIGNALS,
+};
+
+static const uint8_t ROLLUP_STAGE_BINS = 5;
+
+struct RollupSignalDef {
+  const char* name;
+  uint8_t kind;   // RecordKind de donde sale
+  uint8_t value;  // índice en Record::v
+  bool positive;  // 0 = sin lectura (hr sin dedo, rmssd sin latidos)
+};
+
+const RollupSignalDef& rollupSignal(uint8_t signal);
+const char* rollupTierName(uint8_t tier);
+
+// Tabla de los resúmenes de una señal (o ROLLUP_STAGES) en un nivel
+inline uint8_t rollupKind(uint8_t signal, uint8_t tier) {
+  return RECORD_ROLLUP + signal * ROLLUP_TIERS + tier;
+}
+// Las tablas para nightTables(): min, max − min, media − min, n (o los bins
+// de etapas). readRollups() las devuelve como RollupBucket.
+std::vector<NightTable> rollupTables();
+
+class RollupBuilder {
+ public:
+  // Suma el registro a sus intervalos; los que cierra quedan en out
+  void add(const Record& r, std::vector<Record>& out);
+  // Cierra los intervalos que terminaron antes de t_ms − ROLLUP_WAIT_MS
+  // (UINT64_MAX: todos, al cerrar la noche)
+  void flush(uint64_t t_ms, std::vector<Record>& out);
+
+ private:
+  struct Acumulador {
+    uint64_t inicio = 0;
+    uint32_t n = 0;
+    float min = 0;
+    float max = 0;
+    double suma = 0;
+    uint32_t etapas[ROLLUP_STAGE_BINS] = {};
+  };
+
+  static void agregar(Acumulador& a, uint8_t senal, float v);
+  static void emitir(const Acumulador& a, uint8_t senal, uint8_t nivel, std::vector<Record>& out);
+  void sumar(uint8_t senal, uint8_t nivel, uint64_t t, float v, std::vector<Record>& out);
+
+  Acumulador acumuladores[ROLLUP_SIGNALS + 1][ROLLUP_TIERS];
+  Acumulador tardios[ROLLUP_SIGNALS + 1][ROLLUP_TIERS];  // último intervalo ya cerrado
+};
+
+struct RollupBucket {
+  uint64_t t;  // inicio del intervalo
+  uint32_t n;
+  float min;
+  float max;
+  float mean;
+};
+
+struct StageBucket {
+  uint64_t t;
+  uint32_t n[ROLLUP_STAGE_BINS];
+};
+
+// Intervalos de un archivo de resúmenes que empiezan en [desde_ms, hasta_ms),
+// ordenados y con las filas del mismo intervalo combinadas; se agregan a out
+void readRollups(const NightReader& r, uint8_t signal, uint8_t tier, uint64_t desde_ms,
+                 uint64_t hasta_ms, std::vector<RollupBucket>& out);
+void readStages(const NightReader& r, uint8_t tier, uint64_t desde_ms, uint64_t hasta_ms,
+                std::vector<StageBucket>& out);
@@ -0,0 +1,117 @@
+/*
+ * Validación de números de secuencia por pulsera
+ *
+ * Ventana de VENTANA números detrás del máximo visto: lo que llega dentro de
+ * la ventana y ya estaba es un duplicado (QoS 1 reentregado, la misma trama
+ * por dos caminos) y se descarta; lo que faltaba es un reordenamiento y
+ * descuenta el hueco que había dejado. Un salto hacia atrás más grande que
+ * la ventana es un reinicio de la pulsera (los contadores vuelven a 1).
+ */
+
+#pragma once
+
+#include <cstdint>
+
+class SeqTracker {
+ public:
+  static const uint32_t VENTANA = 64;
+
+  enum Result : uint8_t { SEQ_NEW, SEQ_DUPLICATE, SEQ_REORDERED, SEQ_RESET };
+
+  Result observe(uint32_t seq) {
+    if (!iniciado) {
+      iniciado = true;
+      maximo = seq;
+      vistos = 1;
+      return SEQ_NEW;
+    }
+    if (seq > maximo) {
+      uint32_t salto = seq - maximo;
+      huecos += salto - 1;
+      vistos = salto >= VENTANA ? 1 : (vistos << salto) | 1;
+      maximo = seq;
+      return SEQ_NEW;
+    }
+    uint32_t atras = maximo - seq;
+    if (atras >= VENTANA) {
+      reinicios++;
+      maximo = seq;
+      vistos = 1;
+      return SEQ_RESET;
+    }
+    uint64_t bit = 1ULL << atras;
+    if (vistos & bit) {
+      duplicados++;
+      return SEQ_DUPLICATE;
+    }
+    vistos |= bit;
+    if (huecos) huecos--;
+    reordenados++;
+    return SEQ_REORDERED;
+  }
+
+  uint64_t gaps() const { return huecos; }
+  uint64_t duplicates() const { return duplicados; }
+  uint64_t reordered() const { return reordenados; }
+  uint64_t resets() const { return reinicios; }
+
+ private:
+  bool iniciado = false;
+  uint32_t maximo = 0;
+  uint64_t vistos = 0;  // bit i: llegó maximo - i
+  uint64_t huecos = 0;
+  uint64_t duplicados = 0;
+  uint64_t reordenados = 0;
+  uint64_t reinicios = 0;
+};
+
+// Reintentos de una alerta (include/alert_monitor.h): hasta recibir el eco la
+// pulsera la republica con el mismo seq de alerta y la misma muestra, pero
+// con un id de traza nuevo, así que SeqTracker no los ve. Se recuerdan las
+// últimas MEMORIA alertas de la pulsera y solo es reintento la que coincide
+// en seq y en la hora de la muestra (con TOLERANCIA_MS por el redondeo y los
+// ajustes de SNTP). Sin hora en alguno de los dos lados no se puede separar
+// de un seq que vuelve a empezar después de un reinicio y se guarda: una
+// fila repetida no hace daño, una alerta perdida sí. Un reinicio visto por
+// SeqTracker vacía la memoria con forget().
+class AlertDedup {
+ public:
+  static const uint8_t MEMORIA = 16;  // el doble de AlertMonitor::QUEUE
+  static const uint64_t TOLERANCIA_MS = 10000;
+
+  // false si es un reintento de una alerta que ya llegó
+  bool first(uint32_t seq, uint8_t type, bool active, uint64_t sample_ms) {
+    for (uint8_t i = 0; i < n; i++) {
+      const Vista& v = vistas[i];
+      if (v.seq != seq || v.tipo != type || v.activa != active) continue;
+      uint64_t dif = v.muestra_ms > sample_ms ? v.muestra_ms - sample_ms : sample_ms - v.muestra_ms;
+      if (v.muestra_ms && sample_ms && dif <= TOLERANCIA_MS) {
+        repetidas++;
+        return false;
+      }
+    }
+    vistas[pos] = Vista{seq, type, active, sample_ms};
+    pos = (pos + 1) % MEMORIA;
+    if (n < MEMORIA) n++;
+    return true;
+  }
+
+  void forget() {
+    n = 0;
+    pos = 0;
+  }
+
+  uint64_t duplicates() const { return repetidas; }
+
+ private:
+  struct Vista {
+    uint32_t seq;
+    uint8_t tipo;
+    bool activa;
+    uint64_t muestra_ms;
+  };
+  Vista vistas[MEMORIA];
+  uint8_t n = 0;
+  uint8_t pos = 0;
+  uint64_t repetidas = 0;
+};
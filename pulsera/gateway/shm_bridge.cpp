@@ -0,0 +1,145 @@
+#include "shm_bridge.h"
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+static int posicion_tipo(uint8_t kind) {
+  for (uint8_t i = 0; i < SHM_KIND_COUNT; i++) {
+    if (SHM_KINDS[i] == kind) return i;
+  }
+  return -1;
+}
+
+bool ShmBridge::open(const char* name) {
+  close();
+  fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return false;
+  // Antes de tocar el tamaño o la cabecera: si otro ingest lo escribe, nada
+  size_t tam = sizeof(ShmHeader) + (size_t)OIB_SHM_DEVICES * sizeof(ShmDevice);
+  void* m = MAP_FAILED;
+  if (flock(fd, LOCK_EX | LOCK_NB) == 0 && ftruncate(fd, tam) == 0) {
+    m = mmap(nullptr, tam, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (m == MAP_FAILED) {
+    int error = errno;
+    ::close(fd);
+    fd = -1;
+    errno = error;
+    return false;
+  }
+  cabecera = (ShmHeader*)m;
+  largo = tam;
+
+  // Un lector de la corrida anterior puede estar mirando: primero se
+  // invalida la cabecera, después se limpian las pulseras bajo su seqlock
+  cabecera->magic = 0;
+  std::atomic_thread_fence(std::memory_order_release);
+  for (int i = 0; i < OIB_SHM_DEVICES; i++) {
+    ShmDevice* d = dispositivo(i);
+    uint32_t s = d->seq.load(std::memory_order_relaxed) | 1;
+    d->seq.store(s, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memset(d->id, 0, sizeof(ShmDevice) - offsetof(ShmDevice, id));
+    d->seq_end.store(s + 1, std::memory_order_relaxed);
+    d->seq.store(s + 1, std::memory_order_release);
+  }
+  struct timespec ahora;
+  clock_gettime(CLOCK_REALTIME, &ahora);
+  cabecera->version = VERSION;
+  cabecera->header_size = sizeof(ShmHeader);
+  cabecera->max_devices = OIB_SHM_DEVICES;
+  cabecera->device_size = sizeof(ShmDevice);
+  cabecera->ring_size = OIB_SHM_RING;
+  cabecera->devices.store(0, std::memory_order_relaxed);
+  cabecera->created_ns = (uint64_t)ahora.tv_sec * 1000000000ULL + ahora.tv_nsec;
+  std::atomic_thread_fence(std::memory_order_release);
+  cabecera->magic = MAGIC;
+  return true;
+}
+
+void ShmBridge::close() {
+  if (cabecera) munmap(cabecera, largo);
+  if (fd >= 0) ::close(fd);  // suelta el flock
+  cabecera = nullptr;
+  largo = 0;
+  fd = -1;
+}
+
+ShmDevice* ShmBridge::dispositivo(int slot) const {
+  return (ShmDevice*)((uint8_t*)cabecera + sizeof(ShmHeader) + (size_t)slot * sizeof(ShmDevice));
+}
+
+int ShmBridge::claim(const std::string& device) {
+  if (!cabecera) return -1;
+  uint32_t slot = cabecera->devices.fetch_add(1, std::memory_order_relaxed);
+  if (slot >= OIB_SHM_DEVICES) {
+    cabecera->devices.store(OIB_SHM_DEVICES, std::memory_order_relaxed);
+    return -1;
+  }
+  ShmDevice* d = dispositivo(slot);
+  uint32_t s = d->seq.load(std::memory_order_relaxed);
+  d->seq.store(s + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memset(d->id, 0, sizeof(d->id));
+  memcpy(d->id, device.data(), std::min(device.size(), sizeof(d->id) - 1));
+  d->seq_end.store(s + 2, std::memory_order_relaxed);
+  d->seq.store(s + 2, std::memory_order_release);
+  return (int)slot;
+}
+
+void ShmBridge::publish(int slot, const Record* records, size_t count) {
+  if (!cabecera || slot < 0 || !count) return;
+  ShmDevice* d = dispositivo(slot);
+  uint32_t s = d->seq.load(std::memory_order_relaxed);
+  d->seq.store(s + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (size_t i = 0; i < count; i++) {
+    const Record& r = records[i];
+    int k = posicion_tipo(r.kind);
+    if (k < 0) continue;
+    ShmLatest& u = d->latest[k];
+    u.sample_ms = r.sample_ms ? r.sample_ms : r.recv_ms;
+    u.recv_ms = r.recv_ms;
+    memcpy(u.v, r.v, sizeof(u.v));
+
+    ShmSample& m = d->ring[d->ring_count % OIB_SHM_RING];
+    m.sample_ms = u.sample_ms;
+    m.seq = r.seq;
+    m.kind = r.kind;
+    memcpy(m.v, r.v, sizeof(m.v));
+    d->ring_count++;
+    d->records++;
+    if (r.recv_ms > d->updated_ms) d->updated_ms = r.recv_ms;
+  }
+
+  d->seq_end.store(s + 2, std::memory_order_relaxed);
+  d->seq.store(s + 2, std::memory_order_release);
+}
+
+bool ShmBridge::read(int slot, ShmDevice& out) const {
+  if (!cabecera || slot < 0 || slot >= OIB_SHM_DEVICES) return false;
+  const ShmDevice* d = dispositivo(slot);
+  for (uint32_t i = 0; i < LECTURAS_MAX; i++) {
+    uint32_t s1 = d->seq.load(std::memory_order_acquire);
+    if (s1 & 1) {
+      sched_yield();
+      continue;
+    }
+    memcpy((void*)&out, (const void*)d, sizeof(out));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (d->seq.load(std::memory_order_relaxed) == s1 &&
+        out.seq_end.load(std::memory_order_relaxed) == s1) {
+      return true;
+    }
+  }
+  return false;
+}
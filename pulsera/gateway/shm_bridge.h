@@ -0,0 +1,133 @@
+/*
+ * Puente en memoria compartida hacia el controlador de la cama (Python)
+ *
+ * El ingest publica en /dev/shm/oib_pulseras (shm_open) el último valor de
+ * cada tabla de cada pulsera y un anillo con sus últimas muestras, para que
+ * SmartBedController los lea sin pasar por el broker
+ * (Algoritmo_sueño/src/sensors/drivers/Pulsera.py).
+ *
+ *   ShmHeader (64 B) | ShmDevice × max_devices
+ *
+ * Cada ShmDevice tiene un solo escritor, el trabajador del ingest dueño de
+ * la pulsera (ingest_pool.h), y se protege con un seqlock: seq queda impar
+ * mientras se escribe y seq_end repite el valor final al terminar. El
+ * lector copia el bloque y lo descarta si seq era impar, si cambió durante
+ * la copia o si no coincide con el seq_end de la copia; entonces reintenta,
+ * cediendo el procesador mientras seq es impar, hasta LECTURAS_MAX veces:
+ * un escritor que murió a mitad de una escritura deja seq impar para
+ * siempre y el lector tiene que seguir (sin datos) en vez de girar. Los
+ * lectores no escriben nunca en el segmento y no frenan al ingest.
+ *
+ * El lugar de cada pulsera se reparte la primera vez que aparece (devices
+ * crece) y no cambia mientras el ingest corre. Al arrancar, el ingest
+ * reescribe la cabecera y created_ns: un lector que lo ve cambiar vuelve a
+ * buscar su pulsera. Mientras está abierto, el ingest tiene un flock
+ * exclusivo sobre el segmento: un segundo oib_ingest --shm con el mismo
+ * nombre no arranca (dos escritores romperían todos los seqlocks).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "record.h"
+
+#ifndef OIB_SHM_NAME
+#define OIB_SHM_NAME "/oib_pulseras"
+#endif
+#ifndef OIB_SHM_DEVICES
+#define OIB_SHM_DEVICES 64
+#endif
+#ifndef OIB_SHM_RING
+#define OIB_SHM_RING 512  // muestras por pulsera: 5 s de PPG de una captura
+#endif
+
+// Último valor por tabla, en este orden (ShmDevice::latest)
+static const uint8_t SHM_KINDS[] = {
+    RECORD_VITALS, RECORD_ENVIRONMENT, RECORD_PRESENCE, RECORD_EPOCH, RECORD_HEART,
+    RECORD_ACCEL,  RECORD_ALERT,       RECORD_PPG,      RECORD_ACCEL_RAW,
+};
+static const uint8_t SHM_KIND_COUNT = sizeof(SHM_KINDS);
+
+struct ShmHeader {
+  uint32_t magic;  // "OIBS"
+  uint16_t version;
+  uint16_t header_size;
+  uint32_t max_devices;
+  uint32_t device_size;
+  uint32_t ring_size;
+  std::atomic<uint32_t> devices;  // lugares ya asignados
+  uint64_t created_ns;            // arranque del ingest (CLOCK_REALTIME)
+  uint8_t reserved[32];
+};
+static_assert(sizeof(ShmHeader) == 64, "lo lee Python con struct");
+
+struct ShmLatest {
+  uint64_t sample_ms;  // 0 = todavía nada de esta tabla
+  uint64_t recv_ms;
+  float v[6];  // como Record::v
+};
+static_assert(sizeof(ShmLatest) == 40, "lo lee Python con struct");
+
+struct ShmSample {
+  uint64_t sample_ms;
+  uint32_t seq;
+  uint8_t kind;
+  uint8_t reserved[3];
+  float v[4];
+};
+static_assert(sizeof(ShmSample) == 32, "lo lee Python con struct");
+
+struct ShmDevice {
+  std::atomic<uint32_t> seq;  // impar mientras se escribe
+  uint32_t reserved;
+  char id[24];
+  uint64_t updated_ms;  // última llegada
+  uint64_t records;     // registros publicados desde el arranque
+  ShmLatest latest[SHM_KIND_COUNT];
+  uint64_t ring_count;  // la última muestra está en ring[(ring_count - 1) % OIB_SHM_RING]
+  ShmSample ring[OIB_SHM_RING];
+  std::atomic<uint32_t> seq_end;
+  uint32_t reserved2;
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "seqlock entre procesos");
+
+class ShmBridge {
+ public:
+  static const uint32_t MAGIC = 0x5342494F;  // "OIBS"
+  static const uint16_t VERSION = 1;
+  static const uint32_t LECTURAS_MAX = 1000;
+
+  ShmBridge() = default;
+  ShmBridge(const ShmBridge&) = delete;
+  ShmBridge& operator=(const ShmBridge&) = delete;
+  ~ShmBridge() { close(); }
+
+  // Crea (o reusa) el segmento y lo deja vacío; false con errno =
+  // EWOULDBLOCK si otro proceso ya lo tiene abierto para escribir
+  bool open(const char* name = OIB_SHM_NAME);
+  void close();
+  bool isOpen() const { return cabecera != nullptr; }
+
+  // Lugar de la pulsera; -1 si ya no hay. Sólo el trabajador dueño de la
+  // pulsera lo pide, una vez, y después le escribe con publish().
+  int claim(const std::string& device);
+  // Los registros de un mensaje, en una sola escritura del seqlock
+  void publish(int slot, const Record* records, size_t count);
+
+  // Copia consistente de una pulsera (para lectores en C++); false si no
+  // se consiguió en LECTURAS_MAX intentos
+  bool read(int slot, ShmDevice& out) const;
+
+  size_t segmentSize() const { return largo; }
+
+ private:
+  ShmDevice* dispositivo(int slot) const;
+
+  ShmHeader* cabecera = nullptr;
+  size_t largo = 0;
+  int fd = -1;  // abierto mientras dura el flock
+};
@@ -0,0 +1,69 @@
+/*
+ * Cola sin locks de un productor y un consumidor (anillo de potencia de 2)
+ *
+ * El hilo de la fuente es el único que agrega y cada trabajador el único que
+ * saca de la suya: alcanza con dos índices atómicos, cada uno escrito por un
+ * solo lado (release al publicar, acquire al leer el del otro). Cada lado
+ * guarda una copia del índice ajeno y sólo la refresca cuando la cola parece
+ * llena o vacía, para no compartir la línea de caché en cada operación.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class SpscQueue {
+ public:
+  explicit SpscQueue(size_t capacidad) : items(redondear(capacidad)), mascara(items.size() - 1) {}
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  // Sólo el productor; false con la cola llena (item queda intacto)
+  bool tryPush(T& item) {
+    size_t cola = fin.load(std::memory_order_relaxed);
+    if (cola - inicio_visto == items.size()) {
+      inicio_visto = inicio.load(std::memory_order_acquire);
+      if (cola - inicio_visto == items.size()) return false;
+    }
+    items[cola & mascara] = std::move(item);
+    fin.store(cola + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Sólo el consumidor; false con la cola vacía
+  bool tryPop(T& out) {
+    size_t cabeza = inicio.load(std::memory_order_relaxed);
+    if (cabeza == fin_visto) {
+      fin_visto = fin.load(std::memory_order_acquire);
+      if (cabeza == fin_visto) return false;
+    }
+    out = std::move(items[cabeza & mascara]);
+    inicio.store(cabeza + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Desde cualquier hilo; aproximado mientras los dos lados trabajan
+  size_t size() const {
+    size_t cabeza = inicio.load(std::memory_order_acquire);
+    return fin.load(std::memory_order_acquire) - cabeza;
+  }
+  size_t capacity() const { return items.size(); }
+
+ private:
+  static size_t redondear(size_t n) {
+    size_t c = 2;
+    while (c < n) c <<= 1;
+    return c;
+  }
+
+  std::vector<T> items;
+  const size_t mascara;
+  alignas(64) std::atomic<size_t> inicio{0};  // lo escribe el consumidor
+  size_t fin_visto = 0;
+  alignas(64) std::atomic<size_t> fin{0};     // lo escribe el productor
+  size_t inicio_visto = 0;
+};
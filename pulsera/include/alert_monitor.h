@@ -0,0 +1,105 @@
+/*
+ * Alertas clínicas con camino prioritario
+ *
+ * Los umbrales (SPO2_MIN_ALERT, MIN/MAX_HR_ALERT, BED_TEMP_MIN/MAX de
+ * bed_config.py) se evalúan en cada bloque procesado: cada latido para HR y
+ * SpO2 y cada lectura del HTU21D para la cama, no en el ciclo de 2 s. Una
+ * condición se confirma tras varias muestras seguidas fuera de rango y se
+ * da por terminada con histéresis; las dos transiciones son alertas.
+ *
+ * PubSubClient sólo publica con QoS0, así que la entrega se confirma por
+ * eco: la pulsera está suscripta (QoS1) a su propio tópico de alertas y el
+ * broker le reenvía cada una. Hasta recibir el eco la alerta se reintenta
+ * cada REINTENTO_US, también después de reconectar. Los reintentos llevan
+ * el mismo número de secuencia para que el receptor descarte duplicados.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "sleep_config.h"
+
+enum AlertType : uint8_t {
+  ALERT_HR_HIGH,
+  ALERT_HR_LOW,
+  ALERT_SPO2_LOW,
+  ALERT_BED_TEMP_HIGH,
+  ALERT_BED_TEMP_LOW,
+  ALERT_TYPES
+};
+
+struct Alert {
+  uint32_t seq;
+  uint8_t type;
+  bool active;          // true = empezó, false = terminó
+  float value;
+  float threshold;
+  uint32_t sample_ms;   // millis() de la muestra que la confirmó
+  uint32_t detected_us; // micros() de la detección
+  uint32_t sent_us;     // micros() del último publish (0 = nunca)
+  uint8_t attempts;
+};
+
+class AlertMonitor {
+ public:
+  static const uint8_t QUEUE = 8;
+  static const uint32_t REINTENTO_US = 1000000;
+
+  void begin();
+
+  // Un latido con dedo apoyado
+  void onHeartRate(uint32_t t_ms, float bpm);
+  void onSpo2(uint32_t t_ms, float spo2);
+  // Sin contacto no se puede confirmar ni descartar HR/SpO2
+  void onContactLost();
+  void onBedTemperature(uint32_t t_ms, float celsius);
+
+  // Próxima alerta para (re)enviar ahora, o nullptr
+  Alert* nextToSend(uint32_t now_us);
+  void markSent(Alert& a, uint32_t now_us);
+
+  // Eco del broker con ese número de secuencia
+  void acknowledge(uint32_t seq, uint32_t now_us);
+
+  // Cualquier alerta sin confirmar vuelve a enviarse apenas haya red
+  void retryAll();
+
+  static const char* typeName(uint8_t type);
+
+  // Tipos (1 << AlertType) que empezaron desde la última llamada
+  uint8_t takeRaised();
+
+  // Latencias detección -> publish y detección -> eco (us), reintentos y
+  // descartes desde el último resumen, para sistema/alertas
+  String summaryJson();
+
+ private:
+  struct Condicion {
+    uint8_t seguidas;   // muestras seguidas a favor del cambio de estado
+    bool activa;
+  };
+  struct Latencia {
+    uint32_t n;
+    uint32_t suma_us;
+    uint32_t max_us;
+    void agregar(uint32_t us);
+  };
+
+  void evaluate(AlertType tipo, uint32_t t_ms, float valor, float umbral, bool fuera,
+                bool normal, uint8_t confirmar);
+  void raise(AlertType tipo, uint32_t t_ms, float valor, float umbral, bool activa);
+
+  Condicion condiciones[ALERT_TYPES];
+
+  // Alertas sin eco del broker, en orden de detección
+  Alert cola[QUEUE];
+  uint8_t cola_n = 0;
+  uint32_t siguiente_seq = 1;
+
+  Latencia a_publish;
+  Latencia a_eco;
+  uint32_t reintentos = 0;
+  uint32_t descartadas = 0;
+  uint8_t nuevas = 0;
+};
@@ -0,0 +1,77 @@
+/*
+ * Presencia en la cama estimada en la pulsera
+ *
+ * Port de BedPresenceDetector.detect_presence del gateway: cada 2 s se suma
+ * una confianza (0-100 %) con cuatro indicadores (temperatura de la cama
+ * sobre la base, actividad, HR válida y en rango, dedo en el sensor) más un
+ * bonus temporal si la media de las últimas 5 evaluaciones supera 50.
+ *
+ * Histéresis igual que _update_presence_state: se entra con confianza >=
+ * ENTER y se sale con confianza <= EXIT sólo si las últimas
+ * CONFIRMATION_TIME evaluaciones quedaron todas en 30 o menos. La base
+ * térmica sigue a la temperatura (filtro 0,05) mientras la cama está vacía.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "sleep_config.h"
+
+// Indicadores activos en la última evaluación (máscara de bits)
+enum PresenceIndicator : uint8_t {
+  PRESENCE_THERMAL = 1 << 0,
+  PRESENCE_MOVEMENT = 1 << 1,
+  PRESENCE_HEART_RATE = 1 << 2,
+  PRESENCE_CONTACT = 1 << 3,
+  PRESENCE_TEMPORAL = 1 << 4,
+};
+
+struct PresenceInput {
+  float bed_temperature;  // °C (HTU21D)
+  bool temperature_valid;
+  float activity;         // actividad integrada de SleepStager
+  float heart_rate;       // BPM
+  bool hr_valid;          // hubo latidos con dedo en la última sub-ventana
+  bool finger_present;
+};
+
+class BedPresence {
+ public:
+  static const uint8_t HISTORY = OIB_CFG_PRESENCE_HISTORY_SIZE;
+
+  void begin();
+
+  // Una evaluación (cadencia OIB_SLEEP_SUBWINDOW_MS). Devuelve true si
+  // cambió el estado ocupada/vacía.
+  bool update(uint32_t now_ms, const PresenceInput& in);
+
+  bool occupied() const { return ocupada; }
+  uint8_t confidence() const { return confianza; }
+  uint8_t indicators() const { return indicadores; }
+  float temperatureElevation() const { return elevacion; }
+  float baselineTemperature() const { return base_temp; }
+
+  // Tiempo en la cama de la estadía actual, o de la última si está vacía
+  uint32_t occupiedMs(uint32_t now_ms) const;
+
+ private:
+  uint8_t score(const PresenceInput& in);
+  uint8_t historyAt(uint8_t atras) const;  // 0 = la más reciente
+
+  bool ocupada = false;
+  uint8_t confianza = 0;
+  uint8_t indicadores = 0;
+  float elevacion = 0.0f;
+
+  bool hay_base = false;
+  float base_temp = 0.0f;
+
+  // Puntajes sin el bonus temporal, como presence_history del gateway
+  uint8_t historial[HISTORY];
+  uint8_t hist_pos = 0;
+  uint8_t hist_n = 0;
+
+  uint32_t entrada_ms = 0;
+  uint32_t estadia_ms = 0;
+};
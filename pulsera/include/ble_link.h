@@ -0,0 +1,101 @@
+/*
+ * Transmisión de tramas por BLE (periférico GATT) para salas sin WiFi
+ *
+ * Opcional (OIB_BLE=1): la pulsera anuncia el servicio OIB y un central (el
+ * controlador de la cama, un gateway o un teléfono) se suscribe a la
+ * característica de tramas. Cada notificación lleva una o más tramas de
+ * telemetry_frame.h seguidas, tal cual salen por MQTT y ESP-NOW.
+ *
+ * Al conectarse la pulsera pide MTU OIB_BLE_MTU y un intervalo de conexión
+ * entre OIB_BLE_INTERVALO_MIN_MS y OIB_BLE_INTERVALO_MAX_MS; el central
+ * decide y lo negociado se publica en sistema/enlace. Las tramas de una
+ * vuelta de loop se juntan en una sola notificación (update()), hasta
+ * llenar el MTU.
+ *
+ * La característica de control acepta "wifi", "ble" o "ambos" para cambiar
+ * los transportes en tiempo de ejecución (ver aplicar_transportes() en
+ * main.cpp); el mismo pedido llega por MQTT en sistema/transporte/cambiar.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "telemetry_frame.h"
+
+#ifndef OIB_BLE
+#define OIB_BLE 0
+#endif
+#ifndef OIB_BLE_MTU
+#define OIB_BLE_MTU 247
+#endif
+#ifndef OIB_BLE_INTERVALO_MIN_MS
+#define OIB_BLE_INTERVALO_MIN_MS 30
+#endif
+#ifndef OIB_BLE_INTERVALO_MAX_MS
+#define OIB_BLE_INTERVALO_MAX_MS 50
+#endif
+
+#define OIB_BLE_SERVICIO "6e4f4942-0001-4c9a-9e0b-5e2a7c1d0b10"
+#define OIB_BLE_TRAMAS "6e4f4942-0002-4c9a-9e0b-5e2a7c1d0b10"
+#define OIB_BLE_CONTROL "6e4f4942-0003-4c9a-9e0b-5e2a7c1d0b10"
+
+class BLEServer;
+class BLECharacteristic;
+class BLE2902;
+
+class BleLink {
+ public:
+  static const uint16_t NOTIFICACION_MAX = OIB_BLE_MTU - 3;
+
+  // Arranca el stack, el servicio y el anuncio (una sola vez)
+  bool begin(const char* nombre);
+  // Deshabilitado: corta la conexión, deja de anunciar y descarta tramas
+  void setEnabled(bool habilitado);
+  bool connected() const { return conectado && suscripto(); }
+
+  // Agrega la trama a la notificación en armado; si no entra, envía antes
+  // lo acumulado. false si no hay central suscripto o el MTU no alcanza.
+  bool send(const uint8_t* frame, uint8_t length);
+  // Envía lo acumulado; una vez por vuelta de loop
+  void update();
+
+  uint16_t mtu() const { return mtu_negociado; }
+  float intervalMs() const { return intervalo_125us * 1.25f; }
+  const LinkStats& stats() const { return estadisticas; }
+
+  // Pedido de transportes escrito en la característica de control (0 = ninguno)
+  uint8_t takeTransportRequest();
+
+  // Desde los callbacks del stack (tarea de BLE)
+  void onConnect(uint16_t conn_id, const uint8_t* remote_bda, uint16_t interval_units);
+  void onDisconnect();
+  void onMtu(uint16_t mtu);
+  void onConnParams(uint16_t interval_units);
+  void onNotifyStatus(bool ok) { ultimo_ok = ok; }
+  void onControl(const char* texto);
+
+ private:
+  bool suscripto() const;
+  void flush();
+
+  bool iniciado = false;
+  bool habilitado = true;
+  volatile bool conectado = false;
+  volatile uint16_t conn_id = 0;
+  volatile uint16_t mtu_negociado = 23;
+  volatile uint16_t intervalo_125us = 0;
+  volatile uint8_t pedido_transportes = 0;
+  volatile bool ultimo_ok = false;
+
+  BLEServer* servidor = nullptr;
+  BLECharacteristic* c_tramas = nullptr;
+  BLE2902* cccd = nullptr;
+
+  uint8_t armado[NOTIFICACION_MAX];
+  uint16_t armado_largo = 0;
+  uint8_t armado_tramas = 0;
+  LinkStats estadisticas;
+};
+
+extern BleLink ble;
@@ -0,0 +1,69 @@
+/*
+ * Identidad de la pulsera y tópicos por dispositivo
+ *
+ * Con varias camas en el mismo broker cada pulsera publica y se suscribe
+ * bajo su propio prefijo:
+ *
+ *   oib/<id>/sensores/...   telemetría (la Raspberry se suscribe a
+ *                           oib/+/sensores/# y reparte por <id>)
+ *   oib/<id>/sistema/...    estado, enlace, memoria, comandos
+ *
+ * El <id> son los 6 bytes de la MAC de fábrica (eFuse) en hex, estable
+ * entre firmwares y sin configurar nada. Si existe el archivo
+ * ARCHIVO_DISPOSITIVO en LittleFS (p. ej. "cama-07", escrito con
+ * oib/<id>/sistema/identidad/cambiar) se usa ese nombre. El client id MQTT
+ * es "oib-<id>": dos pulseras nunca se pisan la sesión persistente.
+ *
+ * El id solo admite letras, dígitos, '-' y '_' (nada de '/', '+' ni '#').
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#define OIB_TOPICO_RAIZ "oib"
+#define ARCHIVO_DISPOSITIVO "/dispositivo"
+
+#ifndef OIB_TOPICO_MAX
+#define OIB_TOPICO_MAX 64
+#endif
+
+class DeviceIdentity {
+ public:
+  static const uint8_t ID_MAX = 20;
+
+  // Con LittleFS ya montado (cargar_transportes())
+  void begin();
+  const char* id() const { return ident; }
+  const char* clientId() const { return cliente; }
+
+  // Guarda un nombre nuevo; vale desde el próximo arranque. false si no es válido.
+  bool save(const char* nuevo);
+  static bool valid(const char* texto, size_t largo);
+  // Id por defecto: la MAC de fábrica en hex (out de al menos 13 bytes)
+  static void formatMac(uint64_t efuse_mac, char* out);
+
+  // "oib/<id>/<sufijo>"
+  void topic(const char* sufijo, char* out, size_t n) const;
+  // Sufijo de un tópico propio ("oib/<id>/x" -> "x"); nullptr si es de otro
+  const char* localTopic(const char* topico) const;
+
+ private:
+  char ident[ID_MAX + 1] = "";
+  char cliente[ID_MAX + 5] = "";
+  char prefijo[ID_MAX + sizeof(OIB_TOPICO_RAIZ) + 2] = "";
+  uint8_t prefijo_largo = 0;
+};
+
+extern DeviceIdentity identidad;
+
+// Tópico completo de esta pulsera, como temporal en la llamada:
+//   client.publish(Topic("sensores/bpm"), ...)
+class Topic {
+ public:
+  explicit Topic(const char* sufijo) { identidad.topic(sufijo, buf, sizeof(buf)); }
+  operator const char*() const { return buf; }
+
+ private:
+  char buf[OIB_TOPICO_MAX];
+};
@@ -0,0 +1,135 @@
+/*
+ * Vector de características por época (entrada estándar de los modelos)
+ *
+ * Se calcula en una sola pasada sobre los flujos en vivo, con memoria fija
+ * (sólo acumuladores): HR media y desvío, RMSSD/SDNN/pNN50 y LF/HF de
+ * HrvStream/HrvSpectrumEstimator, actividad y movimientos, postura dominante
+ * y cambios de postura, media y pendiente de la temperatura de la cama, SpO2
+ * mínima y media, y frecuencia respiratoria.
+ *
+ * La respiración sale de la línea de base del PPG: la media del IR en cada
+ * latido (un ciclo cardíaco completo, así no queda componente cardíaca) se
+ * compara con su media lenta y se cuentan los cruces ascendentes con
+ * histéresis.
+ *
+ * EpochFeatures se publica tal cual (little-endian, 80 bytes). Cualquier
+ * cambio de campos sube OIB_FEATURES_VERSION; tools/epoch_features.py tiene
+ * el formato del lado de la Raspberry.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "sleep_staging.h"
+#include "hrv_stream.h"
+#include "hrv_spectrum.h"
+
+#define OIB_FEATURES_VERSION 1
+
+enum FeatureFlag : uint8_t {
+  FEATURE_FLAG_IN_BED = 1 << 0,
+  FEATURE_FLAG_HR = 1 << 1,
+  FEATURE_FLAG_SPO2 = 1 << 2,
+  FEATURE_FLAG_TEMP = 1 << 3,
+  FEATURE_FLAG_PSD = 1 << 4,
+  FEATURE_FLAG_RESP = 1 << 5,
+  FEATURE_FLAG_ACCEL = 1 << 6,
+};
+
+enum Posture : uint8_t {
+  POSTURE_SUPINE,   // boca arriba
+  POSTURE_PRONE,    // boca abajo
+  POSTURE_LEFT,
+  POSTURE_RIGHT,
+  POSTURE_UPRIGHT,  // sentado o parado
+  POSTURE_UNKNOWN = 0xFF,
+};
+
+// Campos sin dato: NAN (y la bandera correspondiente en 0)
+struct __attribute__((packed)) EpochFeatures {
+  uint8_t version;
+  uint8_t flags;            // FEATURE_FLAG_*
+  uint8_t stage;            // clasificación de SleepStager (referencia)
+  uint8_t posture;          // postura dominante (Posture)
+  uint32_t epoch;
+  uint64_t start_epoch_ms;  // 0 si el reloj no está sincronizado
+
+  float hr_mean;            // BPM
+  float hr_std;
+  float rmssd;              // ms, ventana de 5 min
+  float sdnn;
+  float pnn50;              // %
+  float lf;                 // ms²
+  float hf;
+  float lf_hf;
+  float activity;           // actividad integrada media
+  float spo2_min;           // %
+  float spo2_mean;
+  float temp_mean;          // °C
+  float temp_slope;         // °C/min
+  float resp_rate;          // respiraciones/min
+
+  uint16_t beats;
+  uint16_t artifacts;
+  uint16_t movements;
+  uint8_t posture_changes;
+  uint8_t reserved;
+};
+
+class FeatureExtractor {
+ public:
+  void begin();
+
+  // Muestra IR con el dedo apoyado (respiración por línea de base)
+  void addPpgSample(uint32_t ir);
+  // Latido con dedo: cierra el ciclo del PPG
+  void addBeat(uint32_t t_ms, float bpm);
+  void addSpo2(float spo2);
+  // Muestra cruda del acelerómetro (cuentas de 12 bits, escala 2g)
+  void addAccelSample(int16_t x, int16_t y, int16_t z);
+  void addTemperature(uint32_t t_ms, float celsius);
+
+  // Completa el vector de la época y reinicia los acumuladores
+  void closeEpoch(uint64_t start_epoch_ms, const SleepEpoch& epoca, const HrvEpoch& hrv,
+                  const HrvSpectrum& espectro, bool en_cama, EpochFeatures& out);
+
+ private:
+  void resetEpoch();
+  static Posture classifyPosture(float x, float y, float z);
+
+  // HR (Welford)
+  uint16_t latidos = 0;
+  float hr_media = 0.0f;
+  float hr_m2 = 0.0f;
+
+  // SpO2
+  uint16_t n_spo2 = 0;
+  float spo2_min = 0.0f;
+  float spo2_suma = 0.0f;
+
+  // Temperatura: regresión lineal sobre (t, °C) relativa al inicio
+  uint16_t n_temp = 0;
+  uint32_t t0_temp = 0;
+  float st = 0.0f, sy = 0.0f, stt = 0.0f, sty = 0.0f;
+
+  // Postura: gravedad filtrada, postura confirmada y muestras por postura
+  bool hay_gravedad = false;
+  float g[3] = {0.0f, 0.0f, 0.0f};
+  Posture postura = POSTURE_UNKNOWN;
+  Posture candidata = POSTURE_UNKNOWN;
+  uint8_t candidata_n = 0;
+  uint16_t muestras_postura[5] = {0, 0, 0, 0, 0};
+  uint8_t cambios_postura = 0;
+
+  // Respiración
+  uint64_t suma_ir = 0;
+  uint16_t muestras_ir = 0;
+  bool hay_base = false;
+  float base_ir = 0.0f;
+  float amplitud = 0.0f;
+  bool bajo = false;
+  uint16_t respiraciones = 0;
+  uint32_t t_primera = 0;
+  uint32_t t_ultima = 0;
+};
@@ -0,0 +1,53 @@
+/*
+ * Enlace ESP-NOW directo de la pulsera al receptor de la cama
+ *
+ * Opcional (OIB_ESPNOW=1): las tramas de telemetry_frame.h van, además de
+ * por MQTT, en un paquete ESP-NOW unicast al nodo receptor de la cama
+ * (receptor/), que las pasa por serie al controlador. Sin asociación, sin
+ * TCP y sin broker: el lazo térmico no depende del AP ni de la Raspberry.
+ *
+ * ESP-NOW comparte la radio con la estación WiFi, así que usa el canal del
+ * AP (peer con canal 0 = el actual); el receptor tiene que estar en el
+ * mismo canal. La capa MAC confirma cada paquete unicast: el callback de
+ * envío mide envío -> ACK, que se publica en sistema/enlace junto con el
+ * costo del camino MQTT.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "telemetry_frame.h"
+
+#ifndef OIB_ESPNOW
+#define OIB_ESPNOW 0
+#endif
+
+class EspNowLink {
+ public:
+  static const uint8_t EN_VUELO = 8;  // envíos sin callback todavía
+
+  // Después de WiFi.mode(WIFI_STA); false si no se pudo iniciar
+  bool begin(const uint8_t peer_mac[6]);
+  bool ready() const { return listo; }
+
+  // false si no hay lugar en vuelo o esp_now_send falló
+  bool send(const uint8_t* frame, uint8_t length);
+
+  const LinkStats& stats() const { return estadisticas; }
+
+  // Desde el callback de envío de esp_now (tarea de WiFi)
+  void onSent(bool ok);
+
+ private:
+  bool listo = false;
+  LinkStats estadisticas;
+
+  // Instante de cada envío en vuelo: el loop escribe en enviados, el
+  // callback (tarea de WiFi) lee en completados; un único escritor por índice
+  uint32_t t_envio_us[EN_VUELO];
+  volatile uint32_t enviados = 0;
+  volatile uint32_t completados = 0;
+};
+
+extern EspNowLink espnow;
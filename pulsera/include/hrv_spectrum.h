@@ -0,0 +1,74 @@
+/*
+ * HRV en frecuencia (VLF/LF/HF) en la pulsera
+ *
+ * Los IBI aceptados por HrvStream se interpolan linealmente a una serie
+ * uniforme de 4 Hz (tacograma; la interpolación lineal atenúa algo la banda
+ * HF frente a un spline, a cambio de O(1) por latido). Al cierre de cada
+ * época se estima la PSD por Welch sobre los últimos 2 a 4,3 min: segmentos
+ * de 256 muestras (64 s) con 50 % de solapamiento y ventana de Hann, FFT
+ * radix-2 en punto fijo Q15 con escalado por etapa (sin FPU en el
+ * ESP32-C3). Bandas estándar:
+ *   VLF 0,0033-0,04 Hz | LF 0,04-0,15 Hz | HF 0,15-0,4 Hz
+ *
+ * Presupuesto en el C3:
+ *   RAM  ~4,3 KB estáticos (tacograma 2 KB, FFT 1 KB, Hann y twiddles 1 KB)
+ *   CPU  <= OIB_HRV_SPECTRUM_CYCLE_BUDGET ciclos por época (7 FFT de 256)
+ * El costo real se mide con ESP.getCycleCount() y se publica con la época.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef OIB_HRV_SPECTRUM_CYCLE_BUDGET
+#define OIB_HRV_SPECTRUM_CYCLE_BUDGET 1600000  // 10 ms a 160 MHz
+#endif
+
+struct HrvSpectrum {
+  bool valid;         // hubo al menos 2 min de tacograma continuo
+  float vlf;          // ms²
+  float lf;           // ms²
+  float hf;           // ms²
+  float lf_hf;
+  uint8_t segments;
+  uint32_t cycles;    // costo del cálculo
+};
+
+class HrvSpectrumEstimator {
+ public:
+  static const uint16_t FS_HZ = 4;
+  static const uint16_t SEGMENT = 256;
+  static const uint16_t CAPACITY = 1024;  // 256 s
+  static const uint16_t MIN_SAMPLES = 480;  // 2 min
+
+  void begin();
+
+  // IBI aceptado (ms) que termina en t_ms; un hueco de más de 3 s entre
+  // latidos aceptados (dedo afuera) reinicia el tacograma
+  void addIbi(uint32_t t_ms, uint16_t ibi_ms);
+
+  void compute(HrvSpectrum& out);
+
+ private:
+  void push(int32_t ibi_ms);
+  void fft();
+
+  // Tacograma a 4 Hz en ms (buffer circular)
+  int16_t serie[CAPACITY];
+  uint16_t inicio = 0;
+  uint16_t cuenta = 0;
+
+  // Interpolación: último latido y próximo instante de la grilla
+  bool hay_latido = false;
+  uint32_t t_anterior = 0;
+  uint16_t ibi_anterior = 0;
+  uint32_t t_grilla = 0;
+
+  // Buffers y tablas de la FFT (Q15)
+  int16_t re[SEGMENT];
+  int16_t im[SEGMENT];
+  int16_t hann[SEGMENT];
+  int16_t cos_q15[SEGMENT / 2];
+  int16_t sin_q15[SEGMENT / 2];
+  float hann_s2 = 0.0f;  // Σw² de la ventana
+};
@@ -0,0 +1,93 @@
+/*
+ * HRV en streaming sobre los intervalos entre latidos (IBI)
+ *
+ * Equivalente en la pulsera a calculate_rmssd/calculate_sdnn de analyzer.py
+ * (SDNN poblacional, como np.std), pero sin recorrer el historial: se
+ * mantienen sumas enteras de IBI, IBI² y diferencias sucesivas² sobre un
+ * buffer circular con ventana de tiempo. Agregar un latido es O(1) y cada
+ * latido sale de la ventana una sola vez (O(1) amortizado).
+ *
+ * Corrección de artefactos: se descartan IBI fuera de 300-2000 ms o que se
+ * apartan más de un 20 % de la media de los últimos aceptados. Un latido
+ * aceptado después de un artefacto no forma par con el anterior, así RMSSD y
+ * pNN50 sólo usan pares de latidos realmente consecutivos. Si se descartan
+ * varios seguidos (cambio brusco real de ritmo) se reinicia la referencia.
+ *
+ * Al cierre de la época también salen los latidos viejos: sin latidos nuevos
+ * (pulsera fuera de la muñeca, mala perfusión) la ventana se vacía sola y,
+ * con menos de MIN_BEATS, la época sale sin datos en vez de repetir la
+ * ventana anterior.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+struct HrvEpoch {
+  bool valid;         // al menos MIN_BEATS IBI en la ventana; si no, todo en 0
+  float rmssd;        // ms (0 si no hay pares)
+  float sdnn;         // ms
+  float pnn50;        // % de pares con |ΔIBI| > 50 ms
+  float mean_hr;      // BPM a partir del IBI medio de la ventana
+  uint16_t window_beats;  // IBI válidos en la ventana
+  uint16_t beats;     // IBI aceptados durante la época
+  uint16_t artifacts; // IBI descartados durante la época
+};
+
+class HrvStream {
+ public:
+  static const uint16_t CAPACITY = 640;  // 5 min hasta 128 BPM
+  static const uint32_t WINDOW_MS = 300000;
+  static const uint16_t MIN_BEATS = 30;
+
+  void begin();
+
+  // Nuevo intervalo entre latidos (ms) terminado en t_ms. Devuelve false si
+  // se descartó como artefacto.
+  bool addIbi(uint32_t t_ms, uint16_t ibi_ms);
+
+  float rmssd() const;
+  float sdnn() const;
+  float pnn50() const;
+  float meanHr() const;
+  uint16_t count() const { return cuenta; }
+
+  // Valores de la ventana terminada en now_ms al cierre de la época;
+  // reinicia los contadores por época
+  void closeEpoch(uint32_t now_ms, HrvEpoch& out);
+
+ private:
+  struct Latido {
+    uint32_t t_ms;
+    uint16_t ibi;
+    bool par;       // forma par con el latido anterior de la ventana
+    uint16_t dif;   // |ibi - ibi_anterior| si par
+  };
+
+  void evictOldest();
+  void evictBefore(uint32_t t_ms);
+  bool isArtifact(uint16_t ibi) const;
+
+  Latido latidos[CAPACITY];
+  uint16_t inicio = 0;
+  uint16_t cuenta = 0;
+
+  // Sumas exactas sobre la ventana
+  uint64_t suma_ibi = 0;
+  uint64_t suma_ibi2 = 0;
+  uint64_t suma_dif2 = 0;
+  uint16_t pares = 0;
+  uint16_t pares_nn50 = 0;
+
+  // Referencia para artefactos: media de los últimos aceptados
+  static const uint8_t REF_N = 5;
+  uint16_t ref[REF_N];
+  uint8_t ref_n = 0;
+  uint8_t ref_pos = 0;
+  uint32_t ref_suma = 0;
+  bool ultimo_valido = false;  // el latido anterior fue aceptado
+  uint8_t rechazos_seguidos = 0;  // tras varios se descarta la referencia
+
+  uint16_t latidos_epoca = 0;
+  uint16_t artefactos_epoca = 0;
+};
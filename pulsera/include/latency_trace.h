@@ -0,0 +1,49 @@
+/*
+ * Trazas de latencia de extremo a extremo (muestra -> broker -> cama)
+ *
+ * Cada bloque de telemetría lleva la hora de adquisición de su muestra (epoch
+ * en ms, sincronizada por SNTP) y un id de traza. Además se marcan los
+ * instantes en que el bloque queda encolado para enviar, codificado y
+ * entregado al cliente MQTT, como desplazamientos en ms desde la adquisición:
+ *
+ *   "traza":{"id":123,"adq":1767308400123,"enc":2,"cod":3,"pub":3}
+ *
+ * tools/latency_monitor.py compara "adq" con la hora de recepción en la
+ * Raspberry (también sincronizada) para obtener la distribución de latencias.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+struct TrazaBloque {
+  uint32_t id;
+  uint64_t adq_epoch_ms;  // 0 si el reloj todavía no está sincronizado
+  uint32_t adq_ms;        // millis() de la adquisición
+  uint32_t enc_ms;
+  uint32_t cod_ms;
+  uint32_t pub_ms;
+};
+
+// Arranca SNTP (llamar con WiFi conectado)
+void traza_iniciar(const char* servidor_ntp);
+
+// Hora de pared en ms desde epoch, 0 si no hay sincronización
+uint64_t traza_epoch_ms();
+
+// Abre una traza para una muestra adquirida en millis() == adq_ms
+TrazaBloque traza_nueva(uint32_t adq_ms);
+
+inline void traza_encolar(TrazaBloque& t) { t.enc_ms = millis(); }
+inline void traza_codificar(TrazaBloque& t) { t.cod_ms = millis(); }
+
+// Marca la entrega al cliente MQTT y devuelve el fragmento JSON
+// ("\"traza\":{...}") para cerrar el payload
+String traza_json(TrazaBloque& t);
+
+// Registra el resultado del publish (tiempo bloqueado dentro de publish()).
+// Si falló devuelve el id, que solo se gasta en bloques que salieron
+void traza_publicado(const TrazaBloque& t, bool ok);
+
+// Estadísticas por etapa desde el último resumen, para sistema/latencia
+String traza_resumen_json();
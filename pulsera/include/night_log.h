@@ -0,0 +1,94 @@
+/*
+ * Hipnograma de la noche guardado en la flash de la pulsera
+ *
+ * Cada época de 30 s ocupa 4 bytes (little-endian):
+ *
+ *   bits  0-1   estado (WAKE/LIGHT/REM/DEEP)
+ *   bits  2-5   banderas NIGHT_FLAG_*
+ *   bits  6-12  HR media - 30 BPM (1..127; 0 = sin latidos)
+ *   bits 13-19  RMSSD en ms (saturado en 127)
+ *   bits 20-25  movimientos (saturado en 63)
+ *   bits 26-31  LF/HF x 8 (saturado en 63)
+ *
+ * Una noche de 10 h son 4,7 KB en LittleFS. El archivo empieza con una
+ * cabecera de 16 bytes (NightFileHeader) y se le agrega un registro por
+ * época, así un reinicio de la pulsera o de la Raspberry no pierde nada.
+ * La noche se abre con la primera época en la cama y se cierra tras una
+ * hora fuera; las épocas fuera de la cama sólo se escriben si después se
+ * vuelve a la cama (no quedan colas vacías).
+ *
+ * La noche completa sale como un único mensaje binario: cabecera, resumen
+ * (NightSummary, 16 bytes) y registros. tools/night_decode.py lo decodifica.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <PubSubClient.h>
+
+#include "sleep_staging.h"
+#include "hrv_stream.h"
+#include "hrv_spectrum.h"
+
+enum NightFlag : uint8_t {
+  NIGHT_FLAG_VALID = 1 << 0,    // 0 = hueco sin datos (reinicio)
+  NIGHT_FLAG_IN_BED = 1 << 1,
+  NIGHT_FLAG_HR_OK = 1 << 2,
+  NIGHT_FLAG_PSD_OK = 1 << 3,
+};
+
+struct __attribute__((packed)) NightFileHeader {
+  char magic[4];          // "OIBN"
+  uint8_t version;
+  uint8_t record_bytes;
+  uint16_t epoch_s;
+  uint64_t start_epoch_ms;  // 0 si el reloj no estaba sincronizado
+};
+
+struct __attribute__((packed)) NightSummary {
+  uint16_t epochs;
+  uint16_t per_stage[4];  // épocas en la cama por estado
+  uint16_t in_bed;
+  uint16_t sleep_onset;   // primera época dormida (0xFFFF = nunca)
+  uint16_t awakenings;    // pasajes de dormido a WAKE después del inicio
+};
+
+class NightLog {
+ public:
+  static const uint16_t MAX_EPOCHS = 1200;       // 10 h
+  static const uint16_t CLOSE_AFTER_EMPTY = 120; // 1 h fuera de la cama
+
+  // Monta LittleFS y retoma una noche abierta antes de un reinicio
+  bool begin();
+
+  void addEpoch(uint64_t start_epoch_ms, const SleepEpoch& epoca, const HrvEpoch& hrv,
+                const HrvSpectrum& espectro, bool en_cama);
+
+  static uint32_t pack(const SleepEpoch& epoca, const HrvEpoch& hrv,
+                       const HrvSpectrum& espectro, bool en_cama);
+
+  bool nightOpen() const { return abierta; }
+  uint16_t epochs() const { return registros; }
+
+  // Se cerró una noche y todavía no se publicó
+  bool closedPending() const { return cerrada_pendiente; }
+
+  // Publica la noche en curso (o la última cerrada si no hay una abierta),
+  // o la anterior, como un único mensaje
+  bool publish(PubSubClient& client, const char* topic, bool previous, bool retained);
+
+ private:
+  bool openNight(uint64_t start_epoch_ms);
+  void closeNight();
+  bool appendRecord(uint32_t registro);
+  bool summarize(File& f, NightSummary& out);
+
+  bool montado = false;
+  bool abierta = false;
+  bool recuperada = false;      // abierta antes del último reinicio
+  bool cerrada_pendiente = false;
+  uint64_t inicio_epoch_ms = 0;
+  uint16_t registros = 0;
+  uint16_t vacias = 0;          // épocas fuera de la cama sin escribir
+};
@@ -0,0 +1,48 @@
+/*
+ * Ventana de publicación propia de cada pulsera dentro del ciclo de 2 s
+ *
+ * Con el ciclo contado desde el arranque, las pulseras que se encienden
+ * juntas (un carro de carga, un corte de luz) publican todas en la misma
+ * ráfaga cada OIB_PUBLISH_PERIOD_MS y el broker recibe la flota entera de
+ * golpe. Cada pulsera toma en cambio una fase fija derivada de su id
+ * (FNV-1a mod período) y publica cuando la hora de pared cruza
+ * k * período + fase: con la hora de SNTP las ventanas de todas las camas
+ * quedan repartidas en el período sin coordinarse. Sin hora todavía, la
+ * misma fase se aplica sobre millis().
+ *
+ * OIB_PUBLISH_SLOTS=0 vuelve al ciclo desde el arranque (para comparar en
+ * la simulación de flota, sim --flota).
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef OIB_PUBLISH_PERIOD_MS
+#define OIB_PUBLISH_PERIOD_MS 2000
+#endif
+#ifndef OIB_PUBLISH_SLOTS
+#define OIB_PUBLISH_SLOTS 1
+#endif
+
+class PublishSlot {
+ public:
+  static uint32_t phaseFor(const char* id, uint32_t periodo_ms);
+
+  void begin(const char* id, uint32_t periodo_ms = OIB_PUBLISH_PERIOD_MS);
+  // true una vez por período, en la ventana de esta pulsera (epoch_ms = 0: sin hora)
+  bool due(uint32_t now_ms, uint64_t epoch_ms);
+
+  uint32_t phaseMs() const { return fase; }
+  // Máximo atraso de la publicación respecto del inicio de la ventana
+  uint32_t maxDelayMs() const { return atraso_max; }
+
+ private:
+  uint32_t periodo = OIB_PUBLISH_PERIOD_MS;
+  uint32_t fase = 0;
+  uint32_t ultimo_ms = 0;         // sin ranuras: último ciclo desde el arranque
+  uint64_t ultima_ranura = 0;
+  bool con_hora = false;          // ultima_ranura cuenta sobre la hora de pared
+  bool iniciado = false;
+  uint32_t atraso_max = 0;
+};
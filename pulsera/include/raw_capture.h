@@ -0,0 +1,155 @@
+/*
+ * Captura de señales crudas alrededor de un evento
+ *
+ * Los últimos OIB_CAPTURE_PRE_S segundos de PPG (IR y rojo, 100 Hz) y del
+ * acelerómetro (12,5 Hz) viven en dos anillos en RAM. Cuando se dispara un
+ * evento (alerta de HR o SpO2, caída, pedido de la Raspberry) se siguen
+ * grabando OIB_CAPTURE_POST_S segundos y la ventana se congela hasta
+ * terminar de subirla; mientras tanto los disparos nuevos se cuentan como
+ * descartados. Los disparos durante el post-evento se suman a la misma
+ * captura (el campo triggers es una máscara).
+ *
+ * La subida va en segundo plano: un trozo por loop, de a lo sumo
+ * OIB_CAPTURE_CHUNK_BYTES. Cada trozo (CaptureChunkHeader + datos) es
+ * decodificable por sí solo: predictor de segundo orden por canal que se
+ * reinicia en cada trozo y residuos zigzag en varint. Si se pierde uno, el
+ * resto de la captura sirve igual. tools/raw_capture.py los rearma.
+ *
+ * RAM fija (anillos + buffer de un trozo), reportada en sistema/capturas
+ * junto con bytes crudos/enviados y el costo de codificar cada trozo.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+
+#ifndef OIB_CAPTURE_PRE_S
+#define OIB_CAPTURE_PRE_S 10
+#endif
+#ifndef OIB_CAPTURE_POST_S
+#define OIB_CAPTURE_POST_S 5
+#endif
+#ifndef OIB_CAPTURE_CHUNK_BYTES
+#define OIB_CAPTURE_CHUNK_BYTES 480  // datos por trozo, sin cabecera
+#endif
+#ifndef OIB_CAPTURE_TRIGGERS
+#define OIB_CAPTURE_TRIGGERS 0x0F  // CaptureTrigger habilitados
+#endif
+
+#define OIB_CAPTURE_VERSION 1
+
+enum CaptureTrigger : uint8_t {
+  CAPTURE_TRIGGER_HR = 1 << 0,      // alerta de HR alta o baja
+  CAPTURE_TRIGGER_SPO2 = 1 << 1,    // desaturación
+  CAPTURE_TRIGGER_FALL = 1 << 2,    // caída libre seguida de impacto
+  CAPTURE_TRIGGER_MANUAL = 1 << 3,  // pedido por MQTT
+};
+
+enum CaptureStream : uint8_t {
+  CAPTURE_STREAM_PPG,    // 2 canales: IR, rojo
+  CAPTURE_STREAM_ACCEL,  // 3 canales: x, y, z (cuentas, escala 2g)
+};
+
+enum CaptureChunkFlag : uint8_t {
+  CAPTURE_CHUNK_LAST = 1 << 0,  // último trozo de la captura
+};
+
+struct __attribute__((packed)) CaptureChunkHeader {
+  uint8_t magic[2];           // "RC"
+  uint8_t version;
+  uint8_t triggers;           // CaptureTrigger
+  uint16_t seq;               // número de captura
+  uint16_t chunk;             // trozo dentro de la captura
+  uint8_t stream;             // CaptureStream
+  uint8_t flags;              // CaptureChunkFlag
+  uint16_t first;             // índice de la primera muestra del trozo
+  uint16_t samples;           // muestras en el trozo
+  uint16_t total;             // muestras del flujo en la captura
+  uint16_t trigger_index;     // muestra del flujo en la que se disparó
+  uint32_t period_us;
+  uint64_t trigger_epoch_ms;  // 0 si el reloj no está sincronizado
+};
+
+class RawCapture {
+ public:
+  static const uint16_t PPG_PERIODO_MS = 10;
+  static const uint16_t ACCEL_PERIODO_MS = 80;
+  // Un segundo de margen: las muestras del post-evento no pisan el pre
+  static const uint16_t PPG_CAPACIDAD = (OIB_CAPTURE_PRE_S + OIB_CAPTURE_POST_S + 1) * 1000 / PPG_PERIODO_MS;
+  static const uint16_t ACCEL_CAPACIDAD = (OIB_CAPTURE_PRE_S + OIB_CAPTURE_POST_S + 1) * 1000 / ACCEL_PERIODO_MS;
+
+  void begin();
+
+  void addPpgSample(uint32_t ir, uint32_t red);
+  // true si detectó una caída (el disparo lo hace quien llama, con la hora)
+  bool addAccelSample(int16_t x, int16_t y, int16_t z);
+
+  // Dispara (si el tipo está habilitado); epoch_ms sella la captura
+  void trigger(uint8_t triggers, uint64_t epoch_ms);
+
+  // Congela la ventana al terminar el post-evento
+  void update(uint32_t now_ms);
+
+  // Sube el próximo trozo de la captura congelada; false si no había nada
+  // que subir o falló el publish (se reintenta el mismo trozo)
+  bool publishNext(PubSubClient& client, const char* topic);
+
+  bool busy() const { return estado != GRABANDO; }
+
+  // Capturas, descartes, bytes y costo desde el arranque, para sistema/capturas
+  String summaryJson() const;
+
+ private:
+  enum Estado : uint8_t { GRABANDO, POST_EVENTO, SUBIENDO };
+
+  struct Flujo {
+    uint16_t capacidad = 0;
+    uint16_t inicio = 0;
+    uint16_t cuenta = 0;
+    uint32_t total = 0;          // muestras agregadas desde el último reinicio
+    uint32_t total_disparo = 0;  // total en el momento del disparo
+    // Ventana congelada
+    uint16_t desde = 0;          // índice en el anillo de la primera muestra
+    uint16_t largo = 0;
+    uint16_t disparo = 0;        // índice de la muestra del disparo en la ventana
+    uint16_t enviadas = 0;
+    uint16_t agregar();  // posición donde escribir la muestra nueva
+    void congelar();
+    uint16_t posicion(uint16_t i) const { return (desde + i) % capacidad; }
+  };
+
+  void freeze();
+  void reset();
+  uint16_t encode(uint8_t flujo, uint8_t* out, uint16_t capacidad, uint16_t& muestras);
+
+  // IR y rojo de 18 bits en 3 bytes cada uno
+  uint8_t ppg[PPG_CAPACIDAD][6];
+  int16_t acc[ACCEL_CAPACIDAD][3];
+  Flujo f_ppg;
+  Flujo f_acc;
+
+  Estado estado = GRABANDO;
+  uint8_t disparos = 0;
+  uint32_t t_disparo = 0;
+  uint64_t epoch_disparo = 0;
+  uint16_t seq = 0;
+  uint16_t trozo = 0;
+  uint32_t t_congelada = 0;
+
+  // Caída: caída libre y, en menos de 1 s, impacto
+  uint8_t desde_caida_libre = 0xFF;  // muestras desde la última caída libre
+
+  uint8_t buffer[sizeof(CaptureChunkHeader) + OIB_CAPTURE_CHUNK_BYTES];
+  uint16_t buffer_largo = 0;  // trozo ya codificado pendiente de publicar
+  uint16_t buffer_muestras = 0;
+
+  // Estadísticas
+  uint32_t capturas = 0;
+  uint32_t descartadas = 0;
+  uint32_t trozos = 0;
+  uint32_t bytes_crudos = 0;
+  uint32_t bytes_enviados = 0;
+  uint32_t ciclos_trozo_max = 0;
+  uint32_t subida_ms_max = 0;
+};
@@ -0,0 +1,116 @@
+/*
+ * Umbrales compartidos con el controlador de la cama
+ *
+ * tools/bed_config_defines.py los genera desde
+ * Algoritmo_sueño/src/config/bed_config.py (OIB_CFG_<NOMBRE>). Los valores de
+ * abajo sólo se usan si se compila sin ese script y deben coincidir con
+ * bed_config.py.
+ */
+
+#pragma once
+
+// ---------- Estados de sueño ----------
+#ifndef OIB_CFG_SLEEP_STATE_WAKE
+#define OIB_CFG_SLEEP_STATE_WAKE 0
+#endif
+#ifndef OIB_CFG_SLEEP_STATE_LIGHT
+#define OIB_CFG_SLEEP_STATE_LIGHT 1
+#endif
+#ifndef OIB_CFG_SLEEP_STATE_REM
+#define OIB_CFG_SLEEP_STATE_REM 2
+#endif
+#ifndef OIB_CFG_SLEEP_STATE_DEEP
+#define OIB_CFG_SLEEP_STATE_DEEP 3
+#endif
+
+// ---------- Detección de sueño: actividad ----------
+#ifndef OIB_CFG_ACTIVITY_THRESHOLD_DEEP_SLEEP
+#define OIB_CFG_ACTIVITY_THRESHOLD_DEEP_SLEEP 0.01f
+#endif
+#ifndef OIB_CFG_ACTIVITY_THRESHOLD_REM
+#define OIB_CFG_ACTIVITY_THRESHOLD_REM 0.008f
+#endif
+#ifndef OIB_CFG_ACTIVITY_THRESHOLD_WAKE
+#define OIB_CFG_ACTIVITY_THRESHOLD_WAKE 0.7f
+#endif
+
+// ---------- Detección de sueño: frecuencia cardíaca ----------
+#ifndef OIB_CFG_HR_THRESHOLD_DEEP_SLEEP
+#define OIB_CFG_HR_THRESHOLD_DEEP_SLEEP 55
+#endif
+#ifndef OIB_CFG_HR_THRESHOLD_REM
+#define OIB_CFG_HR_THRESHOLD_REM 70
+#endif
+#ifndef OIB_CFG_HR_THRESHOLD_WAKE
+#define OIB_CFG_HR_THRESHOLD_WAKE 75
+#endif
+
+// ---------- Integrador de actividad ----------
+#ifndef OIB_CFG_ACCELEROMETER_ACTIVITY_THRESHOLD
+#define OIB_CFG_ACCELEROMETER_ACTIVITY_THRESHOLD 12.5f  // cuentas crudas (2g, 12 bits)
+#endif
+#ifndef OIB_CFG_ACTIVITY_DECAY_CONSTANT
+#define OIB_CFG_ACTIVITY_DECAY_CONSTANT 120000.0f  // ms
+#endif
+#ifndef OIB_CFG_ACTIVITY_SPIKE_STRENGTH
+#define OIB_CFG_ACTIVITY_SPIKE_STRENGTH 0.05f
+#endif
+#ifndef OIB_CFG_ACTIVITY_DECAY_DELAY
+#define OIB_CFG_ACTIVITY_DECAY_DELAY 300000.0f  // ms
+#endif
+#ifndef OIB_CFG_ACTIVITY_LOWER_BOUND
+#define OIB_CFG_ACTIVITY_LOWER_BOUND 0.001f
+#endif
+
+// ---------- MAX30102 ----------
+#ifndef OIB_CFG_FINGER_DETECTION_THRESHOLD
+#define OIB_CFG_FINGER_DETECTION_THRESHOLD 50000
+#endif
+
+// ---------- Alertas ----------
+#ifndef OIB_CFG_SPO2_MIN_ALERT
+#define OIB_CFG_SPO2_MIN_ALERT 88  // %
+#endif
+#ifndef OIB_CFG_MAX_HR_ALERT
+#define OIB_CFG_MAX_HR_ALERT 120  // BPM
+#endif
+#ifndef OIB_CFG_MIN_HR_ALERT
+#define OIB_CFG_MIN_HR_ALERT 40  // BPM
+#endif
+#ifndef OIB_CFG_BED_TEMP_MIN
+#define OIB_CFG_BED_TEMP_MIN 15.0f  // °C
+#endif
+#ifndef OIB_CFG_BED_TEMP_MAX
+#define OIB_CFG_BED_TEMP_MAX 30.0f  // °C
+#endif
+
+// ---------- Presencia en la cama ----------
+#ifndef OIB_CFG_PRESENCE_CONFIDENCE_THRESHOLD_ENTER
+#define OIB_CFG_PRESENCE_CONFIDENCE_THRESHOLD_ENTER 60  // %
+#endif
+#ifndef OIB_CFG_PRESENCE_CONFIDENCE_THRESHOLD_EXIT
+#define OIB_CFG_PRESENCE_CONFIDENCE_THRESHOLD_EXIT 20  // %
+#endif
+#ifndef OIB_CFG_PRESENCE_THERMAL_THRESHOLD
+#define OIB_CFG_PRESENCE_THERMAL_THRESHOLD 1.5f  // °C sobre la base
+#endif
+#ifndef OIB_CFG_PRESENCE_ACTIVITY_THRESHOLD
+#define OIB_CFG_PRESENCE_ACTIVITY_THRESHOLD 0.001f
+#endif
+#ifndef OIB_CFG_PRESENCE_HR_MIN
+#define OIB_CFG_PRESENCE_HR_MIN 40
+#endif
+#ifndef OIB_CFG_PRESENCE_HR_MAX
+#define OIB_CFG_PRESENCE_HR_MAX 150
+#endif
+#ifndef OIB_CFG_PRESENCE_HISTORY_SIZE
+#define OIB_CFG_PRESENCE_HISTORY_SIZE 30  // evaluaciones
+#endif
+#ifndef OIB_CFG_PRESENCE_CONFIRMATION_TIME
+#define OIB_CFG_PRESENCE_CONFIRMATION_TIME 15  // evaluaciones
+#endif
+
+// Cadencia con la que el gateway evaluaba el estado (ms). El firmware
+// clasifica sub-ventanas de este largo para mantener calibrados los umbrales.
+#define OIB_SLEEP_SUBWINDOW_MS 2000
+#define OIB_SLEEP_EPOCH_MS 30000
@@ -0,0 +1,86 @@
+/*
+ * Clasificación de sueño en épocas de 30 s en la pulsera
+ *
+ * Port de SmartBedController.integrate_activity/detect_sleep_state del
+ * gateway, alimentado con la actigrafía a la frecuencia completa del
+ * MMA8452Q y con los latidos del MAX30102 en vez de instantáneas cada 2 s.
+ *
+ * Para que los umbrales de bed_config.py sigan significando lo mismo, el
+ * integrador aplica como mucho un pico de actividad por sub-ventana de 2 s
+ * (la cadencia del gateway) y cada sub-ventana se clasifica con la misma
+ * lógica. La época toma el estado más votado entre sus 15 sub-ventanas.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "sleep_config.h"
+
+enum SleepStage : uint8_t {
+  SLEEP_WAKE = OIB_CFG_SLEEP_STATE_WAKE,
+  SLEEP_LIGHT = OIB_CFG_SLEEP_STATE_LIGHT,
+  SLEEP_REM = OIB_CFG_SLEEP_STATE_REM,
+  SLEEP_DEEP = OIB_CFG_SLEEP_STATE_DEEP,
+};
+
+struct SleepEpoch {
+  uint32_t index;
+  uint32_t start_ms;   // millis() de inicio
+  uint8_t stage;
+  uint8_t votes;       // sub-ventanas que votaron por stage
+  uint16_t beats;      // latidos válidos en la época
+  uint16_t movements;  // muestras con diferencia sobre el umbral
+  float activity;      // actividad integrada media
+  float hr;            // BPM medio de la época (0 = sin latidos válidos)
+};
+
+class SleepStager {
+ public:
+  void begin(uint32_t now_ms);
+
+  // Muestra cruda del acelerómetro (cuentas de 12 bits, escala 2g)
+  void addAccelSample(uint32_t t_ms, int16_t x, int16_t y, int16_t z);
+
+  // Latido detectado con su BPM instantáneo
+  void addBeat(uint32_t t_ms, float bpm);
+
+  // Cierra sub-ventanas/épocas vencidas. Devuelve true si cerró una época
+  // (si pasaron varias, se llama de nuevo hasta que devuelva false).
+  bool update(uint32_t now_ms, SleepEpoch& out);
+
+  // detect_sleep_state() del gateway
+  static SleepStage classify(float activity, float heart_rate);
+
+  float activity() const { return activity_; }
+  float heartRate() const { return hr_actual; }
+
+ private:
+  void closeSubwindow(uint32_t end_ms);
+
+  // Integrador de actividad
+  float activity_ = 0.0f;
+  uint32_t last_spike_ms = 0;
+  bool hubo_pico = false;
+  bool tiene_muestra = false;
+  int16_t ultimo[3] = {0, 0, 0};
+  uint32_t ultima_muestra_ms = 0;
+  bool pico_en_ventana = false;
+  uint32_t t_pico_ventana = 0;
+
+  // Sub-ventana en curso
+  uint32_t ventana_inicio = 0;
+  float suma_bpm_ventana = 0.0f;
+  uint16_t latidos_ventana = 0;
+  float hr_actual = 60.0f;  // mismo valor por defecto que el gateway
+
+  // Época en curso
+  uint32_t epoca_inicio = 0;
+  uint32_t epoca_indice = 0;
+  uint8_t votos[4] = {0, 0, 0, 0};
+  uint8_t ventanas = 0;
+  float suma_actividad = 0.0f;
+  float suma_bpm_epoca = 0.0f;
+  uint16_t latidos_epoca = 0;
+  uint16_t movimientos_epoca = 0;
+};
@@ -0,0 +1,51 @@
+/*
+ * SpO2 latido a latido por razón de razones
+ *
+ * Para cada canal (rojo e IR) se acumulan, entre dos latidos, sumas enteras
+ * de la muestra, su cuadrado y su producto con el índice. Al cerrar el
+ * latido eso da en una pasada la media (DC) y el valor eficaz alrededor de
+ * la recta de mejor ajuste (AC): la deriva respiratoria de la línea de base
+ * dentro del latido queda afuera. Con R = (AC_rojo/DC_rojo) / (AC_ir/DC_ir)
+ * se usa la recta empírica SpO2 = 104 - 17·R. Los latidos con perfusión
+ * fuera de rango (movimiento) se descartan y el valor se promedia en 4
+ * latidos.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class Spo2Estimator {
+ public:
+  static const uint8_t PROMEDIO = 4;  // latidos
+
+  void begin();
+
+  // Muestra cruda de la FIFO del MAX30102
+  void addSample(uint32_t ir, uint32_t red);
+
+  // Cierra el latido en curso. Devuelve la SpO2 promediada (%) o NAN si
+  // todavía no hay latidos válidos.
+  float closeBeat();
+
+  // Descarta el latido en curso (dedo afuera)
+  void reset();
+
+ private:
+  struct Canal {
+    uint32_t referencia;  // primera muestra del latido (sumas chicas y exactas)
+    int64_t suma;         // Σd, con d = x - referencia
+    int64_t suma2;        // Σd²
+    int64_t suma_id;      // Σi·d
+    void agregar(uint32_t x, uint16_t i);
+    // Valor eficaz alrededor de la recta y media; false si no hay pulso
+    bool medir(uint16_t n, float& ac, float& dc) const;
+  };
+
+  Canal ir_, red_;
+  uint16_t muestras = 0;  // muestras del latido en curso
+
+  float ultimas[PROMEDIO];
+  uint8_t ultimas_pos = 0;
+  uint8_t ultimas_n = 0;
+};
@@ -0,0 +1,65 @@
+/*
+ * Clasificación de sueño con un modelo entrenado sobre el vector de época
+ *
+ * Regresión logística multinomial en punto fijo: cada entrada del modelo es
+ * un campo de EpochFeatures, se normaliza con centro/escala enteros a Q8
+ * (saturada en ±4σ) y cada clase suma pesos Q8 → logit Q16; gana el mayor.
+ * Sin heap y sin coma flotante: los campos float del vector se convierten a
+ * entero leyendo los bits IEEE-754 (el C3 no tiene FPU).
+ *
+ * Las tablas (stage_model_tables.h) son constexpr generadas al compilar por
+ * tools/stage_model_tables.py desde el modelo entrenado (model/stage_model.json,
+ * ver tools/stage_model_train.py). Si no están, available() es false y
+ * classify() devuelve la etapa de las reglas de SleepStager.
+ *
+ * En la pulsera corre en sombra: la etapa de las reglas sigue mandando y la
+ * del modelo sólo se publica para compararla (OIB_STAGE_FROM_MODEL en
+ * main.cpp).
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "epoch_features.h"
+
+// Entradas que puede usar un modelo (nombres de campo de EpochFeatures)
+enum StageInput : uint8_t {
+  STAGE_INPUT_HR_MEAN,
+  STAGE_INPUT_HR_STD,
+  STAGE_INPUT_RMSSD,
+  STAGE_INPUT_SDNN,
+  STAGE_INPUT_PNN50,
+  STAGE_INPUT_LF,
+  STAGE_INPUT_HF,
+  STAGE_INPUT_LF_HF,
+  STAGE_INPUT_ACTIVITY,
+  STAGE_INPUT_SPO2_MIN,
+  STAGE_INPUT_SPO2_MEAN,
+  STAGE_INPUT_TEMP_MEAN,
+  STAGE_INPUT_TEMP_SLOPE,
+  STAGE_INPUT_RESP_RATE,
+  STAGE_INPUT_BEATS,
+  STAGE_INPUT_ARTIFACTS,
+  STAGE_INPUT_MOVEMENTS,
+  STAGE_INPUT_POSTURE_CHANGES,
+  STAGE_INPUT_IN_BED,  // bandera FEATURE_FLAG_IN_BED (0/1)
+};
+
+struct StagePrediction {
+  uint8_t stage;     // SleepStage
+  bool from_model;   // false: no hay modelo compilado, es la etapa de las reglas
+  int32_t margin;    // logit ganador - segundo (Q16), confianza relativa
+  uint8_t missing;   // entradas sin dato (tomadas en el centro)
+  uint32_t cycles;   // costo de la inferencia
+};
+
+class StageClassifier {
+ public:
+  static bool available();
+  // Identificador del modelo compilado (CRC32 del archivo entrenado), 0 si no hay
+  static uint32_t modelId();
+
+  // rules_stage: etapa de SleepStager, la que queda si no hay modelo
+  static void classify(const EpochFeatures& in, uint8_t rules_stage, StagePrediction& out);
+};
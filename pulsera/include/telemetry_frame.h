@@ -0,0 +1,129 @@
+/*
+ * Tramas binarias de telemetría para el lazo térmico de la cama
+ *
+ * La misma trama (mismo número de secuencia) sale por todos los transportes
+ * habilitados: MQTT (sensores/trama), ESP-NOW directo al receptor de la cama
+ * y BLE. El receptor descarta duplicados por seq. Formato little-endian:
+ *
+ *   FrameHeader (16 B) | datos (length B) | CRC-16/CCITT-FALSE (2 B)
+ *
+ * El CRC cubre cabecera y datos; lo verifica el que reenvía la trama por
+ * serie o la decodifica (tools/telemetry_frames.py). Una trama entra en un
+ * paquete ESP-NOW (250 B); por BLE hace falta negociar MTU >= 33 (la más
+ * larga tiene 30 B) y con MTU mayor una notificación lleva varias tramas
+ * seguidas (cada una trae su largo en la cabecera).
+ */
+
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+// Gateway (gateway/): sólo el formato, sin LinkStats::json()
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+#define OIB_FRAME_MAGIC 0xB1
+#define OIB_FRAME_VERSION 1
+
+enum FrameType : uint8_t {
+  FRAME_VITALS = 1,       // cada 2 s
+  FRAME_ENVIRONMENT = 2,  // cada 2 s, con lectura válida del HTU21D
+  FRAME_PRESENCE = 3,     // en cada cambio
+  FRAME_EPOCH = 4,        // al cerrar cada época de 30 s
+};
+
+struct __attribute__((packed)) FrameHeader {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t type;             // FrameType
+  uint8_t length;           // bytes de datos
+  uint32_t seq;             // contador de tramas de la pulsera
+  uint64_t sample_epoch_ms; // 0 si el reloj no está sincronizado
+};
+
+struct __attribute__((packed)) FrameVitals {
+  uint16_t hr_x10;          // BPM × 10 (0 = sin latidos)
+  uint16_t spo2_x10;        // % × 10 (0 = sin dato)
+  uint8_t finger;
+  uint8_t stage;            // última etapa de sueño (0xFF = todavía ninguna)
+};
+
+struct __attribute__((packed)) FrameEnvironment {
+  int16_t temp_x100;        // °C × 100
+  uint16_t humidity_x100;   // %RH × 100
+};
+
+struct __attribute__((packed)) FramePresence {
+  uint8_t occupied;
+  uint8_t confidence;       // %
+  uint8_t indicators;       // PresenceIndicator
+  uint8_t reserved;
+};
+
+struct __attribute__((packed)) FrameEpoch {
+  uint32_t index;
+  uint8_t stage;            // etapa que manda (reglas, o modelo con OIB_STAGE_FROM_MODEL)
+  uint8_t rules_stage;      // etapa de SleepStager
+  uint16_t hr_x10;
+  uint16_t rmssd_x10;
+  uint16_t activity_x1000;
+};
+
+static const uint8_t OIB_FRAME_MAX = sizeof(FrameHeader) + 32 + 2;
+
+// Transportes de las tramas (bits; OIB_TRANSPORTES es el de fábrica)
+enum Transport : uint8_t {
+  TRANSPORT_WIFI = 1,  // MQTT (y ESP-NOW, que usa la radio de la estación)
+  TRANSPORT_BLE = 2,
+};
+
+// "wifi", "ble" o "ambos" -> bits de Transport (0 si no se reconoce)
+uint8_t transportFromText(const char* text);
+
+class FrameEncoder {
+ public:
+  // Arma la trama en out (al menos OIB_FRAME_MAX bytes); devuelve su largo.
+  // Cada llamada consume un número de secuencia.
+  uint8_t encode(FrameType type, const void* data, uint8_t length, uint64_t sample_epoch_ms,
+                 uint8_t* out);
+  uint32_t lastSeq() const { return seq; }
+
+  static uint16_t crc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+      crc ^= (uint16_t)data[i] << 8;
+      for (uint8_t b = 0; b < 8; b++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+      }
+    }
+    return crc;
+  }
+
+ private:
+  uint32_t seq = 0;
+};
+
+// Costo por transporte, para comparar caminos en sistema/enlace
+struct LinkStats {
+  uint32_t sent = 0;         // tramas entregadas al transporte
+  uint32_t failed = 0;       // rechazadas por el transporte
+  uint32_t lost = 0;         // aceptadas pero sin confirmación (sin ACK)
+  uint32_t bytes = 0;
+  uint64_t call_us = 0;      // tiempo dentro de la llamada de envío
+  uint32_t call_us_max = 0;
+  uint32_t confirmed = 0;    // con confirmación del otro extremo
+  uint64_t confirm_us = 0;   // envío -> confirmación (radio ocupada)
+  uint32_t confirm_us_max = 0;
+  uint64_t air_us = 0;       // tiempo de aire estimado (sin confirmación medible)
+
+  // Una llamada al transporte puede llevar varias tramas (BLE)
+  void addCall(uint32_t us, uint16_t length, bool ok, uint8_t frames = 1);
+  void addConfirm(uint32_t us);
+  // Energía estimada por trama (µJ) con la radio transmitiendo a tx_mw
+  float energyPerFrameUj(uint32_t tx_mw) const;
+#ifdef ARDUINO
+  String json(uint32_t tx_mw) const;
+#endif
+};
@@ -141,7 +141,9 @@ class MAX30105 {
 
   void bitMask(uint8_t reg, uint8_t mask, uint8_t thing);
  
+  #ifndef STORAGE_SIZE
    #define STORAGE_SIZE 4 //Each long is 4 bytes so limit this to fit on your micro
+  #endif
   typedef struct Record
   {
     uint32_t red[STORAGE_SIZE];
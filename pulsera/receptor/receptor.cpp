@@ -0,0 +1,95 @@
+/*
+ * Receptor ESP-NOW de la cama
+ *
+ * Un ESP32-C3 al lado del controlador de la cama recibe las tramas que la
+ * pulsera manda por ESP-NOW (include/telemetry_frame.h) y las pasa por serie
+ * como líneas "T <hex>" a 115200 baudios. Verifica magia y CRC y descarta
+ * duplicados por seq (un ACK perdido hace que la MAC reenvíe la trama). El
+ * controlador las lee con tools/telemetry_frames.py --serial.
+ *
+ *   pio run -e receptor_espnow -t upload
+ *
+ * Al arrancar imprime "MAC xx:xx:..." para configurar receptor_mac en la
+ * pulsera. Tiene que estar en el canal del AP de la pulsera (OIB_CANAL).
+ */
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+
+#include "telemetry_frame.h"
+
+#ifndef OIB_CANAL
+#define OIB_CANAL 1
+#endif
+
+static const uint8_t COLA = 16;
+
+// El callback corre en la tarea de WiFi: copia a una cola y el loop imprime
+struct Recibida {
+  uint8_t largo;
+  uint8_t datos[OIB_FRAME_MAX];
+};
+static Recibida cola[COLA];
+static volatile uint8_t escritas = 0;
+static volatile uint8_t leidas = 0;
+static uint32_t descartadas = 0;
+
+static void al_recibir(const uint8_t* mac, const uint8_t* datos, int largo) {
+  if (largo < (int)(sizeof(FrameHeader) + 2) || largo > OIB_FRAME_MAX) return;
+  if ((uint8_t)(escritas - leidas) >= COLA) {
+    descartadas++;
+    return;
+  }
+  Recibida& r = cola[escritas % COLA];
+  memcpy(r.datos, datos, largo);
+  r.largo = largo;
+  escritas++;
+}
+
+void setup() {
+  Serial.begin(115200);
+  WiFi.mode(WIFI_STA);
+  esp_wifi_set_channel(OIB_CANAL, WIFI_SECOND_CHAN_NONE);
+  Serial.println("MAC " + WiFi.macAddress());
+  if (esp_now_init() != ESP_OK) {
+    Serial.println("E esp_now_init");
+    return;
+  }
+  esp_now_register_recv_cb(al_recibir);
+}
+
+void loop() {
+  static uint32_t ultimo_seq = 0;
+  static bool hay_seq = false;
+  static uint32_t invalidas = 0;
+  static uint32_t reportadas = 0;
+
+  while (leidas != escritas) {
+    const Recibida& r = cola[leidas % COLA];
+    const FrameHeader* cab = (const FrameHeader*)r.datos;
+    uint8_t n = r.largo - 2;
+    uint16_t crc = r.datos[n] | (r.datos[n + 1] << 8);
+    bool valida = cab->magic == OIB_FRAME_MAGIC && sizeof(FrameHeader) + cab->length == n &&
+                  FrameEncoder::crc16(r.datos, n) == crc;
+    if (!valida) {
+      invalidas++;
+    } else if (!hay_seq || cab->seq != ultimo_seq) {
+      ultimo_seq = cab->seq;
+      hay_seq = true;
+      char hex[2 * OIB_FRAME_MAX + 1];
+      for (uint8_t i = 0; i < r.largo; i++) sprintf(hex + 2 * i, "%02x", r.datos[i]);
+      Serial.print("T ");
+      Serial.println(hex);
+    }
+    leidas++;
+  }
+
+  if (invalidas + descartadas != reportadas) {
+    reportadas = invalidas + descartadas;
+    Serial.printf("E invalidas=%lu descartadas=%lu\n", (unsigned long)invalidas,
+                  (unsigned long)descartadas);
+  }
+  delay(1);
+}
@@ -0,0 +1,137 @@
+#include "fleet_load.h"
+
+#include <algorithm>
+
+#include "device_identity.h"
+#include "publish_slot.h"
+
+namespace oib_sim {
+
+static const size_t COLA_MAX = 4096;
+static const size_t ESPERA_PASOS = 10000;  // hasta 1 s en pasos de 100 µs
+
+// MAC k lugares después, contando como se imprime (el byte bajo del eFuse
+// es el primero)
+static uint64_t macConsecutiva(uint64_t efuse_mac, uint32_t k) {
+  uint64_t impresa = 0;
+  for (int i = 0; i < 6; i++) impresa = impresa << 8 | (efuse_mac >> (8 * i) & 0xFF);
+  impresa += k;
+  uint64_t mac = 0;
+  for (int i = 0; i < 6; i++) mac |= (impresa >> (8 * (5 - i)) & 0xFF) << (8 * i);
+  return mac;
+}
+
+void FleetLoad::begin(uint32_t n, const std::string& propio, uint64_t efuse_mac, bool con_ranuras,
+                      uint32_t periodo_ms, uint32_t semilla) {
+  pulseras = n;
+  ranuras = con_ranuras;
+  prefijo = propio;
+  desfase_us.assign(n, 0);
+  hist_cola.assign(COLA_MAX + 1, 0);
+  hist_espera.assign(ESPERA_PASOS + 1, 0);
+
+  char id[13];
+  DeviceIdentity::formatMac(efuse_mac, id);
+  uint32_t fase_propia = PublishSlot::phaseFor(id, periodo_ms);
+  uint32_t azar = semilla * 2654435761u | 1;
+  for (uint32_t k = 1; k < n; k++) {
+    if (ranuras) {
+      DeviceIdentity::formatMac(macConsecutiva(efuse_mac, k), id);
+      uint32_t fase = PublishSlot::phaseFor(id, periodo_ms);
+      desfase_us[k] = (uint64_t)((fase + periodo_ms - fase_propia) % periodo_ms) * 1000;
+    } else {
+      azar ^= azar << 13;
+      azar ^= azar >> 17;
+      azar ^= azar << 5;
+      desfase_us[k] = azar % arranque_us;
+    }
+  }
+}
+
+void FleetLoad::onPublish(const MqttMessage& msg) {
+  if (!pulseras) return;
+  uint32_t bytes = msg.topic.size() + msg.payload.size();
+  bool propia = msg.topic.compare(0, prefijo.size(), prefijo) == 0;
+  for (uint32_t k = 0; k < (propia ? pulseras : 1); k++) {
+    pendientes.push(Llegada{msg.t_us + desfase_us[k], bytes});
+  }
+  // Las réplicas van siempre hacia adelante: lo anterior a este mensaje ya
+  // no puede cambiar de orden
+  while (!pendientes.empty() && pendientes.top().t_us <= msg.t_us) {
+    atender(pendientes.top());
+    pendientes.pop();
+  }
+}
+
+void FleetLoad::finish() {
+  while (!pendientes.empty()) {
+    atender(pendientes.top());
+    pendientes.pop();
+  }
+}
+
+void FleetLoad::atender(const Llegada& l) {
+  if (!mensajes) primero_us = l.t_us;
+  mensajes++;
+  ultimo_us = l.t_us;
+
+  double llegada = (double)l.t_us;
+  while (!en_broker.empty() && en_broker.front() <= llegada) en_broker.pop_front();
+  hist_cola[std::min(en_broker.size(), COLA_MAX)]++;
+
+  double inicio = std::max(llegada, libre_us);
+  libre_us = inicio + publish_us + l.bytes * byte_us + deliver_us;
+  en_broker.push_back(libre_us);
+  double espera = inicio - llegada;
+  espera_max_us = std::max(espera_max_us, espera);
+  hist_espera[std::min((size_t)(espera / 100), ESPERA_PASOS)]++;
+
+  // Tiempo de CPU repartido entre las ventanas que cruza
+  for (double t = inicio; t < libre_us;) {
+    size_t v = (size_t)(t / ventana_us);
+    if (v >= ocupado_us.size()) ocupado_us.resize(v + 1, 0.0);
+    double fin = std::min(libre_us, (double)(v + 1) * ventana_us);
+    ocupado_us[v] += fin - t;
+    t = fin;
+  }
+}
+
+static size_t percentil(const std::vector<uint64_t>& hist, uint64_t total, double p) {
+  uint64_t objetivo = (uint64_t)(total * p), acumulado = 0;
+  for (size_t i = 0; i < hist.size(); i++) {
+    acumulado += hist[i];
+    if (acumulado > objetivo) return i;
+  }
+  return hist.size() - 1;
+}
+
+void FleetLoad::printSummary(FILE* out) const {
+  if (!pulseras || !mensajes) return;
+  // Desde la primera ventana con tráfico (antes de asociarse no hay carga)
+  std::vector<double> cpu(ocupado_us.begin() + primero_us / ventana_us, ocupado_us.end());
+  double suma = 0;
+  for (double c : cpu) suma += c;
+  std::sort(cpu.begin(), cpu.end());
+  auto pct = [&](double p) {
+    return 100.0 * cpu[std::min(cpu.size() - 1, (size_t)(cpu.size() * p))] / ventana_us;
+  };
+  double duracion_s = std::max<uint64_t>(ultimo_us - primero_us, 1) / 1e6;
+
+  size_t cola_max = 0;
+  for (size_t i = 0; i < hist_cola.size(); i++) {
+    if (hist_cola[i]) cola_max = i;
+  }
+  fprintf(out, "Broker con %u pulseras (%s): %llu mensajes, %.0f msg/s\n", pulseras,
+          ranuras ? "con ranuras" : "sin ranuras", (unsigned long long)mensajes,
+          mensajes / duracion_s);
+  fprintf(out, "  CPU por %llu ms: media %.1f%% | p50 %.1f%% | p99 %.1f%% | máx %.1f%%\n",
+          (unsigned long long)(ventana_us / 1000), 100.0 * suma / (cpu.size() * ventana_us),
+          pct(0.50), pct(0.99), pct(1.0));
+  fprintf(out, "  cola al llegar: p50 %zu | p99 %zu | máx %zu%s mensajes\n",
+          percentil(hist_cola, mensajes, 0.50), percentil(hist_cola, mensajes, 0.99), cola_max,
+          cola_max == COLA_MAX ? "+" : "");
+  fprintf(out, "  espera en cola: p99 %.1f ms | máx %.1f ms\n",
+          percentil(hist_espera, mensajes, 0.99) * 0.1, espera_max_us / 1000.0);
+}
+
+}  // namespace oib_sim
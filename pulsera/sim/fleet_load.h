@@ -0,0 +1,74 @@
+/*
+ * Carga del broker con una flota de pulseras (sim --flota N)
+ *
+ * La pulsera simulada pasa a ser una de N: cada publicación suya se replica
+ * para las otras N-1 con el desfase que tendría cada una. Con ranuras
+ * (OIB_PUBLISH_SLOTS) el desfase es la diferencia de fases de
+ * PublishSlot::phaseFor con el id de cada pulsera (MACs consecutivas); sin
+ * ranuras todas se encienden juntas y sólo las separa la dispersión del
+ * arranque, uniforme en [0, arranque_us).
+ *
+ * El broker se modela como Mosquitto: un único hilo que atiende los PUBLISH
+ * en orden de llegada, con un costo fijo, uno por byte y uno por la entrega
+ * al suscriptor (la Raspberry). Se mide la ocupación de CPU en ventanas de
+ * ventana_us, los mensajes en el broker al llegar cada uno y la espera que
+ * agrega la cola.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "sim_network.h"
+
+namespace oib_sim {
+
+class FleetLoad {
+ public:
+  // Costos del broker en una Raspberry Pi 4 (µs)
+  double publish_us = 30.0;   // leer del socket, parsear, buscar suscriptores
+  double byte_us = 0.01;
+  double deliver_us = 12.0;   // armar y escribir el PUBLISH al suscriptor
+  uint64_t ventana_us = 100000;
+  uint64_t arranque_us = 300000;
+
+  // prefijo: "oib/<id>/" de la pulsera simulada; sólo se replican sus publicaciones
+  void begin(uint32_t pulseras, const std::string& prefijo, uint64_t efuse_mac, bool ranuras,
+             uint32_t periodo_ms, uint32_t semilla);
+  void onPublish(const MqttMessage& msg);
+  // Atiende lo que quedó pendiente
+  void finish();
+  void printSummary(FILE* out) const;
+
+ private:
+  struct Llegada {
+    uint64_t t_us;
+    uint32_t bytes;
+    bool operator>(const Llegada& o) const { return t_us > o.t_us; }
+  };
+  void atender(const Llegada& l);
+
+  uint32_t pulseras = 0;
+  bool ranuras = false;
+  std::string prefijo;
+  std::vector<uint64_t> desfase_us;  // por pulsera; la simulada es la 0
+  std::priority_queue<Llegada, std::vector<Llegada>, std::greater<Llegada>> pendientes;
+
+  double libre_us = 0;               // fin de atención del último mensaje
+  std::deque<double> en_broker;      // fin de atención de los que esperan o se atienden
+  std::vector<double> ocupado_us;    // por ventana
+  std::vector<uint64_t> hist_cola;   // mensajes en el broker al llegar
+  std::vector<uint64_t> hist_espera; // en pasos de 100 µs
+  uint64_t mensajes = 0;
+  uint64_t primero_us = 0;
+  uint64_t ultimo_us = 0;
+  double espera_max_us = 0;
+};
+
+}  // namespace oib_sim
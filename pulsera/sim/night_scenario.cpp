@@ -0,0 +1,181 @@
+#include "night_scenario.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace oib_sim {
+
+static const uint64_t SEG = 1000000ULL;
+static const uint64_t MIN = 60 * SEG;
+
+// Valores medios por estado (mismo orden que SleepStage)
+static const double HR_ESTADO[4] = {74.0, 62.0, 70.0, 53.0};
+static const double RESP_ESTADO[4] = {0.27, 0.24, 0.28, 0.22};
+// Movimientos por minuto y duración típica (s) por estado
+static const double MOV_TASA[4] = {1.5, 0.15, 0.05, 0.02};
+static const double MOV_DURACION[4] = {4.0, 2.5, 1.0, 2.0};
+
+NightScenario::NightScenario(uint32_t seed, double hours) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  std::normal_distribution<double> n(0.0, 1.0);
+
+  duration_us = (uint64_t)(hours * 3600.0 * SEG);
+  bed_enter_us = std::min<uint64_t>(3 * MIN, duration_us / 10);
+  bed_exit_us = duration_us > 10 * MIN ? duration_us - 5 * MIN : duration_us;
+
+  // ---------- Hipnograma: vigilia, ciclos de ~90 min, despertar final ----------
+  uint64_t t = 0;
+  auto agregar = [&](SleepStage s, uint64_t dur) {
+    uint64_t fin = std::min(t + dur, duration_us);
+    if (fin > t) hypnogram.push_back(Segment{t, fin, s});
+    t = fin;
+  };
+
+  agregar(STAGE_WAKE, bed_enter_us + (uint64_t)((10 + 5 * u(rng)) * MIN));
+  int ciclo = 0;
+  while (t + 15 * MIN < bed_exit_us) {
+    // Más sueño profundo al principio de la noche, más REM al final
+    double profundo = std::max(5.0, 35.0 - 8.0 * ciclo + 5 * n(rng));
+    double rem = std::min(35.0, 8.0 + 7.0 * ciclo + 3 * n(rng));
+    agregar(STAGE_LIGHT, (uint64_t)((20 + 5 * u(rng)) * MIN));
+    agregar(STAGE_DEEP, (uint64_t)(profundo * MIN));
+    agregar(STAGE_LIGHT, (uint64_t)((12 + 5 * u(rng)) * MIN));
+    agregar(STAGE_REM, (uint64_t)(std::max(5.0, rem) * MIN));
+    if (u(rng) < 0.4) agregar(STAGE_WAKE, (uint64_t)((1 + 3 * u(rng)) * MIN));
+    ciclo++;
+  }
+  agregar(STAGE_WAKE, duration_us - t);
+
+  // ---------- Movimientos y posturas ----------
+  postures.push_back(PostureChange{0, POSTURE_SUPINE});
+  for (const Segment& s : hypnogram) {
+    double tasa = MOV_TASA[s.stage] / 60.0;  // por segundo
+    uint64_t m = s.start_us;
+    while (true) {
+      m += (uint64_t)(-std::log(1.0 - u(rng)) / tasa * SEG);
+      if (m >= s.end_us) break;
+      uint64_t dur = (uint64_t)(MOV_DURACION[s.stage] * (0.5 + u(rng)) * SEG);
+      double intensidad = s.stage == STAGE_REM ? 0.1 + 0.1 * u(rng) : 0.3 + 0.7 * u(rng);
+      movements.push_back(Movement{m, m + dur, intensidad});
+      if ((s.stage == STAGE_WAKE || s.stage == STAGE_LIGHT) && u(rng) < 0.3) {
+        postures.push_back(PostureChange{m + dur / 2, (Posture)(rng() % 4)});
+      }
+      m += dur;
+    }
+  }
+
+  // ---------- Desaturaciones breves durante REM ----------
+  for (const Segment& s : hypnogram) {
+    if (s.stage == STAGE_REM && u(rng) < 0.35) {
+      uint64_t ini = s.start_us + (uint64_t)((s.end_us - s.start_us) * u(rng) * 0.7);
+      desaturations.push_back(Desaturation{ini, ini + (uint64_t)((25 + 30 * u(rng)) * SEG),
+                                           6.0 + 6.0 * u(rng)});
+    }
+  }
+
+  // El sensor de dedo se sale un par de veces en la noche
+  for (int i = 0; i < 2; i++) {
+    uint64_t ini = bed_enter_us + (uint64_t)((bed_exit_us - bed_enter_us) * u(rng));
+    finger_off.push_back(std::make_pair(ini, ini + (uint64_t)((20 + 60 * u(rng)) * SEG)));
+  }
+
+  // ---------- Series lentas a 1 Hz ----------
+  size_t n_seg = (size_t)(duration_us / SEG) + 2;
+  hr_1hz.resize(n_seg);
+  temp_1hz.resize(n_seg);
+  double hr = HR_ESTADO[STAGE_WAKE];
+  double deriva = 0.0;
+  double temp = 22.0;
+  for (size_t i = 0; i < n_seg; i++) {
+    uint64_t ti = i * SEG;
+    double objetivo = HR_ESTADO[stageAt(ti)] + 12.0 * movementAt(ti);
+    deriva = 0.995 * deriva + 0.15 * n(rng);
+    hr += (objetivo - hr) / 45.0;
+    hr_1hz[i] = (float)(hr + deriva);
+
+    // La cama se calienta con la persona y se enfría al salir
+    double ambiente = 22.0 - 0.3 * (double)ti / (8.0 * 3600.0 * SEG);
+    double objetivo_t = inBed(ti) ? ambiente + 5.0 : ambiente;
+    temp += (objetivo_t - temp) / (inBed(ti) ? 600.0 : 900.0);
+    temp_1hz[i] = (float)(temp + 0.02 * n(rng));
+  }
+}
+
+SleepStage NightScenario::stageAt(uint64_t t_us) const {
+  auto it = std::upper_bound(hypnogram.begin(), hypnogram.end(), t_us,
+                             [](uint64_t t, const Segment& s) { return t < s.end_us; });
+  return it == hypnogram.end() ? STAGE_WAKE : it->stage;
+}
+
+bool NightScenario::inBed(uint64_t t_us) const {
+  return t_us >= bed_enter_us && t_us < bed_exit_us;
+}
+
+bool NightScenario::fingerOn(uint64_t t_us) const {
+  // La pulsera se pone al acostarse y se saca al levantarse
+  if (!inBed(t_us)) return false;
+  for (const auto& f : finger_off) {
+    if (t_us >= f.first && t_us < f.second) return false;
+  }
+  return true;
+}
+
+Posture NightScenario::postureAt(uint64_t t_us) const {
+  auto it = std::upper_bound(postures.begin(), postures.end(), t_us,
+                             [](uint64_t t, const PostureChange& p) { return t < p.t_us; });
+  return it == postures.begin() ? POSTURE_SUPINE : (it - 1)->posture;
+}
+
+double NightScenario::movementAt(uint64_t t_us) const {
+  auto it = std::upper_bound(movements.begin(), movements.end(), t_us,
+                             [](uint64_t t, const Movement& m) { return t < m.start_us; });
+  if (it == movements.begin()) return 0.0;
+  --it;
+  return t_us < it->end_us ? it->intensity : 0.0;
+}
+
+double NightScenario::sampled(const std::vector<float>& serie, uint64_t t_us) const {
+  size_t i = (size_t)(t_us / SEG);
+  if (i + 1 >= serie.size()) return serie.back();
+  double f = (double)(t_us % SEG) / SEG;
+  return serie[i] * (1.0 - f) + serie[i + 1] * f;
+}
+
+double NightScenario::heartRateAt(uint64_t t_us) const {
+  return sampled(hr_1hz, t_us);
+}
+
+double NightScenario::respirationHzAt(uint64_t t_us) const {
+  return RESP_ESTADO[stageAt(t_us)];
+}
+
+double NightScenario::spo2At(uint64_t t_us) const {
+  double spo2 = 97.0;
+  for (const auto& d : desaturations) {
+    if (t_us >= d.start_us && t_us < d.end_us) {
+      double f = (double)(t_us - d.start_us) / (d.end_us - d.start_us);
+      spo2 -= d.depth * std::sin(M_PI * f);
+    }
+  }
+  return spo2;
+}
+
+double NightScenario::bedTemperatureAt(uint64_t t_us) const {
+  return sampled(temp_1hz, t_us);
+}
+
+double NightScenario::humidityAt(uint64_t t_us) const {
+  return 45.0 + (inBed(t_us) ? 8.0 : 0.0) + 0.5 * std::sin((double)t_us / (900.0 * SEG));
+}
+
+uint64_t NightScenario::minutesIn(SleepStage stage) const {
+  uint64_t total = 0;
+  for (const Segment& s : hypnogram) {
+    if (s.stage == stage) total += s.end_us - s.start_us;
+  }
+  return total / MIN;
+}
+
+}  // namespace oib_sim
@@ -0,0 +1,80 @@
+/*
+ * Escenario de una noche simulada
+ *
+ * Genera de forma determinista (a partir de una semilla) un hipnograma con
+ * los mismos estados que usa el controlador de la cama (WAKE=0, LIGHT=1,
+ * REM=2, DEEP=3), eventos de movimiento, cambios de postura, temperatura de
+ * la cama y frecuencia cardíaca/respiratoria. Los modelos de sensores leen
+ * este escenario para producir las señales crudas.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace oib_sim {
+
+enum SleepStage { STAGE_WAKE = 0, STAGE_LIGHT = 1, STAGE_REM = 2, STAGE_DEEP = 3 };
+
+enum Posture { POSTURE_SUPINE = 0, POSTURE_PRONE = 1, POSTURE_LEFT = 2, POSTURE_RIGHT = 3 };
+
+class NightScenario {
+ public:
+  NightScenario(uint32_t seed, double hours);
+
+  SleepStage stageAt(uint64_t t_us) const;
+  bool inBed(uint64_t t_us) const;
+  bool fingerOn(uint64_t t_us) const;
+  Posture postureAt(uint64_t t_us) const;
+
+  // Intensidad de movimiento en [0, 1] (0 = quieto)
+  double movementAt(uint64_t t_us) const;
+
+  double heartRateAt(uint64_t t_us) const;     // BPM medio (sin HRV latido a latido)
+  double respirationHzAt(uint64_t t_us) const;
+  double spo2At(uint64_t t_us) const;          // %
+  double bedTemperatureAt(uint64_t t_us) const;  // °C
+  double humidityAt(uint64_t t_us) const;      // %RH
+
+  uint64_t durationMicros() const { return duration_us; }
+  uint64_t minutesIn(SleepStage stage) const;
+
+ private:
+  struct Segment {
+    uint64_t start_us;
+    uint64_t end_us;
+    SleepStage stage;
+  };
+  struct Movement {
+    uint64_t start_us;
+    uint64_t end_us;
+    double intensity;
+  };
+  struct PostureChange {
+    uint64_t t_us;
+    Posture posture;
+  };
+  struct Desaturation {
+    uint64_t start_us;
+    uint64_t end_us;
+    double depth;
+  };
+
+  double sampled(const std::vector<float>& serie, uint64_t t_us) const;
+
+  uint64_t duration_us;
+  uint64_t bed_enter_us;
+  uint64_t bed_exit_us;
+  std::vector<Segment> hypnogram;
+  std::vector<Movement> movements;
+  std::vector<PostureChange> postures;
+  std::vector<Desaturation> desaturations;
+  std::vector<std::pair<uint64_t, uint64_t>> finger_off;
+
+  // Series a 1 Hz con la dinámica lenta (HR, temperatura)
+  std::vector<float> hr_1hz;
+  std::vector<float> temp_1hz;
+};
+
+}  // namespace oib_sim
@@ -0,0 +1,396 @@
+#include "sensor_models.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "virtual_clock.h"
+
+namespace oib_sim {
+
+static uint8_t crc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+// ==================== HTU21D ====================
+
+static const double HTU21D_CONV_T_MS[] = {44, 11, 22, 6};
+static const double HTU21D_CONV_H_MS[] = {14, 3, 4, 7};
+
+void Htu21dModel::i2cWrite(const uint8_t* data, size_t len) {
+  if (len == 0) return;
+  int res = (user_reg & 0x01) | ((user_reg >> 6) & 0x02);
+  uint64_t ahora = virtualClock().nowMicros();
+
+  switch (data[0]) {
+    case 0xFE:
+      user_reg = 0x02;
+      lectura = NADA;
+      break;
+    case 0xE7:
+      lectura = USUARIO;
+      break;
+    case 0xE6:
+      if (len > 1) user_reg = (uint8_t)((data[1] & 0x81) | 0x02);
+      break;
+    case 0xE3:
+    case 0xF3:
+      lectura = TEMPERATURA;
+      listo_us = ahora + (uint64_t)(HTU21D_CONV_T_MS[res] * 1000);
+      break;
+    case 0xE5:
+    case 0xF5:
+      lectura = HUMEDAD;
+      listo_us = ahora + (uint64_t)(HTU21D_CONV_H_MS[res] * 1000);
+      break;
+  }
+}
+
+size_t Htu21dModel::i2cRead(uint8_t* buf, size_t len) {
+  uint64_t ahora = virtualClock().nowMicros();
+
+  if (lectura == USUARIO) {
+    if (len > 0) buf[0] = user_reg;
+    return std::min<size_t>(len, 1);
+  }
+  if (lectura == NADA || ahora < listo_us) return 0;  // NACK: conversión en curso
+
+  uint16_t crudo;
+  if (lectura == TEMPERATURA) {
+    double t = esc.bedTemperatureAt(ahora);
+    crudo = (uint16_t)((t + 46.85) / 175.72 * 65536.0) & 0xFFFC;
+  } else {
+    double rh = esc.humidityAt(ahora);
+    crudo = ((uint16_t)((rh + 6.0) / 125.0 * 65536.0) & 0xFFFC) | 0x02;
+  }
+  lectura = NADA;
+
+  uint8_t datos[3] = {(uint8_t)(crudo >> 8), (uint8_t)(crudo & 0xFF), 0};
+  datos[2] = crc8(datos, 2);
+  size_t n = std::min<size_t>(len, 3);
+  memcpy(buf, datos, n);
+  return n;
+}
+
+// ==================== MAX30105 ====================
+
+static const uint8_t MAX_FIFOWRITEPTR = 0x04;
+static const uint8_t MAX_FIFOOVERFLOW = 0x05;
+static const uint8_t MAX_FIFOREADPTR = 0x06;
+static const uint8_t MAX_FIFODATA = 0x07;
+static const uint8_t MAX_FIFOCONFIG = 0x08;
+static const uint8_t MAX_MODECONFIG = 0x09;
+static const uint8_t MAX_PARTICLECONFIG = 0x0A;
+static const uint8_t MAX_MULTILEDCONFIG1 = 0x11;
+static const uint8_t MAX_MULTILEDCONFIG2 = 0x12;
+static const uint8_t MAX_DIETEMPCONFIG = 0x21;
+
+static const uint16_t MAX_TASAS[] = {50, 100, 200, 400, 800, 1000, 1600, 3200};
+static const uint8_t MAX_PROMEDIOS[] = {1, 2, 4, 8, 16, 32, 32, 32};
+
+Max30105Model::Max30105Model(const NightScenario& scenario, uint32_t seed)
+    : esc(scenario), rng(seed ^ 0x30105) {
+  resetRegisters();
+}
+
+void Max30105Model::resetRegisters() {
+  memset(regs, 0, sizeof(regs));
+  regs[0x00] = 0x01;  // PWR_RDY
+  regs[0xFE] = 0x03;  // revisión
+  regs[0xFF] = 0x15;  // part ID (igual para MAX30102)
+  wr = rd = ovf = 0;
+  byte_en_muestra = 0;
+  reconfigure();
+}
+
+uint8_t Max30105Model::activeSlots(uint8_t* tipos) const {
+  uint8_t modo = regs[MAX_MODECONFIG] & 0x07;
+  if (modo == 0x02) {
+    tipos[0] = 1;
+    return 1;
+  }
+  if (modo == 0x03) {
+    tipos[0] = 1;
+    tipos[1] = 2;
+    return 2;
+  }
+  if (modo == 0x07) {
+    uint8_t slots[4] = {(uint8_t)(regs[MAX_MULTILEDCONFIG1] & 0x07),
+                        (uint8_t)((regs[MAX_MULTILEDCONFIG1] >> 4) & 0x07),
+                        (uint8_t)(regs[MAX_MULTILEDCONFIG2] & 0x07),
+                        (uint8_t)((regs[MAX_MULTILEDCONFIG2] >> 4) & 0x07)};
+    uint8_t n = 0;
+    while (n < 4 && slots[n] != 0 && n < 3) {
+      tipos[n] = slots[n] & 0x03;
+      n++;
+    }
+    return n;
+  }
+  return 0;
+}
+
+void Max30105Model::reconfigure() {
+  uint8_t tipos[3];
+  bool activo = activeSlots(tipos) > 0 && !(regs[MAX_MODECONFIG] & 0x80);
+  uint64_t nuevo = 0;
+  if (activo) {
+    double tasa = (double)MAX_TASAS[(regs[MAX_PARTICLECONFIG] >> 2) & 0x07] /
+                  MAX_PROMEDIOS[(regs[MAX_FIFOCONFIG] >> 5) & 0x07];
+    nuevo = (uint64_t)(1e6 / tasa);
+  }
+  if (nuevo == periodo_us) return;
+
+  virtualClock().cancel(evento);
+  evento = 0;
+  periodo_us = nuevo;
+  if (periodo_us) {
+    ultima_us = virtualClock().nowMicros();
+    evento = virtualClock().scheduleEvery(periodo_us, [this]() { produceSample(); },
+                                          ultima_us + periodo_us);
+  }
+}
+
+uint32_t Max30105Model::channelValue(uint8_t tipo, double ac_ir, double ac_red, double resp) const {
+  // LED1 = rojo, LED2 = IR, LED3 = verde; la señal escala con la corriente del LED
+  double dc, ac;
+  if (tipo == 1) {
+    dc = 2700.0 * regs[0x0C];
+    ac = ac_red;
+  } else if (tipo == 2) {
+    dc = 3000.0 * regs[0x0D];
+    ac = ac_ir;
+  } else {
+    dc = 1500.0 * regs[0x0E];
+    ac = 0.5 * ac_ir;
+  }
+  double v = dc * (1.0 + 0.003 * resp) - dc * ac;
+  return (uint32_t)std::max(0.0, std::min(262143.0, v));
+}
+
+void Max30105Model::produceSample() {
+  uint64_t t = virtualClock().nowMicros();
+  double dt = (t - ultima_us) / 1e6;
+  ultima_us = t;
+
+  double ts = t / 1e6;
+  double resp = std::sin(2 * M_PI * esc.respirationHzAt(t) * ts);
+  double ac_ir = 0.0, ac_red = 0.0;
+
+  if (esc.fingerOn(t)) {
+    // Arritmia sinusal respiratoria (mayor en sueño profundo) + componente LF
+    double rsa = esc.stageAt(t) == STAGE_DEEP ? 0.05 : 0.025;
+    double hr = esc.heartRateAt(t) * (1.0 + rsa * resp + 0.02 * std::sin(2 * M_PI * 0.1 * ts));
+    fase_latido += dt * hr / 60.0;
+    fase_latido -= std::floor(fase_latido);
+
+    double p = std::exp(-std::pow((fase_latido - 0.2) / 0.1, 2)) +
+               0.12 * std::exp(-std::pow((fase_latido - 0.5) / 0.1, 2));
+    double r = (104.0 - esc.spo2At(t)) / 17.0;  // razón R de la SpO2 empírica
+    ac_ir = 0.005 * p;
+    ac_red = 0.005 * r * p;
+  } else {
+    ac_ir = ac_red = 0.99;  // sólo luz ambiente
+  }
+
+  artefacto = 0.97 * artefacto + esc.movementAt(t) * 400.0 * ruido(rng);
+
+  uint8_t tipos[3];
+  uint8_t n = activeSlots(tipos);
+  uint8_t cuenta = (uint8_t)((wr - rd) & 0x1F);
+  if (cuenta == 31) {
+    // FIFO lleno con rollover: se pierde la muestra más vieja
+    rd = (rd + 1) & 0x1F;
+    ovf = std::min<uint8_t>(31, ovf + 1);
+    desbordes++;
+  }
+  for (uint8_t i = 0; i < n; i++) {
+    double v = channelValue(tipos[i], ac_ir, ac_red, resp) + artefacto + 15.0 * ruido(rng);
+    fifo[wr][i] = (uint32_t)std::max(0.0, std::min(262143.0, v));
+  }
+  wr = (wr + 1) & 0x1F;
+  producidas++;
+}
+
+void Max30105Model::i2cWrite(const uint8_t* data, size_t len) {
+  if (len == 0) return;
+  puntero = data[0];
+
+  for (size_t i = 1; i < len; i++) {
+    uint8_t reg = puntero;
+    uint8_t v = data[i];
+    switch (reg) {
+      case MAX_FIFOWRITEPTR:
+        wr = v & 0x1F;
+        byte_en_muestra = 0;
+        break;
+      case MAX_FIFOOVERFLOW:
+        ovf = v & 0x1F;
+        break;
+      case MAX_FIFOREADPTR:
+        rd = v & 0x1F;
+        byte_en_muestra = 0;
+        break;
+      case MAX_MODECONFIG:
+        if (v & 0x40) {
+          resetRegisters();  // el bit de reset se limpia solo
+        } else {
+          regs[reg] = v;
+          reconfigure();
+        }
+        break;
+      case MAX_FIFOCONFIG:
+      case MAX_PARTICLECONFIG:
+      case MAX_MULTILEDCONFIG1:
+      case MAX_MULTILEDCONFIG2:
+        regs[reg] = v;
+        reconfigure();
+        break;
+      case MAX_DIETEMPCONFIG:
+        if (v & 0x01) {
+          virtualClock().schedule(virtualClock().nowMicros() + 29000, [this]() {
+            double temp = 31.0 + 0.5 * ruido(rng);
+            regs[0x1F] = (uint8_t)(int8_t)std::floor(temp);
+            regs[0x20] = (uint8_t)((temp - std::floor(temp)) / 0.0625) & 0x0F;
+            regs[0x01] |= 0x02;  // DIE_TEMP_RDY
+          });
+        }
+        break;
+      default:
+        regs[reg] = v;
+        break;
+    }
+    if (reg != MAX_FIFODATA) puntero++;
+  }
+}
+
+size_t Max30105Model::i2cRead(uint8_t* buf, size_t len) {
+  uint8_t tipos[3];
+  uint8_t n = activeSlots(tipos);
+
+  for (size_t k = 0; k < len; k++) {
+    if (puntero == MAX_FIFODATA) {
+      uint8_t cuenta = (uint8_t)((wr - rd) & 0x1F);
+      if (cuenta == 0 || n == 0) {
+        buf[k] = 0;
+        continue;
+      }
+      uint32_t v = fifo[rd][byte_en_muestra / 3];
+      uint8_t b = byte_en_muestra % 3;
+      buf[k] = b == 0 ? (uint8_t)((v >> 16) & 0x03) : (b == 1 ? (uint8_t)(v >> 8) : (uint8_t)v);
+      if (++byte_en_muestra == n * 3) {
+        byte_en_muestra = 0;
+        rd = (rd + 1) & 0x1F;
+      }
+      continue;
+    }
+
+    switch (puntero) {
+      case MAX_FIFOWRITEPTR: buf[k] = wr; break;
+      case MAX_FIFOOVERFLOW: buf[k] = ovf; break;
+      case MAX_FIFOREADPTR: buf[k] = rd; break;
+      case 0x01:
+        buf[k] = regs[0x01];
+        regs[0x01] = 0;  // leer el estado limpia las interrupciones
+        break;
+      case 0x20:
+        buf[k] = regs[0x20];
+        regs[0x01] &= (uint8_t)~0x02;
+        break;
+      default: buf[k] = regs[puntero]; break;
+    }
+    puntero++;
+  }
+  return len;
+}
+
+// ==================== MMA8452Q ====================
+
+static const uint8_t MMA_STATUS = 0x00;
+static const uint8_t MMA_OUT_X_MSB = 0x01;
+static const uint8_t MMA_SYSMOD = 0x0B;
+static const uint8_t MMA_WHO_AM_I = 0x0D;
+static const uint8_t MMA_XYZ_DATA_CFG = 0x0E;
+static const uint8_t MMA_CTRL_REG1 = 0x2A;
+
+static const double MMA_TASAS[] = {800, 400, 200, 100, 50, 12.5, 6.25, 1.5625};
+
+Mma8452qModel::Mma8452qModel(const NightScenario& scenario, uint32_t seed)
+    : esc(scenario), rng(seed ^ 0x8452) {
+  memset(regs, 0, sizeof(regs));
+  regs[MMA_WHO_AM_I] = 0x2A;
+}
+
+void Mma8452qModel::reconfigure() {
+  uint64_t nuevo = 0;
+  if (regs[MMA_CTRL_REG1] & 0x01) {
+    nuevo = (uint64_t)(1e6 / MMA_TASAS[(regs[MMA_CTRL_REG1] >> 3) & 0x07]);
+  }
+  if (nuevo == periodo_us) return;
+
+  virtualClock().cancel(evento);
+  evento = 0;
+  periodo_us = nuevo;
+  if (periodo_us) {
+    evento = virtualClock().scheduleEvery(periodo_us, [this]() { produceSample(); },
+                                          virtualClock().nowMicros() + periodo_us);
+  }
+}
+
+void Mma8452qModel::produceSample() {
+  uint64_t t = virtualClock().nowMicros();
+  double g[3];
+  switch (esc.postureAt(t)) {
+    case POSTURE_PRONE: g[0] = 0.0; g[1] = 0.05; g[2] = -1.0; break;
+    case POSTURE_LEFT: g[0] = 0.95; g[1] = 0.0; g[2] = 0.3; break;
+    case POSTURE_RIGHT: g[0] = -0.95; g[1] = 0.0; g[2] = 0.3; break;
+    default: g[0] = 0.02; g[1] = 0.05; g[2] = 1.0; break;
+  }
+
+  double mov = esc.movementAt(t);
+  double resp = 0.004 * std::sin(2 * M_PI * esc.respirationHzAt(t) * t / 1e6);
+  double escala = 2 << (regs[MMA_XYZ_DATA_CFG] & 0x03);
+
+  for (int i = 0; i < 3; i++) {
+    double v = g[i] + (i == 2 ? resp : 0.0) + 0.35 * mov * ruido(rng) + 0.003 * ruido(rng);
+    long cuentas = std::lround(v / escala * 2048.0);
+    cuentas = std::max(-2048L, std::min(2047L, cuentas));
+    uint16_t crudo = (uint16_t)((int16_t)cuentas << 4);
+    regs[MMA_OUT_X_MSB + 2 * i] = (uint8_t)(crudo >> 8);
+    regs[MMA_OUT_X_MSB + 2 * i + 1] = (uint8_t)crudo;
+  }
+
+  if (regs[MMA_STATUS] & 0x08) regs[MMA_STATUS] |= 0x80;  // ZYXOW: dato sobrescrito
+  regs[MMA_STATUS] |= 0x0F;
+}
+
+void Mma8452qModel::i2cWrite(const uint8_t* data, size_t len) {
+  if (len == 0) return;
+  puntero = data[0];
+  bool reconfigurar = false;
+  for (size_t i = 1; i < len; i++) {
+    regs[puntero] = data[i];
+    if (puntero == MMA_CTRL_REG1 || puntero == MMA_XYZ_DATA_CFG) reconfigurar = true;
+    puntero++;
+  }
+  if (reconfigurar) reconfigure();
+}
+
+size_t Mma8452qModel::i2cRead(uint8_t* buf, size_t len) {
+  for (size_t k = 0; k < len; k++) {
+    if (puntero == MMA_SYSMOD) {
+      buf[k] = (regs[MMA_CTRL_REG1] & 0x01) ? 0x01 : 0x00;
+    } else {
+      buf[k] = regs[puntero];
+    }
+    if (puntero == MMA_OUT_X_MSB) regs[MMA_STATUS] = 0;  // leer datos limpia ZYXDR
+    puntero++;
+  }
+  return len;
+}
+
+}  // namespace oib_sim
@@ -0,0 +1,97 @@
+/*
+ * Modelos I2C de los sensores de la pulsera para la simulación nativa
+ *
+ * Implementan el mapa de registros que usan las librerías de lib/ (no todo el
+ * datasheet): los drivers reales corren sin cambios sobre el bus simulado.
+ * Las muestras nuevas se generan con eventos periódicos del reloj virtual a la
+ * frecuencia configurada en los registros del propio sensor.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <random>
+
+#include "Wire.h"
+#include "night_scenario.h"
+
+namespace oib_sim {
+
+// HTU21D: temperatura/humedad con conversión "no hold master"
+class Htu21dModel : public I2CDevice {
+ public:
+  explicit Htu21dModel(const NightScenario& scenario) : esc(scenario) {}
+
+  void i2cWrite(const uint8_t* data, size_t len) override;
+  size_t i2cRead(uint8_t* buf, size_t len) override;
+
+ private:
+  enum Lectura { NADA, USUARIO, TEMPERATURA, HUMEDAD };
+
+  const NightScenario& esc;
+  uint8_t user_reg = 0x02;
+  Lectura lectura = NADA;
+  uint64_t listo_us = 0;
+};
+
+// MAX30105/MAX30102: FIFO de 32 muestras con punteros de escritura/lectura
+class Max30105Model : public I2CDevice {
+ public:
+  Max30105Model(const NightScenario& scenario, uint32_t seed);
+
+  void i2cWrite(const uint8_t* data, size_t len) override;
+  size_t i2cRead(uint8_t* buf, size_t len) override;
+
+  uint64_t samplesProduced() const { return producidas; }
+  uint64_t overflows() const { return desbordes; }
+
+ private:
+  void resetRegisters();
+  void reconfigure();
+  void produceSample();
+  uint8_t activeSlots(uint8_t* tipos) const;
+  uint32_t channelValue(uint8_t tipo, double ac_ir, double ac_red, double resp) const;
+
+  const NightScenario& esc;
+  std::mt19937 rng;
+  std::normal_distribution<double> ruido{0.0, 1.0};
+
+  uint8_t regs[256];
+  uint8_t puntero = 0;
+
+  uint32_t fifo[32][3];
+  uint8_t wr = 0, rd = 0, ovf = 0;
+  uint8_t byte_en_muestra = 0;
+
+  uint32_t evento = 0;
+  uint64_t periodo_us = 0;
+  double fase_latido = 0.0;
+  double artefacto = 0.0;
+  uint64_t ultima_us = 0;
+  uint64_t producidas = 0;
+  uint64_t desbordes = 0;
+};
+
+// MMA8452Q: acelerómetro de 12 bits con bandera ZYXDR
+class Mma8452qModel : public I2CDevice {
+ public:
+  Mma8452qModel(const NightScenario& scenario, uint32_t seed);
+
+  void i2cWrite(const uint8_t* data, size_t len) override;
+  size_t i2cRead(uint8_t* buf, size_t len) override;
+
+ private:
+  void reconfigure();
+  void produceSample();
+
+  const NightScenario& esc;
+  std::mt19937 rng;
+  std::normal_distribution<double> ruido{0.0, 1.0};
+
+  uint8_t regs[256];
+  uint8_t puntero = 0;
+  uint32_t evento = 0;
+  uint64_t periodo_us = 0;
+};
+
+}  // namespace oib_sim
@@ -0,0 +1,58 @@
+#include "Arduino.h"
+
+#include <random>
+
+#include "sim_network.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static std::mt19937& generador() {
+  static std::mt19937 g(1);
+  return g;
+}
+
+unsigned long millis() {
+  return oib_sim::virtualClock().nowMillis();
+}
+
+unsigned long micros() {
+  return (unsigned long)oib_sim::virtualClock().nowMicros();
+}
+
+void configTime(long, int, const char*, const char*, const char*) {
+  oib_sim::network().sntpStart(oib_sim::virtualClock().nowMicros());
+}
+
+long random(long max) {
+  return max > 0 ? (long)(generador()() % (unsigned long)max) : 0;
+}
+
+long random(long min, long max) {
+  return max > min ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long seed) {
+  generador().seed(seed);
+}
+
+// Heap modelado con los valores típicos de un ESP32-C3 con WiFi activo
+uint32_t EspClass::getHeapSize() { return 327680; }
+uint32_t EspClass::getFreeHeap() { return 214000; }
+uint32_t EspClass::getMinFreeHeap() { return 201000; }
+uint32_t EspClass::getMaxAllocHeap() { return 110580; }
+uint64_t EspClass::getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+uint32_t EspClass::getCycleCount() { return (uint32_t)(oib_sim::virtualClock().nowMicros() * 160); }
+
+void EspClass::restart() {
+  fprintf(stderr, "ESP.restart() llamado en t=%lu ms\n", millis());
+  exit(2);
+}
+
+size_t getArduinoLoopTaskStackSize(void) {
+  return 8192;
+}
+
+unsigned int uxTaskGetStackHighWaterMark(TaskHandle_t) {
+  return 8192 - 3100;
+}
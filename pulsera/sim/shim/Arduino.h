@@ -0,0 +1,92 @@
+/*
+ * Arduino.h mínimo para el entorno native_sim
+ *
+ * Sólo cubre lo que usan src/main.cpp y las librerías de lib/. El tiempo lo
+ * lleva el reloj virtual (virtual_clock.h): delay() no duerme, avanza el reloj
+ * y registra el sitio de la llamada.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "WString.h"
+#include "virtual_clock.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+using std::abs;
+using std::isnan;
+using std::max;
+using std::min;
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+unsigned long millis();
+unsigned long micros();
+
+#define delay(ms) ::oib_sim::delayAt((ms), __FILE__, __LINE__)
+#define delayMicroseconds(us) ::oib_sim::delayMicrosAt((us), __FILE__, __LINE__)
+
+template <typename T, typename L, typename H>
+inline T constrain(T x, L lo, H hi) {
+  return x < (T)lo ? (T)lo : (x > (T)hi ? (T)hi : x);
+}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+
+// SNTP (esp32-hal-time): la hora de pared la da la red simulada
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// Serial: escribe en stdout
+class HardwareSerial {
+ public:
+  void begin(unsigned long) {}
+  size_t print(const String& s) { return fwrite(s.c_str(), 1, s.length(), stdout); }
+  size_t print(const char* s) { return fputs(s, stdout) >= 0 ? strlen(s) : 0; }
+  template <typename T>
+  size_t print(T v) { return print(String(v)); }
+  size_t println() { return print("\n"); }
+  template <typename T>
+  size_t println(T v) { return print(v) + println(); }
+  operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+// Subconjunto de EspClass (ESP.getFreeHeap(), etc.) con un heap modelado
+class EspClass {
+ public:
+  uint32_t getHeapSize();
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint64_t getEfuseMac();
+  uint32_t getCycleCount();
+  void restart();
+};
+extern EspClass ESP;
+
+// FreeRTOS / núcleo arduino-esp32
+typedef void* TaskHandle_t;
+size_t getArduinoLoopTaskStackSize(void);
+unsigned int uxTaskGetStackHighWaterMark(TaskHandle_t task);
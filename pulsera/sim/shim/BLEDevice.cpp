@@ -0,0 +1,171 @@
+#include "BLEDevice.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "sim_network.h"
+#include "virtual_clock.h"
+
+static uint16_t mtu_local = 23;
+static BLEServer* servidor = nullptr;
+static BLEAdvertising anuncio;
+static gap_event_handler al_evento_gap = nullptr;
+static uint32_t conexion_pendiente = 0;  // evento del reloj, 0 = ninguno
+
+static void bloquear(const char* sitio, uint64_t us) {
+  oib_sim::virtualClock().recordBlocking(sitio, us);
+  oib_sim::virtualClock().advance(us);
+}
+
+BLECharacteristic* BLEService::createCharacteristic(const char* uuid, uint32_t properties) {
+  caracteristicas.push_back(new BLECharacteristic(uuid, properties, servidor));
+  return caracteristicas.back();
+}
+
+BLE2902* BLECharacteristic::cccd() {
+  for (BLEDescriptor* d : descriptores) {
+    BLE2902* c = dynamic_cast<BLE2902*>(d);
+    if (c) return c;
+  }
+  return nullptr;
+}
+
+void BLECharacteristic::notify(bool) {
+  if (!servidor || !servidor->getConnectedCount()) {
+    if (callbacks) callbacks->onStatus(this, BLECharacteristicCallbacks::ERROR_NO_CLIENT, 0);
+    return;
+  }
+  BLE2902* c = cccd();
+  if (!c || !c->getNotifications()) {
+    if (callbacks) callbacks->onStatus(this, BLECharacteristicCallbacks::ERROR_NOTIFY_DISABLED, 0);
+    return;
+  }
+  oib_sim::SimNetwork& net = oib_sim::network();
+  bloquear("BLE notify", net.ble_notify_us);
+  size_t largo = std::min<size_t>(valor.size(), servidor->getPeerMTU(0) - 3);
+  bool ok = net.bleNotify((const uint8_t*)valor.data(), largo);
+  if (callbacks) {
+    callbacks->onStatus(this, ok ? BLECharacteristicCallbacks::SUCCESS_NOTIFY
+                                 : BLECharacteristicCallbacks::ERROR_GATT, ok ? 0 : 0x8f);
+  }
+}
+
+void BLECharacteristic::centralWrite(const std::string& value) {
+  valor = value;
+  if (callbacks) callbacks->onWrite(this);
+}
+
+BLEService* BLEServer::createService(const char* uuid) {
+  servicios.push_back(new BLEService(uuid, this));
+  return servicios.back();
+}
+
+void BLEServer::centralConnect() {
+  oib_sim::SimNetwork& net = oib_sim::network();
+  oib_sim::VirtualClock& reloj = oib_sim::virtualClock();
+  conectado = true;
+  mtu = std::min(mtu_local, net.ble_central_mtu);
+  intervalo = net.ble_central_interval;
+  net.bleConnected(reloj.nowMicros(), intervalo);
+
+  esp_ble_gatts_cb_param_t param;
+  memset(&param, 0, sizeof(param));
+  param.connect.conn_params.interval = intervalo;
+  param.connect.remote_bda[0] = 0xC0;
+  if (callbacks) {
+    callbacks->onConnect(this);
+    callbacks->onConnect(this, &param);
+    // Intercambio de MTU, justo después de conectarse
+    memset(&param, 0, sizeof(param));
+    param.mtu.mtu = mtu;
+    callbacks->onMtuChanged(this, &param);
+  }
+
+  // El central descubre el servicio y habilita las notificaciones
+  reloj.schedule(reloj.nowMicros() + 4 * intervalo * 1250ULL, [this]() {
+    if (!conectado) return;
+    for (BLEService* s : servicios) {
+      for (BLECharacteristic* c : s->characteristics()) {
+        if (c->cccd()) c->cccd()->setNotifications(true);
+      }
+    }
+  });
+}
+
+void BLEServer::centralDisconnect() {
+  if (!conectado) return;
+  conectado = false;
+  for (BLEService* s : servicios) {
+    for (BLECharacteristic* c : s->characteristics()) {
+      if (c->cccd()) c->cccd()->setNotifications(false);
+    }
+  }
+  if (callbacks) callbacks->onDisconnect(this);
+}
+
+void BLEServer::updateConnParams(esp_bd_addr_t, uint16_t minInterval, uint16_t maxInterval,
+                                 uint16_t latency, uint16_t timeout) {
+  if (!conectado) return;
+  oib_sim::SimNetwork& net = oib_sim::network();
+  oib_sim::VirtualClock& reloj = oib_sim::virtualClock();
+  // El central elige su preferido dentro del rango; rige unos eventos después
+  uint16_t nuevo = std::max(minInterval, std::min(maxInterval, net.ble_central_interval));
+  uint64_t instante = reloj.nowMicros() + 6 * intervalo * 1250ULL;
+  reloj.schedule(instante, [this, nuevo, minInterval, maxInterval, latency, timeout, instante]() {
+    if (!conectado) return;
+    intervalo = nuevo;
+    oib_sim::network().bleIntervalChanged(instante, nuevo);
+    if (!al_evento_gap) return;
+    esp_ble_gap_cb_param_t param;
+    memset(&param, 0, sizeof(param));
+    param.update_conn_params.min_int = minInterval;
+    param.update_conn_params.max_int = maxInterval;
+    param.update_conn_params.latency = latency;
+    param.update_conn_params.conn_int = nuevo;
+    param.update_conn_params.timeout = timeout;
+    al_evento_gap(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &param);
+  });
+}
+
+void BLEServer::disconnect(uint16_t) {
+  centralDisconnect();
+}
+
+void BLEAdvertising::start() {
+  if (!servidor || servidor->getConnectedCount() || conexion_pendiente) return;
+  oib_sim::VirtualClock& reloj = oib_sim::virtualClock();
+  conexion_pendiente = reloj.schedule(reloj.nowMicros() + oib_sim::network().ble_connect_us, []() {
+    conexion_pendiente = 0;
+    if (servidor) servidor->centralConnect();
+  });
+}
+
+void BLEAdvertising::stop() {
+  if (conexion_pendiente) oib_sim::virtualClock().cancel(conexion_pendiente);
+  conexion_pendiente = 0;
+}
+
+void BLEDevice::init(const std::string&) {
+  bloquear("BLE init", 120000);  // arranque del controlador y de Bluedroid
+}
+
+void BLEDevice::setMTU(uint16_t mtu) {
+  mtu_local = mtu;
+}
+
+BLEServer* BLEDevice::createServer() {
+  servidor = new BLEServer();
+  return servidor;
+}
+
+BLEAdvertising* BLEDevice::getAdvertising() {
+  return &anuncio;
+}
+
+void BLEDevice::startAdvertising() {
+  anuncio.start();
+}
+
+void BLEDevice::setCustomGapHandler(gap_event_handler handler) {
+  al_evento_gap = handler;
+}
@@ -0,0 +1,184 @@
+/*
+ * BLE simulado: subconjunto de la librería BLE de arduino-esp32 (Bluedroid)
+ *
+ * Un único central simulado (ver SimNetwork) se conecta poco después de
+ * startAdvertising(), negocia MTU, acepta el intervalo pedido con
+ * updateConnParams() si cae en su rango y se suscribe a las notificaciones.
+ * notify() bloquea lo que tarda en pasar la notificación al controlador y
+ * la entrega ocurre en el próximo evento de conexión con lugar.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+typedef uint8_t esp_bd_addr_t[6];
+
+typedef struct {
+  uint16_t interval;
+  uint16_t latency;
+  uint16_t timeout;
+} esp_gatt_conn_params_t;
+
+typedef union {
+  struct {
+    uint16_t conn_id;
+    uint8_t link_role;
+    esp_bd_addr_t remote_bda;
+    esp_gatt_conn_params_t conn_params;
+  } connect;
+  struct {
+    uint16_t conn_id;
+    uint16_t mtu;
+  } mtu;
+} esp_ble_gatts_cb_param_t;
+
+typedef enum { ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT = 20 } esp_gap_ble_cb_event_t;
+
+typedef union {
+  struct {
+    int status;
+    esp_bd_addr_t bda;
+    uint16_t min_int;
+    uint16_t max_int;
+    uint16_t latency;
+    uint16_t conn_int;
+    uint16_t timeout;
+  } update_conn_params;
+} esp_ble_gap_cb_param_t;
+
+typedef void (*gap_event_handler)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+
+class BLEServer;
+class BLECharacteristic;
+
+class BLEDescriptor {
+ public:
+  virtual ~BLEDescriptor() {}
+};
+
+class BLE2902 : public BLEDescriptor {
+ public:
+  bool getNotifications() { return notificaciones; }
+  void setNotifications(bool flag) { notificaciones = flag; }
+
+ private:
+  bool notificaciones = false;
+};
+
+class BLECharacteristicCallbacks {
+ public:
+  typedef enum {
+    SUCCESS_INDICATE,
+    SUCCESS_NOTIFY,
+    ERROR_INDICATE_DISABLED,
+    ERROR_NOTIFY_DISABLED,
+    ERROR_GATT,
+    ERROR_NO_CLIENT,
+    ERROR_INDICATE_TIMEOUT,
+    ERROR_INDICATE_FAILURE
+  } Status;
+
+  virtual ~BLECharacteristicCallbacks() {}
+  virtual void onRead(BLECharacteristic*) {}
+  virtual void onWrite(BLECharacteristic*) {}
+  virtual void onNotify(BLECharacteristic*) {}
+  virtual void onStatus(BLECharacteristic*, Status, uint32_t) {}
+};
+
+class BLECharacteristic {
+ public:
+  static const uint32_t PROPERTY_READ = 1 << 0;
+  static const uint32_t PROPERTY_WRITE = 1 << 1;
+  static const uint32_t PROPERTY_NOTIFY = 1 << 2;
+  static const uint32_t PROPERTY_INDICATE = 1 << 3;
+
+  BLECharacteristic(const std::string& uuid, uint32_t properties, BLEServer* server)
+      : uuid(uuid), propiedades(properties), servidor(server) {}
+
+  void addDescriptor(BLEDescriptor* d) { descriptores.push_back(d); }
+  void setCallbacks(BLECharacteristicCallbacks* cb) { callbacks = cb; }
+  void setValue(uint8_t* data, size_t size) { valor.assign((const char*)data, size); }
+  void setValue(const std::string& value) { valor = value; }
+  std::string getValue() { return valor; }
+  void notify(bool is_notification = true);
+
+  // Simulación: el central escribe en la característica
+  void centralWrite(const std::string& value);
+  const std::string& getUUID() const { return uuid; }
+  BLE2902* cccd();
+
+ private:
+  std::string uuid;
+  uint32_t propiedades;
+  BLEServer* servidor;
+  std::string valor;
+  std::vector<BLEDescriptor*> descriptores;
+  BLECharacteristicCallbacks* callbacks = nullptr;
+};
+
+class BLEService {
+ public:
+  BLEService(const std::string& uuid, BLEServer* server) : uuid(uuid), servidor(server) {}
+  BLECharacteristic* createCharacteristic(const char* uuid, uint32_t properties);
+  void start() {}
+  std::vector<BLECharacteristic*>& characteristics() { return caracteristicas; }
+
+ private:
+  std::string uuid;
+  BLEServer* servidor;
+  std::vector<BLECharacteristic*> caracteristicas;
+};
+
+class BLEServerCallbacks {
+ public:
+  virtual ~BLEServerCallbacks() {}
+  virtual void onConnect(BLEServer*) {}
+  virtual void onConnect(BLEServer*, esp_ble_gatts_cb_param_t*) {}
+  virtual void onDisconnect(BLEServer*) {}
+  virtual void onMtuChanged(BLEServer*, esp_ble_gatts_cb_param_t*) {}
+};
+
+class BLEServer {
+ public:
+  void setCallbacks(BLEServerCallbacks* cb) { callbacks = cb; }
+  BLEService* createService(const char* uuid);
+  uint16_t getPeerMTU(uint16_t) { return conectado ? mtu : 23; }
+  uint16_t getConnId() { return 0; }
+  uint32_t getConnectedCount() { return conectado ? 1 : 0; }
+  void updateConnParams(esp_bd_addr_t remote_bda, uint16_t minInterval, uint16_t maxInterval,
+                        uint16_t latency, uint16_t timeout);
+  void disconnect(uint16_t conn_id);
+
+  // Simulación: eventos del central
+  void centralConnect();
+  void centralDisconnect();
+
+ private:
+  friend class BLEDevice;
+  BLEServerCallbacks* callbacks = nullptr;
+  std::vector<BLEService*> servicios;
+  bool conectado = false;
+  uint16_t mtu = 23;
+  uint16_t intervalo = 0;
+};
+
+class BLEAdvertising {
+ public:
+  void addServiceUUID(const char*) {}
+  void start();
+  void stop();
+};
+
+class BLEDevice {
+ public:
+  static void init(const std::string& deviceName);
+  static void setMTU(uint16_t mtu);
+  static BLEServer* createServer();
+  static BLEAdvertising* getAdvertising();
+  static void startAdvertising();
+  static void setCustomGapHandler(gap_event_handler handler);
+};
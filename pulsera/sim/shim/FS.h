@@ -0,0 +1,62 @@
+/*
+ * Subconjunto de FS.h del core ESP32 (fs::File / fs::FS) para la simulación.
+ * Los archivos viven en memoria durante la ejecución (ver LittleFS.h).
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File {
+ public:
+  File() {}
+  File(std::shared_ptr<std::vector<uint8_t>> data, bool writable, size_t pos)
+      : datos(data), escritura(writable), pos_(pos) {}
+
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t size);
+  int read();
+  size_t read(uint8_t* buf, size_t size);
+  int available();
+  bool seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const { return pos_; }
+  size_t size() const { return datos ? datos->size() : 0; }
+  void flush() {}
+  void close();
+  operator bool() const { return (bool)datos; }
+
+ private:
+  std::shared_ptr<std::vector<uint8_t>> datos;
+  bool escritura = false;
+  size_t pos_ = 0;
+};
+
+class FS {
+ public:
+  File open(const char* path, const char* mode = "r", bool create = false);
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* pathFrom, const char* pathTo);
+
+ protected:
+  std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> archivos;
+  bool montado = false;
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
@@ -0,0 +1,101 @@
+#include "LittleFS.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "virtual_clock.h"
+
+fs::LittleFSFS LittleFS;
+
+// Escritura + cierre de un archivo chico en littlefs sobre la flash del C3
+static const uint64_t ESCRITURA_FLASH_US = 4000;
+
+namespace fs {
+
+size_t File::write(const uint8_t* buf, size_t size) {
+  if (!datos || !escritura) return 0;
+  if (pos_ + size > datos->size()) datos->resize(pos_ + size);
+  memcpy(datos->data() + pos_, buf, size);
+  pos_ += size;
+  return size;
+}
+
+int File::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+  if (!datos || pos_ >= datos->size()) return 0;
+  size_t n = std::min(size, datos->size() - pos_);
+  memcpy(buf, datos->data() + pos_, n);
+  pos_ += n;
+  return n;
+}
+
+int File::available() {
+  return datos && pos_ < datos->size() ? (int)(datos->size() - pos_) : 0;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!datos) return false;
+  size_t base = mode == SeekSet ? 0 : (mode == SeekCur ? pos_ : datos->size());
+  if (base + pos > datos->size()) return false;
+  pos_ = base + pos;
+  return true;
+}
+
+void File::close() {
+  if (datos && escritura) {
+    oib_sim::virtualClock().recordBlocking("LittleFS write", ESCRITURA_FLASH_US);
+    oib_sim::virtualClock().advance(ESCRITURA_FLASH_US);
+  }
+  datos.reset();
+}
+
+File FS::open(const char* path, const char* mode, bool) {
+  if (!montado) return File();
+  auto it = archivos.find(path);
+  if (mode[0] == 'r') {
+    return it == archivos.end() ? File() : File(it->second, mode[1] == '+', 0);
+  }
+  if (it == archivos.end() || mode[0] == 'w') {
+    archivos[path] = std::make_shared<std::vector<uint8_t>>();
+    it = archivos.find(path);
+  }
+  return File(it->second, true, mode[0] == 'a' ? it->second->size() : 0);
+}
+
+bool FS::exists(const char* path) {
+  return montado && archivos.count(path) > 0;
+}
+
+bool FS::remove(const char* path) {
+  return montado && archivos.erase(path) > 0;
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo) {
+  auto it = archivos.find(pathFrom);
+  if (!montado || it == archivos.end()) return false;
+  archivos[pathTo] = it->second;
+  archivos.erase(pathFrom);
+  return true;
+}
+
+bool LittleFSFS::begin(bool, const char*, uint8_t, const char*) {
+  montado = true;
+  return true;
+}
+
+bool LittleFSFS::format() {
+  archivos.clear();
+  return true;
+}
+
+size_t LittleFSFS::usedBytes() {
+  size_t total = 0;
+  for (const auto& a : archivos) total += (a.second->size() + 4095) / 4096 * 4096;
+  return total;
+}
+
+}  // namespace fs
@@ -0,0 +1,25 @@
+/*
+ * LittleFS simulado: misma API que el core ESP32, con los archivos en
+ * memoria. Cada escritura cuesta un tiempo virtual de flash (programación
+ * de página y metadatos de littlefs).
+ */
+
+#pragma once
+
+#include "FS.h"
+
+namespace fs {
+
+class LittleFSFS : public FS {
+ public:
+  bool begin(bool formatOnFail = false, const char* basePath = "/littlefs",
+             uint8_t maxOpenFiles = 10, const char* partitionLabel = "spiffs");
+  bool format();
+  size_t totalBytes() { return 0x160000; }
+  size_t usedBytes();
+  void end() { montado = false; }
+};
+
+}  // namespace fs
+
+extern fs::LittleFSFS LittleFS;
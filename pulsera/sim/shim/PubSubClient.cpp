@@ -0,0 +1,170 @@
+#include "PubSubClient.h"
+
+#include <cstring>
+
+#include "sim_network.h"
+
+// Mismo cálculo de tamaño que PubSubClient::publish (cabecera fija + largo de tópico)
+static const size_t MQTT_MAX_HEADER_SIZE = 5;
+
+static void bloquear(const char* sitio, uint64_t us) {
+  oib_sim::virtualClock().recordBlocking(sitio, us);
+  oib_sim::virtualClock().advance(us);
+}
+
+PubSubClient& PubSubClient::setServer(const char*, uint16_t) {
+  return *this;
+}
+
+PubSubClient& PubSubClient::setCallback(MQTT_CALLBACK_SIGNATURE) {
+  _callback = callback;
+  return *this;
+}
+
+PubSubClient& PubSubClient::setKeepAlive(uint16_t) {
+  return *this;
+}
+
+PubSubClient& PubSubClient::setSocketTimeout(uint16_t) {
+  return *this;
+}
+
+bool PubSubClient::setBufferSize(uint16_t size) {
+  if (size == 0) return false;
+  buffer_size = size;
+  return true;
+}
+
+boolean PubSubClient::connect(const char* id) {
+  return connect(id, nullptr, nullptr, nullptr, 0, false, nullptr, true);
+}
+
+boolean PubSubClient::connect(const char* id, const char* user, const char* pass) {
+  return connect(id, user, pass, nullptr, 0, false, nullptr, true);
+}
+
+boolean PubSubClient::connect(const char* id, const char* willTopic, uint8_t willQos,
+                              boolean willRetain, const char* willMessage) {
+  return connect(id, nullptr, nullptr, willTopic, willQos, willRetain, willMessage, true);
+}
+
+boolean PubSubClient::connect(const char* id, const char* user, const char* pass,
+                              const char* willTopic, uint8_t willQos, boolean willRetain,
+                              const char* willMessage) {
+  return connect(id, user, pass, willTopic, willQos, willRetain, willMessage, true);
+}
+
+boolean PubSubClient::connect(const char* id, const char*, const char*, const char* willTopic,
+                              uint8_t, boolean willRetain, const char* willMessage,
+                              boolean cleanSession) {
+  oib_sim::SimNetwork& net = oib_sim::network();
+  bloquear("MQTT connect", net.mqtt_connect_us);
+
+  if (!net.wifiConnected(oib_sim::virtualClock().nowMicros())) {
+    _state = MQTT_CONNECT_FAILED;
+    return false;
+  }
+
+  session = net.connect(id, willTopic ? willTopic : "", willMessage ? willMessage : "",
+                        willRetain, cleanSession);
+  _state = MQTT_CONNECTED;
+  return true;
+}
+
+void PubSubClient::disconnect() {
+  oib_sim::network().drop(session, true);
+  session = -1;
+  _state = MQTT_DISCONNECTED;
+}
+
+boolean PubSubClient::publish(const char* topic, const char* payload) {
+  return publish(topic, (const uint8_t*)payload, payload ? strlen(payload) : 0, false);
+}
+
+boolean PubSubClient::publish(const char* topic, const char* payload, boolean retained) {
+  return publish(topic, (const uint8_t*)payload, payload ? strlen(payload) : 0, retained);
+}
+
+boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int plength) {
+  return publish(topic, payload, plength, false);
+}
+
+boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int plength,
+                              boolean retained) {
+  if (!connected()) return false;
+  if (MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + plength > buffer_size) return false;
+
+  oib_sim::SimNetwork& net = oib_sim::network();
+  bloquear("MQTT publish", net.mqtt_publish_us);
+  return net.publish(session, topic, payload, plength, retained);
+}
+
+boolean PubSubClient::beginPublish(const char* topic, unsigned int plength, boolean retained) {
+  if (!connected()) return false;
+  parcial_topico = topic;
+  parcial_payload.clear();
+  parcial_largo = plength;
+  parcial_retenido = retained;
+  return true;
+}
+
+size_t PubSubClient::write(uint8_t b) {
+  return write(&b, 1);
+}
+
+size_t PubSubClient::write(const uint8_t* buffer, size_t size) {
+  if (!connected()) return 0;
+  parcial_payload.append((const char*)buffer, size);
+  return size;
+}
+
+int PubSubClient::endPublish() {
+  if (!connected() || parcial_payload.size() != parcial_largo) return 0;
+  oib_sim::SimNetwork& net = oib_sim::network();
+  // Cada tramo de hasta un buffer va en su propia escritura TCP
+  uint64_t tramos = parcial_payload.size() / buffer_size + 1;
+  bloquear("MQTT publish", net.mqtt_publish_us * tramos);
+  bool ok = net.publish(session, parcial_topico, (const uint8_t*)parcial_payload.data(),
+                        parcial_payload.size(), parcial_retenido);
+  parcial_payload.clear();
+  return ok ? 1 : 0;
+}
+
+boolean PubSubClient::subscribe(const char* topic) {
+  return subscribe(topic, 0);
+}
+
+boolean PubSubClient::subscribe(const char* topic, uint8_t) {
+  if (!connected()) return false;
+  oib_sim::network().subscribe(session, topic);
+  return true;
+}
+
+boolean PubSubClient::unsubscribe(const char* topic) {
+  if (!connected()) return false;
+  oib_sim::network().unsubscribe(session, topic);
+  return true;
+}
+
+boolean PubSubClient::loop() {
+  if (!connected()) return false;
+
+  oib_sim::MqttMessage msg;
+  while (oib_sim::network().nextDelivery(session, msg)) {
+    if (_callback) {
+      std::string topic = msg.topic;
+      _callback(&topic[0], (uint8_t*)&msg.payload[0], (unsigned int)msg.payload.size());
+    }
+  }
+  return true;
+}
+
+boolean PubSubClient::connected() {
+  oib_sim::SimNetwork& net = oib_sim::network();
+  if (_state == MQTT_CONNECTED && !net.wifiConnected(oib_sim::virtualClock().nowMicros())) {
+    // Sin WiFi el broker deja de ver keepalives y publica el last will
+    net.drop(session);
+    _state = MQTT_CONNECTION_LOST;
+  }
+  return _state == MQTT_CONNECTED && net.sessionAlive(session);
+}
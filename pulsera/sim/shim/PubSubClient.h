@@ -0,0 +1,77 @@
+/*
+ * PubSubClient simulado: misma API que knolleary/PubSubClient 2.8, pero los
+ * mensajes van a un broker en memoria (sim_network.h) que los registra con
+ * el tiempo virtual. Respeta el límite de buffer del cliente real.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "Arduino.h"
+#include "WiFi.h"
+
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+class PubSubClient {
+ public:
+  PubSubClient() {}
+  explicit PubSubClient(Client&) {}
+
+  PubSubClient& setServer(const char* domain, uint16_t port);
+  PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE);
+  PubSubClient& setKeepAlive(uint16_t keepAlive);
+  PubSubClient& setSocketTimeout(uint16_t timeout);
+  bool setBufferSize(uint16_t size);
+  uint16_t getBufferSize() { return buffer_size; }
+
+  boolean connect(const char* id);
+  boolean connect(const char* id, const char* user, const char* pass);
+  boolean connect(const char* id, const char* willTopic, uint8_t willQos, boolean willRetain,
+                  const char* willMessage);
+  boolean connect(const char* id, const char* user, const char* pass, const char* willTopic,
+                  uint8_t willQos, boolean willRetain, const char* willMessage);
+  boolean connect(const char* id, const char* user, const char* pass, const char* willTopic,
+                  uint8_t willQos, boolean willRetain, const char* willMessage,
+                  boolean cleanSession);
+  void disconnect();
+
+  boolean publish(const char* topic, const char* payload);
+  boolean publish(const char* topic, const char* payload, boolean retained);
+  boolean publish(const char* topic, const uint8_t* payload, unsigned int plength);
+  boolean publish(const char* topic, const uint8_t* payload, unsigned int plength, boolean retained);
+
+  // Publicación por partes (payload más grande que el buffer del cliente)
+  boolean beginPublish(const char* topic, unsigned int plength, boolean retained);
+  size_t write(uint8_t b);
+  size_t write(const uint8_t* buffer, size_t size);
+  int endPublish();
+
+  boolean subscribe(const char* topic);
+  boolean subscribe(const char* topic, uint8_t qos);
+  boolean unsubscribe(const char* topic);
+
+  boolean loop();
+  boolean connected();
+  int state() { return _state; }
+
+ private:
+  std::function<void(char*, uint8_t*, unsigned int)> _callback;
+  uint16_t buffer_size = MQTT_MAX_PACKET_SIZE;
+  int _state = MQTT_DISCONNECTED;
+  int session = -1;
+
+  // Publicación por partes en curso
+  std::string parcial_topico;
+  std::string parcial_payload;
+  unsigned int parcial_largo = 0;
+  bool parcial_retenido = false;
+};
@@ -0,0 +1,68 @@
+#include "WString.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static std::string en_base(unsigned long long v, unsigned char base, bool negativo) {
+  if (base < 2 || base > 36) base = 10;
+  std::string s;
+  do {
+    int d = (int)(v % base);
+    s.insert(s.begin(), (char)(d < 10 ? '0' + d : 'A' + d - 10));
+    v /= base;
+  } while (v);
+  if (negativo) s.insert(s.begin(), '-');
+  return s;
+}
+
+static std::string con_signo(long long v, unsigned char base) {
+  if (base == 10 && v < 0) return en_base((unsigned long long)(-(v + 1)) + 1, base, true);
+  return en_base((unsigned long long)v, base, false);
+}
+
+String::String(unsigned char v, unsigned char base) : buf(en_base(v, base, false)) {}
+String::String(int v, unsigned char base) : buf(con_signo(v, base)) {}
+String::String(unsigned int v, unsigned char base) : buf(en_base(v, base, false)) {}
+String::String(long v, unsigned char base) : buf(con_signo(v, base)) {}
+String::String(unsigned long v, unsigned char base) : buf(en_base(v, base, false)) {}
+String::String(long long v, unsigned char base) : buf(con_signo(v, base)) {}
+String::String(unsigned long long v, unsigned char base) : buf(en_base(v, base, false)) {}
+
+String::String(float v, unsigned int decimals) : String((double)v, decimals) {}
+
+String::String(double v, unsigned int decimals) {
+  char tmp[64];
+  snprintf(tmp, sizeof(tmp), "%.*f", (int)decimals, v);
+  buf = tmp;
+}
+
+size_t String::strlen_(const char* s) { return s ? strlen(s) : 0; }
+
+int String::indexOf(char c) const {
+  size_t p = buf.find(c);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+int String::indexOf(const char* s) const {
+  size_t p = buf.find(s);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+String String::substring(unsigned int from) const {
+  return from < buf.size() ? String(buf.substr(from)) : String();
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) std::swap(from, to);
+  if (from >= buf.size()) return String();
+  return String(buf.substr(from, to - from));
+}
+
+long String::toInt() const { return strtol(buf.c_str(), nullptr, 10); }
+float String::toFloat() const { return strtof(buf.c_str(), nullptr); }
+
+String operator+(const String& a, const String& b) { return String(a.str() + b.str()); }
+String operator+(const String& a, const char* b) { return String(a.str() + b); }
+String operator+(const char* a, const String& b) { return String(a + b.str()); }
+String operator+(const String& a, char b) { return String(a.str() + b); }
@@ -0,0 +1,59 @@
+/*
+ * String de Arduino sobre std::string (entorno native_sim)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class String {
+ public:
+  String() {}
+  String(const char* s) : buf(s ? s : "") {}
+  String(const std::string& s) : buf(s) {}
+  explicit String(char c) : buf(1, c) {}
+  explicit String(unsigned char v, unsigned char base = 10);
+  explicit String(int v, unsigned char base = 10);
+  explicit String(unsigned int v, unsigned char base = 10);
+  explicit String(long v, unsigned char base = 10);
+  explicit String(unsigned long v, unsigned char base = 10);
+  explicit String(long long v, unsigned char base = 10);
+  explicit String(unsigned long long v, unsigned char base = 10);
+  explicit String(float v, unsigned int decimals = 2);
+  explicit String(double v, unsigned int decimals = 2);
+
+  const char* c_str() const { return buf.c_str(); }
+  unsigned int length() const { return (unsigned int)buf.size(); }
+  bool reserve(unsigned int size) { buf.reserve(size); return true; }
+
+  String& operator+=(const String& s) { buf += s.buf; return *this; }
+  String& operator+=(const char* s) { buf += s; return *this; }
+  String& operator+=(char c) { buf += c; return *this; }
+  bool concat(const String& s) { buf += s.buf; return true; }
+
+  bool operator==(const String& s) const { return buf == s.buf; }
+  bool operator==(const char* s) const { return buf == s; }
+  bool operator!=(const String& s) const { return buf != s.buf; }
+  bool operator!=(const char* s) const { return buf != s; }
+
+  char operator[](unsigned int i) const { return i < buf.size() ? buf[i] : 0; }
+  int indexOf(char c) const;
+  int indexOf(const char* s) const;
+  String substring(unsigned int from) const;
+  String substring(unsigned int from, unsigned int to) const;
+  bool startsWith(const char* s) const { return buf.compare(0, strlen_(s), s) == 0; }
+  long toInt() const;
+  float toFloat() const;
+
+  const std::string& str() const { return buf; }
+
+ private:
+  static size_t strlen_(const char* s);
+  std::string buf;
+};
+
+String operator+(const String& a, const String& b);
+String operator+(const String& a, const char* b);
+String operator+(const char* a, const String& b);
+String operator+(const String& a, char b);
@@ -0,0 +1,49 @@
+#include "WiFi.h"
+
+#include "sim_network.h"
+
+WiFiClass WiFi;
+
+String IPAddress::toString() const {
+  char tmp[16];
+  snprintf(tmp, sizeof(tmp), "%u.%u.%u.%u", b[0], b[1], b[2], b[3]);
+  return String(tmp);
+}
+
+wl_status_t WiFiClass::begin(const char*, const char*) {
+  oib_sim::network().wifiBegin(oib_sim::virtualClock().nowMicros());
+  return WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool) {
+  oib_sim::network().wifiStop();
+  return true;
+}
+
+wl_status_t WiFiClass::status() {
+  return oib_sim::network().wifiConnected(oib_sim::virtualClock().nowMicros()) ? WL_CONNECTED
+                                                                                 : WL_DISCONNECTED;
+}
+
+IPAddress WiFiClass::localIP() {
+  return status() == WL_CONNECTED ? IPAddress(172, 22, 39, 50) : IPAddress();
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+  uint64_t efuse = ESP.getEfuseMac();
+  for (int i = 0; i < 6; i++) mac[i] = (uint8_t)(efuse >> (8 * i));
+  return mac;
+}
+
+String WiFiClass::macAddress() {
+  uint8_t mac[6];
+  macAddress(mac);
+  char tmp[18];
+  snprintf(tmp, sizeof(tmp), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3],
+           mac[4], mac[5]);
+  return String(tmp);
+}
+
+int8_t WiFiClass::RSSI() {
+  return status() == WL_CONNECTED ? -58 : 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * WiFi simulado: la asociación tarda un tiempo virtual y se pueden inyectar
+ * cortes de red desde la simulación (ver sim_network.h)
+ */
+
+#pragma once
+
+#include "Arduino.h"
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+class IPAddress {
+ public:
+  IPAddress() : b{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b1, uint8_t c, uint8_t d) : b{a, b1, c, d} {}
+  String toString() const;
+  uint8_t operator[](int i) const { return b[i]; }
+
+ private:
+  uint8_t b[4];
+};
+
+class WiFiClass {
+ public:
+  wl_status_t begin(const char* ssid, const char* passphrase = nullptr);
+  bool disconnect(bool wifioff = false);
+  wl_status_t status();
+  IPAddress localIP();
+  String macAddress();
+  uint8_t* macAddress(uint8_t* mac);
+  int8_t RSSI();
+};
+
+extern WiFiClass WiFi;
+
+class Client {
+ public:
+  virtual ~Client() {}
+};
+
+class WiFiClient : public Client {};
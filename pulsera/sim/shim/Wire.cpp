@@ -0,0 +1,100 @@
+#include "Wire.h"
+
+#include <cstdio>
+#include <map>
+#include <string>
+
+#include "virtual_clock.h"
+
+TwoWire Wire;
+
+namespace oib_sim {
+
+static std::map<uint8_t, I2CDevice*>& bus() {
+  static std::map<uint8_t, I2CDevice*> dispositivos;
+  return dispositivos;
+}
+
+void attachI2C(uint8_t address, I2CDevice* device) {
+  bus()[address] = device;
+}
+
+static I2CDevice* buscar(uint8_t address) {
+  auto it = bus().find(address);
+  return it == bus().end() ? nullptr : it->second;
+}
+
+// Tiempo de bus: 9 bits por byte más dirección, a la frecuencia configurada
+static void tiempoDeBus(uint8_t address, size_t bytes, uint32_t clock_hz) {
+  uint64_t us = (uint64_t)(bytes + 1) * 9 * 1000000ULL / (clock_hz ? clock_hz : 100000);
+  char sitio[16];
+  snprintf(sitio, sizeof(sitio), "I2C 0x%02X", address);
+  virtualClock().recordBlocking(sitio, us);
+  virtualClock().advance(us);
+}
+
+}  // namespace oib_sim
+
+bool TwoWire::begin(int, int, uint32_t frequency) {
+  if (frequency) clock_hz = frequency;
+  return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency) {
+  clock_hz = frequency;
+  return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  tx_address = address;
+  tx.clear();
+}
+
+size_t TwoWire::write(uint8_t data) {
+  tx.push_back(data);
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t len) {
+  tx.insert(tx.end(), data, data + len);
+  return len;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+  oib_sim::I2CDevice* dev = oib_sim::buscar(tx_address);
+  oib_sim::tiempoDeBus(tx_address, tx.size(), clock_hz);
+  if (!dev) return 2;  // NACK en la dirección, igual que el driver real
+  dev->i2cWrite(tx.data(), tx.size());
+  tx.clear();
+  return 0;
+}
+
+size_t TwoWire::requestFrom(uint16_t address, size_t quantity, bool) {
+  rx.assign(quantity, 0);
+  rx_pos = 0;
+  oib_sim::I2CDevice* dev = oib_sim::buscar((uint8_t)address);
+  size_t n = dev ? dev->i2cRead(rx.data(), quantity) : 0;
+  rx.resize(n);
+  oib_sim::tiempoDeBus((uint8_t)address, n, clock_hz);
+  return n;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+  return (uint8_t)requestFrom((uint16_t)address, (size_t)quantity, true);
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop) {
+  return (uint8_t)requestFrom((uint16_t)address, (size_t)quantity, sendStop != 0);
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity) {
+  return (uint8_t)requestFrom((uint16_t)address, (size_t)quantity, true);
+}
+
+int TwoWire::available() {
+  return (int)(rx.size() - rx_pos);
+}
+
+int TwoWire::read() {
+  return rx_pos < rx.size() ? rx[rx_pos++] : -1;
+}
@@ -0,0 +1,56 @@
+/*
+ * TwoWire simulado: las transacciones I2C se despachan a modelos de sensores
+ * registrados por dirección (ver sensor_models.h)
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace oib_sim {
+
+// Dispositivo esclavo I2C simulado
+class I2CDevice {
+ public:
+  virtual ~I2CDevice() {}
+  // Bytes escritos por el maestro en una transacción (primero suele ser el registro)
+  virtual void i2cWrite(const uint8_t* data, size_t len) = 0;
+  // Lectura de hasta len bytes; devuelve cuántos entregó el dispositivo
+  virtual size_t i2cRead(uint8_t* buf, size_t len) = 0;
+};
+
+void attachI2C(uint8_t address, I2CDevice* device);
+
+}  // namespace oib_sim
+
+class TwoWire {
+ public:
+  bool begin() { return true; }
+  bool begin(int sda, int scl, uint32_t frequency = 0);
+  bool setClock(uint32_t frequency);
+
+  void beginTransmission(uint8_t address);
+  void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+  size_t write(uint8_t data);
+  size_t write(const uint8_t* data, size_t len);
+  uint8_t endTransmission(bool sendStop = true);
+
+  uint8_t requestFrom(uint8_t address, uint8_t quantity);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop);
+  uint8_t requestFrom(int address, int quantity);
+  size_t requestFrom(uint16_t address, size_t quantity, bool sendStop);
+
+  int available();
+  int read();
+
+ private:
+  uint32_t clock_hz = 100000;
+  uint8_t tx_address = 0;
+  std::vector<uint8_t> tx;
+  std::vector<uint8_t> rx;
+  size_t rx_pos = 0;
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,69 @@
+#include "esp_now.h"
+
+#include <cstring>
+#include <vector>
+
+#include "sim_network.h"
+#include "virtual_clock.h"
+
+static bool iniciado = false;
+static esp_now_send_cb_t al_enviar = nullptr;
+static std::vector<std::vector<uint8_t>> peers;
+static const size_t COLA_DRIVER = 10;  // envíos sin callback que acepta el driver
+static size_t en_cola = 0;
+
+esp_err_t esp_now_init() {
+  iniciado = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_deinit() {
+  iniciado = false;
+  peers.clear();
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) {
+  if (!iniciado) return ESP_ERR_ESPNOW_NOT_INIT;
+  al_enviar = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer) {
+  if (!iniciado) return ESP_ERR_ESPNOW_NOT_INIT;
+  if (!peer) return ESP_ERR_ESPNOW_ARG;
+  if (!esp_now_is_peer_exist(peer->peer_addr)) {
+    peers.push_back(std::vector<uint8_t>(peer->peer_addr, peer->peer_addr + ESP_NOW_ETH_ALEN));
+  }
+  return ESP_OK;
+}
+
+bool esp_now_is_peer_exist(const uint8_t* peer_addr) {
+  for (const auto& p : peers) {
+    if (memcmp(p.data(), peer_addr, ESP_NOW_ETH_ALEN) == 0) return true;
+  }
+  return false;
+}
+
+esp_err_t esp_now_send(const uint8_t* peer_addr, const uint8_t* data, size_t len) {
+  if (!iniciado) return ESP_ERR_ESPNOW_NOT_INIT;
+  if (!data || len == 0 || len > ESP_NOW_MAX_DATA_LEN) return ESP_ERR_ESPNOW_ARG;
+  if (peers.empty() || (peer_addr && !esp_now_is_peer_exist(peer_addr))) return ESP_ERR_ESPNOW_ARG;
+  if (en_cola >= COLA_DRIVER) return ESP_ERR_ESPNOW_NO_MEM;
+
+  oib_sim::SimNetwork& net = oib_sim::network();
+  oib_sim::VirtualClock& reloj = oib_sim::virtualClock();
+  reloj.recordBlocking("ESP-NOW send", net.espnow_call_us);
+  reloj.advance(net.espnow_call_us);
+
+  uint64_t fin_us;
+  bool ack = net.espnowSend(data, len, fin_us);
+  std::vector<uint8_t> mac = peer_addr ? std::vector<uint8_t>(peer_addr, peer_addr + ESP_NOW_ETH_ALEN)
+                                       : peers.front();
+  en_cola++;
+  reloj.schedule(fin_us, [mac, ack]() {
+    en_cola--;
+    if (al_enviar) al_enviar(mac.data(), ack ? ESP_NOW_SEND_SUCCESS : ESP_NOW_SEND_FAIL);
+  });
+  return ESP_OK;
+}
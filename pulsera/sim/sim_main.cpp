@@ -0,0 +1,214 @@
+/*
+ * Simulación nativa de una noche completa con el firmware de la pulsera
+ *
+ * Compila src/main.cpp y las librerías de lib/ contra los shims de sim/shim,
+ * conecta modelos de los tres sensores al bus I2C simulado y ejecuta
+ * setup()/loop() sobre el reloj virtual. Una noche de 8 h se reproduce en
+ * segundos y al final se imprime el registro de llamadas bloqueantes.
+ *
+ *   pio run -e native_sim && .pio/build/native_sim/program --horas 8
+ *
+ * Opciones:
+ *   --horas H           duración simulada (por defecto 8)
+ *   --semilla N         semilla del escenario y del ruido (por defecto 1)
+ *   --mqtt-log ARCHIVO  guarda cada publicación como una línea JSON
+ *   --bloqueos ARCHIVO  guarda cada llamada bloqueante (CSV t_ms,sitio,ms)
+ *   --corte MIN:SEG     corte de WiFi que empieza en el minuto MIN y dura SEG
+ *   --mensaje MIN:TOPICO[:PAYLOAD]
+ *                       la Raspberry publica en TOPICO en el minuto MIN
+ *                       (completo: oib/f6e5d4c3b2a1/sensores/captura/pedir)
+ *   --hipnograma ARCHIVO
+ *                       guarda el hipnograma verdadero cada 10 s (CSV
+ *                       epoch_ms,etapa,en_cama) para evaluar la clasificación
+ *   --espnow-log ARCHIVO
+ *                       el receptor ESP-NOW de la cama guarda cada trama que
+ *                       recibe como una línea JSON (mismo formato que --mqtt-log)
+ *   --ble-log ARCHIVO   ídem para el central BLE (firmware con OIB_BLE=1)
+ *   --reinicio-broker MIN
+ *                       el broker se reinicia sin persistencia en el minuto MIN
+ *   --flota N           la pulsera es una de N encendidas juntas: mide la carga
+ *                       del broker (ver fleet_load.h); comparar con el build
+ *                       -DOIB_PUBLISH_SLOTS=0 (env native_sim_sin_ranuras)
+ *   --arranque-ms MS    dispersión del encendido de la flota (por defecto 300)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Wire.h"
+#include "device_identity.h"
+#include "fleet_load.h"
+#include "night_scenario.h"
+#include "publish_slot.h"
+#include "sensor_models.h"
+#include "sim_network.h"
+#include "virtual_clock.h"
+
+void setup();
+void loop();
+
+using namespace oib_sim;
+
+static const uint8_t DIR_HTU21D = 0x40;
+static const uint8_t DIR_MAX30105 = 0x57;
+static const uint8_t DIR_MMA8452Q = 0x1C;  // SA0 a GND, dirección por defecto de la librería
+
+// Paso máximo cuando el loop queda ocioso y no hay eventos pendientes
+static const uint64_t PASO_OCIOSO_US = 1000;
+
+int main(int argc, char** argv) {
+  double horas = 8.0;
+  uint32_t semilla = 1;
+  FILE* mqtt_log = nullptr;
+  FILE* bloqueos = nullptr;
+  FILE* hipnograma = nullptr;
+  FILE* espnow_log = nullptr;
+  FILE* ble_log = nullptr;
+  struct Mensaje {
+    uint64_t t_us;
+    std::string topico;
+    std::string payload;
+  };
+  std::vector<Mensaje> mensajes;
+  std::vector<uint64_t> reinicios_broker;
+  uint32_t flota = 0;
+  FleetLoad carga;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--horas") && i + 1 < argc) {
+      horas = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--semilla") && i + 1 < argc) {
+      semilla = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "--mqtt-log") && i + 1 < argc) {
+      mqtt_log = fopen(argv[++i], "w");
+    } else if (!strcmp(argv[i], "--bloqueos") && i + 1 < argc) {
+      bloqueos = fopen(argv[++i], "w");
+      if (bloqueos) fprintf(bloqueos, "t_ms,sitio,ms\n");
+    } else if (!strcmp(argv[i], "--hipnograma") && i + 1 < argc) {
+      hipnograma = fopen(argv[++i], "w");
+    } else if (!strcmp(argv[i], "--espnow-log") && i + 1 < argc) {
+      espnow_log = fopen(argv[++i], "w");
+    } else if (!strcmp(argv[i], "--ble-log") && i + 1 < argc) {
+      ble_log = fopen(argv[++i], "w");
+    } else if (!strcmp(argv[i], "--reinicio-broker") && i + 1 < argc) {
+      reinicios_broker.push_back((uint64_t)(atof(argv[++i]) * 60e6));
+    } else if (!strcmp(argv[i], "--flota") && i + 1 < argc) {
+      flota = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "--arranque-ms") && i + 1 < argc) {
+      carga.arranque_us = (uint64_t)(atof(argv[++i]) * 1000);
+    } else if (!strcmp(argv[i], "--corte") && i + 1 < argc) {
+      double minuto = 0, segundos = 0;
+      if (sscanf(argv[++i], "%lf:%lf", &minuto, &segundos) == 2) {
+        network().addOutage((uint64_t)(minuto * 60e6), (uint64_t)((minuto * 60 + segundos) * 1e6));
+      }
+    } else if (!strcmp(argv[i], "--mensaje") && i + 1 < argc) {
+      std::string arg = argv[++i];
+      size_t a = arg.find(':');
+      size_t b = a == std::string::npos ? a : arg.find(':', a + 1);
+      if (a != std::string::npos) {
+        std::string topico = arg.substr(a + 1, b == std::string::npos ? b : b - a - 1);
+        std::string payload = b == std::string::npos ? "" : arg.substr(b + 1);
+        mensajes.push_back(Mensaje{(uint64_t)(atof(arg.substr(0, a).c_str()) * 60e6), topico, payload});
+      }
+    } else {
+      fprintf(stderr,
+              "uso: %s [--horas H] [--semilla N] [--mqtt-log F] [--bloqueos F] [--corte MIN:SEG]\n"
+              "          [--mensaje MIN:TOPICO[:PAYLOAD]] [--hipnograma F] [--espnow-log F]\n"
+              "          [--ble-log F] [--reinicio-broker MIN] [--flota N] [--arranque-ms MS]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  NightScenario escenario(semilla, horas);
+  Htu21dModel htu21d(escenario);
+  Max30105Model max30105(escenario, semilla);
+  Mma8452qModel mma8452q(escenario, semilla);
+  attachI2C(DIR_HTU21D, &htu21d);
+  attachI2C(DIR_MAX30105, &max30105);
+  attachI2C(DIR_MMA8452Q, &mma8452q);
+
+  VirtualClock& reloj = virtualClock();
+  reloj.setBlockingTrace(bloqueos);
+  network().setLog(mqtt_log);
+  network().setEspnowLog(espnow_log);
+  network().setBleLog(ble_log);
+  network().setSeed(semilla);
+  for (const Mensaje& m : mensajes) {
+    reloj.schedule(m.t_us, [m]() { network().inject(m.topico, m.payload, false); });
+  }
+
+  if (flota > 1) {
+    char id[13];
+    DeviceIdentity::formatMac(ESP.getEfuseMac(), id);
+    carga.begin(flota, std::string(OIB_TOPICO_RAIZ "/") + id + "/", ESP.getEfuseMac(),
+                OIB_PUBLISH_SLOTS, OIB_PUBLISH_PERIOD_MS, semilla);
+    network().addObserver([&carga](const MqttMessage& m) { carga.onPublish(m); });
+  }
+
+  for (uint64_t t : reinicios_broker) {
+    reloj.schedule(t, []() { network().restartBroker(); });
+  }
+
+  auto inicio = std::chrono::steady_clock::now();
+  uint64_t fin_us = escenario.durationMicros();
+  uint64_t iteraciones = 0;
+
+  setup();
+  while (reloj.nowMicros() < fin_us) {
+    uint64_t eventos_antes = reloj.firedEvents();
+    loop();
+    iteraciones++;
+
+    // Loop ocioso (sólo sondeó sensores sin datos nuevos): el tiempo lo
+    // empujan los eventos de los sensores
+    if (reloj.firedEvents() == eventos_antes && !reloj.advanceToNextEvent()) {
+      reloj.advance(PASO_OCIOSO_US);
+    }
+  }
+
+  double real_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+  double virtual_s = reloj.nowMicros() / 1e6;
+
+  printf("\n==================== SIMULACIÓN ====================\n");
+  printf("Tiempo virtual: %.2f h  |  tiempo real: %.2f s  |  aceleración: %.0fx\n",
+         virtual_s / 3600.0, real_s, real_s > 0 ? virtual_s / real_s : 0.0);
+  printf("Iteraciones de loop(): %llu\n", (unsigned long long)iteraciones);
+  printf("Hipnograma simulado (min): WAKE %llu | LIGHT %llu | REM %llu | DEEP %llu\n",
+         (unsigned long long)escenario.minutesIn(STAGE_WAKE),
+         (unsigned long long)escenario.minutesIn(STAGE_LIGHT),
+         (unsigned long long)escenario.minutesIn(STAGE_REM),
+         (unsigned long long)escenario.minutesIn(STAGE_DEEP));
+  printf("MAX30105: %llu muestras generadas, %llu perdidas por FIFO lleno\n",
+         (unsigned long long)max30105.samplesProduced(), (unsigned long long)max30105.overflows());
+  printf("Tiempo bloqueado: %.1f s (%.2f%% del reloj)\n\n", reloj.blockedMicros() / 1e6,
+         100.0 * reloj.blockedMicros() / std::max<uint64_t>(reloj.nowMicros(), 1));
+  reloj.printBlockingSummary(stdout);
+  printf("\n");
+  network().printSummary(stdout);
+  if (flota > 1) {
+    carga.finish();
+    printf("\n");
+    carga.printSummary(stdout);
+  }
+
+  if (hipnograma) {
+    // Misma base de tiempo que start_epoch_ms de las épocas publicadas
+    fprintf(hipnograma, "epoch_ms,etapa,en_cama\n");
+    for (uint64_t t = 0; t < fin_us; t += 10000000ULL) {
+      fprintf(hipnograma, "%llu,%d,%d\n", (unsigned long long)network().wallMillis(t),
+              (int)escenario.stageAt(t), escenario.inBed(t) ? 1 : 0);
+    }
+    fclose(hipnograma);
+  }
+  if (mqtt_log) fclose(mqtt_log);
+  if (espnow_log) fclose(espnow_log);
+  if (ble_log) fclose(ble_log);
+  if (bloqueos) fclose(bloqueos);
+  return 0;
+}
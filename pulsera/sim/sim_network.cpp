@@ -0,0 +1,314 @@
+#include "sim_network.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "virtual_clock.h"
+
+namespace oib_sim {
+
+SimNetwork& network() {
+  static SimNetwork instancia;
+  return instancia;
+}
+
+bool topicMatches(const std::string& filter, const std::string& topic) {
+  size_t f = 0, t = 0;
+  while (f < filter.size()) {
+    if (filter[f] == '#') return true;
+    if (filter[f] == '+') {
+      while (t < topic.size() && topic[t] != '/') t++;
+      f++;
+      continue;
+    }
+    if (t >= topic.size() || filter[f] != topic[t]) return false;
+    f++;
+    t++;
+  }
+  return t == topic.size();
+}
+
+void SimNetwork::addOutage(uint64_t start_us, uint64_t end_us) {
+  outages.push_back(std::make_pair(start_us, end_us));
+}
+
+bool SimNetwork::wifiAvailable(uint64_t t_us) const {
+  for (const auto& o : outages) {
+    if (t_us >= o.first && t_us < o.second) return false;
+  }
+  return true;
+}
+
+bool SimNetwork::wifiConnected(uint64_t t_us) const {
+  if (!wifi_started || !wifiAvailable(t_us)) return false;
+  // Tras un corte hace falta reasociarse
+  uint64_t desde = wifi_begin_us;
+  for (const auto& o : outages) {
+    if (o.second <= t_us && o.second > desde) desde = o.second;
+  }
+  return t_us - desde >= wifi_association_us;
+}
+
+uint64_t SimNetwork::epochMillis(uint64_t t_us) {
+  if (!sntp_synced && sntp_started && t_us >= sntp_start_us + sntp_us && wifiConnected(t_us)) {
+    sntp_synced = true;
+  }
+  return sntp_synced ? wallMillis(t_us) : 0;
+}
+
+int SimNetwork::connect(const std::string& client_id, const std::string& will_topic,
+                        const std::string& will_message, bool will_retain, bool clean_session) {
+  int idx = -1;
+  for (size_t i = 0; i < sessions.size(); i++) {
+    if (sessions[i].client_id == client_id) idx = (int)i;
+  }
+
+  if (idx >= 0 && sessions[idx].alive) {
+    // Mismo client id: el broker desconecta a la sesión anterior
+    drop(idx);
+  }
+  if (idx < 0) {
+    sessions.push_back(Session());
+    idx = (int)sessions.size() - 1;
+  }
+
+  Session& s = sessions[idx];
+  s.client_id = client_id;
+  s.will_topic = will_topic;
+  s.will_message = will_message;
+  s.will_retain = will_retain;
+  s.alive = true;
+  if (clean_session) {
+    s.filters.clear();
+    s.inbox.clear();
+  }
+
+  // Los retenidos que coinciden con suscripciones persistentes se reentregan
+  for (const auto& r : retained_store) {
+    for (const auto& f : s.filters) {
+      if (topicMatches(f, r.first)) {
+        s.inbox.push_back(r.second);
+        break;
+      }
+    }
+  }
+  return idx;
+}
+
+void SimNetwork::drop(int session, bool clean) {
+  if (!sessionAlive(session)) return;
+  Session& s = sessions[session];
+  s.alive = false;
+  if (!clean && !s.will_topic.empty()) {
+    MqttMessage will{virtualClock().nowMicros(), s.will_topic, s.will_message, s.will_retain};
+    route(will);
+  }
+}
+
+void SimNetwork::restartBroker() {
+  sessions.clear();
+  retained_store.clear();
+}
+
+bool SimNetwork::sessionAlive(int session) const {
+  return session >= 0 && session < (int)sessions.size() && sessions[session].alive;
+}
+
+bool SimNetwork::publish(int session, const std::string& topic, const uint8_t* payload, size_t len,
+                         bool retained) {
+  if (!sessionAlive(session)) return false;
+  MqttMessage msg{virtualClock().nowMicros(), topic,
+                  std::string((const char*)payload, len), retained};
+  route(msg);
+  return true;
+}
+
+void SimNetwork::route(const MqttMessage& msg) {
+  total_published++;
+  total_bytes += msg.payload.size();
+  TopicStats& ts = topic_stats[msg.topic];
+  ts.count++;
+  ts.bytes += msg.payload.size();
+
+  if (msg.retained) {
+    if (msg.payload.empty()) retained_store.erase(msg.topic);
+    else retained_store[msg.topic] = msg;
+  }
+
+  // Como Mosquitto con MQTT 3.1.1, el que publica también recibe el mensaje
+  // si está suscripto al tópico
+  for (size_t i = 0; i < sessions.size(); i++) {
+    Session& s = sessions[i];
+    for (const auto& f : s.filters) {
+      if (topicMatches(f, msg.topic)) {
+        s.inbox.push_back(msg);
+        break;
+      }
+    }
+  }
+
+  for (auto& fn : observers) fn(msg);
+
+  if (log_file) {
+    bool texto = std::all_of(msg.payload.begin(), msg.payload.end(),
+                             [](char c) { return c >= 0x20 && c < 0x7F; });
+    fprintf(log_file, "{\"t_ms\":%.3f,\"recv_epoch_ms\":%llu,\"topic\":\"%s\",\"retained\":%d,",
+            msg.t_us / 1000.0, (unsigned long long)wallMillis(msg.t_us + broker_delivery_us),
+            msg.topic.c_str(), msg.retained ? 1 : 0);
+    if (texto) {
+      fputs("\"payload\":\"", log_file);
+      for (char c : msg.payload) {
+        if (c == '"' || c == '\\') fputc('\\', log_file);
+        fputc(c, log_file);
+      }
+      fputs("\"}\n", log_file);
+    } else {
+      fprintf(log_file, "\"payload_hex\":\"");
+      for (unsigned char c : msg.payload) fprintf(log_file, "%02x", c);
+      fprintf(log_file, "\"}\n");
+    }
+  }
+}
+
+void SimNetwork::subscribe(int session, const std::string& filter) {
+  if (!sessionAlive(session)) return;
+  Session& s = sessions[session];
+  if (std::find(s.filters.begin(), s.filters.end(), filter) == s.filters.end()) {
+    s.filters.push_back(filter);
+  }
+  for (const auto& r : retained_store) {
+    if (topicMatches(filter, r.first)) s.inbox.push_back(r.second);
+  }
+}
+
+void SimNetwork::unsubscribe(int session, const std::string& filter) {
+  if (!sessionAlive(session)) return;
+  auto& f = sessions[session].filters;
+  f.erase(std::remove(f.begin(), f.end(), filter), f.end());
+}
+
+bool SimNetwork::nextDelivery(int session, MqttMessage& out) {
+  if (!sessionAlive(session) || sessions[session].inbox.empty()) return false;
+  out = sessions[session].inbox.front();
+  sessions[session].inbox.pop_front();
+  return true;
+}
+
+void SimNetwork::inject(const std::string& topic, const std::string& payload, bool retained) {
+  MqttMessage msg{virtualClock().nowMicros(), topic, payload, retained};
+  route(msg);
+}
+
+double SimNetwork::uniform() {
+  azar ^= azar << 13;
+  azar ^= azar >> 17;
+  azar ^= azar << 5;
+  return azar / 4294967296.0;
+}
+
+bool SimNetwork::espnowSend(const uint8_t* data, size_t len, uint64_t& done_us) {
+  // Tiempos 802.11b a 1 Mbps con preámbulo largo: DIFS + backoff, 192 µs de
+  // preámbulo, 43 B de cabecera MAC + acción de fabricante + FCS, SIFS y ACK
+  const uint64_t DIFS_US = 50, SLOT_US = 20, SIFS_US = 10, PREAMBULO_US = 192;
+  const uint64_t ACK_US = PREAMBULO_US + 14 * 8;
+  uint64_t t = std::max(virtualClock().nowMicros(), espnow_radio_libre_us);
+  uint32_t ventana = 31;
+  bool ack = false;
+  espnow_sent++;
+  for (uint8_t intento = 0; intento < espnow_attempts && !ack; intento++) {
+    t += DIFS_US + (uint64_t)(uniform() * (ventana + 1)) * SLOT_US;
+    t += PREAMBULO_US + (len + 43) * 8;
+    ventana = std::min<uint32_t>(ventana * 2 + 1, 1023);
+    if (uniform() < espnow_loss) {
+      t += SIFS_US + ACK_US;  // espera el ACK hasta el timeout
+      continue;
+    }
+    espnow_delivered++;
+    if (espnow_log) {
+      fprintf(espnow_log, "{\"t_ms\":%.3f,\"recv_epoch_ms\":%llu,\"intento\":%u,\"payload_hex\":\"",
+              t / 1000.0, (unsigned long long)wallMillis(t), intento);
+      for (size_t i = 0; i < len; i++) fprintf(espnow_log, "%02x", data[i]);
+      fprintf(espnow_log, "\"}\n");
+    }
+    t += SIFS_US + ACK_US;
+    ack = uniform() >= espnow_loss / 4;  // el ACK es corto
+  }
+  espnow_radio_libre_us = t;
+  if (ack) espnow_acked++;
+  done_us = t;
+  return ack;
+}
+
+void SimNetwork::bleConnected(uint64_t t_us, uint16_t interval_units) {
+  ble_ancla_us = t_us;
+  ble_intervalo_us = interval_units * 1250ULL;
+  ble_ultimo_evento_us = 0;
+  ble_usados = 0;
+  ble_pendientes.clear();
+}
+
+void SimNetwork::bleIntervalChanged(uint64_t t_us, uint16_t interval_units) {
+  // El cambio rige desde el primer evento después del instante pedido
+  uint64_t k = (t_us - ble_ancla_us + ble_intervalo_us - 1) / ble_intervalo_us;
+  ble_ancla_us += k * ble_intervalo_us;
+  ble_intervalo_us = interval_units * 1250ULL;
+}
+
+bool SimNetwork::bleNotify(const uint8_t* data, size_t len) {
+  uint64_t ahora = virtualClock().nowMicros();
+  while (!ble_pendientes.empty() && ble_pendientes.front() <= ahora) ble_pendientes.pop_front();
+  if (ble_intervalo_us == 0 || ble_pendientes.size() >= ble_queue) return false;
+
+  // Paquetes de capa de enlace con DLE (251 B), 7 B de L2CAP + ATT
+  uint8_t paquetes = (uint8_t)((len + 7 + 250) / 251);
+  uint64_t k = ahora > ble_ancla_us ? (ahora - ble_ancla_us + ble_intervalo_us - 1) / ble_intervalo_us : 0;
+  uint64_t evento = ble_ancla_us + k * ble_intervalo_us;
+  if (evento < ble_ultimo_evento_us) evento = ble_ultimo_evento_us;
+  if (evento == ble_ultimo_evento_us && ble_usados + paquetes > ble_packets_per_event) {
+    evento += ble_intervalo_us;
+  }
+  if (evento != ble_ultimo_evento_us) ble_usados = 0;
+  // Dentro del evento cada paquete ocupa ~(80 + 150 + 150) µs más su aire
+  uint64_t llegada = evento + ble_usados * 380 + (len + 17) * 8;
+  ble_ultimo_evento_us = evento;
+  ble_usados += paquetes;
+  ble_pendientes.push_back(llegada);
+  ble_notificaciones++;
+  ble_bytes += len;
+
+  if (ble_log) {
+    fprintf(ble_log, "{\"t_ms\":%.3f,\"recv_epoch_ms\":%llu,\"payload_hex\":\"",
+            llegada / 1000.0, (unsigned long long)wallMillis(llegada));
+    for (size_t i = 0; i < len; i++) fprintf(ble_log, "%02x", data[i]);
+    fprintf(ble_log, "\"}\n");
+  }
+  return true;
+}
+
+void SimNetwork::printSummary(FILE* out) const {
+  std::vector<std::pair<std::string, TopicStats>> orden(topic_stats.begin(), topic_stats.end());
+  std::sort(orden.begin(), orden.end(), [](const std::pair<std::string, TopicStats>& a,
+                                           const std::pair<std::string, TopicStats>& b) {
+    return a.second.bytes > b.second.bytes;
+  });
+
+  fprintf(out, "%-40s %10s %12s\n", "tópico", "mensajes", "bytes");
+  for (const auto& t : orden) {
+    fprintf(out, "%-40s %10llu %12llu\n", t.first.c_str(), (unsigned long long)t.second.count,
+            (unsigned long long)t.second.bytes);
+  }
+  fprintf(out, "%-40s %10llu %12llu\n", "TOTAL", (unsigned long long)total_published,
+          (unsigned long long)total_bytes);
+  if (espnow_sent) {
+    fprintf(out, "\nESP-NOW: %llu enviadas, %llu copias recibidas, %llu con ACK\n",
+            (unsigned long long)espnow_sent, (unsigned long long)espnow_delivered,
+            (unsigned long long)espnow_acked);
+  }
+  if (ble_notificaciones) {
+    fprintf(out, "BLE: %llu notificaciones, %llu bytes, intervalo %.2f ms\n",
+            (unsigned long long)ble_notificaciones, (unsigned long long)ble_bytes,
+            ble_intervalo_us / 1000.0);
+  }
+}
+
+}  // namespace oib_sim
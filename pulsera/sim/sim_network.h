@@ -0,0 +1,168 @@
+/*
+ * Red simulada: disponibilidad de WiFi y broker MQTT en memoria
+ *
+ * Los shims WiFi.h y PubSubClient.h consultan este módulo. Las operaciones de
+ * red consumen tiempo virtual (asociación, CONNECT, publish) y quedan en el
+ * registro de llamadas bloqueantes del reloj.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace oib_sim {
+
+struct MqttMessage {
+  uint64_t t_us;
+  std::string topic;
+  std::string payload;
+  bool retained;
+};
+
+bool topicMatches(const std::string& filter, const std::string& topic);
+
+class SimNetwork {
+ public:
+  // Latencias modeladas (µs)
+  uint64_t wifi_association_us = 1500000;
+  uint64_t mqtt_connect_us = 25000;
+  uint64_t mqtt_publish_us = 800;
+  uint64_t broker_delivery_us = 2000;  // publish -> suscriptor en la Raspberry
+  uint64_t sntp_us = 200000;
+
+  // ESP-NOW a 1 Mbps, unicast con ACK de la capa MAC (ver espnowSend)
+  uint64_t espnow_call_us = 30;      // esp_now_send(): copia a la cola del driver
+  double espnow_loss = 0.01;         // por intento (cuerpo entre pulsera y receptor)
+  uint8_t espnow_attempts = 8;       // 1 + reintentos de la MAC
+
+  // BLE: el central de la sala (gateway o controlador de la cama) se conecta
+  // poco después del anuncio, negocia MTU e intervalo y se suscribe
+  uint64_t ble_connect_us = 2000000;     // anuncio -> conexión
+  uint16_t ble_central_mtu = 247;
+  uint16_t ble_central_interval = 24;    // preferido por el central (× 1,25 ms)
+  uint64_t ble_notify_us = 150;          // notify(): Bluedroid -> cola del controlador
+  uint8_t ble_packets_per_event = 6;
+  size_t ble_queue = 12;                 // notificaciones esperando evento de conexión
+
+  // Hora de pared de la simulación: epoch (ms) que corresponde a t = 0
+  uint64_t epoch_base_ms = 1767308400000ULL;  // 2026-01-01 23:00 UTC
+
+  // WiFi
+  void addOutage(uint64_t start_us, uint64_t end_us);
+  bool wifiAvailable(uint64_t t_us) const;
+  void wifiBegin(uint64_t t_us) { wifi_begin_us = t_us; wifi_started = true; }
+  void wifiStop() { wifi_started = false; }
+  bool wifiConnected(uint64_t t_us) const;
+
+  // SNTP: configTime() arranca la sincronización; hasta que termina no hay
+  // hora de pared (epochMillis devuelve 0, como time() sin sincronizar)
+  void sntpStart(uint64_t t_us) { sntp_start_us = t_us; sntp_started = true; }
+  uint64_t epochMillis(uint64_t t_us);
+  uint64_t wallMillis(uint64_t t_us) const { return epoch_base_ms + t_us / 1000; }
+
+  // Broker
+  int connect(const std::string& client_id, const std::string& will_topic,
+              const std::string& will_message, bool will_retain, bool clean_session);
+  // Cierra la sesión y publica el last will; con clean (DISCONNECT del
+  // cliente) el broker lo descarta, como en MQTT
+  void drop(int session, bool clean = false);
+  // Reinicio del broker sin persistencia: se pierden sesiones y retenidos
+  // (sin last will: el broker no llega a publicarlos)
+  void restartBroker();
+  bool publish(int session, const std::string& topic, const uint8_t* payload, size_t len,
+               bool retained);
+  void subscribe(int session, const std::string& filter);
+  void unsubscribe(int session, const std::string& filter);
+  bool sessionAlive(int session) const;
+
+  // Mensajes pendientes para una sesión (los entrega PubSubClient::loop())
+  bool nextDelivery(int session, MqttMessage& out);
+
+  // Publica desde "afuera" (gateway simulado) hacia los suscriptores
+  void inject(const std::string& topic, const std::string& payload, bool retained = false);
+
+  // Observadores externos (herramientas del host que escuchan al broker)
+  void addObserver(std::function<void(const MqttMessage&)> fn) { observers.push_back(fn); }
+
+  // ESP-NOW: no pasa por el AP ni por el broker, así que no lo afectan los
+  // cortes de WiFi. Devuelve el instante del callback de envío (done_us) y
+  // si hubo ACK; cada copia que llega al receptor queda en el registro de
+  // ESP-NOW (el receptor descarta duplicados por seq).
+  bool espnowSend(const uint8_t* data, size_t len, uint64_t& done_us);
+  void setEspnowLog(FILE* f) { espnow_log = f; }
+
+  // BLE: notificación encolada para el próximo evento de conexión con
+  // lugar (el controlador manda hasta ble_packets_per_event por evento).
+  // false si la cola del controlador está llena. Cada notificación que
+  // llega al central queda en el registro de BLE.
+  void bleConnected(uint64_t t_us, uint16_t interval_units);
+  void bleIntervalChanged(uint64_t t_us, uint16_t interval_units);
+  bool bleNotify(const uint8_t* data, size_t len);
+  void setBleLog(FILE* f) { ble_log = f; }
+  void setSeed(uint32_t seed) { azar = seed * 2654435761u | 1; }
+
+  void setLog(FILE* f) { log_file = f; }
+  void printSummary(FILE* out) const;
+
+  uint64_t published() const { return total_published; }
+  uint64_t publishedBytes() const { return total_bytes; }
+
+ private:
+  struct Session {
+    std::string client_id;
+    std::string will_topic;
+    std::string will_message;
+    bool will_retain = false;
+    bool alive = false;
+    std::vector<std::string> filters;
+    std::deque<MqttMessage> inbox;
+  };
+  struct TopicStats {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+  };
+
+  void route(const MqttMessage& msg);
+  double uniform();
+
+  std::vector<std::pair<uint64_t, uint64_t>> outages;
+  uint64_t wifi_begin_us = 0;
+  bool wifi_started = false;
+  uint64_t sntp_start_us = 0;
+  bool sntp_started = false;
+  bool sntp_synced = false;
+
+  std::vector<Session> sessions;
+  std::map<std::string, MqttMessage> retained_store;
+  std::map<std::string, TopicStats> topic_stats;
+  std::vector<std::function<void(const MqttMessage&)>> observers;
+  uint64_t total_published = 0;
+  uint64_t total_bytes = 0;
+  FILE* log_file = nullptr;
+
+  uint32_t azar = 0x9E3779B9u;
+  uint64_t espnow_radio_libre_us = 0;  // fin de la última transmisión
+  uint64_t espnow_sent = 0;
+  uint64_t espnow_delivered = 0;
+  uint64_t espnow_acked = 0;
+  FILE* espnow_log = nullptr;
+
+  uint64_t ble_ancla_us = 0;        // un evento de conexión cada ble_intervalo_us desde acá
+  uint64_t ble_intervalo_us = 0;
+  uint64_t ble_ultimo_evento_us = 0;
+  uint8_t ble_usados = 0;           // paquetes en ble_ultimo_evento_us
+  std::deque<uint64_t> ble_pendientes;
+  uint64_t ble_notificaciones = 0;
+  uint64_t ble_bytes = 0;
+  FILE* ble_log = nullptr;
+};
+
+SimNetwork& network();
+
+}  // namespace oib_sim
@@ -0,0 +1,118 @@
+#include "virtual_clock.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace oib_sim {
+
+VirtualClock& virtualClock() {
+  static VirtualClock instancia;
+  return instancia;
+}
+
+void VirtualClock::runDue(uint64_t until_us) {
+  while (!events.empty() && events.top().at_us <= until_us) {
+    Event ev = events.top();
+    events.pop();
+
+    if (cancelled.count(ev.id)) {
+      cancelled.erase(ev.id);
+      continue;
+    }
+
+    // El evento ve el reloj en su propio instante
+    if (ev.at_us > now_us) now_us = ev.at_us;
+
+    if (ev.period_us > 0) {
+      Event siguiente = ev;
+      siguiente.at_us += ev.period_us;
+      events.push(siguiente);
+    }
+    fired++;
+    ev.fn();
+  }
+}
+
+void VirtualClock::advance(uint64_t us) {
+  advanceTo(now_us + us);
+}
+
+void VirtualClock::advanceTo(uint64_t t_us) {
+  if (t_us < now_us) return;
+  runDue(t_us);
+  now_us = t_us;
+}
+
+bool VirtualClock::advanceToNextEvent() {
+  while (!events.empty() && cancelled.count(events.top().id)) {
+    cancelled.erase(events.top().id);
+    events.pop();
+  }
+  if (events.empty()) return false;
+  advanceTo(std::max(events.top().at_us, now_us));
+  return true;
+}
+
+uint32_t VirtualClock::schedule(uint64_t at_us, Callback fn) {
+  Event ev{at_us, next_id++, 0, fn};
+  events.push(ev);
+  return ev.id;
+}
+
+uint32_t VirtualClock::scheduleEvery(uint64_t period_us, Callback fn, uint64_t first_us) {
+  Event ev{first_us, next_id++, period_us, fn};
+  events.push(ev);
+  return ev.id;
+}
+
+void VirtualClock::cancel(uint32_t id) {
+  if (id != 0) cancelled.insert(id);
+}
+
+void VirtualClock::recordBlocking(const std::string& site, uint64_t us) {
+  SiteStats& s = sites[site];
+  s.calls++;
+  s.total_us += us;
+  if (us > s.max_us) s.max_us = us;
+  blocked_total_us += us;
+
+  if (trace_file) {
+    fprintf(trace_file, "%.3f,%s,%.3f\n", now_us / 1000.0, site.c_str(), us / 1000.0);
+  }
+}
+
+void VirtualClock::printBlockingSummary(FILE* out) const {
+  std::vector<std::pair<std::string, SiteStats>> orden(sites.begin(), sites.end());
+  std::sort(orden.begin(), orden.end(), [](const std::pair<std::string, SiteStats>& a,
+                                           const std::pair<std::string, SiteStats>& b) {
+    return a.second.total_us > b.second.total_us;
+  });
+
+  fprintf(out, "%-40s %10s %12s %9s %8s\n", "llamada bloqueante", "llamadas", "total ms", "max ms", "% reloj");
+  for (const auto& s : orden) {
+    double pct = now_us ? 100.0 * s.second.total_us / now_us : 0.0;
+    fprintf(out, "%-40s %10llu %12.1f %9.1f %7.2f%%\n", s.first.c_str(),
+            (unsigned long long)s.second.calls, s.second.total_us / 1000.0,
+            s.second.max_us / 1000.0, pct);
+  }
+}
+
+static std::string sitio(const char* file, int line) {
+  const char* base = strrchr(file, '/');
+  std::string s = base ? base + 1 : file;
+  return s + ":" + std::to_string(line);
+}
+
+void delayAt(unsigned long ms, const char* file, int line) {
+  VirtualClock& c = virtualClock();
+  c.recordBlocking(sitio(file, line), (uint64_t)ms * 1000);
+  c.advance((uint64_t)ms * 1000);
+}
+
+void delayMicrosAt(unsigned int us, const char* file, int line) {
+  VirtualClock& c = virtualClock();
+  c.recordBlocking(sitio(file, line), us);
+  c.advance(us);
+}
+
+}  // namespace oib_sim
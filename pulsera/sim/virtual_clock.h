@@ -0,0 +1,94 @@
+/*
+ * Reloj virtual para la simulación nativa de la pulsera
+ *
+ * Reemplaza a millis()/micros()/delay() cuando el firmware se compila en el
+ * entorno native_sim. El tiempo sólo avanza cuando:
+ *   - el firmware llama a delay() (avanza al instante, sin dormir),
+ *   - una operación simulada "bloquea" (conexión WiFi/MQTT, publish),
+ *   - el loop queda ocioso y la simulación salta al próximo evento de sensor.
+ *
+ * Cada avance por llamada bloqueante queda registrado por sitio (archivo:línea)
+ * para poder ver qué partes del firmware consumen tiempo de reloj.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <queue>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace oib_sim {
+
+class VirtualClock {
+ public:
+  typedef std::function<void()> Callback;
+
+  uint64_t nowMicros() const { return now_us; }
+  uint32_t nowMillis() const { return (uint32_t)(now_us / 1000); }
+
+  // Avanza el reloj ejecutando en orden los eventos que vencen en el camino
+  void advance(uint64_t us);
+  void advanceTo(uint64_t t_us);
+
+  // Salta al próximo evento programado. Devuelve false si no hay eventos.
+  bool advanceToNextEvent();
+
+  // Programa un evento único o periódico. Devuelve un id para cancelarlo.
+  uint32_t schedule(uint64_t at_us, Callback fn);
+  uint32_t scheduleEvery(uint64_t period_us, Callback fn, uint64_t first_us);
+  void cancel(uint32_t id);
+
+  // Eventos ejecutados hasta ahora: si una vuelta de loop() no disparó
+  // ninguno, el firmware sólo sondeó sensores sin datos nuevos
+  uint64_t firedEvents() const { return fired; }
+
+  // Registro de llamadas bloqueantes
+  void recordBlocking(const std::string& site, uint64_t us);
+  void setBlockingTrace(FILE* f) { trace_file = f; }
+  void printBlockingSummary(FILE* out) const;
+  uint64_t blockedMicros() const { return blocked_total_us; }
+
+ private:
+  struct Event {
+    uint64_t at_us;
+    uint32_t id;
+    uint64_t period_us;
+    Callback fn;
+  };
+  struct Later {
+    bool operator()(const Event& a, const Event& b) const {
+      if (a.at_us != b.at_us) return a.at_us > b.at_us;
+      return a.id > b.id;
+    }
+  };
+  struct SiteStats {
+    uint64_t calls = 0;
+    uint64_t total_us = 0;
+    uint64_t max_us = 0;
+  };
+
+  void runDue(uint64_t until_us);
+
+  uint64_t now_us = 0;
+  uint32_t next_id = 1;
+  uint64_t fired = 0;
+  std::priority_queue<Event, std::vector<Event>, Later> events;
+  std::set<uint32_t> cancelled;
+
+  std::map<std::string, SiteStats> sites;
+  uint64_t blocked_total_us = 0;
+  FILE* trace_file = nullptr;
+};
+
+VirtualClock& virtualClock();
+
+// Implementaciones de delay()/delayMicroseconds() con el sitio de la llamada
+void delayAt(unsigned long ms, const char* file, int line);
+void delayMicrosAt(unsigned int us, const char* file, int line);
+
+}  // namespace oib_sim
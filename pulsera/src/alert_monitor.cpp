@@ -0,0 +1,145 @@
+#include "alert_monitor.h"
+
+// Muestras seguidas para confirmar/terminar cada condición
+static const uint8_t LATIDOS_HR = 5;
+static const uint8_t LATIDOS_SPO2 = 3;   // cada valor ya promedia 4 latidos
+static const uint8_t LECTURAS_TEMP = 2;
+
+// Histéresis para dar por terminada una condición
+static const float HISTERESIS_HR = 5.0f;      // BPM
+static const float HISTERESIS_SPO2 = 2.0f;    // %
+static const float HISTERESIS_TEMP = 0.5f;    // °C
+
+static const char* NOMBRE_TIPO[ALERT_TYPES] = {"hr_alta", "hr_baja", "spo2_baja",
+                                                "temp_cama_alta", "temp_cama_baja"};
+
+void AlertMonitor::Latencia::agregar(uint32_t us) {
+  n++;
+  suma_us += us;
+  if (us > max_us) max_us = us;
+}
+
+void AlertMonitor::begin() {
+  *this = AlertMonitor();
+}
+
+const char* AlertMonitor::typeName(uint8_t type) {
+  return type < ALERT_TYPES ? NOMBRE_TIPO[type] : "?";
+}
+
+void AlertMonitor::evaluate(AlertType tipo, uint32_t t_ms, float valor, float umbral, bool fuera,
+                            bool normal, uint8_t confirmar) {
+  Condicion& c = condiciones[tipo];
+  bool a_favor = c.activa ? normal : fuera;
+  c.seguidas = a_favor ? c.seguidas + 1 : 0;
+  if (c.seguidas >= confirmar) {
+    c.activa = !c.activa;
+    c.seguidas = 0;
+    raise(tipo, t_ms, valor, umbral, c.activa);
+  }
+}
+
+void AlertMonitor::raise(AlertType tipo, uint32_t t_ms, float valor, float umbral, bool activa) {
+  if (cola_n == QUEUE) {
+    // Cola llena sin ecos: se pierde la más vieja
+    memmove(&cola[0], &cola[1], sizeof(Alert) * (QUEUE - 1));
+    cola_n--;
+    descartadas++;
+  }
+  Alert& a = cola[cola_n++];
+  a.seq = siguiente_seq++;
+  a.type = tipo;
+  a.active = activa;
+  a.value = valor;
+  a.threshold = umbral;
+  a.sample_ms = t_ms;
+  a.detected_us = micros();
+  a.sent_us = 0;
+  a.attempts = 0;
+  if (activa) nuevas |= 1 << tipo;
+}
+
+uint8_t AlertMonitor::takeRaised() {
+  uint8_t t = nuevas;
+  nuevas = 0;
+  return t;
+}
+
+void AlertMonitor::onHeartRate(uint32_t t_ms, float bpm) {
+  evaluate(ALERT_HR_HIGH, t_ms, bpm, OIB_CFG_MAX_HR_ALERT, bpm > OIB_CFG_MAX_HR_ALERT,
+           bpm <= OIB_CFG_MAX_HR_ALERT - HISTERESIS_HR, LATIDOS_HR);
+  evaluate(ALERT_HR_LOW, t_ms, bpm, OIB_CFG_MIN_HR_ALERT, bpm < OIB_CFG_MIN_HR_ALERT,
+           bpm >= OIB_CFG_MIN_HR_ALERT + HISTERESIS_HR, LATIDOS_HR);
+}
+
+void AlertMonitor::onSpo2(uint32_t t_ms, float spo2) {
+  evaluate(ALERT_SPO2_LOW, t_ms, spo2, OIB_CFG_SPO2_MIN_ALERT, spo2 < OIB_CFG_SPO2_MIN_ALERT,
+           spo2 >= OIB_CFG_SPO2_MIN_ALERT + HISTERESIS_SPO2, LATIDOS_SPO2);
+}
+
+void AlertMonitor::onContactLost() {
+  condiciones[ALERT_HR_HIGH].seguidas = 0;
+  condiciones[ALERT_HR_LOW].seguidas = 0;
+  condiciones[ALERT_SPO2_LOW].seguidas = 0;
+}
+
+void AlertMonitor::onBedTemperature(uint32_t t_ms, float celsius) {
+  evaluate(ALERT_BED_TEMP_HIGH, t_ms, celsius, OIB_CFG_BED_TEMP_MAX,
+           celsius > OIB_CFG_BED_TEMP_MAX, celsius <= OIB_CFG_BED_TEMP_MAX - HISTERESIS_TEMP,
+           LECTURAS_TEMP);
+  evaluate(ALERT_BED_TEMP_LOW, t_ms, celsius, OIB_CFG_BED_TEMP_MIN,
+           celsius < OIB_CFG_BED_TEMP_MIN, celsius >= OIB_CFG_BED_TEMP_MIN + HISTERESIS_TEMP,
+           LECTURAS_TEMP);
+}
+
+Alert* AlertMonitor::nextToSend(uint32_t now_us) {
+  for (uint8_t i = 0; i < cola_n; i++) {
+    Alert& a = cola[i];
+    if (a.attempts == 0 || now_us - a.sent_us >= REINTENTO_US) return &cola[i];
+  }
+  return nullptr;
+}
+
+void AlertMonitor::markSent(Alert& a, uint32_t now_us) {
+  if (a.attempts == 0) {
+    a_publish.agregar(now_us - a.detected_us);
+  } else {
+    reintentos++;
+  }
+  a.attempts++;
+  a.sent_us = now_us;
+}
+
+void AlertMonitor::acknowledge(uint32_t seq, uint32_t now_us) {
+  for (uint8_t i = 0; i < cola_n; i++) {
+    if (cola[i].seq != seq) continue;
+    a_eco.agregar(now_us - cola[i].detected_us);
+    memmove(&cola[i], &cola[i + 1], sizeof(Alert) * (cola_n - i - 1));
+    cola_n--;
+    return;
+  }
+  // Eco de un reintento ya confirmado: duplicado, se ignora
+}
+
+void AlertMonitor::retryAll() {
+  for (uint8_t i = 0; i < cola_n; i++) {
+    if (cola[i].attempts > 0) cola[i].sent_us = micros() - REINTENTO_US;
+  }
+}
+
+String AlertMonitor::summaryJson() {
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "{\"publish_n\":%lu,\"publish_med_us\":%lu,\"publish_max_us\":%lu,"
+           "\"eco_n\":%lu,\"eco_med_us\":%lu,\"eco_max_us\":%lu,"
+           "\"reintentos\":%lu,\"descartadas\":%lu,\"pendientes\":%u}",
+           (unsigned long)a_publish.n,
+           (unsigned long)(a_publish.n ? a_publish.suma_us / a_publish.n : 0),
+           (unsigned long)a_publish.max_us, (unsigned long)a_eco.n,
+           (unsigned long)(a_eco.n ? a_eco.suma_us / a_eco.n : 0), (unsigned long)a_eco.max_us,
+           (unsigned long)reintentos, (unsigned long)descartadas, cola_n);
+  a_publish = Latencia();
+  a_eco = Latencia();
+  reintentos = descartadas = 0;
+  return String(buf);
+}
@@ -0,0 +1,108 @@
+#include "bed_presence.h"
+
+static_assert(OIB_CFG_PRESENCE_CONFIRMATION_TIME <= OIB_CFG_PRESENCE_HISTORY_SIZE,
+              "la confirmación de salida no entra en el historial");
+
+// Constantes literales de detect_presence/update_baseline_temperature
+static const uint8_t MUESTRAS_TEMPORAL = 5;
+static const uint8_t MEDIA_TEMPORAL = 50;
+static const uint8_t PUNTAJE_BAJO_SALIDA = 30;
+static const float ACTIVIDAD_PLENA = 0.1f;    // actividad que da los 25 puntos
+static const float ALFA_BASE = 0.05f;
+
+void BedPresence::begin() {
+  *this = BedPresence();
+}
+
+uint8_t BedPresence::historyAt(uint8_t atras) const {
+  return historial[(hist_pos + HISTORY - 1 - atras) % HISTORY];
+}
+
+uint8_t BedPresence::score(const PresenceInput& in) {
+  uint8_t puntos = 0;
+  indicadores = 0;
+
+  // 1. Térmico: la cama por encima de la base
+  if (in.temperature_valid) {
+    if (!hay_base) {
+      base_temp = in.bed_temperature;
+      hay_base = true;
+    }
+    elevacion = in.bed_temperature - base_temp;
+    if (elevacion > OIB_CFG_PRESENCE_THERMAL_THRESHOLD) {
+      indicadores |= PRESENCE_THERMAL;
+      puntos += 30;
+      if (elevacion > OIB_CFG_PRESENCE_THERMAL_THRESHOLD * 2) puntos += 10;
+    }
+  }
+
+  // 2. Movimiento, proporcional a la actividad (máximo 25)
+  if (in.activity > OIB_CFG_PRESENCE_ACTIVITY_THRESHOLD) {
+    indicadores |= PRESENCE_MOVEMENT;
+    puntos += (uint8_t)min(25.0f, in.activity * 25.0f / ACTIVIDAD_PLENA);
+  }
+
+  // 3. Cardiovascular, con bonus en el rango típico de sueño
+  if (in.hr_valid && in.heart_rate >= OIB_CFG_PRESENCE_HR_MIN &&
+      in.heart_rate <= OIB_CFG_PRESENCE_HR_MAX) {
+    indicadores |= PRESENCE_HEART_RATE;
+    puntos += 35;
+    if (in.heart_rate >= 50 && in.heart_rate <= 80) puntos += 5;
+  }
+
+  // 4. Contacto con el MAX30102
+  if (in.finger_present) {
+    indicadores |= PRESENCE_CONTACT;
+    puntos += 20;
+  }
+  return puntos;
+}
+
+bool BedPresence::update(uint32_t now_ms, const PresenceInput& in) {
+  uint8_t puntos = score(in);
+
+  historial[hist_pos] = puntos;
+  hist_pos = (hist_pos + 1) % HISTORY;
+  if (hist_n < HISTORY) hist_n++;
+
+  // 5. Temporal: confianza sostenida en las últimas 5 evaluaciones
+  uint16_t total = puntos;
+  if (hist_n >= MUESTRAS_TEMPORAL) {
+    uint16_t suma = 0;
+    for (uint8_t i = 0; i < MUESTRAS_TEMPORAL; i++) suma += historyAt(i);
+    if (suma > MEDIA_TEMPORAL * MUESTRAS_TEMPORAL) {
+      indicadores |= PRESENCE_TEMPORAL;
+      total += 10;
+    }
+  }
+  confianza = (uint8_t)min<uint16_t>(total, 100);
+
+  // Histéresis
+  bool cambio = false;
+  if (!ocupada && confianza >= OIB_CFG_PRESENCE_CONFIDENCE_THRESHOLD_ENTER) {
+    ocupada = true;
+    entrada_ms = now_ms;
+    cambio = true;
+  } else if (ocupada && confianza <= OIB_CFG_PRESENCE_CONFIDENCE_THRESHOLD_EXIT &&
+             hist_n >= OIB_CFG_PRESENCE_CONFIRMATION_TIME) {
+    bool baja_sostenida = true;
+    for (uint8_t i = 0; i < OIB_CFG_PRESENCE_CONFIRMATION_TIME; i++) {
+      if (historyAt(i) > PUNTAJE_BAJO_SALIDA) baja_sostenida = false;
+    }
+    if (baja_sostenida) {
+      ocupada = false;
+      estadia_ms = now_ms - entrada_ms;
+      cambio = true;
+    }
+  }
+
+  // La base térmica sólo se mueve con la cama vacía
+  if (!ocupada && in.temperature_valid) {
+    base_temp = (1.0f - ALFA_BASE) * base_temp + ALFA_BASE * in.bed_temperature;
+  }
+  return cambio;
+}
+
+uint32_t BedPresence::occupiedMs(uint32_t now_ms) const {
+  return ocupada ? now_ms - entrada_ms : estadia_ms;
+}
@@ -0,0 +1,174 @@
+#include "ble_link.h"
+
+#if OIB_BLE
+
+#include <BLE2902.h>
+#include <BLEDevice.h>
+#include <BLEServer.h>
+
+BleLink ble;
+
+// Intervalo de conexión en unidades de 1,25 ms; supervisión en unidades de 10 ms
+static const uint16_t INTERVALO_MIN = OIB_BLE_INTERVALO_MIN_MS * 4 / 5;
+static const uint16_t INTERVALO_MAX = OIB_BLE_INTERVALO_MAX_MS * 4 / 5;
+static const uint16_t SUPERVISION = 400;  // 4 s
+
+// Aire de una notificación en PHY 1M con paquetes de hasta 251 B (DLE):
+// por paquete, el vacío del central (80 µs), dos IFS de 150 µs y 10 B de
+// preámbulo, dirección, cabecera y CRC; más 7 B de L2CAP y ATT
+static const uint16_t LL_PAYLOAD = 251;
+
+static uint32_t aire_us(uint16_t largo) {
+  uint16_t ll = largo + 7;
+  uint16_t paquetes = (ll + LL_PAYLOAD - 1) / LL_PAYLOAD;
+  return paquetes * (80 + 150 + 150 + 10 * 8) + ll * 8;
+}
+
+class ServidorCallbacks : public BLEServerCallbacks {
+  void onConnect(BLEServer*, esp_ble_gatts_cb_param_t* param) override {
+    ble.onConnect(param->connect.conn_id, param->connect.remote_bda,
+                  param->connect.conn_params.interval);
+  }
+  void onMtuChanged(BLEServer*, esp_ble_gatts_cb_param_t* param) override {
+    ble.onMtu(param->mtu.mtu);
+  }
+  void onDisconnect(BLEServer*) override { ble.onDisconnect(); }
+};
+
+class TramasCallbacks : public BLECharacteristicCallbacks {
+  void onStatus(BLECharacteristic*, Status s, uint32_t) override {
+    ble.onNotifyStatus(s == BLECharacteristicCallbacks::Status::SUCCESS_NOTIFY);
+  }
+};
+
+class ControlCallbacks : public BLECharacteristicCallbacks {
+  void onWrite(BLECharacteristic* c) override {
+    std::string valor = c->getValue();
+    char texto[8];
+    size_t n = valor.size() < sizeof(texto) - 1 ? valor.size() : sizeof(texto) - 1;
+    memcpy(texto, valor.data(), n);
+    texto[n] = '\0';
+    ble.onControl(texto);
+  }
+};
+
+static void al_evento_gap(esp_gap_ble_cb_event_t evento, esp_ble_gap_cb_param_t* param) {
+  if (evento == ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT && param->update_conn_params.status == 0) {
+    ble.onConnParams(param->update_conn_params.conn_int);
+  }
+}
+
+bool BleLink::begin(const char* nombre) {
+  if (iniciado) {
+    setEnabled(true);
+    return true;
+  }
+  BLEDevice::init(nombre);
+  BLEDevice::setMTU(OIB_BLE_MTU);
+  BLEDevice::setCustomGapHandler(al_evento_gap);
+
+  servidor = BLEDevice::createServer();
+  servidor->setCallbacks(new ServidorCallbacks());
+  BLEService* servicio = servidor->createService(OIB_BLE_SERVICIO);
+  c_tramas = servicio->createCharacteristic(OIB_BLE_TRAMAS, BLECharacteristic::PROPERTY_NOTIFY);
+  cccd = new BLE2902();
+  c_tramas->addDescriptor(cccd);
+  c_tramas->setCallbacks(new TramasCallbacks());
+  BLECharacteristic* control =
+      servicio->createCharacteristic(OIB_BLE_CONTROL, BLECharacteristic::PROPERTY_WRITE);
+  control->setCallbacks(new ControlCallbacks());
+  servicio->start();
+
+  BLEAdvertising* anuncio = BLEDevice::getAdvertising();
+  anuncio->addServiceUUID(OIB_BLE_SERVICIO);
+  BLEDevice::startAdvertising();
+  iniciado = true;
+  habilitado = true;
+  return true;
+}
+
+void BleLink::setEnabled(bool h) {
+  if (!iniciado || h == habilitado) return;
+  habilitado = h;
+  armado_largo = armado_tramas = 0;
+  if (h) {
+    BLEDevice::startAdvertising();
+  } else {
+    BLEDevice::getAdvertising()->stop();
+    if (conectado) servidor->disconnect(conn_id);
+  }
+}
+
+bool BleLink::suscripto() const {
+  return cccd && cccd->getNotifications();
+}
+
+void BleLink::onConnect(uint16_t id, const uint8_t* remote_bda, uint16_t interval_units) {
+  conn_id = id;
+  intervalo_125us = interval_units;
+  conectado = true;
+  esp_bd_addr_t direccion;
+  memcpy(direccion, remote_bda, sizeof(direccion));
+  servidor->updateConnParams(direccion, INTERVALO_MIN, INTERVALO_MAX, 0, SUPERVISION);
+}
+
+void BleLink::onDisconnect() {
+  conectado = false;
+  mtu_negociado = 23;
+  intervalo_125us = 0;
+  if (habilitado) BLEDevice::startAdvertising();  // el stack deja de anunciar al conectarse
+}
+
+// El MTU lo negocia el central después de conectarse
+void BleLink::onMtu(uint16_t mtu) {
+  mtu_negociado = mtu < 23 ? 23 : mtu;
+}
+
+void BleLink::onConnParams(uint16_t interval_units) {
+  intervalo_125us = interval_units;
+}
+
+void BleLink::onControl(const char* texto) {
+  pedido_transportes = transportFromText(texto);
+}
+
+uint8_t BleLink::takeTransportRequest() {
+  uint8_t pedido = pedido_transportes;
+  pedido_transportes = 0;
+  return pedido;
+}
+
+bool BleLink::send(const uint8_t* frame, uint8_t length) {
+  if (!habilitado || !connected()) {
+    estadisticas.addCall(0, length, false);
+    return false;
+  }
+  uint16_t mtu = mtu_negociado;
+  uint16_t cabe = mtu - 3 < NOTIFICACION_MAX ? mtu - 3 : NOTIFICACION_MAX;
+  if (length > cabe) {
+    estadisticas.addCall(0, length, false);
+    return false;
+  }
+  if (armado_largo + length > cabe) flush();
+  memcpy(armado + armado_largo, frame, length);
+  armado_largo += length;
+  armado_tramas++;
+  return true;
+}
+
+void BleLink::update() {
+  if (armado_largo) flush();
+}
+
+void BleLink::flush() {
+  ultimo_ok = false;
+  uint32_t inicio = micros();
+  c_tramas->setValue(armado, armado_largo);
+  c_tramas->notify();  // onStatus() llega antes de que vuelva
+  uint32_t llamada = micros() - inicio;
+  estadisticas.addCall(llamada, armado_largo, ultimo_ok, armado_tramas);
+  if (ultimo_ok) estadisticas.air_us += aire_us(armado_largo);
+  armado_largo = armado_tramas = 0;
+}
+
+#endif  // OIB_BLE
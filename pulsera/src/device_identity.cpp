@@ -0,0 +1,60 @@
+#include "device_identity.h"
+
+#include <LittleFS.h>
+
+DeviceIdentity identidad;
+
+bool DeviceIdentity::valid(const char* texto, size_t largo) {
+  if (largo == 0 || largo > ID_MAX) return false;
+  for (size_t i = 0; i < largo; i++) {
+    char c = texto[i];
+    if (!isalnum((unsigned char)c) && c != '-' && c != '_') return false;
+  }
+  return true;
+}
+
+void DeviceIdentity::formatMac(uint64_t mac, char* out) {
+  // Los 6 bytes bajos del eFuse, en el orden en que se imprime la MAC
+  snprintf(out, 13, "%02x%02x%02x%02x%02x%02x", (unsigned)(mac & 0xFF),
+           (unsigned)(mac >> 8 & 0xFF), (unsigned)(mac >> 16 & 0xFF),
+           (unsigned)(mac >> 24 & 0xFF), (unsigned)(mac >> 32 & 0xFF),
+           (unsigned)(mac >> 40 & 0xFF));
+}
+
+void DeviceIdentity::begin() {
+  formatMac(ESP.getEfuseMac(), ident);
+
+  File f = LittleFS.open(ARCHIVO_DISPOSITIVO, "r");
+  if (f) {
+    char texto[ID_MAX + 1];
+    size_t n = f.read((uint8_t*)texto, ID_MAX);
+    f.close();
+    while (n && (texto[n - 1] == '\n' || texto[n - 1] == '\r' || texto[n - 1] == ' ')) n--;
+    if (valid(texto, n)) {
+      memcpy(ident, texto, n);
+      ident[n] = '\0';
+    }
+  }
+
+  snprintf(cliente, sizeof(cliente), "oib-%s", ident);
+  prefijo_largo = snprintf(prefijo, sizeof(prefijo), OIB_TOPICO_RAIZ "/%s/", ident);
+}
+
+bool DeviceIdentity::save(const char* nuevo) {
+  size_t n = strlen(nuevo);
+  if (!valid(nuevo, n)) return false;
+  File f = LittleFS.open(ARCHIVO_DISPOSITIVO, "w");
+  if (!f) return false;
+  f.write((const uint8_t*)nuevo, n);
+  f.close();
+  return true;
+}
+
+void DeviceIdentity::topic(const char* sufijo, char* out, size_t n) const {
+  snprintf(out, n, "%s%s", prefijo, sufijo);
+}
+
+const char* DeviceIdentity::localTopic(const char* topico) const {
+  if (strncmp(topico, prefijo, prefijo_largo) != 0) return nullptr;
+  return topico + prefijo_largo;
+}
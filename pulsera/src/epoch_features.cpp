@@ -0,0 +1,179 @@
+#include "epoch_features.h"
+
+static_assert(sizeof(EpochFeatures) == 80, "cambió el formato: subir OIB_FEATURES_VERSION");
+
+static const float CUENTAS_POR_G = 1024.0f;   // 12 bits, escala 2g
+static const float ALFA_GRAVEDAD = 0.1f;      // filtro a 12,5 Hz (~0,8 s)
+static const float G_DOMINANTE = 0.5f;        // eje que tiene la gravedad
+static const uint8_t CONFIRMAR_POSTURA = 25;  // 2 s a 12,5 Hz
+
+static const float ALFA_BASE_RESP = 0.1f;     // media lenta del IR por latido (~10 latidos)
+static const float ALFA_AMPLITUD = 0.1f;
+static const float HISTERESIS_RESP = 0.3f;    // fracción de la amplitud
+static const uint16_t MIN_RESPIRACIONES = 3;
+
+void FeatureExtractor::begin() {
+  *this = FeatureExtractor();
+}
+
+void FeatureExtractor::resetEpoch() {
+  latidos = 0;
+  hr_media = hr_m2 = 0.0f;
+  n_spo2 = 0;
+  spo2_min = spo2_suma = 0.0f;
+  n_temp = 0;
+  st = sy = stt = sty = 0.0f;
+  memset(muestras_postura, 0, sizeof(muestras_postura));
+  cambios_postura = 0;
+  respiraciones = 0;
+}
+
+void FeatureExtractor::addPpgSample(uint32_t ir) {
+  suma_ir += ir;
+  muestras_ir++;
+}
+
+void FeatureExtractor::addBeat(uint32_t t_ms, float bpm) {
+  latidos++;
+  float delta = bpm - hr_media;
+  hr_media += delta / latidos;
+  hr_m2 += delta * (bpm - hr_media);
+
+  if (muestras_ir == 0) return;
+  float dc = (float)suma_ir / muestras_ir;
+  suma_ir = 0;
+  muestras_ir = 0;
+  if (!hay_base) {
+    base_ir = dc;
+    hay_base = true;
+    return;
+  }
+
+  // Ciclo respiratorio: cruce ascendente de la línea de base
+  float d = dc - base_ir;
+  base_ir += ALFA_BASE_RESP * d;
+  amplitud += ALFA_AMPLITUD * (fabsf(d) - amplitud);
+  float h = HISTERESIS_RESP * amplitud;
+  if (d < -h) {
+    bajo = true;
+  } else if (d > h && bajo) {
+    bajo = false;
+    if (respiraciones == 0) t_primera = t_ms;
+    t_ultima = t_ms;
+    respiraciones++;
+  }
+}
+
+void FeatureExtractor::addSpo2(float spo2) {
+  if (n_spo2 == 0 || spo2 < spo2_min) spo2_min = spo2;
+  spo2_suma += spo2;
+  n_spo2++;
+}
+
+Posture FeatureExtractor::classifyPosture(float x, float y, float z) {
+  float ax = fabsf(x), ay = fabsf(y), az = fabsf(z);
+  if (az >= ax && az >= ay && az > G_DOMINANTE) return z > 0 ? POSTURE_SUPINE : POSTURE_PRONE;
+  if (ax >= ay && ax > G_DOMINANTE) return x > 0 ? POSTURE_LEFT : POSTURE_RIGHT;
+  if (ay > G_DOMINANTE) return POSTURE_UPRIGHT;
+  return POSTURE_UNKNOWN;
+}
+
+void FeatureExtractor::addAccelSample(int16_t x, int16_t y, int16_t z) {
+  float m[3] = {x / CUENTAS_POR_G, y / CUENTAS_POR_G, z / CUENTAS_POR_G};
+  for (uint8_t i = 0; i < 3; i++) g[i] = hay_gravedad ? g[i] + ALFA_GRAVEDAD * (m[i] - g[i]) : m[i];
+  hay_gravedad = true;
+
+  // Cambio de postura: la nueva tiene que sostenerse CONFIRMAR_POSTURA muestras
+  Posture p = classifyPosture(g[0], g[1], g[2]);
+  if (p == POSTURE_UNKNOWN || p == postura) {
+    candidata_n = 0;
+  } else if (p != candidata) {
+    candidata = p;
+    candidata_n = 1;
+  } else if (++candidata_n >= CONFIRMAR_POSTURA) {
+    if (postura != POSTURE_UNKNOWN && cambios_postura < 255) cambios_postura++;
+    postura = p;
+    candidata_n = 0;
+  }
+  if (postura != POSTURE_UNKNOWN) muestras_postura[postura]++;
+}
+
+void FeatureExtractor::addTemperature(uint32_t t_ms, float celsius) {
+  if (n_temp == 0) t0_temp = t_ms;
+  float t = (t_ms - t0_temp) / 60000.0f;  // min
+  st += t;
+  sy += celsius;
+  stt += t * t;
+  sty += t * celsius;
+  n_temp++;
+}
+
+void FeatureExtractor::closeEpoch(uint64_t start_epoch_ms, const SleepEpoch& epoca,
+                                  const HrvEpoch& hrv, const HrvSpectrum& espectro, bool en_cama,
+                                  EpochFeatures& out) {
+  memset(&out, 0, sizeof(out));
+  out.version = OIB_FEATURES_VERSION;
+  out.stage = epoca.stage;
+  out.epoch = epoca.index;
+  out.start_epoch_ms = start_epoch_ms;
+  if (en_cama) out.flags |= FEATURE_FLAG_IN_BED;
+
+  out.hr_mean = out.hr_std = out.rmssd = out.sdnn = out.pnn50 = NAN;
+  if (latidos > 0) {
+    out.flags |= FEATURE_FLAG_HR;
+    out.hr_mean = hr_media;
+    out.hr_std = latidos > 1 ? sqrtf(hr_m2 / latidos) : 0.0f;
+  }
+  if (hrv.valid) {
+    out.rmssd = hrv.rmssd;
+    out.sdnn = hrv.sdnn;
+    out.pnn50 = hrv.pnn50;
+  }
+  out.beats = latidos;
+  out.artifacts = hrv.artifacts;
+
+  out.lf = out.hf = out.lf_hf = NAN;
+  if (espectro.valid) {
+    out.flags |= FEATURE_FLAG_PSD;
+    out.lf = espectro.lf;
+    out.hf = espectro.hf;
+    out.lf_hf = espectro.lf_hf;
+  }
+
+  out.activity = epoca.activity;
+  out.movements = epoca.movements;
+
+  out.spo2_min = out.spo2_mean = NAN;
+  if (n_spo2 > 0) {
+    out.flags |= FEATURE_FLAG_SPO2;
+    out.spo2_min = spo2_min;
+    out.spo2_mean = spo2_suma / n_spo2;
+  }
+
+  out.temp_mean = out.temp_slope = NAN;
+  if (n_temp > 0) {
+    out.flags |= FEATURE_FLAG_TEMP;
+    out.temp_mean = sy / n_temp;
+    float den = n_temp * stt - st * st;
+    out.temp_slope = n_temp > 1 && den > 0.0f ? (n_temp * sty - st * sy) / den : 0.0f;
+  }
+
+  out.resp_rate = NAN;
+  if (respiraciones >= MIN_RESPIRACIONES && t_ultima > t_primera) {
+    out.flags |= FEATURE_FLAG_RESP;
+    out.resp_rate = (respiraciones - 1) * 60000.0f / (t_ultima - t_primera);
+  }
+
+  out.posture = POSTURE_UNKNOWN;
+  uint16_t max_muestras = 0;
+  for (uint8_t p = 0; p < 5; p++) {
+    if (muestras_postura[p] > max_muestras) {
+      max_muestras = muestras_postura[p];
+      out.posture = p;
+    }
+  }
+  if (max_muestras > 0) out.flags |= FEATURE_FLAG_ACCEL;
+  out.posture_changes = cambios_postura;
+
+  resetEpoch();
+}
@@ -0,0 +1,60 @@
+#include "espnow_link.h"
+
+#if OIB_ESPNOW
+
+#include <WiFi.h>
+#include <esp_now.h>
+
+EspNowLink espnow;
+
+static void al_enviar(const uint8_t*, esp_now_send_status_t status) {
+  espnow.onSent(status == ESP_NOW_SEND_SUCCESS);
+}
+
+bool EspNowLink::begin(const uint8_t peer_mac[6]) {
+  listo = false;
+  if (esp_now_init() != ESP_OK) return false;
+  esp_now_register_send_cb(al_enviar);
+
+  esp_now_peer_info_t peer;
+  memset(&peer, 0, sizeof(peer));
+  memcpy(peer.peer_addr, peer_mac, 6);
+  peer.channel = 0;  // el canal actual de la estación (el del AP)
+  peer.ifidx = WIFI_IF_STA;
+  peer.encrypt = false;
+  if (!esp_now_is_peer_exist(peer_mac) && esp_now_add_peer(&peer) != ESP_OK) return false;
+
+  listo = true;
+  return true;
+}
+
+bool EspNowLink::send(const uint8_t* frame, uint8_t length) {
+  if (!listo) return false;
+  if (enviados - completados >= EN_VUELO) {
+    estadisticas.addCall(0, length, false);
+    return false;
+  }
+
+  // El instante se escribe antes de enviar: el callback puede llegar antes
+  // de que esp_now_send() vuelva
+  uint32_t inicio = micros();
+  t_envio_us[enviados % EN_VUELO] = inicio;
+  enviados++;
+  bool ok = esp_now_send(NULL, frame, length) == ESP_OK;  // NULL = todos los peers (uno)
+  if (!ok) enviados--;
+  estadisticas.addCall(micros() - inicio, length, ok);
+  return ok;
+}
+
+void EspNowLink::onSent(bool ok) {
+  // ESP-NOW confirma los envíos en orden
+  uint32_t t = t_envio_us[completados % EN_VUELO];
+  completados++;
+  if (ok) {
+    estadisticas.addConfirm(micros() - t);
+  } else {
+    estadisticas.lost++;
+  }
+}
+
+#endif  // OIB_ESPNOW
@@ -0,0 +1,153 @@
+#include "hrv_spectrum.h"
+
+static const uint16_t PASO_GRILLA_MS = 1000 / HrvSpectrumEstimator::FS_HZ;
+static const uint32_t HUECO_MAX_MS = 3000;
+static const uint8_t ETAPAS_FFT = 8;        // log2(SEGMENT)
+static const int16_t ESCALA_MS = 64;        // 1 ms = 64 cuentas Q15 antes de la ventana
+static const uint8_t BIN_MAX = 26;          // 26 * 4/256 Hz = 0,406 Hz
+
+// Límites de banda en bins (f = k * FS / SEGMENT = k / 64 Hz), [desde, hasta)
+static const uint8_t VLF_DESDE = 1;   // 0,0156 Hz (la resolución de 64 s no llega a 0,0033)
+static const uint8_t LF_DESDE = 3;    // 0,047 Hz
+static const uint8_t HF_DESDE = 10;   // 0,156 Hz
+static const uint8_t HF_HASTA = 26;   // 0,406 Hz
+
+void HrvSpectrumEstimator::begin() {
+  inicio = cuenta = 0;
+  hay_latido = false;
+
+  // Tablas Q15: se calculan una sola vez
+  hann_s2 = 0.0f;
+  for (uint16_t i = 0; i < SEGMENT; i++) {
+    float w = 0.5f * (1.0f - cosf(2.0f * PI * i / SEGMENT));
+    hann[i] = (int16_t)lroundf(w * 32767.0f);
+    hann_s2 += w * w;
+  }
+  for (uint16_t i = 0; i < SEGMENT / 2; i++) {
+    cos_q15[i] = (int16_t)lroundf(cosf(2.0f * PI * i / SEGMENT) * 32767.0f);
+    sin_q15[i] = (int16_t)lroundf(sinf(2.0f * PI * i / SEGMENT) * 32767.0f);
+  }
+}
+
+void HrvSpectrumEstimator::push(int32_t ibi_ms) {
+  if (cuenta == CAPACITY) {
+    inicio = (inicio + 1) % CAPACITY;
+    cuenta--;
+  }
+  serie[(inicio + cuenta) % CAPACITY] = (int16_t)constrain(ibi_ms, 0, 32767);
+  cuenta++;
+}
+
+void HrvSpectrumEstimator::addIbi(uint32_t t_ms, uint16_t ibi_ms) {
+  if (!hay_latido || t_ms - t_anterior > HUECO_MAX_MS) {
+    // Arranque o hueco: el tacograma tiene que ser continuo
+    cuenta = 0;
+    inicio = 0;
+    hay_latido = true;
+    t_anterior = t_ms;
+    ibi_anterior = ibi_ms;
+    t_grilla = t_ms;
+  }
+
+  // Interpolación lineal entre el latido anterior y éste sobre la grilla de 4 Hz
+  uint32_t tramo = t_ms - t_anterior;
+  while ((int32_t)(t_ms - t_grilla) >= 0) {
+    int32_t valor = ibi_ms;
+    if (tramo > 0) {
+      int32_t f = (int32_t)(t_grilla - t_anterior);
+      valor = ibi_anterior + ((int32_t)ibi_ms - ibi_anterior) * f / (int32_t)tramo;
+    }
+    push(valor);
+    t_grilla += PASO_GRILLA_MS;
+  }
+  t_anterior = t_ms;
+  ibi_anterior = ibi_ms;
+}
+
+void HrvSpectrumEstimator::fft() {
+  // Reordenamiento por inversión de bits
+  for (uint16_t i = 1, j = 0; i < SEGMENT; i++) {
+    uint16_t bit = SEGMENT >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      int16_t t = re[i];
+      re[i] = re[j];
+      re[j] = t;
+      t = im[i];
+      im[i] = im[j];
+      im[j] = t;
+    }
+  }
+
+  // Mariposas radix-2 con escalado >>1 por etapa (no hay desborde en Q15)
+  for (uint16_t largo = 2; largo <= SEGMENT; largo <<= 1) {
+    uint16_t mitad = largo >> 1;
+    uint16_t paso = SEGMENT / largo;
+    for (uint16_t i = 0; i < SEGMENT; i += largo) {
+      for (uint16_t j = 0; j < mitad; j++) {
+        int32_t c = cos_q15[j * paso];
+        int32_t s = sin_q15[j * paso];
+        uint16_t a = i + j;
+        uint16_t b = a + mitad;
+        // (re + j·im)·(cos - j·sin)
+        int32_t tr = (re[b] * c + im[b] * s) >> 15;
+        int32_t ti = (im[b] * c - re[b] * s) >> 15;
+        re[b] = (int16_t)((re[a] - tr) >> 1);
+        im[b] = (int16_t)((im[a] - ti) >> 1);
+        re[a] = (int16_t)((re[a] + tr) >> 1);
+        im[a] = (int16_t)((im[a] + ti) >> 1);
+      }
+    }
+  }
+}
+
+void HrvSpectrumEstimator::compute(HrvSpectrum& out) {
+  uint32_t ciclos_inicio = ESP.getCycleCount();
+  memset(&out, 0, sizeof(out));
+  if (cuenta < MIN_SAMPLES) {
+    out.cycles = ESP.getCycleCount() - ciclos_inicio;
+    return;
+  }
+
+  const uint16_t salto = SEGMENT / 2;
+  uint8_t segmentos = (cuenta - SEGMENT) / salto + 1;
+  uint16_t desde = cuenta - ((segmentos - 1) * salto + SEGMENT);  // los más recientes
+
+  uint64_t potencia[BIN_MAX] = {0};
+  for (uint8_t s = 0; s < segmentos; s++) {
+    uint16_t base = inicio + desde + s * salto;
+
+    // Quitar la media del segmento (tendencia constante) y aplicar Hann
+    int32_t suma = 0;
+    for (uint16_t i = 0; i < SEGMENT; i++) suma += serie[(base + i) % CAPACITY];
+    int32_t media = suma / SEGMENT;
+    for (uint16_t i = 0; i < SEGMENT; i++) {
+      int32_t x = constrain((serie[(base + i) % CAPACITY] - media) * ESCALA_MS, -32768, 32767);
+      re[i] = (int16_t)((x * hann[i]) >> 15);
+      im[i] = 0;
+    }
+
+    fft();
+    for (uint8_t k = 1; k < BIN_MAX; k++) {
+      potencia[k] += (uint64_t)((int32_t)re[k] * re[k] + (int32_t)im[k] * im[k]);
+    }
+  }
+
+  // |X_ms| = |X_fft| · 2^ETAPAS / ESCALA_MS; potencia de banda unilateral:
+  // Σ 2·|X_ms(k)|² / (Σw² · N), promediada entre segmentos
+  const float a_ms = (float)(1 << ETAPAS_FFT) / ESCALA_MS;
+  const float factor = 2.0f * a_ms * a_ms / (hann_s2 * SEGMENT * segmentos);
+  uint64_t banda[3] = {0, 0, 0};
+  for (uint8_t k = VLF_DESDE; k < HF_HASTA; k++) {
+    banda[k < LF_DESDE ? 0 : (k < HF_DESDE ? 1 : 2)] += potencia[k];
+  }
+
+  out.valid = true;
+  out.vlf = banda[0] * factor;
+  out.lf = banda[1] * factor;
+  out.hf = banda[2] * factor;
+  out.lf_hf = out.hf > 0.0f ? out.lf / out.hf : 0.0f;
+  out.segments = segmentos;
+  out.cycles = ESP.getCycleCount() - ciclos_inicio;
+}
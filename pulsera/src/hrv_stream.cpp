@@ -0,0 +1,126 @@
+#include "hrv_stream.h"
+
+static const uint16_t IBI_MIN_MS = 300;   // 200 BPM
+static const uint16_t IBI_MAX_MS = 2000;  // 30 BPM
+static const float DESVIO_MAX = 0.20f;
+static const uint8_t RECHAZOS_REINICIO = 5;
+
+void HrvStream::begin() {
+  inicio = cuenta = 0;
+  suma_ibi = suma_ibi2 = suma_dif2 = 0;
+  pares = pares_nn50 = 0;
+  ref_n = ref_pos = 0;
+  ref_suma = 0;
+  ultimo_valido = false;
+  rechazos_seguidos = 0;
+  latidos_epoca = artefactos_epoca = 0;
+}
+
+bool HrvStream::isArtifact(uint16_t ibi) const {
+  if (ibi < IBI_MIN_MS || ibi > IBI_MAX_MS) return true;
+  if (ref_n == 0) return false;
+  float media = (float)ref_suma / ref_n;
+  return fabsf(ibi - media) > DESVIO_MAX * media;
+}
+
+void HrvStream::evictOldest() {
+  const Latido& viejo = latidos[inicio];
+  suma_ibi -= viejo.ibi;
+  suma_ibi2 -= (uint32_t)viejo.ibi * viejo.ibi;
+  inicio = (inicio + 1) % CAPACITY;
+  cuenta--;
+
+  // El par (viejo, siguiente) deja de estar en la ventana
+  if (cuenta > 0) {
+    Latido& siguiente = latidos[inicio];
+    if (siguiente.par) {
+      suma_dif2 -= (uint32_t)siguiente.dif * siguiente.dif;
+      pares--;
+      if (siguiente.dif > 50) pares_nn50--;
+      siguiente.par = false;
+    }
+  }
+}
+
+void HrvStream::evictBefore(uint32_t t_ms) {
+  while (cuenta > 0 && t_ms - latidos[inicio].t_ms > WINDOW_MS) evictOldest();
+}
+
+bool HrvStream::addIbi(uint32_t t_ms, uint16_t ibi_ms) {
+  if (isArtifact(ibi_ms)) {
+    artefactos_epoca++;
+    ultimo_valido = false;
+    if (++rechazos_seguidos >= RECHAZOS_REINICIO) {
+      ref_n = ref_pos = 0;
+      ref_suma = 0;
+      rechazos_seguidos = 0;
+    }
+    return false;
+  }
+  rechazos_seguidos = 0;
+  latidos_epoca++;
+
+  if (cuenta == CAPACITY) evictOldest();
+  evictBefore(t_ms);
+
+  Latido& nuevo = latidos[(inicio + cuenta) % CAPACITY];
+  nuevo.t_ms = t_ms;
+  nuevo.ibi = ibi_ms;
+  nuevo.par = ultimo_valido && cuenta > 0;
+  nuevo.dif = 0;
+  if (nuevo.par) {
+    const Latido& anterior = latidos[(inicio + cuenta - 1) % CAPACITY];
+    nuevo.dif = ibi_ms > anterior.ibi ? ibi_ms - anterior.ibi : anterior.ibi - ibi_ms;
+    suma_dif2 += (uint32_t)nuevo.dif * nuevo.dif;
+    pares++;
+    if (nuevo.dif > 50) pares_nn50++;
+  }
+  suma_ibi += ibi_ms;
+  suma_ibi2 += (uint32_t)ibi_ms * ibi_ms;
+  cuenta++;
+  ultimo_valido = true;
+
+  // Referencia de artefactos
+  if (ref_n == REF_N) {
+    ref_suma -= ref[ref_pos];
+  } else {
+    ref_n++;
+  }
+  ref[ref_pos] = ibi_ms;
+  ref_suma += ibi_ms;
+  ref_pos = (ref_pos + 1) % REF_N;
+  return true;
+}
+
+float HrvStream::rmssd() const {
+  return pares ? sqrtf((float)suma_dif2 / pares) : 0.0f;
+}
+
+float HrvStream::sdnn() const {
+  if (cuenta < 2) return 0.0f;
+  // n·Σx² - (Σx)² es exacto en enteros; se divide al final
+  double n = cuenta;
+  double var = ((double)suma_ibi2 * n - (double)suma_ibi * (double)suma_ibi) / (n * n);
+  return var > 0 ? (float)sqrt(var) : 0.0f;
+}
+
+float HrvStream::pnn50() const {
+  return pares ? 100.0f * pares_nn50 / pares : 0.0f;
+}
+
+float HrvStream::meanHr() const {
+  return cuenta ? 60000.0f * cuenta / (float)suma_ibi : 0.0f;
+}
+
+void HrvStream::closeEpoch(uint32_t now_ms, HrvEpoch& out) {
+  evictBefore(now_ms);
+  out.valid = cuenta >= MIN_BEATS;
+  out.rmssd = out.valid ? rmssd() : 0.0f;
+  out.sdnn = out.valid ? sdnn() : 0.0f;
+  out.pnn50 = out.valid ? pnn50() : 0.0f;
+  out.mean_hr = out.valid ? meanHr() : 0.0f;
+  out.window_beats = cuenta;
+  out.beats = latidos_epoca;
+  out.artifacts = artefactos_epoca;
+  latidos_epoca = artefactos_epoca = 0;
+}
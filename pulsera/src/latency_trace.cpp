@@ -0,0 +1,100 @@
+#include "latency_trace.h"
+
+#ifdef OIB_NATIVE_SIM
+#include "sim_network.h"
+#else
+#include <sys/time.h>
+#endif
+
+// Antes de esta fecha (2024-01-01) el reloj del ESP32 no está sincronizado
+static const time_t EPOCH_VALIDA = 1704067200;
+
+enum EtapaTraza { ETAPA_ENCOLADO, ETAPA_CODIFICADO, ETAPA_ENTREGADO, ETAPA_PUBLISH, N_ETAPAS };
+static const char* NOMBRE_ETAPA[N_ETAPAS] = {"enc", "cod", "pub", "envio"};
+
+struct EstadisticaEtapa {
+  uint32_t n;
+  uint32_t suma_ms;
+  uint32_t max_ms;
+};
+
+static uint32_t siguiente_id = 1;
+static EstadisticaEtapa etapas[N_ETAPAS];
+static uint32_t publish_fallidos = 0;
+static uint32_t sin_hora = 0;
+
+static void acumular(EtapaTraza etapa, uint32_t ms) {
+  EstadisticaEtapa& e = etapas[etapa];
+  e.n++;
+  e.suma_ms += ms;
+  if (ms > e.max_ms) e.max_ms = ms;
+}
+
+void traza_iniciar(const char* servidor_ntp) {
+  configTime(0, 0, servidor_ntp);
+}
+
+uint64_t traza_epoch_ms() {
+#ifdef OIB_NATIVE_SIM
+  return oib_sim::network().epochMillis(oib_sim::virtualClock().nowMicros());
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  if (tv.tv_sec < EPOCH_VALIDA) return 0;
+  return (uint64_t)tv.tv_sec * 1000ULL + tv.tv_usec / 1000;
+#endif
+}
+
+TrazaBloque traza_nueva(uint32_t adq_ms) {
+  TrazaBloque t;
+  t.id = siguiente_id++;
+  t.adq_ms = adq_ms;
+  t.enc_ms = t.cod_ms = t.pub_ms = adq_ms;
+
+  // Llevar la hora de pared al instante de la muestra
+  uint64_t ahora = traza_epoch_ms();
+  uint32_t edad = millis() - adq_ms;
+  t.adq_epoch_ms = ahora > edad ? ahora - edad : 0;
+  if (t.adq_epoch_ms == 0) sin_hora++;
+  return t;
+}
+
+String traza_json(TrazaBloque& t) {
+  t.pub_ms = millis();
+  char buf[96];
+  snprintf(buf, sizeof(buf), "\"traza\":{\"id\":%lu,\"adq\":%llu,\"enc\":%lu,\"cod\":%lu,\"pub\":%lu}",
+           (unsigned long)t.id, (unsigned long long)t.adq_epoch_ms,
+           (unsigned long)(t.enc_ms - t.adq_ms), (unsigned long)(t.cod_ms - t.adq_ms),
+           (unsigned long)(t.pub_ms - t.adq_ms));
+  return String(buf);
+}
+
+void traza_publicado(const TrazaBloque& t, bool ok) {
+  acumular(ETAPA_ENCOLADO, t.enc_ms - t.adq_ms);
+  acumular(ETAPA_CODIFICADO, t.cod_ms - t.enc_ms);
+  acumular(ETAPA_ENTREGADO, t.pub_ms - t.cod_ms);
+  acumular(ETAPA_PUBLISH, millis() - t.pub_ms);
+  if (!ok) {
+    publish_fallidos++;
+    // El id no salió: lo toma el próximo bloque (o el reintento), así un
+    // corte no deja huecos en la secuencia que ven el gateway y el monitor
+    if (t.id + 1 == siguiente_id) siguiente_id--;
+  }
+}
+
+String traza_resumen_json() {
+  String json = "{";
+  for (int i = 0; i < N_ETAPAS; i++) {
+    const EstadisticaEtapa& e = etapas[i];
+    json += "\"" + String(NOMBRE_ETAPA[i]) + "\":{\"n\":" + String(e.n) +
+            ",\"med\":" + String(e.n ? (float)e.suma_ms / e.n : 0.0f, 1) +
+            ",\"max\":" + String(e.max_ms) + "},";
+  }
+  json += "\"fallidos\":" + String(publish_fallidos) + ",\"sin_hora\":" + String(sin_hora) +
+          ",\"sincronizado\":" + String(traza_epoch_ms() ? 1 : 0) + "}";
+
+  memset(etapas, 0, sizeof(etapas));
+  publish_fallidos = 0;
+  sin_hora = 0;
+  return json;
+}
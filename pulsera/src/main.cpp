@@ -5,6 +5,23 @@
 #include <MAX30105.h>
 #include <heartRate.h>
 #include <SparkFun_MMA8452Q.h>
+#include "latency_trace.h"
+#include "sleep_staging.h"
+#include "hrv_stream.h"
+#include "hrv_spectrum.h"
+#include "bed_presence.h"
+#include "spo2_estimator.h"
+#include "alert_monitor.h"
+#include "night_log.h"
+#include "epoch_features.h"
+#include "stage_classifier.h"
+#include "raw_capture.h"
+#include "telemetry_frame.h"
+#include "espnow_link.h"
+#include "ble_link.h"
+#include "device_identity.h"
+#include "publish_slot.h"
+#include <LittleFS.h>
 
 // Configuración WiFi
 const char* ssid = "xiaomi";
@@ -16,9 +33,26 @@ const int mqtt_port = 1883;
 const char* mqtt_user = "tu_usuario";  // opcional
 const char* mqtt_password = "tu_password";  // opcional
 
+// Servidor NTP para sellar las muestras (la Raspberry sincroniza con el mismo)
+const char* ntp_server = "pool.ntp.org";
+
 WiFiClient espClient;
 PubSubClient client(espClient);
 
+// Sesión MQTT persistente: el broker guarda las suscripciones y los mensajes
+// QoS 1 mientras la pulsera está desconectada, así que reconectar es un solo
+// CONNECT/CONNACK. El last will deja sistema/estado en "offline" (retenido).
+// Todos los tópicos van bajo oib/<id>/ y el client id es único por pulsera
+// (device_identity.h).
+const char* TOPICO_ESTADO = "sistema/estado";
+const char* TOPICO_SENSORES = "sistema/sensores";
+bool sesion_iniciada = false;        // hubo una conexión limpia desde el arranque
+unsigned long eco_estado_ms = 0;     // esperando el eco de "online" (0 = no)
+bool estado_sensores_pendiente = false;
+uint32_t reconexiones = 0;
+uint32_t sesiones_perdidas = 0;
+const unsigned long ECO_ESTADO_MS = 3000;
+
 // Sensores
 HTU21D htu21d;
 MAX30105 max30102;
@@ -33,10 +67,168 @@ bool accel_ok = false;
 const byte RATE_SIZE = 4; // Increase this for more averaging. 4 is good.
 byte rates[RATE_SIZE]; // Array of heart rates
 byte rateSpot = 0;
-long lastBeat = 0; // Time at which the last beat occurred
+uint32_t lastBeat = 0; // Muestra PPG en la que ocurrió el último latido
 float beatsPerMinute = 0;
 int beatAvg = 0;
 
+// Muestreo continuo: max30102.setup() deja 400 sps con promedio de 4
+const float PPG_PERIODO_MS = 10.0;
+uint32_t muestras_ppg = 0;     // reloj de latidos en muestras del sensor
+uint32_t ppg_base_ms = 0;      // millis() de la muestra 0 de ese reloj
+const uint32_t PPG_DESVIO_MAX_MS = 500;  // más que la FIFO entera (32 muestras)
+long ultimo_ir = 0;
+unsigned long t_ultimo_ir = 0;
+unsigned long t_ultimo_accel = 0;
+unsigned long t_ultimo_latido = 0;  // último latido con dedo apoyado
+
+// Clasificación de sueño en la pulsera (épocas de 30 s) y HRV por época
+SleepStager sueno;
+HrvStream hrv;
+HrvSpectrumEstimator espectro;
+FeatureExtractor rasgos;
+uint32_t espectro_excedido = 0;  // épocas sobre el presupuesto de ciclos
+
+// Alertas clínicas: se evalúan por latido y salen antes que la telemetría
+Spo2Estimator spo2;
+AlertMonitor alertas;
+bool dedo_anterior = false;
+const char* TOPICO_ALERTA = "sensores/alerta";
+
+// Hipnograma de la noche en flash; se publica entero al cerrarse la noche
+// o cuando lo pide la Raspberry ("anterior" para la noche previa)
+NightLog noche;
+bool noche_pedida = false;
+bool noche_pedida_anterior = false;
+const char* TOPICO_NOCHE = "sensores/sueno/noche";
+const char* TOPICO_RASGOS = "sensores/sueno/rasgos";
+const char* TOPICO_NOCHE_PEDIR = "sensores/sueno/noche/pedir";
+
+// Señales crudas alrededor de alertas, caídas o pedidos de la Raspberry
+RawCapture captura;
+const char* TOPICO_CAPTURA = "sensores/captura";
+const char* TOPICO_CAPTURA_PEDIR = "sensores/captura/pedir";
+
+// Presencia en la cama: sólo se publican las transiciones (retenidas)
+BedPresence presencia;
+bool presencia_pendiente = false;
+
+// Tramas binarias para el lazo térmico de la cama: la misma trama (mismo
+// seq) va por MQTT y, con OIB_ESPNOW=1, directo al receptor de la cama
+FrameEncoder tramas;
+LinkStats enlace_mqtt;
+const char* TOPICO_TRAMA = "sensores/trama";
+float ultima_spo2 = NAN;
+uint8_t ultima_etapa = 0xFF;
+#if OIB_ESPNOW
+// MAC del receptor ESP-NOW de la cama (receptor/ la imprime al arrancar)
+const uint8_t receptor_mac[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+#endif
+
+// Transportes activos (TRANSPORT_WIFI, TRANSPORT_BLE). OIB_TRANSPORTES es el
+// de fábrica; el elegido por MQTT o por la característica de control BLE
+// queda en /transporte y sobrevive al reinicio.
+#ifndef OIB_TRANSPORTES
+#define OIB_TRANSPORTES TRANSPORT_WIFI
+#endif
+uint8_t transportes = OIB_TRANSPORTES;
+const char* ARCHIVO_TRANSPORTE = "/transporte";
+const char* TOPICO_TRANSPORTE = "sistema/transporte/cambiar";
+const char* TOPICO_IDENTIDAD = "sistema/identidad/cambiar";
+
+// Potencia de la radio al transmitir, para estimar la energía por trama
+// (ESP32-C3 a 1 Mbps y 20 dBm: ~300 mA a 3,3 V)
+#ifndef OIB_RADIO_TX_MW
+#define OIB_RADIO_TX_MW 1000
+#endif
+
+// La etapa que manda (noche, FRAME_EPOCH, lazo térmico) es la de SleepStager;
+// el modelo entrenado corre en sombra y sale aparte en "modelo" del JSON de
+// la época. Con 1 el modelo la reemplaza: sólo después de validarlo en noches
+// reales etiquetadas (se entrenó con noches de la simulación).
+#ifndef OIB_STAGE_FROM_MODEL
+#define OIB_STAGE_FROM_MODEL 0
+#endif
+
+// Épocas pendientes de publicar: la clasificación sigue durante un corte de
+// red y se envían al reconectar (120 épocas = 1 hora)
+struct EpocaPendiente {
+  SleepEpoch epoca;
+  HrvEpoch hrv;
+  HrvSpectrum espectro;
+  EpochFeatures rasgos;
+  StagePrediction prediccion;
+  unsigned long encolada_ms;
+  bool json_enviado;  // falta sólo el vector de características
+};
+const uint8_t EPOCAS_MAX = 120;
+EpocaPendiente epocas_pendientes[EPOCAS_MAX];
+uint8_t epocas_inicio = 0;
+uint8_t epocas_cuenta = 0;
+uint32_t epocas_descartadas = 0;
+const uint8_t EPOCAS_POR_LOOP = 8;  // no frenar el muestreo al vaciar la cola
+
+// 1 = además de las épocas se publican las lecturas crudas cada 2 s
+#ifndef OIB_TELEMETRIA_CRUDA
+#define OIB_TELEMETRIA_CRUDA 1
+#endif
+
+// Presupuestos de memoria en tiempo de ejecución (los inyecta tools/memory_budget.py
+// desde platformio.ini; 0 = sin presupuesto)
+#ifndef OIB_HEAP_PEAK_BUDGET
+#define OIB_HEAP_PEAK_BUDGET 0
+#endif
+#ifndef OIB_LOOP_STACK_BUDGET
+#define OIB_LOOP_STACK_BUDGET 0
+#endif
+
+// Ventana de publicación del ciclo de 2 s, con fase propia de esta pulsera
+PublishSlot ranura;
+
+// Lee los transportes guardados; sin archivo (o sin BLE compilado) quedan
+// los de fábrica
+void cargar_transportes() {
+  if (!LittleFS.begin(true)) return;
+  File f = LittleFS.open(ARCHIVO_TRANSPORTE, "r");
+  if (!f) return;
+  char texto[8];
+  size_t n = f.read((uint8_t*)texto, sizeof(texto) - 1);
+  f.close();
+  texto[n] = '\0';
+  uint8_t guardados = transportFromText(texto);
+  if (!OIB_BLE) guardados &= ~TRANSPORT_BLE;
+  if (guardados) transportes = guardados;
+}
+
+// Cambia los transportes sin reiniciar: WiFi se apaga o vuelve a asociarse
+// (reconnect() sigue con MQTT) y BLE deja de anunciar o arranca
+void aplicar_transportes(uint8_t nuevos) {
+  if (!OIB_BLE) nuevos &= ~TRANSPORT_BLE;
+  if (nuevos == 0 || nuevos == transportes) return;
+  uint8_t antes = transportes;
+  transportes = nuevos;
+
+  File f = LittleFS.open(ARCHIVO_TRANSPORTE, "w");
+  if (f) {
+    const char* texto = nuevos == TRANSPORT_WIFI ? "wifi" : nuevos == TRANSPORT_BLE ? "ble" : "ambos";
+    f.write((const uint8_t*)texto, strlen(texto));
+    f.close();
+  }
+
+#if OIB_BLE
+  if (nuevos & TRANSPORT_BLE) ble.begin(identidad.clientId());
+  else ble.setEnabled(false);
+#endif
+  if ((antes & TRANSPORT_WIFI) && !(nuevos & TRANSPORT_WIFI)) {
+    // Con un DISCONNECT limpio el broker descarta el last will: el "offline"
+    // retenido va a mano, si no sistema/estado queda en "online"
+    client.publish(Topic(TOPICO_ESTADO), "offline", true);
+    client.disconnect();
+    WiFi.disconnect(true);
+  } else if (!(antes & TRANSPORT_WIFI) && (nuevos & TRANSPORT_WIFI)) {
+    WiFi.begin(ssid, password);
+  }
+}
+
 void setup_wifi() {
   delay(10);
   WiFi.begin(ssid, password);
@@ -48,13 +240,468 @@ void setup_wifi() {
   }
 }
 
+void suscribir() {
+  // Eco de las propias alertas como confirmación de entrega
+  client.subscribe(Topic(TOPICO_ALERTA), 1);
+  client.subscribe(Topic(TOPICO_NOCHE_PEDIR), 1);
+  client.subscribe(Topic(TOPICO_CAPTURA_PEDIR), 1);
+  client.subscribe(Topic(TOPICO_TRANSPORTE), 1);
+  client.subscribe(Topic(TOPICO_IDENTIDAD), 1);
+  client.subscribe(Topic(TOPICO_ESTADO), 0);
+}
+
+// Un intento cada 5 s sin bloquear: el muestreo y la clasificación de sueño
+// siguen funcionando mientras no hay broker
 void reconnect() {
-  while (!client.connected()) {
-    if (client.connect("ESP32Client_Sensores", mqtt_user, mqtt_password)) {
-      client.publish("sensores/status", "ESP32 conectado - Iniciando lecturas de sensores");
+  static unsigned long ultimo_intento = 0;
+  static bool primer_intento = true;
+  if (!primer_intento && millis() - ultimo_intento < 5000) return;
+  primer_intento = false;
+  ultimo_intento = millis();
+
+  // La primera conexión después de arrancar es limpia (nada de la sesión de
+  // un firmware anterior); las siguientes reanudan la que guardó el broker
+  bool limpia = !sesion_iniciada;
+  if (client.connect(identidad.clientId(), mqtt_user, mqtt_password, Topic(TOPICO_ESTADO), 1, true, "offline",
+                     limpia)) {
+    if (limpia) {
+      suscribir();
+      sesion_iniciada = true;
     } else {
-      delay(5000);
+      // Si el broker perdió la sesión (reinicio sin persistencia) el eco de
+      // "online" no llega y hay que volver a suscribirse (ver verificar_sesion)
+      reconexiones++;
+      eco_estado_ms = millis() | 1;
     }
+    client.publish(Topic(TOPICO_ESTADO), "online", true);
+    alertas.retryAll();
+  }
+}
+
+
+// Sin eco de "online" después de reanudar: la sesión no existía
+void verificar_sesion() {
+  if (eco_estado_ms == 0 || !client.connected()) return;
+  if (millis() - eco_estado_ms < ECO_ESTADO_MS) return;
+  eco_estado_ms = 0;
+  sesiones_perdidas++;
+  suscribir();
+  estado_sensores_pendiente = true;  // el broker pudo perder también los retenidos
+}
+
+// Sensores detectados y modelo de sueño, retenido: lo recibe cualquiera que
+// se suscriba aunque la pulsera no lo vuelva a publicar
+void publicar_estado_sensores() {
+  if (!estado_sensores_pendiente || !client.connected()) return;
+  char modelo[12];
+  snprintf(modelo, sizeof(modelo), "%08lx", (unsigned long)StageClassifier::modelId());
+  char buf[240];
+  snprintf(buf, sizeof(buf),
+           "{\"htu21d\":%u,\"max30105\":%u,\"mma8452q\":%u,\"i2c\":\"SDA=GPIO6,SCL=GPIO7,100kHz\","
+           "\"modelo_sueno\":\"%s\",\"mac\":\"%s\",\"id\":\"%s\"}",
+           htu21d_ok ? 1 : 0, max30102_ok ? 1 : 0, accel_ok ? 1 : 0,
+           StageClassifier::available() ? modelo : "reglas", WiFi.macAddress().c_str(),
+           identidad.id());
+  if (client.publish(Topic(TOPICO_SENSORES), buf, true)) estado_sensores_pendiente = false;
+}
+
+// millis() de la muestra actual contada desde el ancla, no la hora del
+// vaciado de la FIFO. Se vuelve a anclar cuando se aleja de millis() más de
+// lo que cabe en la FIFO (desborde, deriva del oscilador del sensor)
+uint32_t hora_muestra_ppg() {
+  uint32_t ahora = millis();
+  uint32_t t = ppg_base_ms + (uint32_t)(muestras_ppg * (uint64_t)PPG_PERIODO_MS);
+  int32_t desvio = (int32_t)(ahora - t);
+  if (desvio > (int32_t)PPG_DESVIO_MAX_MS || desvio < -(int32_t)PPG_DESVIO_MAX_MS) {
+    ppg_base_ms += desvio;
+    t = ahora;
+  }
+  return t;
+}
+
+// Vacía la FIFO del MAX30102 y pasa cada muestra por el detector de latidos
+void muestrear_ppg() {
+  max30102.check();
+  while (max30102.available()) {
+    long irValue = max30102.getFIFOIR();
+    uint32_t redValue = max30102.getFIFORed();
+    max30102.nextSample();
+    muestras_ppg++;
+    captura.addPpgSample(irValue, redValue);
+    ultimo_ir = irValue;
+    t_ultimo_ir = millis();
+
+    bool dedo_muestra = irValue >= OIB_CFG_FINGER_DETECTION_THRESHOLD;
+    if (dedo_muestra) {
+      spo2.addSample(irValue, redValue);
+      rasgos.addPpgSample(irValue);
+    } else if (dedo_anterior) {
+      spo2.reset();
+      alertas.onContactLost();
+    }
+    dedo_anterior = dedo_muestra;
+
+    // Usar algoritmo oficial de SparkFun para detectar latidos
+    if (checkForBeat(irValue) == true) {
+      // ¡Detectamos un latido! (intervalo medido en muestras del sensor)
+      float delta_ms = (muestras_ppg - lastBeat) * PPG_PERIODO_MS;
+      lastBeat = muestras_ppg;
+      bool dedo = dedo_muestra;
+      float saturacion = dedo ? spo2.closeBeat() : NAN;
+      if (!isnan(saturacion)) {
+        ultima_spo2 = saturacion;
+        alertas.onSpo2(millis(), saturacion);
+        rasgos.addSpo2(saturacion);
+      }
+      uint16_t ibi = (uint16_t)min(delta_ms, 65535.0f);
+      uint32_t t_latido = hora_muestra_ppg();
+      if (dedo && hrv.addIbi(t_latido, ibi)) espectro.addIbi(t_latido, ibi);
+
+      beatsPerMinute = 60 / (delta_ms / 1000.0);
+
+      if (beatsPerMinute < 255 && beatsPerMinute > 20) {
+        // Almacenar esta lectura en el array
+        rates[rateSpot++] = (byte)beatsPerMinute;
+        rateSpot %= RATE_SIZE; // Wrap variable
+
+        // Calcular promedio de lecturas
+        beatAvg = 0;
+        for (byte x = 0; x < RATE_SIZE; x++)
+          beatAvg += rates[x];
+        beatAvg /= RATE_SIZE;
+
+        if (dedo) {
+          sueno.addBeat(millis(), beatsPerMinute);
+          alertas.onHeartRate(millis(), beatsPerMinute);
+          rasgos.addBeat(millis(), beatsPerMinute);
+          t_ultimo_latido = millis();
+        }
+      }
+    }
+  }
+}
+
+// Lee el acelerómetro a su frecuencia completa (ODR 12.5 Hz) para la actigrafía
+void muestrear_accel() {
+  if (accel.available()) {
+    accel.read();
+    t_ultimo_accel = millis();
+    sueno.addAccelSample(t_ultimo_accel, accel.x, accel.y, accel.z);
+    rasgos.addAccelSample(accel.x, accel.y, accel.z);
+    if (captura.addAccelSample(accel.x, accel.y, accel.z)) {
+      captura.trigger(CAPTURE_TRIGGER_FALL, traza_epoch_ms());
+    }
+  }
+}
+
+// Las alertas nuevas de HR y SpO2 disparan una captura cruda
+void disparar_captura() {
+  uint8_t nuevas = alertas.takeRaised();
+  uint8_t disparos = 0;
+  if (nuevas & ((1 << ALERT_HR_HIGH) | (1 << ALERT_HR_LOW))) disparos |= CAPTURE_TRIGGER_HR;
+  if (nuevas & (1 << ALERT_SPO2_LOW)) disparos |= CAPTURE_TRIGGER_SPO2;
+  if (disparos) captura.trigger(disparos, traza_epoch_ms());
+  captura.update(millis());
+}
+
+void encolar_epoca(const SleepEpoch& epoca, const HrvEpoch& hrv_epoca,
+                   const HrvSpectrum& espectro_epoca, const EpochFeatures& rasgos_epoca,
+                   const StagePrediction& prediccion) {
+  if (epocas_cuenta == EPOCAS_MAX) {
+    // Cola llena: se pierde la más vieja
+    epocas_inicio = (epocas_inicio + 1) % EPOCAS_MAX;
+    epocas_cuenta--;
+    epocas_descartadas++;
+  }
+  EpocaPendiente& p = epocas_pendientes[(epocas_inicio + epocas_cuenta) % EPOCAS_MAX];
+  p.epoca = epoca;
+  p.hrv = hrv_epoca;
+  p.espectro = espectro_epoca;
+  p.rasgos = rasgos_epoca;
+  p.prediccion = prediccion;
+  p.json_enviado = false;
+  p.encolada_ms = millis();
+  epocas_cuenta++;
+}
+
+// Publica las épocas pendientes, de la más vieja a la más nueva
+void publicar_epocas() {
+  uint8_t enviadas = 0;
+  while (epocas_cuenta > 0 && client.connected() && enviadas < EPOCAS_POR_LOOP) {
+    EpocaPendiente& p = epocas_pendientes[epocas_inicio];
+    const SleepEpoch& e = p.epoca;
+    const HrvEpoch& h = p.hrv;
+    const HrvSpectrum& f = p.espectro;
+
+    if (!p.json_enviado) {
+      TrazaBloque traza = traza_nueva(e.start_ms + OIB_SLEEP_EPOCH_MS);
+      traza.enc_ms = p.encolada_ms;
+      uint64_t inicio_epoch = traza.adq_epoch_ms ? traza.adq_epoch_ms - OIB_SLEEP_EPOCH_MS : 0;
+
+      char buf[448];
+      snprintf(buf, sizeof(buf),
+               "{\"ep\":%lu,\"inicio\":%llu,\"estado\":%u,\"votos\":%u,\"act\":%.4f,"
+               "\"hr\":%.1f,\"latidos\":%u,\"mov\":%u,"
+               "\"rmssd\":%.1f,\"sdnn\":%.1f,\"pnn50\":%.1f,\"hr_hrv\":%.1f,"
+               "\"ibi_ok\":%u,\"art\":%u,\"ibi_ventana\":%u,",
+               (unsigned long)e.index, (unsigned long long)inicio_epoch, e.stage, e.votes,
+               e.activity, e.hr, e.beats, e.movements, h.rmssd, h.sdnn, h.pnn50, h.mean_hr,
+               h.beats, h.artifacts, h.window_beats);
+      if (f.valid) {
+        size_t n = strlen(buf);
+        snprintf(buf + n, sizeof(buf) - n,
+                 "\"vlf\":%.1f,\"lf\":%.1f,\"hf\":%.1f,\"lf_hf\":%.2f,\"psd_seg\":%u,\"ciclos\":%lu,",
+                 f.vlf, f.lf, f.hf, f.lf_hf, f.segments, (unsigned long)f.cycles);
+      }
+      // estado es la etapa que manda; reglas, la de SleepStager, y modelo, la
+      // del clasificador con su margen (logit ganador - segundo, Q16)
+      if (p.prediccion.from_model) {
+        size_t n = strlen(buf);
+        snprintf(buf + n, sizeof(buf) - n,
+                 "\"reglas\":%u,\"modelo\":{\"etapa\":%u,\"margen\":%ld,\"faltan\":%u,"
+                 "\"ciclos\":%lu},",
+                 p.rasgos.stage, p.prediccion.stage, (long)p.prediccion.margin,
+                 p.prediccion.missing, (unsigned long)p.prediccion.cycles);
+      }
+      traza_codificar(traza);
+      String epoca_json = String(buf) + traza_json(traza) + "}";
+
+      bool ok = client.publish(Topic("sensores/sueno/epoca"), epoca_json.c_str());
+      traza_publicado(traza, ok);
+      if (!ok) break;
+      p.json_enviado = true;
+    }
+
+    // Vector de características en binario para los modelos del gateway
+    if (!client.publish(Topic(TOPICO_RASGOS), (const uint8_t*)&p.rasgos, sizeof(p.rasgos))) break;
+
+    epocas_inicio = (epocas_inicio + 1) % EPOCAS_MAX;
+    epocas_cuenta--;
+    enviadas++;
+  }
+}
+
+// Camino prioritario: se llama después de cada bloque de muestras procesado,
+// antes que cualquier otra publicación
+void publicar_alertas() {
+  if (!client.connected()) return;
+  Alert* a;
+  while ((a = alertas.nextToSend(micros())) != nullptr) {
+    uint32_t espera_us = micros() - a->detected_us;
+    TrazaBloque traza = traza_nueva(a->sample_ms);
+    traza.enc_ms = millis() - espera_us / 1000;
+
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+             "{\"seq\":%lu,\"tipo\":\"%s\",\"activa\":%u,\"valor\":%.1f,\"umbral\":%.1f,"
+             "\"intento\":%u,\"espera_us\":%lu,",
+             (unsigned long)a->seq, AlertMonitor::typeName(a->type), a->active ? 1 : 0, a->value,
+             a->threshold, a->attempts + 1, (unsigned long)espera_us);
+    traza_codificar(traza);
+    String alerta_json = String(buf) + traza_json(traza) + "}";
+
+    bool ok = client.publish(Topic(TOPICO_ALERTA), alerta_json.c_str());
+    traza_publicado(traza, ok);
+    if (!ok) break;
+    alertas.markSent(*a, micros());
+  }
+}
+
+// Mensajes recibidos: eco de las alertas, pedidos del hipnograma y de capturas
+void mqtt_callback(char* topico, byte* payload, unsigned int length) {
+  const char* topic = identidad.localTopic(topico);
+  if (!topic) return;
+  if (strcmp(topic, TOPICO_ESTADO) == 0) {
+    if (length == 6 && memcmp(payload, "online", 6) == 0) eco_estado_ms = 0;
+    return;
+  }
+  if (strcmp(topic, TOPICO_TRANSPORTE) == 0) {
+    char texto[8];
+    unsigned int n = min(length, (unsigned int)sizeof(texto) - 1);
+    memcpy(texto, payload, n);
+    texto[n] = '\0';
+    aplicar_transportes(transportFromText(texto));
+    return;
+  }
+  if (strcmp(topic, TOPICO_IDENTIDAD) == 0) {
+    // El nombre nuevo vale desde el próximo arranque: tópicos, client id y
+    // sesión del broker cambian juntos
+    char nombre[DeviceIdentity::ID_MAX + 1];
+    unsigned int n = min(length, (unsigned int)DeviceIdentity::ID_MAX);
+    memcpy(nombre, payload, n);
+    nombre[n] = '\0';
+    if (identidad.save(nombre)) {
+      client.publish(Topic(TOPICO_ESTADO), "offline", true);
+      client.disconnect();
+      ESP.restart();
+    }
+    return;
+  }
+  if (strcmp(topic, TOPICO_CAPTURA_PEDIR) == 0) {
+    captura.trigger(CAPTURE_TRIGGER_MANUAL, traza_epoch_ms());
+    return;
+  }
+  if (strcmp(topic, TOPICO_NOCHE_PEDIR) == 0) {
+    noche_pedida = true;
+    noche_pedida_anterior = length >= 8 && memcmp(payload, "anterior", 8) == 0;
+    return;
+  }
+  if (strcmp(topic, TOPICO_ALERTA) != 0) return;
+  char buf[32];
+  unsigned int n = min(length, (unsigned int)sizeof(buf) - 1);
+  memcpy(buf, payload, n);
+  buf[n] = '\0';
+  const char* seq = strstr(buf, "\"seq\":");
+  if (seq) alertas.acknowledge(strtoul(seq + 6, NULL, 10), micros());
+}
+
+// La noche cerrada sale retenida, así la Raspberry la recibe aunque se
+// haya reiniciado; los pedidos se contestan en el momento
+void publicar_noche() {
+  if (!client.connected()) return;
+  if (noche.closedPending()) noche.publish(client, Topic(TOPICO_NOCHE), true, true);
+  if (noche_pedida && noche.publish(client, Topic(TOPICO_NOCHE), noche_pedida_anterior, false)) {
+    noche_pedida = false;
+  }
+}
+
+// Hora de pared de una muestra tomada en adq_ms (0 sin reloj sincronizado)
+uint64_t epoch_de(uint32_t adq_ms) {
+  uint64_t ahora = traza_epoch_ms();
+  uint32_t edad = millis() - adq_ms;
+  return ahora > edad ? ahora - edad : 0;
+}
+
+// Arma una trama y la manda por todos los transportes habilitados. Sin red
+// la copia MQTT se cuenta como fallida y no se reintenta: el lazo térmico
+// sólo quiere el último valor.
+void enviar_trama(FrameType tipo, const void* datos, uint8_t largo, uint64_t epoch_ms) {
+  uint8_t trama[OIB_FRAME_MAX];
+  uint8_t n = tramas.encode(tipo, datos, largo, epoch_ms, trama);
+  if (transportes & TRANSPORT_WIFI) {
+    if (client.connected()) {
+      uint32_t inicio = micros();
+      bool ok = client.publish(Topic(TOPICO_TRAMA), trama, n);
+      enlace_mqtt.addCall(micros() - inicio, n, ok);
+    } else {
+      enlace_mqtt.addCall(0, n, false);
+    }
+#if OIB_ESPNOW
+    espnow.send(trama, n);
+#endif
+  }
+#if OIB_BLE
+  if (transportes & TRANSPORT_BLE) ble.send(trama, n);  // sale en ble.update()
+#endif
+}
+
+void enviar_tramas_periodicas(float temperatura, float humedad, bool ambiente_ok) {
+  FrameVitals v;
+  bool dedo = max30102_ok && ultimo_ir >= OIB_CFG_FINGER_DETECTION_THRESHOLD;
+  v.hr_x10 = dedo ? beatAvg * 10 : 0;
+  v.spo2_x10 = dedo && !isnan(ultima_spo2) ? (uint16_t)(ultima_spo2 * 10 + 0.5f) : 0;
+  v.finger = dedo ? 1 : 0;
+  v.stage = ultima_etapa;
+  enviar_trama(FRAME_VITALS, &v, sizeof(v), epoch_de(t_ultimo_ir));
+
+  if (ambiente_ok) {
+    FrameEnvironment a;
+    a.temp_x100 = (int16_t)lroundf(temperatura * 100);
+    a.humidity_x100 = isnan(humedad) ? 0 : (uint16_t)lroundf(constrain(humedad, 0, 100) * 100);
+    enviar_trama(FRAME_ENVIRONMENT, &a, sizeof(a), traza_epoch_ms());
+  }
+}
+
+void enviar_trama_epoca(const SleepEpoch& epoca, const HrvEpoch& hrv_epoca, uint8_t etapa_reglas,
+                        uint64_t inicio_epoch) {
+  FrameEpoch e;
+  e.index = epoca.index;
+  e.stage = epoca.stage;
+  e.rules_stage = etapa_reglas;
+  e.hr_x10 = (uint16_t)(epoca.hr * 10 + 0.5f);
+  e.rmssd_x10 = (uint16_t)min(hrv_epoca.rmssd * 10 + 0.5f, 65535.0f);
+  e.activity_x1000 = (uint16_t)min(epoca.activity * 1000 + 0.5f, 65535.0f);
+  enviar_trama(FRAME_EPOCH, &e, sizeof(e), inicio_epoch);
+}
+
+// Evalúa la presencia con la última lectura de cada sensor
+void evaluar_presencia(float temperatura, bool temperatura_ok) {
+  PresenceInput in;
+  in.bed_temperature = temperatura;
+  in.temperature_valid = temperatura_ok;
+  in.activity = sueno.activity();
+  in.heart_rate = sueno.heartRate();
+  in.hr_valid = t_ultimo_latido != 0 && millis() - t_ultimo_latido < OIB_SLEEP_SUBWINDOW_MS;
+  in.finger_present = max30102_ok && ultimo_ir >= OIB_CFG_FINGER_DETECTION_THRESHOLD;
+  if (presencia.update(millis(), in)) {
+    presencia_pendiente = true;
+    FramePresence f;
+    f.occupied = presencia.occupied() ? 1 : 0;
+    f.confidence = presencia.confidence();
+    f.indicators = presencia.indicators();
+    f.reserved = 0;
+    enviar_trama(FRAME_PRESENCE, &f, sizeof(f), traza_epoch_ms());
+  }
+}
+
+// Publica el último cambio de presencia; si no hay red queda pendiente
+void publicar_presencia() {
+  if (!presencia_pendiente || !client.connected()) return;
+  char buf[160];
+  snprintf(buf, sizeof(buf),
+           "{\"ocupada\":%u,\"confianza\":%u,\"indicadores\":%u,\"elev_temp\":%.2f,"
+           "\"min_en_cama\":%.1f,\"uptime\":%lu}",
+           presencia.occupied() ? 1 : 0, presencia.confidence(), presencia.indicators(),
+           presencia.temperatureElevation(), presencia.occupiedMs(millis()) / 60000.0f,
+           millis() / 1000);
+  if (client.publish(Topic("sensores/presencia"), buf, true)) presencia_pendiente = false;
+}
+
+// Costo de cada transporte de tramas (energía estimada con OIB_RADIO_TX_MW).
+// Con los tres transportes no entra en el buffer de PubSubClient: sale por
+// partes con beginPublish().
+void publicar_enlace() {
+  String json = "{\"seq\":" + String(tramas.lastSeq()) + ",\"transportes\":" +
+                String(transportes) + ",\"reconexiones\":" + String(reconexiones) +
+                ",\"sesiones_perdidas\":" + String(sesiones_perdidas) +
+                ",\"ranura_ms\":" + String(ranura.phaseMs()) +
+                ",\"ranura_atraso_max_ms\":" + String(ranura.maxDelayMs()) +
+                ",\"mqtt\":" + enlace_mqtt.json(OIB_RADIO_TX_MW);
+#if OIB_ESPNOW
+  json += ",\"espnow\":" + espnow.stats().json(OIB_RADIO_TX_MW);
+#endif
+#if OIB_BLE
+  json += ",\"ble\":" + ble.stats().json(OIB_RADIO_TX_MW);
+  json += ",\"ble_mtu\":" + String(ble.mtu()) + ",\"ble_intervalo_ms\":" + String(ble.intervalMs(), 2);
+#endif
+  json += "}";
+  if (!client.beginPublish(Topic("sistema/enlace"), json.length(), false)) return;
+  client.write((const uint8_t*)json.c_str(), json.length());
+  client.endPublish();
+}
+
+// Publica el pico de heap y la marca de agua del stack del loop
+void publicar_memoria() {
+  uint32_t heap_total = ESP.getHeapSize();
+  uint32_t heap_min_libre = ESP.getMinFreeHeap();
+  uint32_t heap_pico = heap_total - heap_min_libre;
+  uint32_t stack_total = getArduinoLoopTaskStackSize();
+  uint32_t stack_usado = stack_total - uxTaskGetStackHighWaterMark(NULL);
+
+  bool excede_heap = OIB_HEAP_PEAK_BUDGET > 0 && heap_pico > OIB_HEAP_PEAK_BUDGET;
+  bool excede_stack = OIB_LOOP_STACK_BUDGET > 0 && stack_usado > OIB_LOOP_STACK_BUDGET;
+
+  String mem_json = "{\"heap_libre\":" + String(ESP.getFreeHeap()) +
+                    ",\"heap_pico\":" + String(heap_pico) +
+                    ",\"heap_bloque_max\":" + String(ESP.getMaxAllocHeap()) +
+                    ",\"stack_loop\":" + String(stack_usado) +
+                    ",\"stack_loop_total\":" + String(stack_total) +
+                    ",\"excede_heap\":" + String(excede_heap ? 1 : 0) +
+                    ",\"excede_stack\":" + String(excede_stack ? 1 : 0) + "}";
+  client.publish(Topic("sistema/memoria"), mem_json.c_str());
+
+  if (excede_heap || excede_stack) {
+    client.publish(Topic("sensores/error"), "Presupuesto de memoria excedido (ver sistema/memoria)");
   }
 }
 
@@ -63,34 +710,39 @@ void setup() {
   Wire.begin(6, 7);  // SDA=GPIO6, SCL=GPIO7
   Wire.setClock(100000);  // 100kHz
   
-  setup_wifi();
+  cargar_transportes();
+  identidad.begin();
+  ranura.begin(identidad.id());
+  if (transportes & TRANSPORT_WIFI) setup_wifi();
+#if OIB_BLE
+  if (transportes & TRANSPORT_BLE) ble.begin(identidad.clientId());
+#endif
+  traza_iniciar(ntp_server);
   client.setServer(mqtt_server, mqtt_port);
+  client.setBufferSize(512);  // registro de época con HRV y traza
+  client.setCallback(mqtt_callback);
   
   // Conectar MQTT
-  reconnect();
-  
-  client.publish("sensores/info", "Inicializando sensores en ESP32-C3");
-  client.publish("sensores/config", "I2C: SDA=GPIO6, SCL=GPIO7, 100kHz");
+  if (transportes & TRANSPORT_WIFI) reconnect();
   
   // Inicializar HTU21D (Temperatura y Humedad)
   if (htu21d.begin()) {
     htu21d_ok = true;
-    client.publish("sensores/htu21d", "HTU21D inicializado correctamente");
   } else {
     htu21d_ok = false;
-    client.publish("sensores/error", "HTU21D no encontrado");
+    client.publish(Topic("sensores/error"), "HTU21D no encontrado");
   }
   
   // Inicializar MAX30105 (Pulso cardíaco)
   if (max30102.begin(Wire, I2C_SPEED_FAST)) { // Usar I2C_SPEED_FAST como en el ejemplo
     max30102.setup(); // Configuración por defecto como en el ejemplo
-    max30102.setPulseAmplitudeRed(0x0A); // Turn Red LED to low to indicate sensor is running
+    // El rojo queda a la misma corriente que el IR: con el LED atenuado la
+    // componente pulsátil roja se pierde en el ruido y la SpO2 sale baja
     max30102.setPulseAmplitudeGreen(0);  // Turn off Green LED
     max30102_ok = true;
-    client.publish("sensores/max30105", "MAX30105 inicializado correctamente");
   } else {
     max30102_ok = false;
-    client.publish("sensores/error", "MAX30105 no encontrado");
+    client.publish(Topic("sensores/error"), "MAX30105 no encontrado");
   }
   
   // Inicializar MMA8452Q (Acelerómetro)
@@ -98,140 +750,188 @@ void setup() {
     accel.setScale(SCALE_2G);
     accel.setDataRate(ODR_12);
     accel_ok = true;
-    client.publish("sensores/mma8452q", "MMA8452Q inicializado correctamente - Escala 2g");
   } else {
     accel_ok = false;
-    client.publish("sensores/error", "MMA8452Q no encontrado");
+    client.publish(Topic("sensores/error"), "MMA8452Q no encontrado");
   }
   
-  // Resumen de inicialización
-  String resumen = "Sensores activos: ";
-  if (htu21d_ok) resumen += "HTU21D ";
-  if (max30102_ok) resumen += "MAX30105 ";
-  if (accel_ok) resumen += "MMA8452Q ";
-  if (!htu21d_ok && !max30102_ok && !accel_ok) resumen += "NINGUNO";
-  
-  client.publish("sensores/resumen", resumen.c_str());
+  // Resumen de inicialización (retenido, una vez por arranque)
+  estado_sensores_pendiente = true;
+  publicar_estado_sensores();
+
+  if (!noche.begin()) {
+    client.publish(Topic("sensores/error"), "LittleFS no disponible: el hipnograma no se guarda");
+  }
+  sueno.begin(millis());
+  hrv.begin();
+  espectro.begin();
+  rasgos.begin();
+  spo2.begin();
+  alertas.begin();
+  captura.begin();
+#if OIB_ESPNOW
+  if (!espnow.begin(receptor_mac)) client.publish(Topic("sensores/error"), "ESP-NOW no disponible");
+#endif
 }
 
 void loop() {
-  if (!client.connected()) {
+  if ((transportes & TRANSPORT_WIFI) && !client.connected()) {
     reconnect();
   }
   client.loop();
+  verificar_sesion();
+  publicar_estado_sensores();
+
+  // Muestreo continuo y clasificación de sueño (también sin red)
+  if (max30102_ok) muestrear_ppg();
+  publicar_alertas();
+  if (accel_ok) muestrear_accel();
+  disparar_captura();
+  SleepEpoch epoca;
+  while (sueno.update(millis(), epoca)) {
+    HrvEpoch hrv_epoca;
+    hrv.closeEpoch(millis(), hrv_epoca);
+    HrvSpectrum espectro_epoca;
+    espectro.compute(espectro_epoca);
+    if (espectro_epoca.cycles > OIB_HRV_SPECTRUM_CYCLE_BUDGET) espectro_excedido++;
+
+    uint64_t ahora_epoch = traza_epoch_ms();
+    uint64_t inicio_epoch = ahora_epoch ? ahora_epoch - (millis() - epoca.start_ms) : 0;
+    EpochFeatures rasgos_epoca;
+    rasgos.closeEpoch(inicio_epoch, epoca, hrv_epoca, espectro_epoca, presencia.occupied(),
+                      rasgos_epoca);
 
-  // Leer sensores cada 2 segundos
-  static unsigned long lastMsg = 0;
+    // Las reglas quedan en rasgos_epoca.stage; el modelo, en prediccion
+    StagePrediction prediccion;
+    StageClassifier::classify(rasgos_epoca, epoca.stage, prediccion);
+#if OIB_STAGE_FROM_MODEL
+    epoca.stage = prediccion.stage;
+#endif
+    ultima_etapa = epoca.stage;
+    enviar_trama_epoca(epoca, hrv_epoca, rasgos_epoca.stage, inicio_epoch);
+    encolar_epoca(epoca, hrv_epoca, espectro_epoca, rasgos_epoca, prediccion);
+    noche.addEpoch(inicio_epoch, epoca, hrv_epoca, espectro_epoca, presencia.occupied());
+  }
+  publicar_epocas();
+  publicar_noche();
+  publicar_presencia();
+  captura.publishNext(client, Topic(TOPICO_CAPTURA));  // un trozo por loop, después de todo lo demás
+
+  // Leer sensores cada 2 segundos, en la ventana de esta pulsera
   static int contador = 0;
-  unsigned long now = millis();
   
-  if (now - lastMsg > 2000) {  // Cada 2 segundos
-    lastMsg = now;
+  if (ranura.due(millis(), traza_epoch_ms())) {
     contador++;
     
-    client.publish("sensores/contador", String(contador).c_str());
+    client.publish(Topic("sensores/contador"), String(contador).c_str());
     
-    // Enviar resumen cada 10 ciclos (cada 20 segundos)
+    // Estadísticas cada 10 ciclos (cada 20 segundos)
     if (contador % 10 == 1) {
-      String resumen = "Sensores activos: ";
-      if (htu21d_ok) resumen += "HTU21D ";
-      if (max30102_ok) resumen += "MAX30105 ";
-      if (accel_ok) resumen += "MMA8452Q ";
-      if (!htu21d_ok && !max30102_ok && !accel_ok) resumen += "NINGUNO";
-      
-      client.publish("sensores/resumen", resumen.c_str());
+      publicar_memoria();
+      client.publish(Topic("sistema/latencia"), traza_resumen_json().c_str());
+      client.publish(Topic("sistema/alertas"), alertas.summaryJson().c_str());
+      client.publish(Topic("sistema/capturas"), captura.summaryJson().c_str());
+      publicar_enlace();
+      if (espectro_excedido > 0) {
+        client.publish(Topic("sensores/error"), ("HRV LF/HF: " + String(espectro_excedido) +
+                                          " épocas sobre el presupuesto de ciclos").c_str());
+        espectro_excedido = 0;
+      }
+      if (epocas_descartadas > 0) {
+        client.publish(Topic("sensores/error"), ("Sueño: " + String(epocas_descartadas) +
+                                          " épocas descartadas sin red").c_str());
+        epocas_descartadas = 0;
+      }
+    }
+    
+    // Temperatura de la cama: la necesita la presencia aunque no se publique
+    bool htu_medido = htu21d_ok && htu21d.measure();
+    float temperatura = htu_medido ? htu21d.getTemperature() : NAN;
+    float humedad = htu_medido ? htu21d.getHumidity() : NAN;
+    bool temperatura_ok = !isnan(temperatura) && temperatura >= -40 && temperatura <= 125;
+    evaluar_presencia(temperatura, temperatura_ok);
+    enviar_tramas_periodicas(temperatura, humedad, temperatura_ok);
+#if OIB_BLE
+    ble.update();  // antes de la telemetría cruda por MQTT, que bloquea
+#endif
+    if (temperatura_ok) {
+      rasgos.addTemperature(millis(), temperatura);
+      alertas.onBedTemperature(millis(), temperatura);
+      publicar_alertas();
     }
     
+#if OIB_TELEMETRIA_CRUDA
     // ==================== LEER HTU21D ====================
     if (htu21d_ok) {
-      if (htu21d.measure()) {
-        float temperatura = htu21d.getTemperature();
-        float humedad = htu21d.getHumidity();
-        
-        if (!isnan(temperatura) && temperatura >= -40 && temperatura <= 125) {
-          client.publish("sensores/temperatura", String(temperatura, 2).c_str());
+      if (htu_medido) {
+        if (temperatura_ok) {
+          client.publish(Topic("sensores/temperatura"), String(temperatura, 2).c_str());
         } else {
-          client.publish("sensores/error", "HTU21D: temperatura invalida");
+          client.publish(Topic("sensores/error"), "HTU21D: temperatura invalida");
         }
         
         if (!isnan(humedad) && humedad >= 0 && humedad <= 100) {
-          client.publish("sensores/humedad", String(humedad, 2).c_str());
+          client.publish(Topic("sensores/humedad"), String(humedad, 2).c_str());
         } else {
-          client.publish("sensores/error", "HTU21D: humedad invalida");
+          client.publish(Topic("sensores/error"), "HTU21D: humedad invalida");
         }
       } else {
-        client.publish("sensores/error", "HTU21D: fallo en medicion");
+        client.publish(Topic("sensores/error"), "HTU21D: fallo en medicion");
       }
     }
     
     // ==================== LEER MAX30105 ====================
     if (max30102_ok) {
-      // Leer valor IR directamente (como en el ejemplo oficial)
-      long irValue = max30102.getIR();
+      // Última muestra IR del muestreo continuo (los latidos se detectan ahí)
+      long irValue = ultimo_ir;
+      TrazaBloque traza_corazon = traza_nueva(t_ultimo_ir);
       
       // Publicar valor IR
-      client.publish("sensores/ir_value", String(irValue).c_str());
-      
-      // Usar algoritmo oficial de SparkFun para detectar latidos
-      if (checkForBeat(irValue) == true) {
-        // ¡Detectamos un latido!
-        long delta = millis() - lastBeat;
-        lastBeat = millis();
-        
-        beatsPerMinute = 60 / (delta / 1000.0);
-        
-        if (beatsPerMinute < 255 && beatsPerMinute > 20) {
-          // Almacenar esta lectura en el array
-          rates[rateSpot++] = (byte)beatsPerMinute;
-          rateSpot %= RATE_SIZE; // Wrap variable
-          
-          // Calcular promedio de lecturas
-          beatAvg = 0;
-          for (byte x = 0; x < RATE_SIZE; x++)
-            beatAvg += rates[x];
-          beatAvg /= RATE_SIZE;
-        }
-      }
+      client.publish(Topic("sensores/ir_value"), String(irValue).c_str());
       
       // Estado del dedo (igual que en el ejemplo oficial)
-      String finger_status = (irValue < 50000) ? "no_detectado" : "detectado";
+      String finger_status = (irValue < OIB_CFG_FINGER_DETECTION_THRESHOLD) ? "no_detectado" : "detectado";
       
       // Publicar datos de heart rate
-      client.publish("sensores/bpm", String((int)beatsPerMinute).c_str());
-      client.publish("sensores/bpm_avg", String(beatAvg).c_str());
-      client.publish("sensores/finger_status", finger_status.c_str());
+      client.publish(Topic("sensores/bpm"), String((int)beatsPerMinute).c_str());
+      client.publish(Topic("sensores/bpm_avg"), String(beatAvg).c_str());
+      client.publish(Topic("sensores/finger_status"), finger_status.c_str());
       
       // JSON con datos del corazón
+      traza_encolar(traza_corazon);
       String heart_json = "{\"ir\":" + String(irValue) + 
                         ",\"bpm\":" + String((int)beatsPerMinute) + 
                         ",\"bpm_avg\":" + String(beatAvg) + 
-                        ",\"finger\":\"" + finger_status + "\"}";
-      client.publish("sensores/heart_data", heart_json.c_str());
+                        ",\"finger\":\"" + finger_status + "\",";
+      traza_codificar(traza_corazon);
+      heart_json += traza_json(traza_corazon) + "}";
+      traza_publicado(traza_corazon, client.publish(Topic("sensores/heart_data"), heart_json.c_str()));
     }
     
     // ==================== LEER MMA8452Q ====================
     if (accel_ok) {
-      if (accel.available()) {
-        accel.read();
+      // Última lectura del muestreo continuo, si es de este ciclo
+      if (t_ultimo_accel != 0 && millis() - t_ultimo_accel < 2000) {
+        TrazaBloque traza_accel = traza_nueva(t_ultimo_accel);
         
-        float x = accel.getCalculatedX();
-        float y = accel.getCalculatedY();
-        float z = accel.getCalculatedZ();
+        float x = accel.cx;
+        float y = accel.cy;
+        float z = accel.cz;
         
         // Verificar valores válidos
         if (x >= -4 && x <= 4) {
-          client.publish("sensores/accel_x", String(x, 3).c_str());
+          client.publish(Topic("sensores/accel_x"), String(x, 3).c_str());
         }
         if (y >= -4 && y <= 4) {
-          client.publish("sensores/accel_y", String(y, 3).c_str());
+          client.publish(Topic("sensores/accel_y"), String(y, 3).c_str());
         }
         if (z >= -4 && z <= 4) {
-          client.publish("sensores/accel_z", String(z, 3).c_str());
+          client.publish(Topic("sensores/accel_z"), String(z, 3).c_str());
         }
         
         // Calcular magnitud
         float magnitud = sqrt(x*x + y*y + z*z);
-        client.publish("sensores/accel_mag", String(magnitud, 3).c_str());
+        client.publish(Topic("sensores/accel_mag"), String(magnitud, 3).c_str());
         
         // Detectar orientación
         String orientacion = "indefinida";
@@ -239,30 +939,32 @@ void loop() {
           if (z > 0.5) orientacion = "boca_arriba";
           else if (z < -0.5) orientacion = "boca_abajo";
         }
-        client.publish("sensores/orientacion", orientacion.c_str());
+        client.publish(Topic("sensores/orientacion"), orientacion.c_str());
         
         // Detectar movimiento
-        client.publish("sensores/movimiento", (magnitud > 1.5) ? "SI" : "NO");
+        client.publish(Topic("sensores/movimiento"), (magnitud > 1.5) ? "SI" : "NO");
         
         // Datos JSON combinados
-        String accel_json = "{\"x\":" + String(x,3) + ",\"y\":" + String(y,3) + ",\"z\":" + String(z,3) + ",\"mag\":" + String(magnitud,3) + "}";
-        client.publish("sensores/accel_datos", accel_json.c_str());
+        traza_encolar(traza_accel);
+        String accel_json = "{\"x\":" + String(x,3) + ",\"y\":" + String(y,3) + ",\"z\":" + String(z,3) + ",\"mag\":" + String(magnitud,3) + ",";
+        traza_codificar(traza_accel);
+        accel_json += traza_json(traza_accel) + "}";
+        traza_publicado(traza_accel, client.publish(Topic("sensores/accel_datos"), accel_json.c_str()));
         
       } else {
-        client.publish("sensores/error", "MMA8452Q: sin nuevos datos");
+        client.publish(Topic("sensores/error"), "MMA8452Q: sin nuevos datos");
       }
     }
+#endif
     
-    // Estado del sistema
-    client.publish("sistema/wifi_ip", WiFi.localIP().toString().c_str());
-    client.publish("sistema/wifi_status", (WiFi.status() == WL_CONNECTED) ? "conectado" : "desconectado");
-    client.publish("sistema/uptime", String(millis() / 1000).c_str());
-    
-    // Estado de sensores cada 5 ciclos (cada 10 segundos)
-    if (contador % 5 == 0) {
-      client.publish("sensores/estado_htu21d", htu21d_ok ? "OK" : "ERROR");
-      client.publish("sensores/estado_max30105", max30102_ok ? "OK" : "ERROR");
-      client.publish("sensores/estado_mma8452q", accel_ok ? "OK" : "ERROR");
-  }
+    // Conectado/desconectado y sensores quedan retenidos en sistema/estado y
+    // sistema/sensores (last will); acá sólo lo que cambia
+    client.publish(Topic("sistema/uptime"), String(millis() / 1000).c_str());
   }
+
+#if OIB_BLE
+  // Las tramas de esta vuelta salen juntas en una notificación
+  ble.update();
+  aplicar_transportes(ble.takeTransportRequest());
+#endif
 }
\ No newline at end of file
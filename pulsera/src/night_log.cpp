@@ -0,0 +1,184 @@
+#include "night_log.h"
+
+#include <LittleFS.h>
+
+static const char* NOCHE_ACTUAL = "/noche.bin";
+static const char* NOCHE_ANTERIOR = "/noche_1.bin";
+static const uint8_t VERSION = 1;
+static const uint8_t BYTES_REGISTRO = 4;
+static const uint16_t TRAMO = 256;  // bytes por lectura al publicar
+
+static uint32_t saturar(float v, uint32_t max) {
+  if (!(v > 0.0f)) return 0;
+  return v >= max ? max : (uint32_t)lroundf(v);
+}
+
+uint32_t NightLog::pack(const SleepEpoch& epoca, const HrvEpoch& hrv, const HrvSpectrum& espectro,
+                        bool en_cama) {
+  uint32_t banderas = NIGHT_FLAG_VALID;
+  if (en_cama) banderas |= NIGHT_FLAG_IN_BED;
+  if (epoca.beats > 0) banderas |= NIGHT_FLAG_HR_OK;
+  if (espectro.valid) banderas |= NIGHT_FLAG_PSD_OK;
+
+  uint32_t hr = epoca.beats > 0 ? constrain(lroundf(epoca.hr) - 30, 1L, 127L) : 0;
+  return (uint32_t)(epoca.stage & 0x03) | banderas << 2 | hr << 6 |
+         saturar(hrv.rmssd, 127) << 13 | min<uint32_t>(epoca.movements, 63) << 20 |
+         saturar(espectro.lf_hf * 8.0f, 63) << 26;
+}
+
+bool NightLog::begin() {
+  *this = NightLog();
+  montado = LittleFS.begin(true);
+  if (!montado) return false;
+
+  // Noche abierta antes de un reinicio: se sigue escribiendo en ella si la
+  // próxima época cae dentro de la hora siguiente (ver addEpoch)
+  File f = LittleFS.open(NOCHE_ACTUAL, "r");
+  if (f) {
+    NightFileHeader cab;
+    if (f.read((uint8_t*)&cab, sizeof(cab)) == sizeof(cab) && memcmp(cab.magic, "OIBN", 4) == 0) {
+      abierta = recuperada = true;
+      inicio_epoch_ms = cab.start_epoch_ms;
+      registros = (f.size() - sizeof(cab)) / BYTES_REGISTRO;
+    }
+    f.close();
+    if (!abierta) LittleFS.remove(NOCHE_ACTUAL);
+  }
+  return true;
+}
+
+bool NightLog::openNight(uint64_t start_epoch_ms) {
+  if (LittleFS.exists(NOCHE_ACTUAL)) closeNight();
+  File f = LittleFS.open(NOCHE_ACTUAL, "w");
+  if (!f) return false;
+  NightFileHeader cab;
+  memcpy(cab.magic, "OIBN", 4);
+  cab.version = VERSION;
+  cab.record_bytes = BYTES_REGISTRO;
+  cab.epoch_s = OIB_SLEEP_EPOCH_MS / 1000;
+  cab.start_epoch_ms = start_epoch_ms;
+  f.write((const uint8_t*)&cab, sizeof(cab));
+  f.close();
+
+  abierta = true;
+  recuperada = false;
+  inicio_epoch_ms = start_epoch_ms;
+  registros = 0;
+  vacias = 0;
+  return true;
+}
+
+void NightLog::closeNight() {
+  LittleFS.remove(NOCHE_ANTERIOR);
+  LittleFS.rename(NOCHE_ACTUAL, NOCHE_ANTERIOR);
+  abierta = recuperada = false;
+  registros = vacias = 0;
+  cerrada_pendiente = true;
+}
+
+bool NightLog::appendRecord(uint32_t registro) {
+  File f = LittleFS.open(NOCHE_ACTUAL, "a");
+  if (!f) return false;
+  uint8_t bytes[BYTES_REGISTRO] = {(uint8_t)registro, (uint8_t)(registro >> 8),
+                                   (uint8_t)(registro >> 16), (uint8_t)(registro >> 24)};
+  bool ok = f.write(bytes, sizeof(bytes)) == sizeof(bytes);
+  f.close();
+  if (ok) registros++;
+  return ok;
+}
+
+void NightLog::addEpoch(uint64_t start_epoch_ms, const SleepEpoch& epoca, const HrvEpoch& hrv,
+                        const HrvSpectrum& espectro, bool en_cama) {
+  if (!montado) return;
+
+  if (abierta && recuperada) {
+    // Primera época después de un reinicio: ubicarla por la hora de pared
+    recuperada = false;
+    bool seguir = false;
+    if (start_epoch_ms && inicio_epoch_ms && start_epoch_ms >= inicio_epoch_ms) {
+      uint32_t indice = (start_epoch_ms - inicio_epoch_ms) / OIB_SLEEP_EPOCH_MS;
+      if (indice >= registros && indice - registros <= CLOSE_AFTER_EMPTY &&
+          indice < MAX_EPOCHS) {
+        while (registros < indice && appendRecord(0)) {}
+        seguir = true;
+      }
+    }
+    if (!seguir) closeNight();
+  }
+
+  if (!abierta) {
+    if (!en_cama || !openNight(start_epoch_ms)) return;
+  }
+
+  if (!en_cama) {
+    // No se escribe hasta saber si vuelve a la cama
+    if (++vacias >= CLOSE_AFTER_EMPTY) closeNight();
+    return;
+  }
+  SleepEpoch fuera = {};
+  fuera.stage = SLEEP_WAKE;
+  HrvEpoch sin_hrv = {};
+  HrvSpectrum sin_psd = {};
+  for (; vacias > 0; vacias--) appendRecord(pack(fuera, sin_hrv, sin_psd, false));
+
+  appendRecord(pack(epoca, hrv, espectro, true));
+  if (registros >= MAX_EPOCHS) closeNight();
+}
+
+bool NightLog::summarize(File& f, NightSummary& out) {
+  memset(&out, 0, sizeof(out));
+  out.sleep_onset = 0xFFFF;
+  f.seek(sizeof(NightFileHeader));
+  uint8_t bytes[BYTES_REGISTRO];
+  bool dormido_antes = false;
+  while (f.read(bytes, sizeof(bytes)) == sizeof(bytes)) {
+    uint32_t r = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    uint8_t banderas = (r >> 2) & 0x0F;
+    uint8_t estado = r & 0x03;
+    uint16_t i = out.epochs++;
+    if (!(banderas & NIGHT_FLAG_VALID) || !(banderas & NIGHT_FLAG_IN_BED)) continue;
+
+    out.in_bed++;
+    out.per_stage[estado]++;
+    bool dormido = estado != SLEEP_WAKE;
+    if (dormido && out.sleep_onset == 0xFFFF) out.sleep_onset = i;
+    if (dormido_antes && !dormido) out.awakenings++;
+    dormido_antes = dormido;
+  }
+  return true;
+}
+
+bool NightLog::publish(PubSubClient& client, const char* topic, bool previous, bool retained) {
+  if (!montado) return false;
+  const char* ruta = previous || !LittleFS.exists(NOCHE_ACTUAL) ? NOCHE_ANTERIOR : NOCHE_ACTUAL;
+  File f = LittleFS.open(ruta, "r");
+  if (!f) return false;
+
+  NightFileHeader cab;
+  NightSummary resumen;
+  if (f.read((uint8_t*)&cab, sizeof(cab)) != sizeof(cab) || !summarize(f, resumen)) {
+    f.close();
+    return false;
+  }
+  uint32_t largo_registros = (uint32_t)resumen.epochs * BYTES_REGISTRO;
+  uint32_t largo = sizeof(cab) + sizeof(resumen) + largo_registros;
+
+  // Más grande que el buffer del cliente: se transmite por partes
+  if (!client.beginPublish(topic, largo, retained)) {
+    f.close();
+    return false;
+  }
+  bool ok = client.write((const uint8_t*)&cab, sizeof(cab)) == sizeof(cab);
+  ok = ok && client.write((const uint8_t*)&resumen, sizeof(resumen)) == sizeof(resumen);
+  f.seek(sizeof(cab));
+  uint8_t tramo[TRAMO];
+  for (uint32_t enviados = 0; ok && enviados < largo_registros;) {
+    size_t n = f.read(tramo, min<uint32_t>(TRAMO, largo_registros - enviados));
+    ok = n > 0 && client.write(tramo, n) == n;
+    enviados += n;
+  }
+  f.close();
+  ok = client.endPublish() && ok;
+  if (ok && ruta == NOCHE_ANTERIOR) cerrada_pendiente = false;
+  return ok;
+}
@@ -0,0 +1,45 @@
+#include "publish_slot.h"
+
+uint32_t PublishSlot::phaseFor(const char* id, uint32_t periodo_ms) {
+  uint32_t h = 2166136261u;
+  for (const char* c = id; *c; c++) {
+    h ^= (uint8_t)*c;
+    h *= 16777619u;
+  }
+  return h % periodo_ms;
+}
+
+void PublishSlot::begin(const char* id, uint32_t periodo_ms) {
+  periodo = periodo_ms;
+  fase = OIB_PUBLISH_SLOTS ? phaseFor(id, periodo_ms) : 0;
+  iniciado = false;
+  atraso_max = 0;
+}
+
+bool PublishSlot::due(uint32_t now_ms, uint64_t epoch_ms) {
+  if (!OIB_PUBLISH_SLOTS) {
+    if (now_ms - ultimo_ms <= periodo) return false;
+    ultimo_ms = now_ms;
+    return true;
+  }
+
+  bool hora = epoch_ms != 0;
+  uint64_t t = hora ? epoch_ms : now_ms;
+  if (t < fase) return false;
+  uint64_t ranura = (t - fase) / periodo;
+
+  // Al sincronizar cambia la base: se espera la primera ventana sobre la
+  // hora de pared. Un ajuste de SNTP hacia atrás no repite ventanas.
+  if (!iniciado || hora != con_hora || ranura < ultima_ranura) {
+    iniciado = true;
+    con_hora = hora;
+    ultima_ranura = ranura;
+    return false;
+  }
+  if (ranura == ultima_ranura) return false;
+
+  ultima_ranura = ranura;
+  uint32_t atraso = (t - fase) % periodo;
+  if (atraso > atraso_max) atraso_max = atraso;
+  return true;
+}
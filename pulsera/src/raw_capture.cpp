@@ -0,0 +1,244 @@
+#include "raw_capture.h"
+
+static const uint8_t VARINT_MAX = 5;       // int32 en zigzag
+static const int32_t CAIDA_LIBRE2 = 410L * 410L;    // < 0,4 g (1 g = 1024 cuentas)
+static const int32_t IMPACTO2 = 1843L * 1843L;      // > 1,8 g (la escala satura en 2 g)
+static const uint8_t IMPACTO_MUESTRAS = 13;         // ~1 s a 12,5 Hz
+
+static uint8_t escribir_varint(uint8_t* out, int32_t v) {
+  uint32_t z = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);  // zigzag
+  uint8_t n = 0;
+  while (z >= 0x80) {
+    out[n++] = (uint8_t)(z | 0x80);
+    z >>= 7;
+  }
+  out[n++] = (uint8_t)z;
+  return n;
+}
+
+uint16_t RawCapture::Flujo::agregar() {
+  uint16_t pos;
+  if (cuenta == capacidad) {
+    pos = inicio;
+    inicio = (inicio + 1) % capacidad;
+  } else {
+    pos = (inicio + cuenta) % capacidad;
+    cuenta++;
+  }
+  total++;
+  return pos;
+}
+
+void RawCapture::Flujo::congelar() {
+  desde = inicio;
+  largo = cuenta;
+  uint32_t despues = total - total_disparo;
+  disparo = despues < largo ? largo - despues : 0;
+  enviadas = 0;
+}
+
+void RawCapture::begin() {
+  // Sin *this = RawCapture(): el temporal de ~11 KB no entra en el stack
+  f_ppg = Flujo();
+  f_acc = Flujo();
+  f_ppg.capacidad = PPG_CAPACIDAD;
+  f_acc.capacidad = ACCEL_CAPACIDAD;
+  reset();
+  seq = 0;
+  desde_caida_libre = 0xFF;
+  capturas = descartadas = trozos = 0;
+  bytes_crudos = bytes_enviados = 0;
+  ciclos_trozo_max = subida_ms_max = 0;
+}
+
+void RawCapture::reset() {
+  f_ppg.inicio = f_ppg.cuenta = 0;
+  f_acc.inicio = f_acc.cuenta = 0;
+  f_ppg.total = f_acc.total = 0;
+  estado = GRABANDO;
+  disparos = 0;
+  buffer_largo = 0;
+}
+
+void RawCapture::addPpgSample(uint32_t ir, uint32_t red) {
+  if (estado == SUBIENDO) return;
+  uint8_t* m = ppg[f_ppg.agregar()];
+  m[0] = ir;
+  m[1] = ir >> 8;
+  m[2] = ir >> 16;
+  m[3] = red;
+  m[4] = red >> 8;
+  m[5] = red >> 16;
+}
+
+bool RawCapture::addAccelSample(int16_t x, int16_t y, int16_t z) {
+  int32_t m2 = (int32_t)x * x + (int32_t)y * y + (int32_t)z * z;
+  bool caida = false;
+  if (m2 < CAIDA_LIBRE2) {
+    desde_caida_libre = 0;
+  } else if (desde_caida_libre != 0xFF) {
+    if (m2 > IMPACTO2) {
+      caida = true;
+      desde_caida_libre = 0xFF;
+    } else if (++desde_caida_libre > IMPACTO_MUESTRAS) {
+      desde_caida_libre = 0xFF;
+    }
+  }
+
+  if (estado != SUBIENDO) {
+    int16_t* a = acc[f_acc.agregar()];
+    a[0] = x;
+    a[1] = y;
+    a[2] = z;
+  }
+  return caida;
+}
+
+void RawCapture::trigger(uint8_t triggers, uint64_t epoch_ms) {
+  triggers &= OIB_CAPTURE_TRIGGERS;
+  if (!triggers) return;
+  switch (estado) {
+    case GRABANDO:
+      estado = POST_EVENTO;
+      disparos = triggers;
+      t_disparo = millis();
+      epoch_disparo = epoch_ms;
+      f_ppg.total_disparo = f_ppg.total;
+      f_acc.total_disparo = f_acc.total;
+      break;
+    case POST_EVENTO:
+      disparos |= triggers;
+      break;
+    case SUBIENDO:
+      descartadas++;
+      break;
+  }
+}
+
+void RawCapture::update(uint32_t now_ms) {
+  if (estado == POST_EVENTO && now_ms - t_disparo >= OIB_CAPTURE_POST_S * 1000UL) freeze();
+}
+
+void RawCapture::freeze() {
+  f_ppg.congelar();
+  f_acc.congelar();
+  estado = SUBIENDO;
+  seq++;
+  trozo = 0;
+  buffer_largo = 0;
+  t_congelada = millis();
+  capturas++;
+  bytes_crudos += f_ppg.largo * sizeof(ppg[0]) + f_acc.largo * sizeof(acc[0]);
+}
+
+uint16_t RawCapture::encode(uint8_t flujo, uint8_t* out, uint16_t capacidad, uint16_t& muestras) {
+  Flujo& f = flujo == CAPTURE_STREAM_PPG ? f_ppg : f_acc;
+  uint8_t canales = flujo == CAPTURE_STREAM_PPG ? 2 : 3;
+  int32_t p1[3] = {0, 0, 0};
+  int32_t p2[3] = {0, 0, 0};
+  uint16_t largo = 0;
+  muestras = 0;
+
+  // Predictor por canal, reiniciado en cada trozo: x, x - x1, x - 2·x1 + x2
+  while (f.enviadas + muestras < f.largo && largo + canales * VARINT_MAX <= capacidad) {
+    uint16_t pos = f.posicion(f.enviadas + muestras);
+    int32_t v[3];
+    if (flujo == CAPTURE_STREAM_PPG) {
+      const uint8_t* m = ppg[pos];
+      v[0] = m[0] | (m[1] << 8) | ((int32_t)m[2] << 16);
+      v[1] = m[3] | (m[4] << 8) | ((int32_t)m[5] << 16);
+    } else {
+      v[0] = acc[pos][0];
+      v[1] = acc[pos][1];
+      v[2] = acc[pos][2];
+    }
+    for (uint8_t c = 0; c < canales; c++) {
+      int32_t residuo = v[c];
+      if (muestras == 1) residuo -= p1[c];
+      if (muestras >= 2) residuo -= 2 * p1[c] - p2[c];
+      largo += escribir_varint(out + largo, residuo);
+      p2[c] = p1[c];
+      p1[c] = v[c];
+    }
+    muestras++;
+  }
+  return largo;
+}
+
+bool RawCapture::publishNext(PubSubClient& client, const char* topic) {
+  if (estado != SUBIENDO || !client.connected()) return false;
+
+  if (buffer_largo == 0) {
+    uint8_t flujo;
+    if (f_ppg.enviadas < f_ppg.largo) {
+      flujo = CAPTURE_STREAM_PPG;
+    } else if (f_acc.enviadas < f_acc.largo) {
+      flujo = CAPTURE_STREAM_ACCEL;
+    } else {
+      reset();  // captura vacía (sin sensores)
+      return false;
+    }
+    Flujo& f = flujo == CAPTURE_STREAM_PPG ? f_ppg : f_acc;
+
+    uint32_t ciclos_inicio = ESP.getCycleCount();
+    uint16_t muestras;
+    uint16_t datos = encode(flujo, buffer + sizeof(CaptureChunkHeader), OIB_CAPTURE_CHUNK_BYTES,
+                            muestras);
+    uint32_t ciclos = ESP.getCycleCount() - ciclos_inicio;
+    if (ciclos > ciclos_trozo_max) ciclos_trozo_max = ciclos;
+
+    CaptureChunkHeader cab;
+    cab.magic[0] = 'R';
+    cab.magic[1] = 'C';
+    cab.version = OIB_CAPTURE_VERSION;
+    cab.triggers = disparos;
+    cab.seq = seq;
+    cab.chunk = trozo;
+    cab.stream = flujo;
+    bool ultimo = f.enviadas + muestras >= f.largo &&
+                  (flujo == CAPTURE_STREAM_ACCEL || f_acc.largo == 0);
+    cab.flags = ultimo ? CAPTURE_CHUNK_LAST : 0;
+    cab.first = f.enviadas;
+    cab.samples = muestras;
+    cab.total = f.largo;
+    cab.trigger_index = f.disparo;
+    cab.period_us = (flujo == CAPTURE_STREAM_PPG ? PPG_PERIODO_MS : ACCEL_PERIODO_MS) * 1000UL;
+    cab.trigger_epoch_ms = epoch_disparo;
+    memcpy(buffer, &cab, sizeof(cab));
+    buffer_largo = sizeof(cab) + datos;
+    buffer_muestras = muestras;
+  }
+
+  if (!client.beginPublish(topic, buffer_largo, false)) return false;
+  bool ok = client.write(buffer, buffer_largo) == buffer_largo;
+  ok = client.endPublish() && ok;
+  if (!ok) return false;
+
+  const CaptureChunkHeader* cab = (const CaptureChunkHeader*)buffer;
+  Flujo& f = cab->stream == CAPTURE_STREAM_PPG ? f_ppg : f_acc;
+  f.enviadas += buffer_muestras;
+  bytes_enviados += buffer_largo;
+  trozos++;
+  trozo++;
+  bool ultimo = cab->flags & CAPTURE_CHUNK_LAST;
+  buffer_largo = 0;
+  if (ultimo) {
+    uint32_t subida = millis() - t_congelada;
+    if (subida > subida_ms_max) subida_ms_max = subida;
+    reset();
+  }
+  return true;
+}
+
+String RawCapture::summaryJson() const {
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "{\"capturas\":%lu,\"descartadas\":%lu,\"estado\":%u,\"trozos\":%lu,"
+           "\"bytes_crudos\":%lu,\"bytes_enviados\":%lu,\"ram\":%u,\"ciclos_trozo_max\":%lu,"
+           "\"subida_ms_max\":%lu}",
+           (unsigned long)capturas, (unsigned long)descartadas, (unsigned)estado,
+           (unsigned long)trozos, (unsigned long)bytes_crudos, (unsigned long)bytes_enviados,
+           (unsigned)sizeof(RawCapture), (unsigned long)ciclos_trozo_max,
+           (unsigned long)subida_ms_max);
+  return String(buf);
+}
@@ -0,0 +1,136 @@
+#include "sleep_staging.h"
+
+// BPM por debajo del cual "quieto con HR moderada" es sueño ligero (literal
+// en detect_sleep_state del gateway)
+static const float HR_LIGERO_QUIETO = 65.0f;
+
+void SleepStager::begin(uint32_t now_ms) {
+  *this = SleepStager();
+  ventana_inicio = now_ms;
+  epoca_inicio = now_ms;
+}
+
+void SleepStager::addAccelSample(uint32_t t_ms, int16_t x, int16_t y, int16_t z) {
+  if (tiene_muestra) {
+    float diff = fabsf(((x - ultimo[0]) + (y - ultimo[1]) + (z - ultimo[2])) / 3.0f);
+    if (diff > OIB_CFG_ACCELEROMETER_ACTIVITY_THRESHOLD) {
+      movimientos_epoca++;
+      if (!pico_en_ventana) {
+        pico_en_ventana = true;
+        t_pico_ventana = t_ms;
+      }
+    }
+
+    // Decaimiento continuo (depende de dt, no de la frecuencia de muestreo)
+    float dt = (float)(t_ms - ultima_muestra_ms);
+    if ((!hubo_pico || (float)(t_ms - last_spike_ms) > OIB_CFG_ACTIVITY_DECAY_DELAY) &&
+        activity_ > OIB_CFG_ACTIVITY_LOWER_BOUND) {
+      activity_ += -activity_ / OIB_CFG_ACTIVITY_DECAY_CONSTANT * dt;
+    }
+    if (activity_ < OIB_CFG_ACTIVITY_LOWER_BOUND) activity_ = 0.0f;
+  }
+
+  ultimo[0] = x;
+  ultimo[1] = y;
+  ultimo[2] = z;
+  ultima_muestra_ms = t_ms;
+  tiene_muestra = true;
+}
+
+void SleepStager::addBeat(uint32_t t_ms, float bpm) {
+  (void)t_ms;
+  suma_bpm_ventana += bpm;
+  latidos_ventana++;
+}
+
+SleepStage SleepStager::classify(float activity, float heart_rate) {
+  // Clasificación por actividad (ACTIVITY_THRESHOLD_REM < DEEP_SLEEP en la
+  // configuración actual, así que "REM o ligero" sólo aparece si se invierten)
+  enum { ACT_DEEP, ACT_REM_O_LIGERO, ACT_LIGERO, ACT_WAKE } estado_act;
+  if (activity < OIB_CFG_ACTIVITY_THRESHOLD_DEEP_SLEEP) {
+    estado_act = ACT_DEEP;
+  } else if (activity < OIB_CFG_ACTIVITY_THRESHOLD_REM) {
+    estado_act = ACT_REM_O_LIGERO;
+  } else if (activity < OIB_CFG_ACTIVITY_THRESHOLD_WAKE) {
+    estado_act = ACT_LIGERO;
+  } else {
+    estado_act = ACT_WAKE;
+  }
+
+  // Clasificación por frecuencia cardíaca
+  SleepStage estado_hr;
+  if (heart_rate < OIB_CFG_HR_THRESHOLD_DEEP_SLEEP) {
+    estado_hr = SLEEP_DEEP;
+  } else if (heart_rate < OIB_CFG_HR_THRESHOLD_WAKE) {
+    estado_hr = SLEEP_LIGHT;
+  } else {
+    estado_hr = SLEEP_WAKE;
+  }
+
+  // Lógica combinada (mismo orden que el gateway)
+  if (estado_act == ACT_DEEP && estado_hr == SLEEP_DEEP) return SLEEP_DEEP;
+  if (estado_act == ACT_REM_O_LIGERO) {
+    if (heart_rate >= OIB_CFG_HR_THRESHOLD_REM && activity < OIB_CFG_ACTIVITY_THRESHOLD_REM) {
+      return SLEEP_REM;
+    }
+    return heart_rate < HR_LIGERO_QUIETO ? SLEEP_LIGHT : SLEEP_WAKE;
+  }
+  if (estado_act == ACT_LIGERO) return estado_hr == SLEEP_WAKE ? SLEEP_WAKE : SLEEP_LIGHT;
+  // Actividad de sueño profundo con HR no profunda cae en la rama final del
+  // gateway (WAKE); se conserva para que ambos clasifiquen igual
+  return SLEEP_WAKE;
+}
+
+void SleepStager::closeSubwindow(uint32_t end_ms) {
+  // Como mucho un pico por sub-ventana, igual que con instantáneas de 2 s
+  if (pico_en_ventana) {
+    activity_ += (1.0f - activity_) * OIB_CFG_ACTIVITY_SPIKE_STRENGTH;
+    last_spike_ms = t_pico_ventana;
+    hubo_pico = true;
+  }
+  pico_en_ventana = false;
+
+  if (latidos_ventana > 0) hr_actual = suma_bpm_ventana / latidos_ventana;
+  suma_bpm_epoca += suma_bpm_ventana;
+  latidos_epoca += latidos_ventana;
+  suma_bpm_ventana = 0.0f;
+  latidos_ventana = 0;
+
+  votos[classify(activity_, hr_actual)]++;
+  suma_actividad += activity_;
+  ventanas++;
+  ventana_inicio = end_ms;
+}
+
+bool SleepStager::update(uint32_t now_ms, SleepEpoch& out) {
+  while (now_ms - ventana_inicio >= OIB_SLEEP_SUBWINDOW_MS) {
+    closeSubwindow(ventana_inicio + OIB_SLEEP_SUBWINDOW_MS);
+
+    if (ventana_inicio - epoca_inicio >= OIB_SLEEP_EPOCH_MS) {
+      // Empates: gana el estado más despierto (menor índice)
+      uint8_t ganador = 0;
+      for (uint8_t s = 1; s < 4; s++) {
+        if (votos[s] > votos[ganador]) ganador = s;
+      }
+
+      out.index = epoca_indice++;
+      out.start_ms = epoca_inicio;
+      out.stage = ganador;
+      out.votes = votos[ganador];
+      out.beats = latidos_epoca;
+      out.movements = movimientos_epoca;
+      out.activity = suma_actividad / ventanas;
+      out.hr = latidos_epoca ? suma_bpm_epoca / latidos_epoca : 0.0f;
+
+      epoca_inicio = ventana_inicio;
+      memset(votos, 0, sizeof(votos));
+      ventanas = 0;
+      suma_actividad = 0.0f;
+      suma_bpm_epoca = 0.0f;
+      latidos_epoca = 0;
+      movimientos_epoca = 0;
+      return true;
+    }
+  }
+  return false;
+}
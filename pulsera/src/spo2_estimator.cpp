@@ -0,0 +1,66 @@
+#include "spo2_estimator.h"
+
+static const uint16_t MUESTRAS_MIN = 30;      // 300 ms: latido incompleto
+static const float PERFUSION_MIN = 0.0002f;   // AC eficaz / DC del IR
+static const float PERFUSION_MAX = 0.01f;     // más es movimiento
+static const float R_MIN = 0.2f;
+static const float R_MAX = 2.0f;
+
+void Spo2Estimator::Canal::agregar(uint32_t x, uint16_t i) {
+  if (i == 0) {
+    referencia = x;
+    suma = suma2 = suma_id = 0;
+  }
+  int64_t d = (int64_t)x - referencia;
+  suma += d;
+  suma2 += d * d;
+  suma_id += (int64_t)i * d;
+}
+
+bool Spo2Estimator::Canal::medir(uint16_t n, float& ac, float& dc) const {
+  // Regresión de d sobre i = 0..n-1; el residuo es la parte pulsátil
+  double nn = n;
+  double si = nn * (nn - 1) / 2.0;
+  double sii = (nn - 1) * nn * (2 * nn - 1) / 6.0;
+  double var_i = sii - si * si / nn;
+  double cov = suma_id - si * (double)suma / nn;
+  double residuo = suma2 - (double)suma * suma / nn - cov * cov / var_i;
+  dc = referencia + (float)(suma / nn);
+  if (residuo <= 0.0 || dc <= 0.0f) return false;
+  ac = (float)sqrt(residuo / nn);
+  return true;
+}
+
+void Spo2Estimator::begin() {
+  *this = Spo2Estimator();
+}
+
+void Spo2Estimator::reset() {
+  muestras = 0;
+}
+
+void Spo2Estimator::addSample(uint32_t ir, uint32_t red) {
+  ir_.agregar(ir, muestras);
+  red_.agregar(red, muestras);
+  if (muestras < UINT16_MAX) muestras++;
+}
+
+float Spo2Estimator::closeBeat() {
+  float ac_ir, dc_ir, ac_red, dc_red;
+  if (muestras >= MUESTRAS_MIN && ir_.medir(muestras, ac_ir, dc_ir) &&
+      red_.medir(muestras, ac_red, dc_red)) {
+    float perf_ir = ac_ir / dc_ir;
+    float r = (ac_red / dc_red) / perf_ir;
+    if (perf_ir >= PERFUSION_MIN && perf_ir <= PERFUSION_MAX && r >= R_MIN && r <= R_MAX) {
+      ultimas[ultimas_pos] = constrain(104.0f - 17.0f * r, 0.0f, 100.0f);
+      ultimas_pos = (ultimas_pos + 1) % PROMEDIO;
+      if (ultimas_n < PROMEDIO) ultimas_n++;
+    }
+  }
+  muestras = 0;
+
+  if (ultimas_n < PROMEDIO) return NAN;
+  float suma = 0.0f;
+  for (uint8_t i = 0; i < PROMEDIO; i++) suma += ultimas[i];
+  return suma / PROMEDIO;
+}
@@ -0,0 +1,139 @@
+#include "stage_classifier.h"
+
+#if __has_include("stage_model_tables.h")
+#include "stage_model_tables.h"
+#define OIB_STAGE_MODEL 1
+#else
+#define OIB_STAGE_MODEL 0
+#endif
+
+#if OIB_STAGE_MODEL
+
+static const int32_t Z_MAX = 4 * 256;  // ±4σ en Q8
+static const int32_t DIF_MAX = 1 << 14;  // antes de multiplicar (escala·2^exp ≥ 256)
+
+// x·2^exp truncado hacia cero, a partir de los bits IEEE-754 (sin soft-float).
+// false si x es NaN o infinito (campo sin dato).
+static bool a_fijo(float x, int8_t exp, int32_t& out) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  int32_t e = (bits >> 23) & 0xFF;
+  if (e == 0xFF) return false;
+  if (e == 0) {  // cero o subnormal
+    out = 0;
+    return true;
+  }
+  uint32_t mantisa = (bits & 0x7FFFFF) | 0x800000;  // valor = mantisa·2^(e-150)
+  int32_t corrimiento = e - 150 + exp;
+  int32_t v;
+  if (corrimiento >= 8) {
+    v = INT32_MAX;
+  } else if (corrimiento >= 0) {
+    v = (int32_t)(mantisa << corrimiento);
+  } else if (corrimiento > -24) {
+    v = (int32_t)(mantisa >> -corrimiento);
+  } else {
+    v = 0;
+  }
+  out = (bits & 0x80000000u) ? -v : v;
+  return true;
+}
+
+static int32_t entero_a_fijo(int32_t v, int8_t exp) {
+  return exp >= 0 ? v << exp : v >> -exp;
+}
+
+static bool leer_entrada(const EpochFeatures& r, StageInput entrada, int8_t exp, int32_t& out) {
+  switch (entrada) {
+    case STAGE_INPUT_HR_MEAN: return a_fijo(r.hr_mean, exp, out);
+    case STAGE_INPUT_HR_STD: return a_fijo(r.hr_std, exp, out);
+    case STAGE_INPUT_RMSSD: return a_fijo(r.rmssd, exp, out);
+    case STAGE_INPUT_SDNN: return a_fijo(r.sdnn, exp, out);
+    case STAGE_INPUT_PNN50: return a_fijo(r.pnn50, exp, out);
+    case STAGE_INPUT_LF: return a_fijo(r.lf, exp, out);
+    case STAGE_INPUT_HF: return a_fijo(r.hf, exp, out);
+    case STAGE_INPUT_LF_HF: return a_fijo(r.lf_hf, exp, out);
+    case STAGE_INPUT_ACTIVITY: return a_fijo(r.activity, exp, out);
+    case STAGE_INPUT_SPO2_MIN: return a_fijo(r.spo2_min, exp, out);
+    case STAGE_INPUT_SPO2_MEAN: return a_fijo(r.spo2_mean, exp, out);
+    case STAGE_INPUT_TEMP_MEAN: return a_fijo(r.temp_mean, exp, out);
+    case STAGE_INPUT_TEMP_SLOPE: return a_fijo(r.temp_slope, exp, out);
+    case STAGE_INPUT_RESP_RATE: return a_fijo(r.resp_rate, exp, out);
+    case STAGE_INPUT_BEATS: out = entero_a_fijo(r.beats, exp); return true;
+    case STAGE_INPUT_ARTIFACTS: out = entero_a_fijo(r.artifacts, exp); return true;
+    case STAGE_INPUT_MOVEMENTS: out = entero_a_fijo(r.movements, exp); return true;
+    case STAGE_INPUT_POSTURE_CHANGES: out = entero_a_fijo(r.posture_changes, exp); return true;
+    case STAGE_INPUT_IN_BED:
+      out = entero_a_fijo((r.flags & FEATURE_FLAG_IN_BED) ? 1 : 0, exp);
+      return true;
+  }
+  return false;
+}
+
+bool StageClassifier::available() {
+  return true;
+}
+
+uint32_t StageClassifier::modelId() {
+  return stage_model::ID;
+}
+
+void StageClassifier::classify(const EpochFeatures& in, uint8_t rules_stage, StagePrediction& out) {
+  uint32_t ciclos_inicio = ESP.getCycleCount();
+  using namespace stage_model;
+
+  // Entradas normalizadas a Q8; sin dato queda en el centro (z = 0)
+  int32_t z[ENTRADAS];
+  out.missing = 0;
+  for (uint8_t i = 0; i < ENTRADAS; i++) {
+    int32_t crudo;
+    if (!leer_entrada(in, RASGO[i], EXP[i], crudo)) {
+      z[i] = 0;
+      out.missing++;
+      continue;
+    }
+    int32_t dif = constrain(crudo - CENTRO[i], -DIF_MAX, DIF_MAX);
+    z[i] = constrain((int32_t)(((int64_t)dif * MULT[i]) >> 16), -Z_MAX, Z_MAX);
+  }
+
+  int32_t mejor = INT32_MIN, segundo = INT32_MIN;
+  uint8_t ganadora = 0;
+  for (uint8_t c = 0; c < CLASES; c++) {
+    int32_t logit = SESGO[c];
+    for (uint8_t i = 0; i < ENTRADAS; i++) logit += PESO[c][i] * z[i];
+    if (logit > mejor) {
+      segundo = mejor;
+      mejor = logit;
+      ganadora = c;
+    } else if (logit > segundo) {
+      segundo = logit;
+    }
+  }
+
+  (void)rules_stage;
+  out.stage = CLASE[ganadora];
+  out.from_model = true;
+  out.margin = mejor - segundo;
+  out.cycles = ESP.getCycleCount() - ciclos_inicio;
+}
+
+#else
+
+bool StageClassifier::available() {
+  return false;
+}
+
+uint32_t StageClassifier::modelId() {
+  return 0;
+}
+
+void StageClassifier::classify(const EpochFeatures& in, uint8_t rules_stage, StagePrediction& out) {
+  (void)in;
+  out.stage = rules_stage;
+  out.from_model = false;
+  out.margin = 0;
+  out.missing = 0;
+  out.cycles = 0;
+}
+
+#endif
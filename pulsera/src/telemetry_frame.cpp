@@ -0,0 +1,68 @@
+#include "telemetry_frame.h"
+
+uint8_t transportFromText(const char* text) {
+  if (strcmp(text, "wifi") == 0) return TRANSPORT_WIFI;
+  if (strcmp(text, "ble") == 0) return TRANSPORT_BLE;
+  if (strcmp(text, "ambos") == 0) return TRANSPORT_WIFI | TRANSPORT_BLE;
+  return 0;
+}
+
+uint8_t FrameEncoder::encode(FrameType type, const void* data, uint8_t length,
+                             uint64_t sample_epoch_ms, uint8_t* out) {
+  FrameHeader cab;
+  cab.magic = OIB_FRAME_MAGIC;
+  cab.version = OIB_FRAME_VERSION;
+  cab.type = type;
+  cab.length = length;
+  cab.seq = ++seq;
+  cab.sample_epoch_ms = sample_epoch_ms;
+  memcpy(out, &cab, sizeof(cab));
+  memcpy(out + sizeof(cab), data, length);
+  uint8_t largo = sizeof(cab) + length;
+  uint16_t crc = crc16(out, largo);
+  out[largo++] = crc;
+  out[largo++] = crc >> 8;
+  return largo;
+}
+
+void LinkStats::addCall(uint32_t us, uint16_t length, bool ok, uint8_t frames) {
+  call_us += us;
+  if (us > call_us_max) call_us_max = us;
+  if (ok) {
+    sent += frames;
+    bytes += length;
+  } else {
+    failed += frames;
+  }
+}
+
+void LinkStats::addConfirm(uint32_t us) {
+  confirmed++;
+  confirm_us += us;
+  if (us > confirm_us_max) confirm_us_max = us;
+}
+
+float LinkStats::energyPerFrameUj(uint32_t tx_mw) const {
+  // Con confirmación la radio queda ocupada hasta el ACK; si no, el tiempo
+  // de aire estimado por el transporte o, en último caso, el de la llamada
+  // (cota inferior)
+  if (!sent) return 0.0f;
+  float radio_us = confirmed ? (float)confirm_us / confirmed
+                             : (float)(air_us ? air_us : call_us) / sent;
+  return radio_us * tx_mw / 1000.0f;
+}
+
+String LinkStats::json(uint32_t tx_mw) const {
+  char buf[256];
+  uint32_t n = sent + failed;
+  snprintf(buf, sizeof(buf),
+           "{\"enviadas\":%lu,\"fallidas\":%lu,\"bytes\":%lu,\"llamada_us\":%lu,"
+           "\"llamada_us_max\":%lu,\"confirmadas\":%lu,\"confirmacion_us\":%lu,"
+           "\"confirmacion_us_max\":%lu,\"perdidas\":%lu,\"aire_us\":%lu,\"energia_uj\":%.1f}",
+           (unsigned long)sent, (unsigned long)failed, (unsigned long)bytes,
+           (unsigned long)(n ? call_us / n : 0), (unsigned long)call_us_max,
+           (unsigned long)confirmed, (unsigned long)(confirmed ? confirm_us / confirmed : 0),
+           (unsigned long)confirm_us_max, (unsigned long)lost,
+           (unsigned long)(sent ? air_us / sent : 0), energyPerFrameUj(tx_mw));
+  return String(buf);
+}
@@ -0,0 +1,81 @@
+"""
+Umbrales de la cama para el firmware (script extra de PlatformIO)
+=================================================================
+Lee Algoritmo_sueño/src/config/bed_config.py (la misma configuración que usa
+el controlador de la Raspberry) y exporta cada constante numérica como
+macro OIB_CFG_<NOMBRE>. Así la clasificación de sueño, la presencia y las
+alertas del firmware usan exactamente los mismos umbrales que el gateway.
+
+include/sleep_config.h tiene valores por defecto para compilar sin este
+script (por ejemplo, fuera de PlatformIO).
+
+Configuración en platformio.ini:
+
+    extra_scripts = pre:tools/bed_config_defines.py
+    custom_bed_config = ../Algoritmo_sueño/src/config/bed_config.py  ; opcional
+"""
+
+import ast
+import operator
+import os
+
+Import("env")  # noqa: F821 - inyectado por PlatformIO/SCons
+
+RUTA_POR_DEFECTO = os.path.join("..", "Algoritmo_sueño", "src", "config", "bed_config.py")
+
+OPERADORES = {
+    ast.Add: operator.add,
+    ast.Sub: operator.sub,
+    ast.Mult: operator.mul,
+    ast.Div: operator.truediv,
+}
+
+
+def evaluar(nodo):
+    """Evalúa literales numéricos y aritmética simple (p. ej. 2 * 60 * 1000.0)"""
+    if isinstance(nodo, ast.Constant) and isinstance(nodo.value, (bool, int, float)):
+        return nodo.value
+    if isinstance(nodo, ast.UnaryOp) and isinstance(nodo.op, ast.USub):
+        return -evaluar(nodo.operand)
+    if isinstance(nodo, ast.BinOp) and type(nodo.op) in OPERADORES:
+        return OPERADORES[type(nodo.op)](evaluar(nodo.left), evaluar(nodo.right))
+    raise ValueError("no numérico")
+
+
+def leer_constantes(ruta):
+    with open(ruta, encoding="utf-8") as f:
+        arbol = ast.parse(f.read(), ruta)
+    constantes = {}
+    for nodo in arbol.body:
+        if not isinstance(nodo, ast.Assign) or len(nodo.targets) != 1:
+            continue
+        objetivo = nodo.targets[0]
+        if not isinstance(objetivo, ast.Name) or not objetivo.id.isupper():
+            continue
+        try:
+            constantes[objetivo.id] = evaluar(nodo.value)
+        except ValueError:
+            continue  # textos, diccionarios, etc.
+    return constantes
+
+
+def como_macro(valor):
+    if isinstance(valor, bool):
+        return "1" if valor else "0"
+    if isinstance(valor, float):
+        return repr(valor) + "f"
+    return str(valor)
+
+
+config = env.GetProjectConfig()
+nombre_env = env.subst("$PIOENV")
+ruta = config.get("env:" + nombre_env, "custom_bed_config", RUTA_POR_DEFECTO)
+ruta = os.path.join(env.subst("$PROJECT_DIR"), ruta)
+
+if os.path.isfile(ruta):
+    constantes = leer_constantes(ruta)
+    env.Append(CPPDEFINES=[("OIB_CFG_" + nombre, como_macro(valor))
+                           for nombre, valor in sorted(constantes.items())])
+    print("bed_config_defines: %d umbrales desde %s" % (len(constantes), ruta))
+else:
+    print("bed_config_defines: no se encontró %s, se usan los valores de sleep_config.h" % ruta)
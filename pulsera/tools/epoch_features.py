@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""
+Vector de características por época de la pulsera
+=================================================
+Formato binario de sensores/sueno/rasgos (EpochFeatures en
+include/epoch_features.h, little-endian). Los modelos del gateway importan
+decodificar() y reciben un dict por época; los campos sin dato llegan como
+None.
+
+Como script, junta los vectores del broker o del registro de la simulación
+y los guarda en CSV:
+
+    python3 tools/epoch_features.py --broker 172.22.39.27 --csv rasgos.csv
+    python3 tools/epoch_features.py --log noche.jsonl --csv rasgos.csv
+"""
+
+import argparse
+import csv
+import json
+import math
+import struct
+import sys
+import time
+
+import topicos
+
+TOPICO = "sensores/sueno/rasgos"
+VERSION = 1
+
+FORMATO = struct.Struct("<BBBBIQ14fHHHBB")
+
+CAMPOS_FLOAT = ("hr_mean", "hr_std", "rmssd", "sdnn", "pnn50", "lf", "hf", "lf_hf",
+                "activity", "spo2_min", "spo2_mean", "temp_mean", "temp_slope", "resp_rate")
+CAMPOS = (("version", "flags", "stage", "posture", "epoch", "start_epoch_ms") + CAMPOS_FLOAT +
+          ("beats", "artifacts", "movements", "posture_changes"))
+
+BANDERAS = ("in_bed", "hr", "spo2", "temp", "psd", "resp", "accel")
+POSTURAS = {0: "supine", 1: "prone", 2: "left", 3: "right", 4: "upright"}
+
+
+def decodificar(datos):
+    """bytes de un mensaje -> dict con los campos de EpochFeatures"""
+    if len(datos) != FORMATO.size:
+        raise ValueError("largo %d, se esperaban %d bytes" % (len(datos), FORMATO.size))
+    valores = FORMATO.unpack(datos)
+    if valores[0] != VERSION:
+        raise ValueError("versión %d no soportada (se espera %d)" % (valores[0], VERSION))
+    rasgos = dict(zip(CAMPOS, valores[:len(CAMPOS)]))
+    for campo in CAMPOS_FLOAT:
+        if math.isnan(rasgos[campo]):
+            rasgos[campo] = None
+    rasgos["start_epoch_ms"] = rasgos["start_epoch_ms"] or None
+    rasgos["posture"] = POSTURAS.get(rasgos["posture"])
+    rasgos["flags"] = {b: bool(rasgos["flags"] & (1 << i)) for i, b in enumerate(BANDERAS)}
+    return rasgos
+
+
+def fila_csv(rasgos):
+    fila = dict(rasgos)
+    banderas = fila.pop("flags")
+    fila.update({"flag_" + b: int(v) for b, v in banderas.items()})
+    return fila
+
+
+def desde_log(ruta, dispositivo=None):
+    with open(ruta) as f:
+        for linea in f:
+            try:
+                msg = json.loads(linea)
+            except ValueError:
+                continue
+            if topicos.coincide(msg.get("topic", ""), TOPICO, dispositivo) and "payload_hex" in msg:
+                yield bytes.fromhex(msg["payload_hex"])
+
+
+def desde_broker(args):
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit("Falta paho-mqtt: pip install paho-mqtt")
+
+    recibidos = []
+    cliente = mqtt.Client()
+    if args.usuario:
+        cliente.username_pw_set(args.usuario, args.password)
+    cliente.on_message = lambda c, u, msg: recibidos.append(msg.payload)
+    cliente.connect(args.broker, args.puerto)
+    topico = topicos.completo(TOPICO, args.dispositivo)
+    cliente.subscribe(topico, qos=1)
+    cliente.loop_start()
+    print("Escuchando %s en %s:%d ... (Ctrl+C para terminar)" % (topico, args.broker, args.puerto))
+    try:
+        fin = time.time() + args.duracion if args.duracion else None
+        while fin is None or time.time() < fin:
+            time.sleep(0.5)
+    except KeyboardInterrupt:
+        pass
+    cliente.loop_stop()
+    cliente.disconnect()
+    return recibidos
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Vectores de características por época")
+    origen = parser.add_mutually_exclusive_group(required=True)
+    origen.add_argument("--broker", help="broker MQTT a escuchar")
+    origen.add_argument("--log", help="registro JSON de la simulación (--mqtt-log)")
+    parser.add_argument("--puerto", type=int, default=1883)
+    parser.add_argument("--usuario")
+    parser.add_argument("--password")
+    topicos.agregar_argumento(parser)
+    parser.add_argument("--duracion", type=float, default=0, help="segundos (0 = hasta Ctrl+C)")
+    parser.add_argument("--csv", help="guarda las épocas en este archivo")
+    args = parser.parse_args()
+
+    mensajes = desde_log(args.log, args.dispositivo) if args.log else desde_broker(args)
+    epocas = []
+    for datos in mensajes:
+        try:
+            epocas.append(decodificar(datos))
+        except ValueError as e:
+            print("Descartado: %s" % e)
+
+    print("%d épocas" % len(epocas))
+    if epocas:
+        ultima = epocas[-1]
+        print("Última: " + ", ".join("%s=%s" % (k, ("%.2f" % v) if isinstance(v, float) else v)
+                                     for k, v in ultima.items() if k != "flags"))
+    if args.csv and epocas:
+        filas = [fila_csv(r) for r in epocas]
+        with open(args.csv, "w", newline="") as f:
+            escritor = csv.DictWriter(f, fieldnames=list(filas[0].keys()))
+            escritor.writeheader()
+            escritor.writerows(filas)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+"""
+Monitor de latencia de extremo a extremo de la pulsera
+======================================================
+Se suscribe al broker (o lee el registro JSON de la simulación nativa) y, para
+cada bloque de telemetría con "traza", calcula:
+
+    e2e   = recepción en el host - adquisición de la muestra ("adq")
+    enc   = adquisición -> encolado en el firmware
+    cod   = encolado -> codificado
+    pub   = codificado -> entregado al cliente MQTT
+    red   = entregado al cliente MQTT -> recepción en el host
+
+"adq" es hora de pared del ESP32 sincronizada por SNTP, así que el host tiene
+que estar sincronizado con el mismo servidor (chrony/ntpd en la Raspberry).
+Los ids de traza faltantes se cuentan como bloques perdidos, por pulsera
+(oib/<id>/...): cada una numera sus bloques por separado.
+
+Uso:
+    python3 tools/latency_monitor.py --broker 172.22.39.27 [--duracion 600]
+    python3 tools/latency_monitor.py --log noche.jsonl   # --mqtt-log de native_sim
+    ... --json resultado.json  (guarda percentiles, histograma y perdidos)
+"""
+
+import argparse
+import json
+import os
+import sys
+import time
+from collections import defaultdict
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import topicos  # noqa: E402
+
+ETAPAS = ("e2e", "enc", "cod", "pub", "red")
+PERCENTILES = (50, 90, 99)
+# Cubetas del histograma de e2e (ms, límite superior)
+CUBETAS = (5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000)
+
+
+def percentil(valores_ordenados, p):
+    if not valores_ordenados:
+        return 0.0
+    k = (len(valores_ordenados) - 1) * p / 100.0
+    i = int(k)
+    j = min(i + 1, len(valores_ordenados) - 1)
+    return valores_ordenados[i] + (valores_ordenados[j] - valores_ordenados[i]) * (k - i)
+
+
+class Acumulador:
+    """Muestras de latencia por tópico y control de ids perdidos por pulsera"""
+
+    def __init__(self):
+        self.muestras = defaultdict(lambda: defaultdict(list))
+        self.ultimo_id = {}
+        self.perdidos = defaultdict(int)
+        self.sin_hora = defaultdict(int)
+
+    def agregar(self, topico, payload, recv_epoch_ms):
+        try:
+            datos = json.loads(payload)
+        except (ValueError, TypeError):
+            return
+        traza = datos.get("traza") if isinstance(datos, dict) else None
+        if not traza:
+            return
+
+        # Los ids son una única secuencia para todos los tópicos de una
+        # pulsera (su conexión MQTT conserva el orden); un id menor indica un
+        # reinicio. Tópicos sin prefijo oib/<id>/ cuentan como una pulsera "-"
+        pulsera = topicos.separar(topico)[0] or "-"
+        id_traza = traza.get("id", 0)
+        ultimo = self.ultimo_id.get(pulsera)
+        if ultimo is not None and id_traza > ultimo + 1:
+            self.perdidos[pulsera] += id_traza - ultimo - 1
+        self.ultimo_id[pulsera] = id_traza
+
+        adq = traza.get("adq", 0)
+        if not adq:
+            self.sin_hora[topico] += 1
+            return
+
+        e2e = recv_epoch_ms - adq
+        m = self.muestras[topico]
+        m["e2e"].append(e2e)
+        m["enc"].append(traza.get("enc", 0))
+        m["cod"].append(traza.get("cod", 0) - traza.get("enc", 0))
+        m["pub"].append(traza.get("pub", 0) - traza.get("cod", 0))
+        m["red"].append(e2e - traza.get("pub", 0))
+
+    def resumen(self):
+        resultado = {}
+        for topico, etapas in sorted(self.muestras.items()):
+            fila = {"n": len(etapas["e2e"]), "sin_hora": self.sin_hora[topico]}
+            for etapa in ETAPAS:
+                valores = sorted(etapas[etapa])
+                fila[etapa] = {"p%d" % p: round(percentil(valores, p), 1) for p in PERCENTILES}
+                fila[etapa]["max"] = valores[-1] if valores else 0
+            histograma = [0] * (len(CUBETAS) + 1)
+            for v in etapas["e2e"]:
+                i = 0
+                while i < len(CUBETAS) and v > CUBETAS[i]:
+                    i += 1
+                histograma[i] += 1
+            fila["histograma_e2e"] = histograma
+            resultado[topico] = fila
+        return resultado
+
+    def perdidos_por_pulsera(self):
+        return {p: self.perdidos[p] for p in sorted(self.ultimo_id)}
+
+    def perdidos_total(self):
+        return sum(self.perdidos.values())
+
+    def imprimir(self):
+        resumen = self.resumen()
+        if not resumen:
+            print("No se recibieron bloques con traza")
+            return
+        for topico, fila in resumen.items():
+            print("")
+            print("%s  (n=%d, sin hora=%d)" % (topico, fila["n"], fila["sin_hora"]))
+            print("  %-6s %9s %9s %9s %9s" % ("etapa", "p50 ms", "p90 ms", "p99 ms", "max ms"))
+            for etapa in ETAPAS:
+                e = fila[etapa]
+                print("  %-6s %9.1f %9.1f %9.1f %9.1f" % (etapa, e["p50"], e["p90"], e["p99"],
+                                                          e["max"]))
+            total = max(fila["n"], 1)
+            limites = ["<=%d" % c for c in CUBETAS] + [">%d" % CUBETAS[-1]]
+            print("  e2e:", "  ".join("%s:%.0f%%" % (l, 100.0 * c / total)
+                                      for l, c in zip(limites, fila["histograma_e2e"]) if c))
+        print("")
+        print("Bloques perdidos (ids faltantes): %d" % self.perdidos_total())
+        for pulsera, perdidos in self.perdidos_por_pulsera().items():
+            print("  %-20s %d" % (pulsera, perdidos))
+
+
+def leer_log(ruta, acumulador):
+    with open(ruta) as f:
+        for linea in f:
+            try:
+                msg = json.loads(linea)
+            except ValueError:
+                continue
+            if "payload" in msg:
+                acumulador.agregar(msg["topic"], msg["payload"], msg["recv_epoch_ms"])
+
+
+def escuchar_broker(args, acumulador):
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit("Falta paho-mqtt: pip install paho-mqtt")
+
+    def al_recibir(cliente, userdata, msg):
+        acumulador.agregar(msg.topic, msg.payload.decode("utf-8", "replace"),
+                           int(time.time() * 1000))
+
+    cliente = mqtt.Client()
+    if args.usuario:
+        cliente.username_pw_set(args.usuario, args.password)
+    cliente.on_message = al_recibir
+    cliente.connect(args.broker, args.puerto)
+    cliente.subscribe(args.topico)
+    cliente.loop_start()
+    print("Escuchando %s en %s:%d ... (Ctrl+C para terminar)" % (args.topico, args.broker,
+                                                                 args.puerto))
+    try:
+        fin = time.time() + args.duracion if args.duracion else None
+        while fin is None or time.time() < fin:
+            time.sleep(0.5)
+    except KeyboardInterrupt:
+        pass
+    cliente.loop_stop()
+    cliente.disconnect()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Latencia de extremo a extremo de la pulsera")
+    origen = parser.add_mutually_exclusive_group(required=True)
+    origen.add_argument("--broker", help="broker MQTT a escuchar")
+    origen.add_argument("--log", help="registro JSON de la simulación (--mqtt-log)")
+    parser.add_argument("--puerto", type=int, default=1883)
+    parser.add_argument("--usuario")
+    parser.add_argument("--password")
+    parser.add_argument("--topico", default="oib/+/sensores/#")
+    parser.add_argument("--duracion", type=float, default=0, help="segundos (0 = hasta Ctrl+C)")
+    parser.add_argument("--json", help="guarda el resumen en este archivo")
+    args = parser.parse_args()
+
+    acumulador = Acumulador()
+    if args.log:
+        leer_log(args.log, acumulador)
+    else:
+        escuchar_broker(args, acumulador)
+
+    acumulador.imprimir()
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"topicos": acumulador.resumen(), "perdidos": acumulador.perdidos_total(),
+                       "perdidos_por_pulsera": acumulador.perdidos_por_pulsera()}, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
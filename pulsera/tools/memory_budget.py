@@ -0,0 +1,211 @@
+"""
+Presupuesto de memoria por módulo (script extra de PlatformIO)
+==============================================================
+Después de enlazar el firmware lee el mapa del linker (firmware.map) y suma
+los tamaños de .text/.data/.bss de cada objeto agrupados por módulo
+(firmware, cada librería de sensores, red, framework). Compara el resultado
+con los presupuestos configurados en platformio.ini y además exporta los
+presupuestos de heap y stack para que el firmware los reporte en tiempo real.
+
+Configuración en platformio.ini:
+
+    extra_scripts = post:tools/memory_budget.py
+    custom_mem_budget =
+        firmware  text=65536 data=2048 bss=16384
+        ...
+    custom_heap_peak_budget = 180000
+    custom_loop_stack_budget = 6144
+    custom_mem_budget_strict = yes
+
+El reporte se imprime al final del build y se guarda en
+$BUILD_DIR/memory_budget.json.
+"""
+
+import json
+import os
+import re
+
+Import("env", "projenv")  # noqa: F821 - inyectado por PlatformIO/SCons
+
+# Módulos conocidos: nombre -> fragmentos que aparecen en la ruta del objeto
+MODULOS = [
+    ("firmware", ["/src/"]),
+    ("HTU21D", ["HTU21D"]),
+    ("MAX3010x", ["MAX3010x", "MAX30105"]),
+    ("MMA8452Q", ["MMA8452Q"]),
+    ("PubSubClient", ["PubSubClient"]),
+    ("red", ["libWiFi.a", "libNetwork", "liblwip", "libesp_wifi", "libnet80211",
+             "libpp.a", "libwpa_supplicant", "libmbedtls", "libmbedcrypto",
+             "libesp_netif", "libcoexist", "libphy"]),
+]
+MODULO_RESTO = "framework"
+
+SECCIONES_IGNORADAS = (".debug", ".comment", ".note", ".riscv.attributes",
+                       ".xt.", ".xtensa.info", ".stab")
+
+RE_ENTRADA = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+RE_NOMBRE_SOLO = re.compile(r"^ (\S+)$")
+RE_CONTINUACION = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+
+
+def clasificar_seccion(nombre):
+    """Devuelve 'text', 'data', 'bss' o None para secciones que no ocupan memoria"""
+    if nombre.startswith(SECCIONES_IGNORADAS):
+        return None
+    if nombre == "COMMON" or ".bss" in nombre or ".sbss" in nombre or nombre.startswith(".noinit"):
+        return "bss"
+    if ".data" in nombre or ".sdata" in nombre or nombre.startswith(".dram"):
+        return "data"
+    if (nombre.startswith((".text", ".literal", ".iram", ".rodata", ".srodata", ".flash"))
+            or ".text" in nombre or ".rodata" in nombre):
+        return "text"
+    return None
+
+
+def clasificar_modulo(objeto):
+    ruta = objeto.replace("\\", "/")
+    for nombre, patrones in MODULOS:
+        if any(p in ruta for p in patrones):
+            return nombre
+    return MODULO_RESTO
+
+
+def parsear_mapa(ruta_mapa):
+    """Suma bytes por (módulo, sección) a partir del mapa de GNU ld"""
+    totales = {}
+    en_mapa = False
+    pendiente = None
+
+    with open(ruta_mapa, "r", errors="replace") as f:
+        for linea in f:
+            linea = linea.rstrip("\n")
+            if not en_mapa:
+                en_mapa = linea.startswith("Linker script and memory map")
+                continue
+
+            seccion = objeto = None
+            tamano = 0
+
+            m = RE_ENTRADA.match(linea)
+            if m:
+                seccion, tamano, objeto = m.group(1), int(m.group(3), 16), m.group(4)
+                pendiente = None
+            elif pendiente is not None:
+                c = RE_CONTINUACION.match(linea)
+                if c:
+                    seccion, tamano, objeto = pendiente, int(c.group(2), 16), c.group(3)
+                pendiente = None
+            else:
+                n = RE_NOMBRE_SOLO.match(linea)
+                if n:
+                    pendiente = n.group(1)
+                continue
+
+            if seccion is None or tamano == 0:
+                continue
+            tipo = clasificar_seccion(seccion)
+            if tipo is None:
+                continue
+
+            modulo = clasificar_modulo(objeto)
+            fila = totales.setdefault(modulo, {"text": 0, "data": 0, "bss": 0})
+            fila[tipo] += tamano
+
+    return totales
+
+
+def leer_presupuestos(config, nombre_env):
+    """Parsea custom_mem_budget: una línea por módulo con text=/data=/bss="""
+    presupuestos = {}
+    opcion = "env:" + nombre_env
+    if not config.has_option(opcion, "custom_mem_budget"):
+        return presupuestos
+
+    for linea in config.get(opcion, "custom_mem_budget").splitlines():
+        partes = linea.split()
+        if not partes:
+            continue
+        limites = {}
+        for campo in partes[1:]:
+            clave, _, valor = campo.partition("=")
+            limites[clave] = int(valor, 0)
+        presupuestos[partes[0]] = limites
+    return presupuestos
+
+
+def opcion_entera(config, nombre_env, clave):
+    opcion = "env:" + nombre_env
+    if config.has_option(opcion, clave):
+        return int(config.get(opcion, clave), 0)
+    return None
+
+
+def reporte_memoria(source, target, env):
+    ruta_mapa = os.path.join(env.subst("$BUILD_DIR"), "firmware.map")
+    if not os.path.isfile(ruta_mapa):
+        print("memory_budget: no se encontró %s" % ruta_mapa)
+        return
+
+    config = env.GetProjectConfig()
+    nombre_env = env.subst("$PIOENV")
+    presupuestos = leer_presupuestos(config, nombre_env)
+    totales = parsear_mapa(ruta_mapa)
+
+    total = {"text": 0, "data": 0, "bss": 0}
+    for fila in totales.values():
+        for k in total:
+            total[k] += fila[k]
+    totales["total"] = total
+
+    excedidos = []
+    print("")
+    print("Memoria por módulo (bytes)")
+    print("%-14s %10s %10s %10s   %s" % ("modulo", "text", "data", "bss", "presupuesto"))
+    orden = [m for m, _ in MODULOS] + [MODULO_RESTO, "total"]
+    for modulo in orden:
+        fila = totales.get(modulo)
+        if fila is None:
+            continue
+        limites = presupuestos.get(modulo, {})
+        estado = []
+        for k in ("text", "data", "bss"):
+            if k in limites:
+                if fila[k] > limites[k]:
+                    excedidos.append("%s.%s %d > %d" % (modulo, k, fila[k], limites[k]))
+                    estado.append("%s EXCEDIDO" % k)
+                else:
+                    estado.append("%s %d%%" % (k, 100 * fila[k] // max(limites[k], 1)))
+        print("%-14s %10d %10d %10d   %s" % (modulo, fila["text"], fila["data"], fila["bss"],
+                                           ", ".join(estado) if estado else "-"))
+
+    resultado = {
+        "modulos": totales,
+        "presupuestos": presupuestos,
+        "heap_peak_budget": opcion_entera(config, nombre_env, "custom_heap_peak_budget"),
+        "loop_stack_budget": opcion_entera(config, nombre_env, "custom_loop_stack_budget"),
+        "excedidos": excedidos,
+    }
+    with open(os.path.join(env.subst("$BUILD_DIR"), "memory_budget.json"), "w") as f:
+        json.dump(resultado, f, indent=2)
+
+    if excedidos:
+        print("Presupuesto de memoria excedido: " + "; ".join(excedidos))
+        estricto = config.get("env:" + nombre_env, "custom_mem_budget_strict", "no")
+        if str(estricto).lower() in ("yes", "true", "1"):
+            env.Exit(1)
+
+
+# Generar el mapa del linker junto al ELF
+env.Append(LINKFLAGS=["-Wl,-Map,${BUILD_DIR}/firmware.map"])
+
+# Presupuestos de tiempo de ejecución: el firmware los compara con el mínimo de
+# heap libre y la marca de agua del stack del loop (ver publicar_memoria())
+_config = env.GetProjectConfig()
+_env_nombre = env.subst("$PIOENV")
+for _clave, _macro in (("custom_heap_peak_budget", "OIB_HEAP_PEAK_BUDGET"),
+                       ("custom_loop_stack_budget", "OIB_LOOP_STACK_BUDGET")):
+    _valor = opcion_entera(_config, _env_nombre, _clave)
+    if _valor is not None:
+        projenv.Append(CPPDEFINES=[(_macro, _valor)])
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", reporte_memoria)
@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+"""
+Hipnograma de la noche guardado en la pulsera
+=============================================
+Decodifica el mensaje binario de sensores/sueno/noche (ver include/night_log.h):
+
+    cabecera (16 B)  "OIBN", versión, bytes por registro, s por época,
+                     inicio en ms desde epoch
+    resumen  (16 B)  épocas, épocas por estado, en la cama, inicio del sueño,
+                     despertares
+    registros        4 B por época
+
+Con --broker pide la noche a la pulsera (o toma la retenida de la última noche
+cerrada) y la imprime; --log la busca en el registro de la simulación nativa.
+
+Uso:
+    python3 tools/night_decode.py --broker 172.22.39.27 [--anterior]
+    python3 tools/night_decode.py --log noche.jsonl      # --mqtt-log de native_sim
+    python3 tools/night_decode.py --archivo noche.bin
+    ... --json noche.json  (épocas decodificadas y resumen)
+"""
+
+import argparse
+import datetime
+import json
+import struct
+import sys
+import time
+
+import topicos
+
+TOPICO = "sensores/sueno/noche"
+TOPICO_PEDIR = "sensores/sueno/noche/pedir"
+
+CABECERA = struct.Struct("<4sBBHQ")
+RESUMEN = struct.Struct("<HHHHHHHH")
+ESTADOS = ("WAKE", "LIGHT", "REM", "DEEP")
+SIMBOLO = {"WAKE": "W", "LIGHT": "L", "REM": "R", "DEEP": "D"}
+
+BANDERA_VALIDA = 1
+BANDERA_EN_CAMA = 2
+BANDERA_HR = 4
+BANDERA_PSD = 8
+
+
+def decodificar(datos):
+    if len(datos) < CABECERA.size + RESUMEN.size:
+        raise ValueError("mensaje demasiado corto (%d bytes)" % len(datos))
+    magia, version, bytes_registro, epoca_s, inicio_ms = CABECERA.unpack_from(datos, 0)
+    if magia != b"OIBN" or version != 1 or bytes_registro != 4:
+        raise ValueError("formato desconocido: %r v%d" % (magia, version))
+    campos = RESUMEN.unpack_from(datos, CABECERA.size)
+    resumen = {
+        "epocas": campos[0],
+        "por_estado": dict(zip(ESTADOS, campos[1:5])),
+        "en_cama": campos[5],
+        "inicio_sueno": None if campos[6] == 0xFFFF else campos[6],
+        "despertares": campos[7],
+    }
+
+    epocas = []
+    desde = CABECERA.size + RESUMEN.size
+    for i in range(resumen["epocas"]):
+        (r,) = struct.unpack_from("<I", datos, desde + 4 * i)
+        banderas = (r >> 2) & 0x0F
+        hr = (r >> 6) & 0x7F
+        epocas.append({
+            "indice": i,
+            "inicio_ms": inicio_ms + i * epoca_s * 1000 if inicio_ms else None,
+            "valida": bool(banderas & BANDERA_VALIDA),
+            "en_cama": bool(banderas & BANDERA_EN_CAMA),
+            "estado": ESTADOS[r & 0x03],
+            "hr": hr + 30 if (banderas & BANDERA_HR) and hr else None,
+            "rmssd": (r >> 13) & 0x7F,
+            "movimientos": (r >> 20) & 0x3F,
+            "lf_hf": ((r >> 26) & 0x3F) / 8.0 if banderas & BANDERA_PSD else None,
+        })
+    return {"inicio_ms": inicio_ms or None, "epoca_s": epoca_s, "resumen": resumen,
+            "epocas": epocas}
+
+
+def imprimir(noche):
+    r = noche["resumen"]
+    epoca_min = noche["epoca_s"] / 60.0
+    inicio = noche["inicio_ms"]
+    print("\n==================== NOCHE ====================")
+    if inicio:
+        print("Inicio: %s" % datetime.datetime.fromtimestamp(inicio / 1000.0))
+    print("Épocas: %d (%.0f min)  |  en la cama: %.0f min" % (
+        r["epocas"], r["epocas"] * epoca_min, r["en_cama"] * epoca_min))
+    dormido = sum(v for k, v in r["por_estado"].items() if k != "WAKE")
+    if r["en_cama"]:
+        print("Eficiencia: %.1f %%" % (100.0 * dormido / r["en_cama"]))
+    if r["inicio_sueno"] is not None:
+        print("Latencia de sueño: %.1f min" % (r["inicio_sueno"] * epoca_min))
+    print("Despertares: %d" % r["despertares"])
+    print("Minutos por estado: " + "  ".join(
+        "%s %.0f" % (k, v * epoca_min) for k, v in r["por_estado"].items()))
+
+    # Hipnograma en texto, una línea por hora
+    simbolos = "".join(
+        (SIMBOLO[e["estado"]] if e["en_cama"] else "·") if e["valida"] else " "
+        for e in noche["epocas"])
+    por_hora = int(3600 / noche["epoca_s"])
+    print("\nHipnograma (W/L/R/D, · fuera de la cama, espacio = sin datos):")
+    for h in range(0, len(simbolos), por_hora):
+        print("  %2dh %s" % (h // por_hora, simbolos[h:h + por_hora]))
+
+
+def desde_log(ruta, dispositivo=None):
+    ultimo = None
+    with open(ruta) as f:
+        for linea in f:
+            try:
+                msg = json.loads(linea)
+            except ValueError:
+                continue
+            if topicos.coincide(msg.get("topic", ""), TOPICO, dispositivo) and "payload_hex" in msg:
+                ultimo = bytes.fromhex(msg["payload_hex"])
+    if ultimo is None:
+        sys.exit("No hay mensajes de %s en %s" % (TOPICO, ruta))
+    return ultimo
+
+
+def desde_broker(args):
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit("Falta paho-mqtt: pip install paho-mqtt")
+
+    recibido = []
+
+    def al_conectar(cliente, userdata, flags, rc):
+        cliente.subscribe(topicos.completo(TOPICO, args.dispositivo), qos=1)
+        if not args.retenida:
+            cliente.publish(topicos.completo(TOPICO_PEDIR, args.dispositivo), "anterior" if args.anterior else "", qos=1)
+
+    def al_recibir(cliente, userdata, msg):
+        recibido.append(msg.payload)
+
+    cliente = mqtt.Client()
+    if args.usuario:
+        cliente.username_pw_set(args.usuario, args.password)
+    cliente.on_connect = al_conectar
+    cliente.on_message = al_recibir
+    cliente.connect(args.broker, args.puerto)
+    cliente.loop_start()
+    fin = time.time() + args.espera
+    while not recibido and time.time() < fin:
+        time.sleep(0.2)
+    cliente.loop_stop()
+    cliente.disconnect()
+    if not recibido:
+        sys.exit("La pulsera no respondió en %.0f s" % args.espera)
+    return recibido[-1]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Hipnograma guardado en la pulsera")
+    origen = parser.add_mutually_exclusive_group(required=True)
+    origen.add_argument("--broker", help="broker MQTT")
+    origen.add_argument("--log", help="registro JSON de la simulación (--mqtt-log)")
+    origen.add_argument("--archivo", help="mensaje binario guardado")
+    parser.add_argument("--puerto", type=int, default=1883)
+    parser.add_argument("--usuario")
+    parser.add_argument("--password")
+    topicos.agregar_argumento(parser)
+    parser.add_argument("--anterior", action="store_true", help="pedir la noche anterior")
+    parser.add_argument("--retenida", action="store_true",
+                        help="no pedir: usar la última noche cerrada (retenida)")
+    parser.add_argument("--espera", type=float, default=30, help="segundos")
+    parser.add_argument("--json", help="guarda la noche decodificada en este archivo")
+    args = parser.parse_args()
+
+    if args.log:
+        datos = desde_log(args.log, args.dispositivo)
+    elif args.archivo:
+        with open(args.archivo, "rb") as f:
+            datos = f.read()
+    else:
+        datos = desde_broker(args)
+
+    noche = decodificar(datos)
+    imprimir(noche)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(noche, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+"""
+Capturas crudas de la pulsera
+=============================
+Rearma las capturas de sensores/captura (ver include/raw_capture.h): cada
+trozo trae una cabecera de 30 bytes y residuos zigzag/varint de un predictor
+de segundo orden que se reinicia en cada trozo, así que los trozos se
+decodifican por separado y una captura con trozos perdidos queda con
+huecos, no inutilizable.
+
+    python3 tools/raw_capture.py --log noche.jsonl --dir capturas/
+    python3 tools/raw_capture.py --broker 172.22.39.27 --pedir
+
+--pedir publica en sensores/captura/pedir para forzar una captura. Con --dir
+cada captura se guarda como captura_<seq>_ppg.csv (t_ms,ir,rojo) y
+captura_<seq>_accel.csv (t_ms,x,y,z), con t_ms relativo al disparo.
+"""
+
+import argparse
+import csv
+import json
+import os
+import struct
+import sys
+import time
+
+import topicos
+
+TOPICO = "sensores/captura"
+TOPICO_PEDIR = "sensores/captura/pedir"
+VERSION = 1
+
+CABECERA = struct.Struct("<2sBBHHBBHHHHIQ")
+DISPAROS = ("hr", "spo2", "caida", "manual")
+FLUJOS = {0: ("ppg", ("ir", "rojo")), 1: ("accel", ("x", "y", "z"))}
+BYTES_CRUDOS = 6  # por muestra en la RAM de la pulsera (ambos flujos)
+ULTIMO = 1
+
+
+def leer_varint(datos, i):
+    valor = 0
+    corrimiento = 0
+    while True:
+        b = datos[i]
+        i += 1
+        valor |= (b & 0x7F) << corrimiento
+        if b < 0x80:
+            break
+        corrimiento += 7
+    return (valor >> 1) ^ -(valor & 1), i
+
+
+def decodificar_trozo(datos):
+    """bytes de un mensaje -> (cabecera dict, lista de muestras)"""
+    if len(datos) < CABECERA.size:
+        raise ValueError("trozo de %d bytes" % len(datos))
+    (magia, version, disparos, seq, trozo, flujo, banderas, primera, muestras, total,
+     disparo, periodo_us, epoch_ms) = CABECERA.unpack_from(datos)
+    if magia != b"RC":
+        raise ValueError("no es una captura")
+    if version != VERSION:
+        raise ValueError("versión %d no soportada" % version)
+    if flujo not in FLUJOS:
+        raise ValueError("flujo %d desconocido" % flujo)
+    canales = len(FLUJOS[flujo][1])
+
+    valores = []
+    i = CABECERA.size
+    p1 = [0] * canales
+    p2 = [0] * canales
+    for k in range(muestras):
+        muestra = []
+        for c in range(canales):
+            residuo, i = leer_varint(datos, i)
+            if k == 0:
+                v = residuo
+            elif k == 1:
+                v = residuo + p1[c]
+            else:
+                v = residuo + 2 * p1[c] - p2[c]
+            p2[c], p1[c] = p1[c], v
+            muestra.append(v)
+        valores.append(muestra)
+
+    cabecera = {
+        "seq": seq, "trozo": trozo, "flujo": flujo, "ultimo": bool(banderas & ULTIMO),
+        "primera": primera, "muestras": muestras, "total": total, "disparo": disparo,
+        "periodo_us": periodo_us, "epoch_ms": epoch_ms or None, "bytes": len(datos),
+        "disparos": [d for b, d in enumerate(DISPAROS) if disparos & (1 << b)],
+    }
+    return cabecera, valores
+
+
+class Captura:
+    def __init__(self, cab):
+        self.seq = cab["seq"]
+        self.disparos = cab["disparos"]
+        self.epoch_ms = cab["epoch_ms"]
+        self.flujos = {}   # flujo -> {"total", "disparo", "periodo_us", "muestras": {i: valores}}
+        self.bytes = 0
+        self.trozos = set()
+        self.completa = False
+
+    def agregar(self, cab, valores):
+        f = self.flujos.setdefault(cab["flujo"], {"total": cab["total"], "disparo": cab["disparo"],
+                                                  "periodo_us": cab["periodo_us"], "muestras": {}})
+        for k, v in enumerate(valores):
+            f["muestras"][cab["primera"] + k] = v
+        self.bytes += cab["bytes"]
+        self.trozos.add(cab["trozo"])
+        self.completa = self.completa or cab["ultimo"]
+
+    def resumen(self):
+        partes = []
+        crudos = 0
+        for flujo, f in sorted(self.flujos.items()):
+            nombre = FLUJOS[flujo][0]
+            partes.append("%s %d/%d (disparo en %.1f s)" % (
+                nombre, len(f["muestras"]), f["total"], f["disparo"] * f["periodo_us"] / 1e6))
+            crudos += f["total"] * BYTES_CRUDOS
+        relacion = crudos / self.bytes if self.bytes else 0
+        return "#%d [%s] %s | %d trozos, %d B (%.1fx)%s" % (
+            self.seq, ",".join(self.disparos), " | ".join(partes), len(self.trozos), self.bytes,
+            relacion, "" if self.completa else " INCOMPLETA")
+
+    def guardar(self, directorio):
+        os.makedirs(directorio, exist_ok=True)
+        for flujo, f in self.flujos.items():
+            nombre, canales = FLUJOS[flujo]
+            ruta = os.path.join(directorio, "captura_%d_%s.csv" % (self.seq, nombre))
+            with open(ruta, "w", newline="") as arch:
+                escritor = csv.writer(arch)
+                escritor.writerow(("t_ms",) + canales)
+                for i in sorted(f["muestras"]):
+                    t_ms = (i - f["disparo"]) * f["periodo_us"] / 1000.0
+                    escritor.writerow(["%.1f" % t_ms] + f["muestras"][i])
+
+
+def rearmar(mensajes):
+    """Agrupa los trozos por captura (una nueva empieza con el trozo 0)"""
+    capturas = []
+    abiertas = {}
+    for datos in mensajes:
+        try:
+            cab, valores = decodificar_trozo(datos)
+        except (ValueError, IndexError) as e:
+            print("Descartado: %s" % e)
+            continue
+        c = abiertas.get(cab["seq"])
+        if c is None or cab["trozo"] == 0 and c.trozos:
+            c = Captura(cab)
+            abiertas[cab["seq"]] = c
+            capturas.append(c)
+        c.agregar(cab, valores)
+    return capturas
+
+
+def desde_log(ruta, dispositivo=None):
+    with open(ruta) as f:
+        for linea in f:
+            try:
+                msg = json.loads(linea)
+            except ValueError:
+                continue
+            if topicos.coincide(msg.get("topic", ""), TOPICO, dispositivo) and "payload_hex" in msg:
+                yield bytes.fromhex(msg["payload_hex"])
+
+
+def desde_broker(args):
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit("Falta paho-mqtt: pip install paho-mqtt")
+
+    recibidos = []
+    cliente = mqtt.Client()
+    if args.usuario:
+        cliente.username_pw_set(args.usuario, args.password)
+    cliente.on_message = lambda c, u, msg: recibidos.append(msg.payload)
+    cliente.connect(args.broker, args.puerto)
+    topico = topicos.completo(TOPICO, args.dispositivo)
+    cliente.subscribe(topico, qos=1)
+    cliente.loop_start()
+    if args.pedir:
+        cliente.publish(topicos.completo(TOPICO_PEDIR, args.dispositivo), "", qos=1)
+    print("Escuchando %s en %s:%d ... (Ctrl+C para terminar)" % (topico, args.broker, args.puerto))
+    try:
+        fin = time.time() + args.duracion if args.duracion else None
+        while fin is None or time.time() < fin:
+            time.sleep(0.5)
+    except KeyboardInterrupt:
+        pass
+    cliente.loop_stop()
+    cliente.disconnect()
+    return recibidos
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Capturas crudas alrededor de eventos")
+    origen = parser.add_mutually_exclusive_group(required=True)
+    origen.add_argument("--broker", help="broker MQTT a escuchar")
+    origen.add_argument("--log", help="registro JSON de la simulación (--mqtt-log)")
+    parser.add_argument("--puerto", type=int, default=1883)
+    parser.add_argument("--usuario")
+    parser.add_argument("--password")
+    topicos.agregar_argumento(parser)
+    parser.add_argument("--duracion", type=float, default=0, help="segundos (0 = hasta Ctrl+C)")
+    parser.add_argument("--pedir", action="store_true", help="forzar una captura al conectar")
+    parser.add_argument("--dir", help="guarda cada captura en CSV en este directorio")
+    args = parser.parse_args()
+    if args.pedir and not args.dispositivo:
+        parser.error("--pedir necesita --dispositivo")
+
+    mensajes = desde_log(args.log, args.dispositivo) if args.log else desde_broker(args)
+    capturas = rearmar(mensajes)
+    print("%d capturas" % len(capturas))
+    for c in capturas:
+        print("  " + c.resumen())
+        if args.dir:
+            c.guardar(args.dir)
+
+
+if __name__ == "__main__":
+    main()
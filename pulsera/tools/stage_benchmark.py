@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""
+Banco de prueba de la clasificación de sueño de la pulsera
+==========================================================
+Compara, contra un hipnograma de referencia, la etapa del modelo entrenado
+("modelo" en sensores/sueno/epoca, que corre en sombra) y la de las reglas
+de SleepStager ("reglas"), y resume el costo de la inferencia en la pulsera.
+
+    pio run -e native_sim
+    .pio/build/native_sim/program --horas 8 --semilla 9 \\
+        --mqtt-log noche.jsonl --hipnograma hipno.csv
+    python3 tools/stage_benchmark.py --par noche.jsonl hipno.csv
+
+Reporta exactitud, kappa de Cohen, sensibilidad por etapa y la matriz de
+confusión de cada clasificador. El costo sale de "modelo.ciclos" (medido
+con ESP.getCycleCount(); en la simulación el reloj virtual no avanza
+durante el cálculo y da 0) y del tamaño del modelo (multiplicaciones y
+bytes de tablas). Usar noches que no estén en el entrenamiento.
+"""
+
+import argparse
+import json
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from stage_model_train import ETAPAS, cargar_hipnograma, etapa_verdadera  # noqa: E402
+import topicos  # noqa: E402
+
+TOPICO_EPOCA = "sensores/sueno/epoca"
+
+
+def cargar_par(ruta_log, ruta_hipnograma):
+    hipnograma = cargar_hipnograma(ruta_hipnograma)
+    epocas = []
+    with open(ruta_log) as f:
+        for linea in f:
+            try:
+                msg = json.loads(linea)
+                if not topicos.coincide(msg.get("topic", ""), TOPICO_EPOCA):
+                    continue
+                e = json.loads(msg["payload"])
+            except (ValueError, KeyError):
+                continue
+            if not e.get("inicio") or "modelo" not in e:
+                continue
+            e["etapa_modelo"] = e["modelo"]["etapa"]
+            e["verdad"] = etapa_verdadera(hipnograma, e["inicio"])
+            if e["verdad"] is not None:
+                epocas.append(e)
+    return epocas
+
+
+def metricas(epocas, campo):
+    etapas = sorted(ETAPAS)
+    confusion = {(v, p): 0 for v in etapas for p in etapas}
+    for e in epocas:
+        confusion[(e["verdad"], e[campo])] = confusion.get((e["verdad"], e[campo]), 0) + 1
+    n = len(epocas)
+    acierto = sum(confusion[(s, s)] for s in etapas) / n
+    # Kappa: acierto corregido por el azar de las proporciones marginales
+    azar = sum(sum(confusion[(s, p)] for p in etapas) * sum(confusion[(v, s)] for v in etapas)
+               for s in etapas) / (n * n)
+    kappa = (acierto - azar) / (1 - azar) if azar < 1 else 0.0
+    sensibilidad = {}
+    for s in etapas:
+        total = sum(confusion[(s, p)] for p in etapas)
+        sensibilidad[s] = confusion[(s, s)] / total if total else None
+    return acierto, kappa, sensibilidad, confusion
+
+
+def costo_modelo(ruta):
+    with open(ruta) as f:
+        modelo = json.load(f)
+    entradas = len(modelo["rasgos"])
+    clases = len(modelo["clases"])
+    # EXP (1) + CENTRO (4) + MULT (4) + RASGO (1) por entrada; PESO (2) por entrada y clase
+    tablas = entradas * 10 + clases * (entradas * 2 + 4 + 1)
+    return entradas, clases, entradas * (clases + 1), tablas
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Modelo vs reglas en la clasificación de sueño")
+    parser.add_argument("--par", nargs=2, action="append", required=True,
+                        metavar=("LOG", "HIPNOGRAMA"), help="registro MQTT y su hipnograma")
+    parser.add_argument("--modelo", default=os.path.join("model", "stage_model.json"))
+    args = parser.parse_args()
+
+    epocas = [e for log, hip in args.par for e in cargar_par(log, hip)]
+    if not epocas:
+        sys.exit("No hay épocas con modelo y referencia (¿firmware sin modelo compilado?)")
+
+    print("%d épocas en %d noches\n" % (len(epocas), len(args.par)))
+    print("%-8s %9s %7s   %s" % ("", "exactitud", "kappa",
+                                  "  ".join("%6s" % ETAPAS[s] for s in sorted(ETAPAS))))
+    resultados = {}
+    for nombre, campo in (("reglas", "reglas"), ("modelo", "etapa_modelo")):
+        acierto, kappa, sensibilidad, confusion = metricas(epocas, campo)
+        resultados[nombre] = confusion
+        print("%-8s %8.1f%% %7.3f   %s" % (
+            nombre, 100 * acierto, kappa,
+            "  ".join("%5.1f%%" % (100 * v) if v is not None else "     -"
+                      for _, v in sorted(sensibilidad.items()))))
+
+    for nombre, confusion in resultados.items():
+        print("\nConfusión %s (filas: referencia, columnas: clasificado)" % nombre)
+        print("        " + " ".join("%6s" % ETAPAS[s] for s in sorted(ETAPAS)))
+        for v in sorted(ETAPAS):
+            print("%-7s " % ETAPAS[v] + " ".join("%6d" % confusion[(v, p)] for p in sorted(ETAPAS)))
+
+    ciclos = sorted(e["modelo"].get("ciclos", 0) for e in epocas)
+    print("\nCosto de la inferencia")
+    if ciclos[-1] > 0:
+        print("  ciclos: media %.0f | p95 %d | máx %d" % (
+            sum(ciclos) / len(ciclos), ciclos[int(0.95 * (len(ciclos) - 1))], ciclos[-1]))
+    else:
+        print("  ciclos: sin medir (reloj virtual de la simulación)")
+    if os.path.isfile(args.modelo):
+        entradas, clases, mults, tablas = costo_modelo(args.modelo)
+        print("  modelo: %d entradas x %d clases | %d multiplicaciones enteras | %d B de tablas" % (
+            entradas, clases, mults, tablas))
+
+
+if __name__ == "__main__":
+    main()
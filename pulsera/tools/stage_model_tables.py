@@ -0,0 +1,160 @@
+"""
+Tablas del clasificador de sueño (script extra de PlatformIO)
+=============================================================
+Lee el modelo entrenado (JSON de tools/stage_model_train.py), lo cuantiza a
+punto fijo y genera stage_model_tables.h con tablas constexpr para
+src/stage_classifier.cpp. El encabezado va al directorio de compilación
+(no se versiona): el modelo que corre es siempre el del archivo.
+
+Cuantización, por entrada i del modelo con z = (x - centro) / escala:
+    crudo = x·2^EXP[i]              con escala·2^EXP en [256, 512)
+    z_Q8  = (crudo - CENTRO[i])·MULT[i] >> 16
+    logit_Q16 = SESGO[c] + Σ PESO[c][i]·z_Q8      (PESO en Q8)
+
+Configuración en platformio.ini:
+
+    extra_scripts = pre:tools/stage_model_tables.py
+    custom_stage_model = model/stage_model.json   ; opcional
+
+Fuera de PlatformIO (simulación compilada a mano):
+
+    python3 tools/stage_model_tables.py model/stage_model.json -o build/generado
+"""
+
+import argparse
+import json
+import math
+import os
+import zlib
+
+try:
+    Import("env")  # noqa: F821 - inyectado por PlatformIO/SCons
+except NameError:
+    env = None
+
+RUTA_POR_DEFECTO = os.path.join("model", "stage_model.json")
+ENCABEZADO = "stage_model_tables.h"
+
+ENTRADAS = ("hr_mean", "hr_std", "rmssd", "sdnn", "pnn50", "lf", "hf", "lf_hf", "activity",
+            "spo2_min", "spo2_mean", "temp_mean", "temp_slope", "resp_rate", "beats",
+            "artifacts", "movements", "posture_changes", "in_bed")
+
+Z_MAX_Q8 = 4 * 256
+INT32_MAX = 2 ** 31 - 1
+
+
+def cuantizar(modelo):
+    rasgos = modelo["rasgos"]
+    pesos = modelo["pesos"]
+    sesgos = modelo["sesgos"]
+    if len(pesos) != len(modelo["clases"]) or len(sesgos) != len(pesos):
+        raise ValueError("pesos/sesgos no coinciden con las clases")
+
+    tabla = {"rasgo": [], "exp": [], "centro": [], "mult": []}
+    for r in rasgos:
+        if r["nombre"] not in ENTRADAS:
+            raise ValueError("entrada desconocida: %s" % r["nombre"])
+        escala = float(r["escala"])
+        if escala <= 0:
+            raise ValueError("escala no positiva en %s" % r["nombre"])
+        exp = max(-16, min(24, int(math.floor(math.log2(512.0 / escala)))))
+        while escala * 2 ** exp >= 512:
+            exp -= 1
+        tabla["rasgo"].append("STAGE_INPUT_" + r["nombre"].upper())
+        tabla["exp"].append(exp)
+        tabla["centro"].append(int(round(r["centro"] * 2 ** exp)))
+        tabla["mult"].append(int(round(2 ** 24 / (escala * 2 ** exp))))
+
+    tabla["peso"] = [[max(-32768, min(32767, int(round(w * 256)))) for w in fila] for fila in pesos]
+    tabla["sesgo"] = [int(round(b * 65536)) for b in sesgos]
+    for fila, sesgo in zip(tabla["peso"], tabla["sesgo"]):
+        if abs(sesgo) + sum(abs(w) for w in fila) * Z_MAX_Q8 > INT32_MAX:
+            raise ValueError("los logits pueden desbordar int32; regularizar más el modelo")
+    return tabla
+
+
+def lista(valores):
+    return "{" + ", ".join(str(v) for v in valores) + "}"
+
+
+def generar(ruta_modelo):
+    with open(ruta_modelo, "rb") as f:
+        crudo = f.read()
+    modelo = json.loads(crudo.decode("utf-8"))
+    if modelo.get("tipo") != "logistica":
+        raise ValueError("tipo de modelo no soportado: %s" % modelo.get("tipo"))
+    t = cuantizar(modelo)
+    n = len(t["rasgo"])
+    c = len(t["peso"])
+
+    lineas = [
+        "// Generado por tools/stage_model_tables.py desde %s; no editar" % os.path.basename(ruta_modelo),
+        "#pragma once",
+        "",
+        "#include \"stage_classifier.h\"",
+        "",
+        "namespace stage_model {",
+        "",
+        "constexpr uint32_t ID = 0x%08X;" % (zlib.crc32(crudo) & 0xFFFFFFFF),
+        "constexpr uint8_t ENTRADAS = %d;" % n,
+        "constexpr uint8_t CLASES = %d;" % c,
+        "",
+        "constexpr StageInput RASGO[ENTRADAS] = {",
+    ]
+    lineas += ["    %s," % r for r in t["rasgo"]]
+    lineas += [
+        "};",
+        "constexpr int8_t EXP[ENTRADAS] = %s;" % lista(t["exp"]),
+        "constexpr int32_t CENTRO[ENTRADAS] = %s;" % lista(t["centro"]),
+        "constexpr int32_t MULT[ENTRADAS] = %s;" % lista(t["mult"]),
+        "",
+        "// SleepStage de cada fila",
+        "constexpr uint8_t CLASE[CLASES] = %s;" % lista(modelo["clases"]),
+        "constexpr int16_t PESO[CLASES][ENTRADAS] = {",
+    ]
+    lineas += ["    %s," % lista(fila) for fila in t["peso"]]
+    lineas += [
+        "};",
+        "constexpr int32_t SESGO[CLASES] = %s;" % lista(t["sesgo"]),
+        "",
+        "}  // namespace stage_model",
+        "",
+    ]
+    return "\n".join(lineas)
+
+
+def escribir(texto, directorio):
+    """Escribe el encabezado sólo si cambió (no fuerza recompilar)"""
+    os.makedirs(directorio, exist_ok=True)
+    ruta = os.path.join(directorio, ENCABEZADO)
+    if os.path.isfile(ruta):
+        with open(ruta, encoding="utf-8") as f:
+            if f.read() == texto:
+                return ruta
+    with open(ruta, "w", encoding="utf-8") as f:
+        f.write(texto)
+    return ruta
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Genera las tablas constexpr del clasificador")
+    parser.add_argument("modelo", nargs="?", default=RUTA_POR_DEFECTO)
+    parser.add_argument("-o", "--salida", default=".", help="directorio del encabezado")
+    args = parser.parse_args()
+    print("stage_model_tables: %s" % escribir(generar(args.modelo), args.salida))
+
+
+if env is not None:
+    config = env.GetProjectConfig()
+    nombre_env = env.subst("$PIOENV")
+    ruta = config.get("env:" + nombre_env, "custom_stage_model", RUTA_POR_DEFECTO)
+    ruta = os.path.join(env.subst("$PROJECT_DIR"), ruta)
+    if os.path.isfile(ruta):
+        directorio = os.path.join(env.subst("$BUILD_DIR"), "generado")
+        escribir(generar(ruta), directorio)
+        env.Append(CPPPATH=[directorio])
+        print("stage_model_tables: modelo %s" % ruta)
+    else:
+        print("stage_model_tables: no se encontró %s, la etapa sale de las reglas" % ruta)
+elif __name__ == "__main__":
+    main()
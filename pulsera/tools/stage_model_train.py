@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+"""
+Entrenamiento del clasificador de sueño de la pulsera
+=====================================================
+Ajusta una regresión logística multinomial sobre el vector de características
+por época (sensores/sueno/rasgos, ver tools/epoch_features.py) contra un
+hipnograma de referencia, y guarda el modelo en JSON. Al compilar,
+tools/stage_model_tables.py lo convierte en tablas de punto fijo para
+src/stage_classifier.cpp.
+
+Cada par es un registro MQTT (--mqtt-log de la simulación o capturado del
+broker) y su hipnograma en CSV epoch_ms,etapa[,en_cama] (--hipnograma de la
+simulación, o la puntuación de una polisomnografía en el mismo formato). La
+etapa verdadera de una época es la más frecuente en [inicio, inicio + 30 s).
+
+    python3 tools/stage_model_train.py \\
+        --par noche1.jsonl hipno1.csv --par noche2.jsonl hipno2.csv \\
+        --validacion 1 --salida model/stage_model.json
+
+Sin numpy (descenso por gradiente en Python puro): alcanza para unas decenas
+de miles de épocas.
+"""
+
+import argparse
+import bisect
+import collections
+import csv
+import json
+import math
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from epoch_features import decodificar, desde_log  # noqa: E402
+
+EPOCA_MS = 30000
+# Mismos valores que SleepStage (bed_config.py)
+ETAPAS = {0: "WAKE", 1: "LIGHT", 2: "REM", 3: "DEEP"}
+RASGOS_POR_DEFECTO = ("hr_mean", "hr_std", "rmssd", "sdnn", "pnn50", "lf_hf", "activity",
+                      "resp_rate", "movements", "posture_changes", "temp_slope", "in_bed")
+Z_MAX = 4.0  # igual que la saturación del firmware
+
+
+def cargar_hipnograma(ruta):
+    """CSV -> (tiempos ordenados, etapas)"""
+    with open(ruta) as f:
+        filas = sorted((int(r["epoch_ms"]), int(r["etapa"])) for r in csv.DictReader(f))
+    return [t for t, _ in filas], [e for _, e in filas]
+
+
+def etapa_verdadera(hipnograma, inicio_ms):
+    """Etapa más frecuente dentro de la época, o None si no hay referencia"""
+    tiempos, etapas = hipnograma
+    desde = bisect.bisect_left(tiempos, inicio_ms)
+    hasta = bisect.bisect_left(tiempos, inicio_ms + EPOCA_MS)
+    if desde == hasta:
+        return None
+    return collections.Counter(etapas[desde:hasta]).most_common(1)[0][0]
+
+
+def valor(rasgos, nombre):
+    if nombre == "in_bed":
+        return 1.0 if rasgos["flags"]["in_bed"] else 0.0
+    v = rasgos[nombre]
+    return None if v is None else float(v)
+
+
+def cargar_par(ruta_log, ruta_hipnograma):
+    """Épocas con reloj sincronizado y etapa de referencia"""
+    hipnograma = cargar_hipnograma(ruta_hipnograma)
+    epocas = []
+    for datos in desde_log(ruta_log):
+        try:
+            r = decodificar(datos)
+        except ValueError:
+            continue
+        if not r["start_epoch_ms"]:
+            continue
+        r["verdad"] = etapa_verdadera(hipnograma, r["start_epoch_ms"])
+        if r["verdad"] is not None:
+            epocas.append(r)
+    return epocas
+
+
+class Modelo:
+    def __init__(self, nombres, centros, escalas, pesos, sesgos, clases):
+        self.nombres = nombres
+        self.centros = centros
+        self.escalas = escalas
+        self.pesos = pesos
+        self.sesgos = sesgos
+        self.clases = clases
+
+    def normalizar(self, r):
+        z = []
+        for nombre, c, s in zip(self.nombres, self.centros, self.escalas):
+            v = valor(r, nombre)
+            z.append(0.0 if v is None else max(-Z_MAX, min(Z_MAX, (v - c) / s)))
+        return z
+
+    def logits(self, z):
+        return [b + sum(w * x for w, x in zip(fila, z)) for fila, b in zip(self.pesos, self.sesgos)]
+
+    def predecir(self, r):
+        lg = self.logits(self.normalizar(r))
+        return self.clases[max(range(len(lg)), key=lambda k: lg[k])]
+
+    def a_json(self, extra):
+        return dict({
+            "tipo": "logistica",
+            "clases": self.clases,
+            "nombres_clases": [ETAPAS[c] for c in self.clases],
+            "rasgos": [{"nombre": n, "centro": round(c, 6), "escala": round(s, 6)}
+                       for n, c, s in zip(self.nombres, self.centros, self.escalas)],
+            "pesos": [[round(w, 6) for w in fila] for fila in self.pesos],
+            "sesgos": [round(b, 6) for b in self.sesgos],
+        }, **extra)
+
+
+def entrenar(epocas, nombres, iteraciones, paso, l2):
+    # Centro y escala por entrada (media y desvío de los valores presentes)
+    centros, escalas = [], []
+    for nombre in nombres:
+        vs = [v for v in (valor(r, nombre) for r in epocas) if v is not None]
+        media = sum(vs) / len(vs) if vs else 0.0
+        desvio = math.sqrt(sum((v - media) ** 2 for v in vs) / len(vs)) if vs else 0.0
+        centros.append(media)
+        escalas.append(desvio if desvio > 1e-6 else 1.0)
+
+    clases = sorted(ETAPAS)
+    k = len(clases)
+    modelo = Modelo(nombres, centros, escalas, [[0.0] * len(nombres) for _ in clases],
+                    [0.0] * k, clases)
+    xs = [modelo.normalizar(r) for r in epocas]
+    ys = [clases.index(r["verdad"]) for r in epocas]
+
+    # Clases balanceadas: la vigilia en cama es rara y es la que más importa
+    cuenta = collections.Counter(ys)
+    peso_clase = {c: len(ys) / (k * n) for c, n in cuenta.items()}
+    total = sum(peso_clase[y] for y in ys)
+
+    for _ in range(iteraciones):
+        g_pesos = [[0.0] * len(nombres) for _ in clases]
+        g_sesgos = [0.0] * k
+        for z, y in zip(xs, ys):
+            lg = modelo.logits(z)
+            m = max(lg)
+            p = [math.exp(v - m) for v in lg]
+            s = sum(p)
+            w = peso_clase[y]
+            for c in range(k):
+                g = w * (p[c] / s - (1.0 if c == y else 0.0))
+                g_sesgos[c] += g
+                fila = g_pesos[c]
+                for j, x in enumerate(z):
+                    fila[j] += g * x
+        for c in range(k):
+            modelo.sesgos[c] -= paso * g_sesgos[c] / total
+            for j in range(len(nombres)):
+                modelo.pesos[c][j] -= paso * (g_pesos[c][j] / total + l2 * modelo.pesos[c][j])
+    return modelo
+
+
+def exactitud(epocas, etapa):
+    return sum(etapa(r) == r["verdad"] for r in epocas) / len(epocas) if epocas else 0.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Entrena el clasificador de sueño de la pulsera")
+    parser.add_argument("--par", nargs=2, action="append", required=True,
+                        metavar=("LOG", "HIPNOGRAMA"), help="registro MQTT y su hipnograma")
+    parser.add_argument("--validacion", type=int, default=0,
+                        help="últimos N pares que no se usan para entrenar")
+    parser.add_argument("--rasgos", default=",".join(RASGOS_POR_DEFECTO))
+    parser.add_argument("--iteraciones", type=int, default=300)
+    parser.add_argument("--paso", type=float, default=0.5)
+    parser.add_argument("--l2", type=float, default=1e-3)
+    parser.add_argument("--salida", default=os.path.join("model", "stage_model.json"))
+    args = parser.parse_args()
+
+    if args.validacion >= len(args.par):
+        sys.exit("--validacion tiene que dejar al menos un par para entrenar")
+    pares = args.par[:len(args.par) - args.validacion]
+    validacion = args.par[len(pares):]
+    entrenamiento = [r for log, hip in pares for r in cargar_par(log, hip)]
+    prueba = [r for log, hip in validacion for r in cargar_par(log, hip)]
+    if not entrenamiento:
+        sys.exit("No hay épocas con referencia para entrenar")
+
+    nombres = [n.strip() for n in args.rasgos.split(",") if n.strip()]
+    print("Entrenando con %d épocas (%s)" % (
+        len(entrenamiento),
+        ", ".join("%s %d" % (ETAPAS[e], n) for e, n in
+                  sorted(collections.Counter(r["verdad"] for r in entrenamiento).items()))))
+    modelo = entrenar(entrenamiento, nombres, args.iteraciones, args.paso, args.l2)
+
+    resultados = {}
+    for nombre, epocas in (("entrenamiento", entrenamiento), ("validacion", prueba)):
+        if not epocas:
+            continue
+        resultados[nombre] = {
+            "epocas": len(epocas),
+            "modelo": round(exactitud(epocas, modelo.predecir), 4),
+            "reglas": round(exactitud(epocas, lambda r: r["stage"]), 4),
+        }
+        print("%-14s %5d épocas | modelo %.1f%% | reglas %.1f%%" % (
+            nombre, len(epocas), 100 * resultados[nombre]["modelo"],
+            100 * resultados[nombre]["reglas"]))
+
+    extra = {
+        "entrenamiento": {
+            "pares": [os.path.basename(log) for log, _ in pares],
+            "iteraciones": args.iteraciones,
+            "l2": args.l2,
+            "exactitud": resultados,
+        },
+    }
+    os.makedirs(os.path.dirname(args.salida) or ".", exist_ok=True)
+    with open(args.salida, "w") as f:
+        json.dump(modelo.a_json(extra), f, indent=2)
+        f.write("\n")
+    print("Modelo guardado en %s" % args.salida)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,343 @@
+#!/usr/bin/env python3
+"""
+Tramas binarias de telemetría
+=============================
+Decodifica las tramas de include/telemetry_frame.h y compara los transportes
+por los que salen: MQTT (sensores/trama), ESP-NOW directo al receptor de la
+cama y notificaciones BLE (varias tramas seguidas por notificación). Cada
+trama lleva un seq único, así que la misma trama se puede seguir en todos los
+caminos: entrega, duplicados y latencia desde la muestra
+(recv_epoch_ms - sample_epoch_ms).
+
+    python3 tools/telemetry_frames.py --log noche.jsonl --espnow-log espnow.jsonl \
+        --ble-log ble.jsonl
+    python3 tools/telemetry_frames.py --serial /dev/ttyACM0
+    python3 tools/telemetry_frames.py --broker 172.22.39.27
+
+--serial lee las líneas "T <hex>" del receptor (receptor/receptor.cpp) y
+muestra cada trama; --broker hace lo mismo con sensores/trama. Con --log se
+agregan también las estadísticas de sistema/enlace que publica la pulsera
+(tiempo de llamada, envío -> ACK o aire estimado y energía por trama), la
+capacidad de BLE con el MTU y el intervalo negociados y una estimación de
+potencia media por transporte: energía por trama × tramas/s más el costo de
+fondo de tener la radio lista (--fondo-wifi-mw, --fondo-ble-mw; valores
+típicos del ESP32-C3, no medidos).
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+import topicos
+
+TOPICO = "sensores/trama"
+MAGIA = 0xB1
+VERSION = 1
+
+CABECERA = struct.Struct("<BBBBIQ")
+TIPOS = {
+    1: ("vitales", struct.Struct("<HHBB"), ("hr_x10", "spo2_x10", "dedo", "etapa")),
+    2: ("ambiente", struct.Struct("<hH"), ("temp_x100", "humedad_x100")),
+    3: ("presencia", struct.Struct("<BBBB"), ("ocupada", "confianza", "indicadores", "reservado")),
+    4: ("epoca", struct.Struct("<IBBHHH"),
+        ("indice", "etapa", "etapa_reglas", "hr_x10", "rmssd_x10", "actividad_x1000")),
+}
+ETAPAS = {0: "WAKE", 1: "LIGHT", 2: "REM", 3: "DEEP", 0xFF: "-"}  # bed_config.py
+
+
+def crc16(datos):
+    crc = 0xFFFF
+    for b in datos:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def decodificar(datos):
+    """bytes -> dict con la cabecera y los campos; ValueError si no es válida"""
+    if len(datos) < CABECERA.size + 2:
+        raise ValueError("trama de %d bytes" % len(datos))
+    magia, version, tipo, largo, seq, epoch_ms = CABECERA.unpack_from(datos)
+    if magia != MAGIA:
+        raise ValueError("magia %02x" % magia)
+    if version != VERSION:
+        raise ValueError("versión %d no soportada" % version)
+    if CABECERA.size + largo + 2 != len(datos):
+        raise ValueError("largo %d en una trama de %d bytes" % (largo, len(datos)))
+    n = CABECERA.size + largo
+    if crc16(datos[:n]) != datos[n] | datos[n + 1] << 8:
+        raise ValueError("CRC")
+    trama = {"seq": seq, "tipo": tipo, "epoch_ms": epoch_ms or None, "bytes": len(datos)}
+    if tipo in TIPOS:
+        nombre, formato, campos = TIPOS[tipo]
+        trama["tipo"] = nombre
+        if largo >= formato.size:
+            trama.update(zip(campos, formato.unpack_from(datos, CABECERA.size)))
+    return trama
+
+
+def describir(t):
+    if t["tipo"] == "vitales":
+        datos = "HR %.1f SpO2 %.1f dedo %d etapa %s" % (
+            t["hr_x10"] / 10, t["spo2_x10"] / 10, t["dedo"], ETAPAS.get(t["etapa"], t["etapa"]))
+    elif t["tipo"] == "ambiente":
+        datos = "%.2f °C %.2f %%RH" % (t["temp_x100"] / 100, t["humedad_x100"] / 100)
+    elif t["tipo"] == "presencia":
+        datos = "ocupada %d confianza %d%%" % (t["ocupada"], t["confianza"])
+    elif t["tipo"] == "epoca":
+        datos = "época %d %s (reglas %s) HR %.1f" % (
+            t["indice"], ETAPAS.get(t["etapa"], t["etapa"]),
+            ETAPAS.get(t["etapa_reglas"], t["etapa_reglas"]), t["hr_x10"] / 10)
+    else:
+        datos = "tipo %s" % t["tipo"]
+    return "#%d %-9s %s" % (t["seq"], t["tipo"], datos)
+
+
+def leer_log(ruta, topico=None, dispositivo=None):
+    """Líneas JSON de --mqtt-log o --espnow-log -> [(recv_epoch_ms, bytes)]"""
+    recibidas = []
+    with open(ruta) as f:
+        for linea in f:
+            try:
+                msg = json.loads(linea)
+            except ValueError:
+                continue
+            if topico and not topicos.coincide(msg.get("topic", ""), topico, dispositivo):
+                continue
+            if "payload_hex" in msg:
+                recibidas.append((msg["recv_epoch_ms"], bytes.fromhex(msg["payload_hex"])))
+    return recibidas
+
+
+def ultimo_enlace(ruta, dispositivo=None):
+    enlace = None
+    with open(ruta) as f:
+        for linea in f:
+            if 'sistema/enlace"' not in linea:
+                continue
+            try:
+                msg = json.loads(linea)
+                if topicos.coincide(msg["topic"], "sistema/enlace", dispositivo):
+                    enlace = json.loads(msg["payload"])
+            except (ValueError, KeyError):
+                pass
+    return enlace
+
+
+def percentil(valores, p):
+    if not valores:
+        return float("nan")
+    valores = sorted(valores)
+    return valores[min(len(valores) - 1, int(p / 100.0 * len(valores)))]
+
+
+def separar(datos):
+    """Una notificación BLE puede traer varias tramas seguidas"""
+    i = 0
+    while i < len(datos):
+        if len(datos) - i < CABECERA.size + 2:
+            yield datos[i:]
+            return
+        n = CABECERA.size + datos[i + 3] + 2
+        yield datos[i:i + n]
+        i += n
+
+
+def analizar(nombre, recibidas):
+    """Primera copia de cada seq, duplicados y latencia desde la muestra"""
+    por_seq = {}
+    invalidas = 0
+    duplicadas = 0
+    mensajes = 0
+    for recv_ms, datos in recibidas:
+        mensajes += 1
+        for parte in separar(datos):
+            try:
+                t = decodificar(parte)
+            except (ValueError, IndexError):
+                invalidas += 1
+                continue
+            if t["seq"] in por_seq:
+                duplicadas += 1
+                continue
+            t["recv_ms"] = recv_ms
+            por_seq[t["seq"]] = t
+    return {"nombre": nombre, "tramas": por_seq, "invalidas": invalidas, "duplicadas": duplicadas,
+            "mensajes": mensajes}
+
+
+def latencias(tramas, seqs):
+    # Las épocas llevan el inicio de la época, no el instante de la muestra
+    return [tramas[s]["recv_ms"] - tramas[s]["epoch_ms"] for s in seqs
+            if s in tramas and tramas[s]["epoch_ms"] and tramas[s]["tipo"] != "epoca"]
+
+
+def comparar(caminos, enlace, args):
+    todas = set()
+    for c in caminos:
+        todas |= set(c["tramas"])
+    if not todas:
+        print("Sin tramas")
+        return
+    emitidas = max(todas)
+    if enlace:
+        emitidas = max(emitidas, enlace.get("seq", 0))
+    comunes = set.intersection(*[set(c["tramas"]) for c in caminos]) if len(caminos) > 1 else todas
+
+    print("%d tramas emitidas (seq 1..%d)\n" % (emitidas, emitidas))
+    print("%-8s %9s %8s %9s %6s %6s %10s %10s %10s %10s" % (
+        "camino", "recibidas", "entrega", "mensajes", "dupl", "inval", "lat p50", "lat p95",
+        "lat max", "comunes p50"))
+    for c in caminos:
+        lat = latencias(c["tramas"], c["tramas"])
+        lat_comunes = latencias(c["tramas"], comunes)
+        print("%-8s %9d %7.2f%% %9d %6d %6d %8.1fms %8.1fms %8.1fms %9.1fms" % (
+            c["nombre"], len(c["tramas"]), 100.0 * len(c["tramas"]) / emitidas, c["mensajes"],
+            c["duplicadas"], c["invalidas"], percentil(lat, 50), percentil(lat, 95),
+            max(lat) if lat else float("nan"), percentil(lat_comunes, 50)))
+
+    if len(caminos) > 1:
+        for c in caminos:
+            solo = set(c["tramas"]) - set.union(*[set(o["tramas"]) for o in caminos if o is not c])
+            if solo:
+                print("Sólo por %s: %d tramas (p. ej. durante cortes del otro camino)" % (c["nombre"], len(solo)))
+
+    if enlace:
+        print("\nCosto en la pulsera (sistema/enlace, energía estimada con la potencia de TX):")
+        print("%-8s %9s %9s %11s %11s %13s" % ("camino", "enviadas", "fallidas", "llamada", "hasta ACK",
+                                               "energía/trama"))
+        for nombre in ("mqtt", "espnow", "ble"):
+            e = enlace.get(nombre)
+            if not e:
+                continue
+            if e["confirmadas"]:
+                radio = "%dµs" % e["confirmacion_us"]
+            elif e.get("aire_us"):
+                radio = "~%dµs" % e["aire_us"]
+            else:
+                radio = "-"
+            print("%-8s %9d %9d %9dµs %9s %11.1fµJ" % (
+                nombre, e["enviadas"], e["fallidas"] + e.get("perdidas", 0), e["llamada_us"],
+                radio, e["energia_uj"]))
+        print("(MQTT: sólo el tiempo dentro de publish(); no incluye el ACK de TCP ni mantener la\n"
+              " asociación con el AP, que ESP-NOW no necesita para transmitir. BLE: aire estimado\n"
+              " de la notificación y del vacío del central en PHY 1M)")
+
+        duracion_s = None
+        tiempos = [t["recv_ms"] for c in caminos for t in c["tramas"].values()]
+        if len(tiempos) > 1:
+            duracion_s = (max(tiempos) - min(tiempos)) / 1000.0
+        if duracion_s:
+            print("\nPotencia media estimada (%.2f tramas/s):" % (emitidas / duracion_s))
+            fondos = {"mqtt": args.fondo_wifi_mw, "espnow": args.fondo_wifi_mw, "ble": args.fondo_ble_mw}
+            for nombre in ("mqtt", "espnow", "ble"):
+                e = enlace.get(nombre)
+                if not e:
+                    continue
+                envio_mw = e["energia_uj"] * e["enviadas"] / duracion_s / 1000.0
+                print("  %-7s %7.2f mW de envío + %5.1f mW de fondo" % (nombre, envio_mw, fondos[nombre]))
+
+        if enlace.get("ble_mtu"):
+            mtu, intervalo = enlace["ble_mtu"], enlace["ble_intervalo_ms"]
+            if intervalo:
+                capacidad = args.paquetes_por_evento * (mtu - 3) * 8 / intervalo
+                print("\nBLE: MTU %d, intervalo %.2f ms -> capacidad ~%.0f kbit/s (%d notificaciones "
+                      "por evento); carga actual %.2f kbit/s" % (
+                          mtu, intervalo, capacidad, args.paquetes_por_evento,
+                          e_bits(enlace["ble"], duracion_s)))
+
+
+def e_bits(e, duracion_s):
+    return e["bytes"] * 8 / duracion_s / 1000.0 if duracion_s else 0.0
+
+
+def desde_serie(args):
+    try:
+        import serial
+    except ImportError:
+        sys.exit("Falta pyserial: pip install pyserial")
+    puerto = serial.Serial(args.serial, args.baudios, timeout=1)
+    print("Escuchando %s ... (Ctrl+C para terminar)" % args.serial)
+    try:
+        while True:
+            linea = puerto.readline().decode("ascii", "replace").strip()
+            if linea.startswith("T "):
+                try:
+                    print(describir(decodificar(bytes.fromhex(linea[2:]))))
+                except ValueError as e:
+                    print("Descartada: %s" % e)
+            elif linea:
+                print(linea)
+    except KeyboardInterrupt:
+        pass
+
+
+def desde_broker(args):
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit("Falta paho-mqtt: pip install paho-mqtt")
+
+    def al_recibir(c, u, msg):
+        try:
+            print(describir(decodificar(msg.payload)))
+        except ValueError as e:
+            print("Descartada: %s" % e)
+
+    cliente = mqtt.Client()
+    if args.usuario:
+        cliente.username_pw_set(args.usuario, args.password)
+    cliente.on_message = al_recibir
+    cliente.connect(args.broker, args.puerto)
+    topico = topicos.completo(TOPICO, args.dispositivo)
+    cliente.subscribe(topico)
+    print("Escuchando %s en %s:%d ... (Ctrl+C para terminar)" % (topico, args.broker, args.puerto))
+    try:
+        cliente.loop_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Tramas de telemetría por MQTT, ESP-NOW y BLE")
+    origen = parser.add_mutually_exclusive_group(required=True)
+    origen.add_argument("--log", help="registro JSON de la simulación (--mqtt-log)")
+    origen.add_argument("--serial", help="puerto serie del receptor ESP-NOW")
+    origen.add_argument("--broker", help="broker MQTT a escuchar")
+    parser.add_argument("--espnow-log", help="registro del receptor ESP-NOW (--espnow-log)")
+    parser.add_argument("--ble-log", help="registro del central BLE (--ble-log)")
+    parser.add_argument("--fondo-wifi-mw", type=float, default=66.0,
+                        help="estación asociada en modem sleep (~20 mA a 3,3 V)")
+    parser.add_argument("--fondo-ble-mw", type=float, default=3.3,
+                        help="conexión BLE a ~30 ms sin datos (~1 mA a 3,3 V)")
+    parser.add_argument("--paquetes-por-evento", type=int, default=6)
+    parser.add_argument("--baudios", type=int, default=115200)
+    parser.add_argument("--puerto", type=int, default=1883)
+    parser.add_argument("--usuario")
+    parser.add_argument("--password")
+    topicos.agregar_argumento(parser)
+    parser.add_argument("--mostrar", type=int, default=0, help="imprime las primeras N tramas")
+    args = parser.parse_args()
+
+    if args.serial:
+        desde_serie(args)
+        return
+    if args.broker:
+        desde_broker(args)
+        return
+
+    caminos = [analizar("mqtt", leer_log(args.log, TOPICO, args.dispositivo))]
+    if args.espnow_log:
+        caminos.append(analizar("espnow", leer_log(args.espnow_log)))
+    if args.ble_log:
+        caminos.append(analizar("ble", leer_log(args.ble_log)))
+    for t in sorted(caminos[0]["tramas"].values(), key=lambda t: t["seq"])[:args.mostrar]:
+        print(describir(t))
+    comparar(caminos, ultimo_enlace(args.log, args.dispositivo), args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,31 @@
+"""
+Tópicos MQTT por pulsera: oib/<id>/<sufijo> (ver include/device_identity.h)
+
+Las herramientas filtran por sufijo ("sensores/trama") y, con --dispositivo,
+por pulsera; sin --dispositivo se suscriben a oib/+/<sufijo> y aceptan todas.
+Para publicar un pedido hace falta el id (MQTT no admite comodines al publicar).
+"""
+
+RAIZ = "oib"
+
+
+def completo(sufijo, dispositivo=None):
+    return "%s/%s/%s" % (RAIZ, dispositivo or "+", sufijo)
+
+
+def separar(topico):
+    """"oib/<id>/<sufijo>" -> (id, sufijo); (None, topico) si no tiene prefijo"""
+    partes = topico.split("/", 2)
+    if len(partes) == 3 and partes[0] == RAIZ:
+        return partes[1], partes[2]
+    return None, topico
+
+
+def coincide(topico, sufijo, dispositivo=None):
+    d, s = separar(topico)
+    return s == sufijo and (dispositivo is None or d == dispositivo)
+
+
+def agregar_argumento(parser):
+    parser.add_argument("--dispositivo",
+                        help="id de la pulsera (oib/<id>/...; por defecto todas)")